@@ -5,6 +5,8 @@
  */
 
 #include "../Common/common.hpp"
+#include "../Common/probes.hpp"
+#include "../Common/arena.hpp"
 #include "BancorConverter.hpp"
 
 struct account {
@@ -19,8 +21,21 @@ TABLE currency_stats {
     uint64_t primary_key() const { return supply.symbol.code().raw(); }
 };
 
+// the network's registered routes, see BancorNetwork::setroute
+struct route_hop {
+    name        converter;
+    symbol_code to;
+};
+
+struct route {
+    uint64_t          id;
+    vector<route_hop> hops;
+    uint64_t primary_key() const { return id; }
+};
+
 typedef eosio::multi_index<"stat"_n, currency_stats> stats;
 typedef eosio::multi_index<"accounts"_n, account> accounts;
+typedef eosio::multi_index<"routes"_n, route> routes;
 
 ACTION BancorConverter::init(name smart_contract, asset smart_currency, bool smart_enabled, bool enabled, name network, bool require_balance, uint64_t max_fee, uint64_t fee) {
     require_auth(get_self());
@@ -43,6 +58,8 @@ ACTION BancorConverter::init(name smart_contract, asset smart_currency, bool sma
         s.require_balance = require_balance;
         s.max_fee         = max_fee;
         s.fee             = fee;
+        s.total_ratio.emplace(0);
+        s.batch_window.emplace(0);
     });
 }
 
@@ -53,7 +70,6 @@ ACTION BancorConverter::update(bool smart_enabled, bool enabled, bool require_ba
     const auto& st = settings_table.get("settings"_n.value, "settings do not exist");
     
     check(fee <= st.max_fee, "fee must be lower or equal to the maximum fee");
-    uint64_t prevFee = st.fee;
 
     settings_table.modify(st, get_self(), [&](auto& s) {
         s.smart_enabled   = smart_enabled;		
@@ -63,6 +79,91 @@ ACTION BancorConverter::update(bool smart_enabled, bool enabled, bool require_ba
     });
 }
 
+ACTION BancorConverter::setbatch(uint64_t batch_window) {
+    require_auth(get_self());
+    check(batch_window <= 3600, "batch window must be at most 3600 seconds");
+
+    settings settings_table(get_self(), get_self().value);
+    const auto& st = settings_table.get("settings"_n.value, "settings do not exist");
+    auto upgraded = upgrade_settings(st);
+
+    settings_table.modify(st, same_payer, [&](auto& s) {
+        s = upgraded;
+        s.batch_window.emplace(batch_window);
+    });
+}
+
+ACTION BancorConverter::settle(uint32_t max_orders) {
+    check(max_orders > 0, "max_orders must be positive");
+
+    settings settings_table(get_self(), get_self().value);
+    const auto& converter_settings = settings_table.get("settings"_n.value, "settings do not exist");
+    check(converter_settings.enabled, "converter is disabled");
+
+    uint32_t now = current_time_point().sec_since_epoch();
+    orders orders_table(get_self(), get_self().value);
+    auto by_settle = orders_table.get_index<"bysettle"_n>();
+
+    // due orders grouped by reserve pair, lower symbol code first
+    map<pair<uint64_t, uint64_t>, vector<order_t>> batches;
+    uint32_t count = 0;
+    for (auto itr = by_settle.begin(); itr != by_settle.end() && itr->settle_after.sec_since_epoch() <= now && count < max_orders; count++) {
+        uint64_t from = itr->quantity.symbol.code().raw();
+        uint64_t to = itr->min_return.symbol.code().raw();
+        batches[{ min(from, to), max(from, to) }].push_back(*itr);
+        itr = by_settle.erase(itr);
+    }
+    check(!batches.empty(), "no orders to settle");
+
+    for (const auto& batch : batches)
+        settle_batch(symbol_code(batch.first.first), symbol_code(batch.first.second), batch.second, converter_settings);
+}
+
+ACTION BancorConverter::cancel(name owner, uint64_t id) {
+    require_auth(owner);
+
+    orders orders_table(get_self(), get_self().value);
+    const auto& o = orders_table.get(id, "order not found");
+    check(o.owner == owner, "not the order's owner");
+
+    // the input leaves the pending offset with its refund transfer, as in settle_batch
+    reserves reserves_table(get_self(), get_self().value);
+    const auto& rsrv = reserves_table.get(o.quantity.symbol.code().raw(), "reserve not found");
+    reserves_table.modify(rsrv, same_payer, [&](auto& r) {
+        r.currency.amount += o.quantity.amount;
+    });
+
+    action(
+        permission_level{ get_self(), "active"_n },
+        rsrv.contract, "transfer"_n,
+        std::make_tuple(get_self(), owner, o.quantity, string("order cancelled"))
+    ).send();
+
+    orders_table.erase(o);
+}
+
+BancorConverter::price_observation BancorConverter::observe(symbol_code base, symbol_code quote) {
+    check(base != quote, "base and quote must differ");
+
+    reserves reserves_table(get_self(), get_self().value);
+    reserve_t sides[2] = { reserves_table.get(base.raw(), "reserve not found"), reserves_table.get(quote.raw(), "reserve not found") };
+
+    double weighted[2];
+    for (int s = 0; s < 2; s++) {
+        double balance = (get_balance_amount(sides[s].contract, get_self(), sides[s].currency.symbol.code()) + sides[s].currency.amount) / power10(sides[s].currency.symbol.precision());
+        check(balance > 0, "reserve is empty");
+        check(sides[s].price_timestamp.has_value(), "no price history yet, it starts with the next conversion");
+        accrue_price(sides[s], balance);
+        weighted[s] = balance / sides[s].ratio;
+    }
+
+    price_observation observation;
+    observation.timestamp        = sides[0].price_timestamp.value();
+    observation.price            = weighted[1] / weighted[0];
+    observation.price_cumulative = sides[1].price_cumulative.value() - sides[0].price_cumulative.value();
+    return observation;
+}
+
 ACTION BancorConverter::setreserve(name contract, symbol currency, uint64_t ratio, bool sale_enabled) {
     require_auth(get_self());
     check(currency.is_valid(), "invalid symbol");
@@ -70,31 +171,45 @@ ACTION BancorConverter::setreserve(name contract, symbol currency, uint64_t rati
     check(ratio > 0 && ratio <= RATIO_DENOMINATOR,
          ("ratio must be between 1 and " + std::to_string(RATIO_DENOMINATOR)).c_str());
 
+    settings settings_table(get_self(), get_self().value);
+    const auto& converter_settings = settings_table.get("settings"_n.value, "settings do not exist");
+
+    // the aggregate ratio is cached in settings so that adding a reserve costs the same for any pool size
+    auto upgraded = upgrade_settings(converter_settings);
+    uint64_t total_ratio = upgraded.total_ratio.value() + ratio;
+
     reserves reserves_table(get_self(), get_self().value);
     auto existing = reserves_table.find(currency.code().raw());
     if (existing != reserves_table.end()) {
         check(existing->contract == contract, "cannot update the reserve contract name");
+        total_ratio -= existing->ratio;
+        double balance = (get_balance_amount(contract, get_self(), currency.code()) + existing->currency.amount) / power10(currency.precision());
 
         reserves_table.modify(existing, get_self(), [&](auto& s) {
+            // the accumulated price used the old ratio up to now
+            accrue_price(s, balance);
             s.ratio = ratio;
             s.sale_enabled = sale_enabled;
         });
     }
-    else reserves_table.emplace(get_self(), [&](auto& s) {
-        s.contract  = contract;
-        s.currency  = asset(0, currency);
-        s.ratio     = ratio;
-        s.sale_enabled = sale_enabled;
-    });
-    uint64_t total_ratio = 0;
-    for (auto& reserve : reserves_table)
-        total_ratio += reserve.ratio;
-    
+    else {
+        reserves_table.emplace(get_self(), [&](auto& s) {
+            s.contract  = contract;
+            s.currency  = asset(0, currency);
+            s.ratio     = ratio;
+            s.sale_enabled = sale_enabled;
+            s.price_cumulative.emplace(0);
+            s.price_timestamp.emplace(time_point_sec(current_time_point()));
+        });
+    }
+
     check(total_ratio <= RATIO_DENOMINATOR, 
          ("ratio must be between 1 and " + std::to_string(RATIO_DENOMINATOR)).c_str());
 
-    settings settings_table(get_self(), get_self().value);
-    const auto& converter_settings = settings_table.get("settings"_n.value, "settings do not exist");
+    settings_table.modify(converter_settings, same_payer, [&](auto& s) {
+        s = upgraded;
+        s.total_ratio.emplace(total_ratio);
+    });
 }
 
 ACTION BancorConverter::delreserve(symbol_code currency) {
@@ -107,31 +222,353 @@ ACTION BancorConverter::delreserve(symbol_code currency) {
     asset balance = get_balance(rsrv.contract, get_self(), currency);
     check(!balance.amount, "may delete only empty reserves");
 
+    settings settings_table(get_self(), get_self().value);
+    const auto& converter_settings = settings_table.get("settings"_n.value, "settings do not exist");
+    auto upgraded = upgrade_settings(converter_settings);
+    settings_table.modify(converter_settings, same_payer, [&](auto& s) {
+        s = upgraded;
+        s.total_ratio.emplace(upgraded.total_ratio.value() - rsrv.ratio);
+    });
+
     reserves_table.erase(rsrv);
 }
 
+ACTION BancorConverter::fund(name sender, asset quantity) {
+    require_auth(sender);
+    check(quantity.is_valid() && quantity.amount > 0, "invalid quantity");
+
+    settings settings_table(get_self(), get_self().value);
+    const auto& converter_settings = settings_table.get("settings"_n.value, "settings do not exist");
+
+    check(converter_settings.enabled, "converter is disabled");
+    check(quantity.symbol == converter_settings.smart_currency.symbol, "quantity must be in the smart token");
+
+    int64_t supply = get_supply(converter_settings.smart_contract, quantity.symbol.code()).amount + converter_settings.smart_currency.amount;
+    check(supply > 0, "cannot fund a converter without smart token supply");
+
+    deposits deposits_table(get_self(), sender.value);
+    reserves reserves_table(get_self(), get_self().value);
+    for (auto rsrv = reserves_table.begin(); rsrv != reserves_table.end(); ++rsrv) {
+        auto sym = rsrv->currency.symbol;
+        int64_t balance = get_balance_amount(rsrv->contract, get_self(), sym.code()) + rsrv->currency.amount;
+
+        // rounded up, the provider pays for the precision lost on the smart token
+        int64_t amount = (static_cast<__int128>(balance) * quantity.amount + supply - 1) / supply;
+        if (amount > 0) {
+            auto dep = deposits_table.find(sym.code().raw());
+            check(dep != deposits_table.end() && dep->quantity.amount >= amount,
+                 ("insufficient deposit, " + asset(amount, sym).to_string() + " required").c_str());
+
+            if (dep->quantity.amount == amount)
+                deposits_table.erase(dep);
+            else
+                deposits_table.modify(dep, same_payer, [&](auto& d) {
+                    d.quantity.amount -= amount;
+                });
+        }
+
+        // the deposit already sits in the converter balance, cancelling its offset adds it to the reserve
+        reserves_table.modify(rsrv, same_payer, [&](auto& r) {
+            accrue_price(r, balance / power10(sym.precision()));
+            r.currency.amount += amount;
+        });
+    }
+    action(
+        permission_level{ get_self(), "active"_n },
+        converter_settings.smart_contract, "issue"_n,
+        std::make_tuple(get_self(), quantity, string("fund"))
+    ).send();
+
+    action(
+        permission_level{ get_self(), "active"_n },
+        converter_settings.smart_contract, "transfer"_n,
+        std::make_tuple(get_self(), sender, quantity, string("fund"))
+    ).send();
+}
+
+ACTION BancorConverter::withdraw(name sender, asset quantity) {
+    require_auth(sender);
+    check(quantity.is_valid() && quantity.amount > 0, "invalid quantity");
+
+    deposits deposits_table(get_self(), sender.value);
+    const auto& dep = deposits_table.get(quantity.symbol.code().raw(), "deposit not found");
+    check(dep.quantity.symbol == quantity.symbol, "symbol precision mismatch");
+    check(dep.quantity.amount >= quantity.amount, "insufficient deposit");
+
+    // the withdrawn deposit was never part of the reserve, the balance it moves out is offset by as much
+    reserves reserves_table(get_self(), get_self().value);
+    const auto& rsrv = reserves_table.get(quantity.symbol.code().raw(), "reserve not found");
+    double balance = (get_balance_amount(rsrv.contract, get_self(), quantity.symbol.code()) + rsrv.currency.amount) / power10(quantity.symbol.precision());
+    reserves_table.modify(rsrv, same_payer, [&](auto& r) {
+        accrue_price(r, balance);
+        r.currency.amount += quantity.amount;
+    });
+
+    if (dep.quantity.amount == quantity.amount)
+        deposits_table.erase(dep);
+    else
+        deposits_table.modify(dep, same_payer, [&](auto& d) {
+            d.quantity.amount -= quantity.amount;
+        });
+
+    action(
+        permission_level{ get_self(), "active"_n },
+        rsrv.contract, "transfer"_n,
+        std::make_tuple(get_self(), sender, quantity, string("withdraw"))
+    ).send();
+}
+
+// credits a "fund" transfer to the sender's deposits
+// the reserve offset is lowered by the same amount so the pending deposit does not move the price
+void BancorConverter::deposit(name from, eosio::asset quantity, name code) {
+    settings settings_table(get_self(), get_self().value);
+    const auto& converter_settings = settings_table.get("settings"_n.value, "settings do not exist");
+    check(converter_settings.enabled, "converter is disabled");
+
+    reserves reserves_table(get_self(), get_self().value);
+    const auto& rsrv = reserves_table.get(quantity.symbol.code().raw(), "reserve not found");
+    check(code == rsrv.contract, "unknown 'from' contract");
+    check(quantity.symbol == rsrv.currency.symbol, "symbol precision mismatch");
+
+    reserves_table.modify(rsrv, same_payer, [&](auto& r) {
+        r.currency.amount -= quantity.amount;
+    });
+
+    deposits deposits_table(get_self(), from.value);
+    auto dep = deposits_table.find(quantity.symbol.code().raw());
+    if (dep == deposits_table.end())
+        deposits_table.emplace(get_self(), [&](auto& d) {
+            d.quantity = quantity;
+        });
+    else
+        deposits_table.modify(dep, same_payer, [&](auto& d) {
+            d.quantity += quantity;
+        });
+}
+
+// retires smart tokens received with the "liquidate" memo and pays out every reserve in proportion;
+// conversion fees stay in the reserves, so each smart token earns its share of them with no per LP bookkeeping
+void BancorConverter::liquidate(name from, eosio::asset quantity, name code) {
+    settings settings_table(get_self(), get_self().value);
+    const auto& converter_settings = settings_table.get("settings"_n.value, "settings do not exist");
+
+    check(converter_settings.enabled, "converter is disabled");
+    check(code == converter_settings.smart_contract && quantity.symbol == converter_settings.smart_currency.symbol,
+         "only the smart token can be liquidated");
+
+    // the received tokens are still part of the supply until the retire below executes
+    int64_t supply = get_supply(converter_settings.smart_contract, quantity.symbol.code()).amount + converter_settings.smart_currency.amount;
+
+    action(
+        permission_level{ get_self(), "active"_n },
+        converter_settings.smart_contract, "retire"_n,
+        std::make_tuple(quantity, string("liquidate"))
+    ).send();
+
+    reserves reserves_table(get_self(), get_self().value);
+    for (auto rsrv = reserves_table.begin(); rsrv != reserves_table.end(); ++rsrv) {
+        int64_t balance = get_balance_amount(rsrv->contract, get_self(), rsrv->currency.symbol.code()) + rsrv->currency.amount;
+        int64_t amount = static_cast<__int128>(balance) * quantity.amount / supply;
+
+        // the price held until now is accrued before the payout lowers the balance
+        reserves_table.modify(rsrv, same_payer, [&](auto& r) {
+            accrue_price(r, balance / power10(r.currency.symbol.precision()));
+        });
+
+        if (amount > 0)
+            action(
+                permission_level{ get_self(), "active"_n },
+                rsrv->contract, "transfer"_n,
+                std::make_tuple(get_self(), from, asset(amount, rsrv->currency.symbol), string("liquidate"))
+            ).send();
+    }
+}
+
+// queues a final hop reserve to reserve conversion for the next settle
+// the input is kept out of the reserve until then, the same way as a pending deposit; the converter pays
+// for the order's row, dust orders are refused so that queueing them costs the sender a share of the reserve
+void BancorConverter::queue_order(name owner, eosio::asset quantity, const reserve_t& to_token, std::string_view min_return, std::string_view receiver_memo, const settings_t& settings) {
+    auto to_symbol = to_token.currency.symbol;
+    if (settings.require_balance)
+        verify_entry(owner, to_token.contract, asset(0, to_symbol));
+
+    reserves reserves_table(get_self(), get_self().value);
+    const auto& from_token = reserves_table.get(quantity.symbol.code().raw());
+    int64_t balance = get_balance_amount(from_token.contract, get_self(), quantity.symbol.code()) + from_token.currency.amount - quantity.amount;
+    check(quantity.amount >= balance / MIN_ORDER_DENOMINATOR,
+         ("batched orders must be at least " + asset(balance / MIN_ORDER_DENOMINATOR, quantity.symbol).to_string()).c_str());
+
+    reserves_table.modify(from_token, same_payer, [&](auto& r) {
+        r.currency.amount -= quantity.amount;
+    });
+
+    uint32_t now = current_time_point().sec_since_epoch();
+    orders orders_table(get_self(), get_self().value);
+    orders_table.emplace(get_self(), [&](auto& o) {
+        o.id            = orders_table.available_primary_key();
+        o.owner         = owner;
+        o.quantity      = quantity;
+        o.min_return    = asset(int64_t(stof(min_return) * power10(to_symbol.precision())), to_symbol);
+        o.receiver_memo = receiver_memo;
+        o.settle_after  = time_point_sec(uint32_t((now / settings.batch_window.value() + 1) * settings.batch_window.value()));
+    });
+}
+
+// settles the orders of one reserve pair; side 0 sells the first reserve, side 1 the second.
+// the opposing flows cross at the spot price and only the imbalance is converted on the curve, so the
+// curve is evaluated once per batch; orders below their min return are refunded and the batch re-priced
+void BancorConverter::settle_batch(symbol_code first, symbol_code second, const vector<order_t>& batch, const settings_t& settings) {
+    reserves reserves_table(get_self(), get_self().value);
+    const reserve_t* sides[2] = { &reserves_table.get(first.raw(), "reserve not found"), &reserves_table.get(second.raw(), "reserve not found") };
+
+    double scale[2], balance[2];
+    for (int s = 0; s < 2; s++) {
+        scale[s] = power10(sides[s]->currency.symbol.precision());
+        balance[s] = (get_balance_amount(sides[s]->contract, get_self(), sides[s]->currency.symbol.code()) + sides[s]->currency.amount) / scale[s];
+    }
+
+    // price of the first reserve in the second at the margin, as in calculate_cross_reserve_limit
+    double spot = (balance[1] / sides[1]->ratio) / (balance[0] / sides[0]->ratio);
+    double net = 1 - calculate_fee(1, settings.fee, 2);
+
+    auto side_of = [&](const order_t& o) { return o.quantity.symbol.code() == first ? 0 : 1; };
+
+    vector<bool> filled(batch.size(), true);
+    vector<int64_t> payout(batch.size(), 0);
+    double in[2], out[2];   // out[s] is paid to side s, in the other reserve
+    for (bool repriced = true; repriced; ) {
+        repriced = false;
+
+        in[0] = in[1] = 0;
+        for (size_t i = 0; i < batch.size(); i++)
+            if (filled[i])
+                in[side_of(batch[i])] += batch[i].quantity.amount / scale[side_of(batch[i])];
+
+        double matched = min(in[0], in[1] / spot);   // in the first reserve
+        out[0] = matched * spot;
+        out[1] = matched;
+        if (in[0] > matched)
+            out[0] += calculate_cross_reserve_return(balance[0], in[0] - matched, sides[0]->ratio, balance[1], sides[1]->ratio);
+        else if (in[1] > matched * spot)
+            out[1] += calculate_cross_reserve_return(balance[1], in[1] - matched * spot, sides[1]->ratio, balance[0], sides[0]->ratio);
+
+        for (size_t i = 0; i < batch.size(); i++) {
+            if (!filled[i]) continue;
+            int s = side_of(batch[i]);
+            double share = batch[i].quantity.amount / scale[s] / in[s];
+            // truncated in units rather than through to_fixed, whose int cast overflows past 2^31 units
+            payout[i] = int64_t(share * out[s] * net * scale[1 - s]);
+            if (payout[i] < batch[i].min_return.amount) {
+                filled[i] = false;
+                repriced = true;
+            }
+        }
+    }
+
+    int64_t received[2] = { 0, 0 };
+    for (size_t i = 0; i < batch.size(); i++) {
+        const auto& o = batch[i];
+        int s = side_of(o);
+        received[s] += o.quantity.amount;
+
+        if (!filled[i])
+            action(
+                permission_level{ get_self(), "active"_n },
+                sides[s]->contract, "transfer"_n,
+                std::make_tuple(get_self(), o.owner, o.quantity, string("below min return"))
+            ).send();
+        else if (payout[i] > 0)
+            action(
+                permission_level{ get_self(), "active"_n },
+                sides[1 - s]->contract, "transfer"_n,
+                std::make_tuple(get_self(), o.owner, asset(payout[i], sides[1 - s]->currency.symbol), o.receiver_memo)
+            ).send();
+    }
+
+    double supply = (get_supply(settings.smart_contract, settings.smart_currency.symbol.code()).amount + settings.smart_currency.amount) / power10(settings.smart_currency.symbol.precision());
+    for (int s = 0; s < 2; s++) {
+        // every input leaves the pending offset, refunds leave the balance with their transfer
+        reserves_table.modify(*sides[s], same_payer, [&](auto& r) {
+            accrue_price(r, balance[s]);
+            r.currency.amount += received[s];
+        });
+    }
+
+    if (in[0] > 0 || in[1] > 0) {
+        inline_vector<swap_record, 2> records;
+        for (int s = 0; s < 2; s++) {
+            if (in[s] <= 0) continue;
+            double depth = balance[s] + in[s] - out[1 - s] * net;
+            records.push_back({ asset(int64_t(in[s] * scale[s]), sides[s]->currency.symbol),
+                                in[s] / (out[s] * net),
+                                asset(int64_t(depth * scale[s]), sides[s]->currency.symbol),
+                                depth / supply });
+        }
+        action( permission_level{ get_self(), "active"_n },
+                "data.tbn"_n, "log"_n,
+                std::make_tuple( get_self(), records )
+        ).send();
+    }
+}
+
+// adds ln(balance / ratio) over the seconds since the last update to the price accumulator of a reserve,
+// `balance` must be the one held over that time, i.e. before the change being recorded; an empty reserve has
+// no price and adds nothing, and a row written before the accumulator existed starts it now
+void BancorConverter::accrue_price(reserve_t& reserve, double balance) {
+    uint32_t now = current_time_point().sec_since_epoch();
+    double cumulative = reserve.price_cumulative.value_or(0);
+    if (reserve.price_timestamp.has_value()) {
+        uint32_t last = reserve.price_timestamp.value().sec_since_epoch();
+        if (now > last && balance > 0)
+            cumulative += log(balance / reserve.ratio) * (now - last);
+    }
+    reserve.price_cumulative.emplace(cumulative);
+    reserve.price_timestamp.emplace(time_point_sec(now));
+}
+
 void BancorConverter::convert(name from, eosio::asset quantity, std::string memo, name code) {
-    auto from_amount = quantity.amount / pow(10, quantity.symbol.precision());
+    PROBE_SCOPE("convert");
+    auto from_amount = quantity.amount / power10(quantity.symbol.precision());
 
+    PROBE_STAGE("memo");
     auto memo_object = parse_memo(memo);
-    check(memo_object.path.size() > 1, "invalid memo format");
+    check(memo_object.route || memo_object.conversion_path.size() > 1, "invalid memo format");
 
+    PROBE_STAGE("reserves");
     settings settings_table(get_self(), get_self().value);
     const auto& converter_settings = settings_table.get("settings"_n.value, "settings do not exist");
+    PROBE_READ(1);
 
     check(converter_settings.enabled, "converter is disabled");
     check(converter_settings.network == from, "converter can only receive from network contract");
 
-    auto contract_name = name(memo_object.path[0].c_str());
+    name contract_name;
     auto from_path_currency = quantity.symbol.code().raw();
-    auto to_path_currency = symbol_code(memo_object.path[1].c_str()).raw();
+    uint64_t to_path_currency;
+    bool last_hop;
+    if (memo_object.route) {
+        routes routes_table(converter_settings.network, converter_settings.network.value);
+        const auto& r = routes_table.get(memo_object.route, "route not found");
+        PROBE_READ(1);
+        check(memo_object.route_hop < r.hops.size(), "invalid memo format");
+        contract_name = r.hops[memo_object.route_hop].converter;
+        to_path_currency = r.hops[memo_object.route_hop].to.raw();
+        last_hop = memo_object.route_hop + 1 == r.hops.size();
+    }
+    else {
+        contract_name = name(memo_object.conversion_path[0]);
+        to_path_currency = symbol_code(memo_object.conversion_path[1]).raw();
+        last_hop = memo_object.conversion_path.size() == 2;
+    }
 
     check(contract_name == get_self(), "wrong converter");    
     check(from_path_currency != to_path_currency, "cannot convert to self");
     
     auto smart_symbol_name = converter_settings.smart_currency.symbol.code().raw();
-    auto from_token = get_reserve(from_path_currency, converter_settings);
-    auto to_token = get_reserve(to_path_currency, converter_settings);
+    // the rows read here are modified below, through the same instance
+    reserves reserves_table(get_self(), get_self().value);
+    auto from_token = get_reserve(reserves_table, from_path_currency, converter_settings);
+    auto to_token = get_reserve(reserves_table, to_path_currency, converter_settings);
 
     auto from_currency = from_token.currency;
     auto to_currency = to_token.currency;
@@ -149,63 +586,118 @@ void BancorConverter::convert(name from, eosio::asset quantity, std::string memo
 
     check(to_token.sale_enabled, "'to' token purchases disabled");
     check(code == from_contract, "unknown 'from' contract");
-    
-    auto current_from_balance = ((get_balance(from_contract, get_self(), from_currency.symbol.code())).amount + from_currency.amount - quantity.amount) / pow(10, from_currency.symbol.precision()); 
-    auto current_to_balance = ((get_balance(to_contract, get_self(), to_currency.symbol.code())).amount + to_currency.amount) / pow(10, to_currency_precision);
+
+    if (converter_settings.batch_window.value_or(0) > 0 && !incoming_smart_token && !outgoing_smart_token &&
+        last_hop && memo_object.price_limit.empty()) {
+        queue_order(name(memo_object.dest_account), quantity, to_token, memo_object.min_return, memo_object.receiver_memo, converter_settings);
+        return;
+    }
+
+    PROBE_STAGE("balances");
+    auto current_from_balance = ((get_balance(from_contract, get_self(), from_currency.symbol.code())).amount + from_currency.amount - quantity.amount) / power10(from_currency.symbol.precision()); 
+    auto current_to_balance = ((get_balance(to_contract, get_self(), to_currency.symbol.code())).amount + to_currency.amount) / power10(to_currency_precision);
     
     double current_smart_supply = (get_supply(converter_settings.smart_contract, converter_settings.smart_currency.symbol.code())).amount + converter_settings.smart_currency.amount;
-    current_smart_supply /= pow(10, converter_settings.smart_currency.symbol.precision());
+    current_smart_supply /= power10(converter_settings.smart_currency.symbol.precision());
 
-    name final_to = name(memo_object.dest_account.c_str());
+    name final_to = name(memo_object.dest_account);
     
+    PROBE_STAGE("curve");
     double smart_tokens = 0;
     double to_tokens = 0;
-    bool quick = false;
+    bool cross = !incoming_smart_token && !outgoing_smart_token;
+    uint8_t magnitude = cross ? 2 : 1;
+
+    if (!memo_object.price_limit.empty()) {
+        check(last_hop, "price limit is only supported on single hop conversions");
+        check(stof(memo_object.price_limit) > 0, "invalid price limit");
+
+        // the limit is net of fees, the curve functions work on the gross rate
+        double rate = stof(memo_object.price_limit) / (1 - calculate_fee(1, converter_settings.fee, magnitude));
+        double max_amount = cross ? calculate_cross_reserve_limit(current_from_balance, from_ratio, current_to_balance, to_ratio, rate)
+                          : incoming_smart_token ? calculate_sale_limit(current_to_balance, current_smart_supply, to_ratio, rate)
+                          : calculate_purchase_limit(current_from_balance, current_smart_supply, from_ratio, rate);
+
+        if (max_amount < from_amount) {
+            int64_t fill_amount = max(0.0, max_amount) * power10(quantity.symbol.precision());
+            asset refund(quantity.amount - fill_amount, quantity.symbol);
+
+            // the network only forwards a price limit whose destination is the sender
+
+            PROBE_SEND(action(
+                permission_level{ get_self(), "active"_n },
+                from_contract, "transfer"_n,
+                std::make_tuple(get_self(), final_to, refund, string("price limit refund"))
+            ));
+
+            if (fill_amount == 0)
+                return;
+
+            quantity.amount = fill_amount;
+            from_amount = fill_amount / power10(quantity.symbol.precision());
+        }
+    }
     
     if (incoming_smart_token) {
-        action( // destory received token
+        PROBE_SEND(action( // destory received token
             permission_level{ get_self(), "active"_n },
             converter_settings.smart_contract, "retire"_n,
             std::make_tuple(quantity, string("destroy on conversion"))
-        ).send();
+        ));
 
         smart_tokens = from_amount;
     }
-    else if (!incoming_smart_token && !outgoing_smart_token && (from_ratio == to_ratio)) {
-        to_tokens = quick_convert(current_from_balance, from_amount, current_to_balance);
-        quick = true;
-    }
-    else {
+    else if (!cross) {
         smart_tokens = calculate_purchase_return(current_from_balance, from_amount, current_smart_supply, from_ratio);
         current_smart_supply += smart_tokens;
     }
     auto issue = false;
 
     if (outgoing_smart_token) {
-        check(memo_object.path.size() == 2, "smart token must be final currency");
+        check(last_hop, "smart token must be final currency");
         to_tokens = smart_tokens;
         issue = true;
     }
-    else if (!quick) {
+    else if (cross) {
+        // reserve to reserve in one step, the smart supply cancels out so the cost does not depend on the pool
+        to_tokens = calculate_cross_reserve_return(current_from_balance, from_amount, from_ratio, current_to_balance, to_ratio);
+    }
+    else {
         to_tokens = calculate_sale_return(current_to_balance, smart_tokens, current_smart_supply, to_ratio);
         current_smart_supply -= smart_tokens;
     }
-    uint8_t magnitude = (incoming_smart_token || outgoing_smart_token) ? 1 : 2;
     double fee = calculate_fee(to_tokens, converter_settings.fee, magnitude);
     to_tokens -= fee;
 
     if (outgoing_smart_token)
         current_smart_supply -= fee;
+
+    // the reserves whose balance moves close their price interval at the balance held until now
+    PROBE_STAGE("reserve_state");
+    if (!incoming_smart_token) {
+        reserves_table.modify(reserves_table.get(from_path_currency), same_payer, [&](auto& r) {
+            accrue_price(r, current_from_balance);
+        });
+        PROBE_WRITE(1);
+    }
+    if (!outgoing_smart_token) {
+        reserves_table.modify(reserves_table.get(to_path_currency), same_payer, [&](auto& r) {
+            accrue_price(r, current_to_balance);
+        });
+        PROBE_WRITE(1);
+    }
         
     to_tokens = to_fixed(to_tokens, to_currency_precision);
 
-    path new_path = memo_object.path;
-    new_path.erase(new_path.begin(), new_path.begin() + 2);
-    memo_object.path = new_path;
+    PROBE_STAGE("memo");
+    if (memo_object.route)
+        memo_object.route_hop++;
+    else
+        memo_object.conversion_path.erase(memo_object.conversion_path.begin(), memo_object.conversion_path.begin() + 2);
 
     auto new_memo = build_memo(memo_object);
 
-    int64_t to_amount = to_tokens * pow(10, to_currency_precision);
+    int64_t to_amount = to_tokens * power10(to_currency_precision);
     auto new_asset = asset(to_amount, to_currency.symbol);
     name inner_to = converter_settings.network;
 
@@ -213,13 +705,14 @@ void BancorConverter::convert(name from, eosio::asset quantity, std::string memo
     // Dummy action to write conversion results to the action trace
 
     // from liquidity
-    int64_t from_liquidity_amount = (incoming_smart_token) ? (current_smart_supply * pow(10, from_currency.symbol.precision())) : ((current_from_balance + from_amount) * pow(10, from_currency.symbol.precision()));
+    int64_t from_liquidity_amount = (incoming_smart_token) ? (current_smart_supply * power10(from_currency.symbol.precision())) : ((current_from_balance + from_amount) * power10(from_currency.symbol.precision()));
     auto from_liquidity = asset(from_liquidity_amount, from_currency.symbol);
 
     // to liquidity
-    int64_t to_liquidity_amount = (outgoing_smart_token) ? ((current_smart_supply) * pow(10, to_currency_precision)) : ((current_to_balance - to_tokens) * pow(10, to_currency_precision));
+    int64_t to_liquidity_amount = (outgoing_smart_token) ? ((current_smart_supply) * power10(to_currency_precision)) : ((current_to_balance - to_tokens) * power10(to_currency_precision));
     auto to_liquidity = asset(to_liquidity_amount, to_currency.symbol);
 
+    PROBE_STAGE("inline");
     if (!incoming_smart_token && !outgoing_smart_token) {
         swap_record swap_from_record = { quantity,
                                          asset_to_double( quantity ) / asset_to_double( new_asset ),
@@ -230,14 +723,14 @@ void BancorConverter::convert(name from, eosio::asset quantity, std::string memo
                                          to_liquidity,
                                          asset_to_double( to_liquidity ) / current_smart_supply };
 
-        action( permission_level{ get_self(), "active"_n },
+        PROBE_SEND(action( permission_level{ get_self(), "active"_n },
                 "data.tbn"_n, "log"_n,
-                std::make_tuple( get_self(), vector<swap_record>{ swap_from_record, swap_to_record } )
-        ).send();
+                std::make_tuple( get_self(), inline_vector<swap_record, 2>{ swap_from_record, swap_to_record }, final_to )
+        ));
     }
     //-----------------------------------------------------------------------------------------------------------------------------------------------
 
-    if (memo_object.path.size() == 0) {
+    if (last_hop) {
         inner_to = final_to;
         verify_min_return(new_asset, memo_object.min_return);
         if (converter_settings.require_balance)
@@ -246,40 +739,64 @@ void BancorConverter::convert(name from, eosio::asset quantity, std::string memo
     }
 
     if (issue)
-        action(
+        PROBE_SEND(action(
             permission_level{ get_self(), "active"_n },
             to_contract, "issue"_n,
             std::make_tuple(get_self(), new_asset, new_memo) 
-        ).send();
+        ));
 
-    action(
+    PROBE_SEND(action(
         permission_level{ get_self(), "active"_n },
         to_contract, "transfer"_n,
         std::make_tuple(get_self(), inner_to, new_asset, new_memo)
-    ).send();
+    ));
 }
 
 // returns a reserve object
 // can also be called for the smart token itself
-const BancorConverter::reserve_t& BancorConverter::get_reserve(uint64_t name, const settings_t& settings) {
+// returned by value, a reference would outlive the table instance that owns the row
+BancorConverter::reserve_t BancorConverter::get_reserve(uint64_t name, const settings_t& settings) {
+    reserves reserves_table(get_self(), get_self().value);
+    return get_reserve(reserves_table, name, settings);
+}
+
+// the same, reading the row through a table instance the caller goes on using
+BancorConverter::reserve_t BancorConverter::get_reserve(const reserves& reserves_table, uint64_t name, const settings_t& settings) {
     if (settings.smart_currency.symbol.code().raw() == name) {
-        static reserve_t temp_reserve;
+        reserve_t temp_reserve;
         temp_reserve.ratio = 0;
         temp_reserve.contract = settings.smart_contract;
         temp_reserve.currency = settings.smart_currency;
         temp_reserve.sale_enabled = settings.smart_enabled;
         return temp_reserve;
     }
-    reserves reserves_table(get_self(), get_self().value);
     auto existing = reserves_table.find(name);
     check(existing != reserves_table.end(), "reserve not found");
+    PROBE_READ(1);
     return *existing;
 }
 
+// returns the settings with the fields of rows written before they existed filled in, so that the row
+// can be written back whole: the total ratio is summed from the reserves once, batching starts off
+BancorConverter::settings_t BancorConverter::upgrade_settings(const settings_t& settings) {
+    settings_t upgraded = settings;
+    if (!upgraded.total_ratio.has_value()) {
+        uint64_t total_ratio = 0;
+        reserves reserves_table(get_self(), get_self().value);
+        for (const auto& r : reserves_table)
+            total_ratio += r.ratio;
+        upgraded.total_ratio.emplace(total_ratio);
+    }
+    if (!upgraded.batch_window.has_value())
+        upgraded.batch_window.emplace(0);
+    return upgraded;
+}
+
 // returns the balance object for an account
 asset BancorConverter::get_balance(name contract, name owner, symbol_code sym) {
     accounts accountstable(contract, owner.value);
     const auto& ac = accountstable.get(sym.raw());
+    PROBE_READ(1);
     return ac.balance;
 }
 
@@ -288,6 +805,7 @@ uint64_t BancorConverter::get_balance_amount(name contract, name owner, symbol_c
     accounts accountstable(contract, owner.value);
 
     auto ac = accountstable.find(sym.raw());
+    PROBE_READ(1);
     if (ac != accountstable.end())
         return ac->balance.amount;
 
@@ -298,6 +816,7 @@ uint64_t BancorConverter::get_balance_amount(name contract, name owner, symbol_c
 asset BancorConverter::get_supply(name contract, symbol_code sym) {
     stats statstable(contract, sym.raw());
     const auto& st = statstable.get(sym.raw());
+    PROBE_READ(1);
     return st.supply;
 }
 
@@ -306,82 +825,32 @@ void BancorConverter::verify_entry(name account, name currency_contract, eosio::
     accounts accountstable(currency_contract, account.value);
     auto ac = accountstable.find(currency.symbol.code().raw());
     check(ac != accountstable.end(), "must have entry for token (claim token first)");
+    PROBE_READ(1);
 }
 
 // asserts if a conversion resulted in an amount lower than the minimum amount defined by the caller
-void BancorConverter::verify_min_return(eosio::asset quantity, std::string min_return) {
-    float ret = stof(min_return.c_str());
-    int64_t ret_amount = (ret * pow(10, quantity.symbol.precision()));
+void BancorConverter::verify_min_return(eosio::asset quantity, std::string_view min_return) {
+    float ret = stof(min_return);
+    int64_t ret_amount = (ret * power10(quantity.symbol.precision()));
     check(quantity.amount >= ret_amount, "below min return");
 }
 
-// given a token supply, reserve balance, ratio and a input amount (in the reserve token),
-// calculates the return for a given conversion (in the main token)
-double BancorConverter::calculate_purchase_return(double balance, double deposit_amount, double supply, int64_t ratio) {
-    double R(supply);
-    double C(balance);
-    double F(ratio / RATIO_DENOMINATOR);
-    double T(deposit_amount);
-    double ONE(1.0);
-
-    double E = -R * (ONE - pow(ONE + T / C, F));
-    return E;
-}
-
-// given a token supply, reserve balance, ratio and a input amount (in the main token),
-// calculates the return for a given conversion (in the reserve token)
-double BancorConverter::calculate_sale_return(double balance, double sell_amount, double supply, int64_t ratio) {
-    double R(supply);
-    double C(balance);
-    double F(RATIO_DENOMINATOR / ratio);
-    double E(sell_amount);
-    double ONE(1.0);
-
-    double T = C * (ONE - pow(ONE - E/R, F));
-    return T;
-}
-
-double BancorConverter::calculate_fee(double amount, uint64_t fee, uint8_t magnitude) {
-    return amount * (1 - pow((1 - fee / FEE_DENOMINATOR), magnitude));
-}
-
-double BancorConverter::quick_convert(double balance, double in, double toBalance) {
-    return in / (balance + in) * toBalance;
-}
-
-float BancorConverter::stof(const char* s) {
-    float rez = 0, fact = 1;
-    
-    if (*s == '-') {
-        s++;
-        fact = -1;
-    }
-    for (int point_seen = 0; *s; s++) {
-        if (*s == '.') {
-            if (point_seen) return 0;
-            point_seen = 1; 
-            continue;
-        }
-        int d = *s - '0';
-        if (d >= 0 && d <= 9) {
-            if (point_seen) fact /= 10.0f;
-            rez = rez * 10.0f + (float)d;
-        } else return 0;
-    }
-    return rez * fact;
-}
-
 void BancorConverter::on_transfer(name from, name to, asset quantity, std::string memo) {
+    PROBE_ACTION("on_transfer");
     require_auth(from);
     check(quantity.is_valid() && quantity.amount > 0, "invalid quantity");
 
-    // avoid unstaking and system contract ops mishaps
-    if (from == get_self() || from == "eosio.ram"_n || from == "eosio.stake"_n || from == "eosio.rex"_n)
+    // only incoming transfers are conversions; avoid unstaking and system contract ops mishaps
+    if (from == get_self() || to != get_self() || from == "eosio.ram"_n || from == "eosio.stake"_n || from == "eosio.rex"_n)
 	    return;
 
     if (memo == "setup") {
         settings settings_table(get_self(), get_self().value);
-        const auto& converter_settings = settings_table.get("settings"_n.value, "settings do not exist");
-    } else
+        settings_table.get("settings"_n.value, "settings do not exist");
+    } else if (memo == "fund")
+        deposit(from, quantity, get_first_receiver());
+    else if (memo == "liquidate")
+        liquidate(from, quantity, get_first_receiver());
+    else
         convert(from, quantity, memo, get_first_receiver()); 
 }
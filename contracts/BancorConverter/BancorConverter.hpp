@@ -8,6 +8,11 @@
 #include <eosio/transaction.hpp>
 #include <eosio/asset.hpp>
 #include <eosio/symbol.hpp>
+#include <eosio/time.hpp>
+#include <eosio/binary_extension.hpp>
+
+#include <algorithm>
+#include "../Common/curve.hpp"
 
 using namespace eosio;
 using namespace std;
@@ -19,6 +24,9 @@ using namespace std;
  * that are defined as its reserves and between the different reserves directly.
  */
 
+// a queued order must be at least this fraction of its reserve, the converter pays for the order's row
+constexpr int64_t MIN_ORDER_DENOMINATOR = 100000;
+
 CONTRACT BancorConverter : public eosio::contract {
     public:
         using contract::contract;
@@ -46,7 +54,11 @@ CONTRACT BancorConverter : public eosio::contract {
          * - require_balance : require creating new balance for the calling account should fail
          * - max_fee : maximum conversion fee percentage, 0-30000, 4-pt precision a la eosio.asset
          * - fee : conversion fee for this converter
-
+         * - total_ratio : sum of the ratios of all reserves, kept up to date by setreserve/delreserve
+         * - batch_window : seconds over which final hop reserve to reserve conversions are collected and settled together, 0 to convert immediately
+         *
+         * The last two are binary extensions: rows written before they existed lack them and are completed,
+         * the total ratio summed from the reserves, the first time an action writes the row back
          */
         TABLE settings_t {
             name smart_contract;
@@ -57,6 +69,8 @@ CONTRACT BancorConverter : public eosio::contract {
             bool require_balance;
             uint64_t max_fee;
             uint64_t fee;
+            binary_extension<uint64_t> total_ratio;
+            binary_extension<uint64_t> batch_window;
 
             uint64_t primary_key() const { return "settings"_n.value; }
         };
@@ -71,16 +85,65 @@ CONTRACT BancorConverter : public eosio::contract {
           *              PRIMARY KEY is `currency.symbol.code().raw()`
           * - ratio    : Reserve ratio
           * - sale_enabled : Are transactions enabled on this reserve
+          * - price_cumulative : Time integral, in seconds, of ln(balance / ratio) since price_timestamp was first set.
+          *                      The marginal price of reserve A in reserve B is (balance_B / ratio_B) / (balance_A / ratio_A),
+          *                      so exp of the change in (price_cumulative_B - price_cumulative_A) between two snapshots
+          *                      divided by the seconds between them is the time weighted (geometric) price over that window
+          * - price_timestamp : Last update of price_cumulative, every action that moves the balance (conversions, fund, liquidate, settle) updates it first
+          *
+          * The last two are binary extensions: rows written before they existed lack them, and their price history
+          * starts at the first action that moves the balance or updates the reserve
           */
         TABLE reserve_t {
             name contract;
             asset currency;
             uint64_t ratio;
             bool sale_enabled;
+            binary_extension<double> price_cumulative;
+            binary_extension<time_point_sec> price_timestamp;
 
             uint64_t primary_key() const { return currency.symbol.code().raw(); }
         };
 
+        /**
+          * @defgroup Converter_Deposits_Table Deposits Table
+          * @brief This table stores reserve tokens transferred with the "fund" memo that are not yet part of the reserves
+          * @details SCOPE of this table is the depositing account
+          *
+          * - quantity : Deposited amount, PRIMARY KEY is `quantity.symbol.code().raw()`
+          */
+        TABLE deposit_t {
+            asset quantity;
+
+            uint64_t primary_key() const { return quantity.symbol.code().raw(); }
+        };
+
+        /**
+          * @defgroup Converter_Orders_Table Orders Table
+          * @brief This table stores the conversions queued for the next batch settlement
+          * @details SCOPE of this table is `_self`
+          *
+          * - id : PRIMARY KEY, increasing
+          * - owner : Receives the proceeds, or the refund if the order misses its min return
+          * - quantity : Input, already held by the converter but kept out of the reserve until settled
+          * - min_return : Minimum output, its symbol is the reserve to convert to
+          * - receiver_memo : Memo of the proceeds transfer
+          * - settle_after : End of the batch window the order was placed in, secondary key `bysettle`
+          *
+          * The converter pays for the rows, so an order must be at least 1 / MIN_ORDER_DENOMINATOR of its reserve
+          */
+        TABLE order_t {
+            uint64_t       id;
+            name           owner;
+            asset          quantity;
+            asset          min_return;
+            string         receiver_memo;
+            time_point_sec settle_after;
+
+            uint64_t primary_key() const { return id; }
+            uint64_t by_settle() const { return settle_after.sec_since_epoch(); }
+        };
+
         /**
          * @brief initializes the converter settings
          * @details can only be called once, by the contract account
@@ -105,6 +168,49 @@ CONTRACT BancorConverter : public eosio::contract {
          */
         ACTION update(bool smart_enabled, bool enabled, bool require_balance, uint64_t fee);
 
+        /**
+         * @brief enables batch settlement of final hop reserve to reserve conversions
+         * @details can only be called by the contract account; orders already queued keep their window
+         * @param batch_window - window length in seconds, 0 converts immediately
+         */
+        ACTION setbatch(uint64_t batch_window);
+
+        /**
+         * @brief settles the orders whose batch window has closed, earliest window first
+         * @details may be called by anyone; per reserve pair the opposing flows are crossed at the spot price
+         * and only the imbalance is converted on the curve, every order receives the batch price
+         * @param max_orders - most orders to settle, call again to settle the rest
+         */
+        ACTION settle(uint32_t max_orders);
+
+        /**
+         * @brief cancels a queued order and refunds its input
+         * @details can only be called by the order's owner, also while conversions are disabled
+         * @param owner - the order's owner
+         * @param id - the order's id
+         */
+        ACTION cancel(name owner, uint64_t id);
+
+        /**
+         * @brief the price accumulators of a reserve pair brought up to now, see the reserves table
+         * @details price is the marginal price of `base` in `quote`; price_cumulative is the time integral of its log,
+         * the time weighted price between two observations is exp(delta price_cumulative / delta seconds)
+         */
+        struct price_observation {
+            time_point_sec timestamp;
+            double         price;
+            double         price_cumulative;
+        };
+
+        /**
+         * @brief returns the current price and price accumulator of a reserve pair, for an oracle or client to snapshot
+         * @details read only; contracts can read the same accumulators from the reserves table
+         * @param base - reserve whose price is returned
+         * @param quote - reserve the price is expressed in
+         */
+        [[eosio::action, eosio::read_only]]
+        price_observation observe(symbol_code base, symbol_code quote);
+
         /**
          * @brief initializes a new reserve in the converter
          * @details can also be used to update an existing reserve, can only be called by the contract account
@@ -121,10 +227,27 @@ CONTRACT BancorConverter : public eosio::contract {
          */
         ACTION delreserve(symbol_code currency);
 
+        /**
+         * @brief buys `quantity` smart tokens with every reserve in proportion to its balance
+         * @details the reserve tokens are taken from the sender's deposits (transfers with the "fund" memo),
+         * the smart tokens are issued to the sender; can only be called by the sender
+         * @param sender - the liquidity provider
+         * @param quantity - amount of smart tokens to issue
+         */
+        ACTION fund(name sender, asset quantity);
+
+        /**
+         * @brief returns a deposit that was not used by fund
+         * @param sender - the depositing account
+         * @param quantity - amount to withdraw
+         */
+        ACTION withdraw(name sender, asset quantity);
+
         /**
          * @brief transfer intercepts
          * @details `memo` in csv format, may contain an extra keyword (e.g. "setup") following a semicolon at the end of the conversion path; 
-         * indicates special transfer which otherwise would be interpreted as a standard conversion
+         * indicates special transfer which otherwise would be interpreted as a standard conversion.
+         * "fund" deposits a reserve token for a following fund action, "liquidate" sells smart tokens for every reserve in proportion
          * @param from - the sender of the transfer
          * @param to - the receiver of the transfer
          * @param quantity - the quantity for the transfer
@@ -137,29 +260,29 @@ CONTRACT BancorConverter : public eosio::contract {
         using transfer_action = action_wrapper<name("transfer"), &BancorConverter::on_transfer>;
         typedef eosio::multi_index<"settings"_n, settings_t> settings;
         typedef eosio::multi_index<"reserves"_n, reserve_t> reserves;
-
-        constexpr static double RATIO_DENOMINATOR = 1000000.0;
-        constexpr static double FEE_DENOMINATOR = 1000000.0;
+        typedef eosio::multi_index<"deposits"_n, deposit_t> deposits;
+        typedef eosio::multi_index<"orders"_n, order_t,
+            indexed_by<"bysettle"_n, const_mem_fun<order_t, uint64_t, &order_t::by_settle>>> orders;
 
         void convert(name from, eosio::asset quantity, std::string memo, name code);
-        const reserve_t& get_reserve(uint64_t name, const settings_t& settings);
+        void deposit(name from, eosio::asset quantity, name code);
+        void liquidate(name from, eosio::asset quantity, name code);
+        void queue_order(name owner, eosio::asset quantity, const reserve_t& to_token, std::string_view min_return, std::string_view receiver_memo, const settings_t& settings);
+        void settle_batch(symbol_code first, symbol_code second, const vector<order_t>& batch, const settings_t& settings);
+        void accrue_price(reserve_t& reserve, double balance);
+        reserve_t get_reserve(uint64_t name, const settings_t& settings);
+        reserve_t get_reserve(const reserves& reserves_table, uint64_t name, const settings_t& settings);
+        settings_t upgrade_settings(const settings_t& settings);
 
         asset get_balance(name contract, name owner, symbol_code sym);
         uint64_t get_balance_amount(name contract, name owner, symbol_code sym);
         asset get_supply(name contract, symbol_code sym);
 
-        void verify_min_return(eosio::asset quantity, std::string min_return);
+        void verify_min_return(eosio::asset quantity, std::string_view min_return);
         void verify_entry(name account, name currency_contract, eosio::asset currency);
 
-        double calculate_fee(double amount, uint64_t fee, uint8_t magnitude);
-        double calculate_purchase_return(double balance, double deposit_amount, double supply, int64_t ratio);
-        double calculate_sale_return(double balance, double sell_amount, double supply, int64_t ratio);
-        double quick_convert(double balance, double in, double toBalance);
-
-        float stof(const char* s);
-
         static double asset_to_double( const asset quantity ) {
             if ( quantity.amount == 0 ) return 0.0;
-            return quantity.amount / pow(10, quantity.symbol.precision());
+            return quantity.amount / power10(quantity.symbol.precision());
         }
 };
\ No newline at end of file
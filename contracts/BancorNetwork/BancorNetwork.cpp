@@ -6,40 +6,255 @@
 
 #include "../Common/common.hpp"
 #include "BancorNetwork.hpp"
+#include "../Common/probes.hpp"
+#include "../Common/arena.hpp"
+
+struct account {
+    asset    balance;
+    uint64_t primary_key() const { return balance.symbol.code().raw(); }
+};
+
+TABLE currency_stats {
+    asset   supply;
+    asset   max_supply;
+    name    issuer;
+    uint64_t primary_key() const { return supply.symbol.code().raw(); }
+};
+
+typedef eosio::multi_index<"stat"_n, currency_stats> stats;
+typedef eosio::multi_index<"accounts"_n, account> accounts;
 
 ACTION BancorNetwork::init() {
     require_auth(get_self());
 }
 
+ACTION BancorNetwork::setroute(uint64_t id, vector<route_hop> hops) {
+    require_auth(get_self());
+    check(id > 0, "route id must be greater than 0");
+    check(!hops.empty() && hops.size() <= MAX_HOPS, ("a route has 1 to " + std::to_string(MAX_HOPS) + " hops").c_str());
+
+    for (size_t i = 0; i < hops.size(); i++) {
+        check(hops[i].to.is_valid(), "invalid symbol");
+        settings settings_table(hops[i].converter, hops[i].converter.value);
+        const auto& st = settings_table.get("settings"_n.value, "converter doesn't exist");
+        reserve_t to_token;
+        check(find_reserve(hops[i].converter, hops[i].to, st, to_token), "converter has no such reserve");
+        check(to_token.currency.symbol != st.smart_currency.symbol || i + 1 == hops.size(), "smart token must be final currency");
+    }
+
+    routes routes_table(get_self(), get_self().value);
+    auto existing = routes_table.find(id);
+    if (existing != routes_table.end())
+        routes_table.modify(existing, same_payer, [&](auto& r) {
+            r.hops = hops;
+        });
+    else
+        routes_table.emplace(get_self(), [&](auto& r) {
+            r.id   = id;
+            r.hops = hops;
+        });
+}
+
+ACTION BancorNetwork::delroute(uint64_t id) {
+    require_auth(get_self());
+    routes routes_table(get_self(), get_self().value);
+    routes_table.erase(routes_table.get(id, "route not found"));
+}
+
 void BancorNetwork::on_transfer(name from, name to, asset quantity, string memo) {
-    // avoid unstaking and system contract ops mishaps
-    if (from == get_self() || from == "eosio.ram"_n || from == "eosio.stake"_n || from == "eosio.rex"_n) 
+    PROBE_ACTION("on_transfer");
+    // only incoming transfers are conversions; avoid unstaking and system contract ops mishaps
+    if (from == get_self() || to != get_self() || from == "eosio.ram"_n || from == "eosio.stake"_n || from == "eosio.rex"_n) 
 	    return;
 
     check(quantity.symbol.is_valid(), "invalid quantity in transfer");
     check(quantity.amount != 0, "zero quantity is disallowed in transfer");
 
+    PROBE_STAGE("memo");
     auto memo_object = parse_memo(memo);
-    check(memo_object.path.size() >= 2, "bad path format");
+    // a malformed limit would parse as 0, no limit at all
+    check(memo_object.price_limit.empty() || stof(memo_object.price_limit) > 0, "invalid price limit");
+    if (!memo_object.alternatives.empty()) {
+        PROBE_STAGE("select_path");
+        // only the selected path travels on, the converters never see the alternatives
+        split(select_path(memo_object, quantity), ' ', memo_object.conversion_path);
+        memo_object.route = 0;
+        memo = build_memo(memo_object);
+        memo_object = parse_memo(memo);
+    }
 
-    name next_converter = memo_object.converters[0].account;
+    PROBE_STAGE("converters");
+    name next_converter;
+    if (memo_object.route) {
+        routes routes_table(get_self(), get_self().value);
+        const auto& r = routes_table.get(memo_object.route, "route not found");
+        PROBE_READ(1);
+        check(memo_object.route_hop < r.hops.size(), "bad path format");
+        check(memo_object.price_limit.empty() || r.hops.size() == 1, "price limit is only supported on single hop conversions");
+        next_converter = r.hops[memo_object.route_hop].converter;
+    }
+    else {
+        check(memo_object.conversion_path.size() >= 2, "bad path format");
+        check(memo_object.price_limit.empty() || memo_object.conversion_path.size() == 2, "price limit is only supported on single hop conversions");
+        next_converter = memo_object.converters[0].account;
+    }
     check(isConverter(next_converter), "converter doesn't exist");
 
-    const name destination_account = name(memo_object.dest_account.c_str());
+    const name destination_account = name(memo_object.dest_account);
     
     // the 'from' param must be either the destination account, or a valid converter (in case it's a "2-hop" conversion path)
     if (from != destination_account && destination_account != BANCOR_X)
         check(isConverter(from), "the destination account must by either the sender, or the BancorX contract account");
+    // the converter refunds what the limit leaves unfilled to the destination, the only account it knows
+    check(memo_object.price_limit.empty() || from == destination_account, "a price limit requires the sender to be the destination");
     
-    action(
+    PROBE_STAGE("inline");
+    PROBE_SEND(action(
         permission_level{ get_self(), "active"_n },
         get_first_receiver(), "transfer"_n,
         std::make_tuple(get_self(), next_converter, quantity, memo)
-    ).send();
+    ));
 }
 
 bool BancorNetwork::isConverter(name converter) {
     settings settings_table(converter, converter.value);
     const auto& st = settings_table.get("settings"_n.value, "settings do not exist");
+    PROBE_READ(1);
     return st.enabled;
 }
+
+// returns the first candidate path whose quote meets the min return
+std::string_view BancorNetwork::select_path(const memo_structure& memo_object, asset quantity) {
+    float min_return = stof(memo_object.min_return);
+
+    for (const auto& candidate : memo_object.alternatives) {
+        auto result = quote(candidate, quantity, memo_object.price_limit);
+        if (result.amount > 0 && result.amount >= int64_t(min_return * power10(result.symbol.precision())))
+            return candidate;
+    }
+    check(false, "below min return");
+    return "";
+}
+
+// quotes a candidate conversion path, or "#<id>" route, against the current state of its converters, the same
+// way each converter will execute it, a price limit filling only part of the input; returns a zero amount if any
+// hop cannot be executed, or would be queued by a batching converter rather than filled
+asset BancorNetwork::quote(std::string_view candidate, asset quantity, std::string_view price_limit) {
+    inline_vector<route_hop, MAX_HOPS> hops;
+    if (!candidate.empty() && candidate[0] == '#') {
+        uint64_t id;
+        routes routes_table(get_self(), get_self().value);
+        auto r = parse_uint(candidate.substr(1), id) ? routes_table.find(id) : routes_table.end();
+        PROBE_READ(1);
+        if (r == routes_table.end())
+            return asset(0, quantity.symbol);
+        for (const auto& hop : r->hops)
+            hops.push_back(hop);
+    }
+    else {
+        path conversion_path;
+        size_t elements = split(candidate, ' ', conversion_path);
+        if (elements > conversion_path.capacity() || elements < 2 || elements % 2 != 0)
+            return asset(0, quantity.symbol);
+        for (size_t i = 0; i < conversion_path.size(); i += 2)
+            hops.push_back(route_hop{ name(conversion_path[i]), symbol_code(conversion_path[i + 1]) });
+    }
+    if (!price_limit.empty() && hops.size() != 1)
+        return asset(0, quantity.symbol);
+
+    for (size_t i = 0; i < hops.size(); i++) {
+        name converter = hops[i].converter;
+        symbol_code to_code = hops[i].to;
+
+        settings settings_table(converter, converter.value);
+        auto st = settings_table.find("settings"_n.value);
+        PROBE_ITERATION();
+        PROBE_READ(1);
+        if (st == settings_table.end() || !st->enabled || st->network != get_self())
+            return asset(0, quantity.symbol);
+
+        reserve_t from_token, to_token;
+        if (!find_reserve(converter, quantity.symbol.code(), *st, from_token) || !find_reserve(converter, to_code, *st, to_token) ||
+            !to_token.sale_enabled || from_token.currency.symbol == to_token.currency.symbol)
+            return asset(0, quantity.symbol);
+
+        bool incoming_smart_token = from_token.currency.symbol == st->smart_currency.symbol;
+        bool outgoing_smart_token = to_token.currency.symbol == st->smart_currency.symbol;
+        if (outgoing_smart_token && i + 1 != hops.size())
+            return asset(0, quantity.symbol);
+        // a batching converter queues a final reserve to reserve hop without a price limit for its next settle, at a
+        // price not known yet
+        if (i + 1 == hops.size() && !incoming_smart_token && !outgoing_smart_token && st->batch_window.value_or(0) > 0 &&
+            price_limit.empty())
+            return asset(0, quantity.symbol);
+
+        auto balance_of = [&](const reserve_t& r) {
+            accounts accountstable(r.contract, converter.value);
+            auto ac = accountstable.find(r.currency.symbol.code().raw());
+            PROBE_READ(1);
+            int64_t balance = (ac != accountstable.end() ? ac->balance.amount : 0) + r.currency.amount;
+            return balance / power10(r.currency.symbol.precision());
+        };
+
+        stats statstable(st->smart_contract, st->smart_currency.symbol.code().raw());
+        auto smart_stats = statstable.find(st->smart_currency.symbol.code().raw());
+        PROBE_READ(1);
+        if (smart_stats == statstable.end())
+            return asset(0, quantity.symbol);
+        double supply = (smart_stats->supply.amount + st->smart_currency.amount) / power10(st->smart_currency.symbol.precision());
+
+        double amount = quantity.amount / power10(quantity.symbol.precision());
+        double from_balance = incoming_smart_token ? 0 : balance_of(from_token);
+        double to_balance = outgoing_smart_token ? 0 : balance_of(to_token);
+        uint8_t magnitude = (incoming_smart_token || outgoing_smart_token) ? 1 : 2;
+
+        // the part of the input the converter fills under the limit, as in BancorConverter::convert
+        if (!price_limit.empty()) {
+            double rate = stof(price_limit) / (1 - calculate_fee(1, st->fee, magnitude));
+            double max_amount = incoming_smart_token ? calculate_sale_limit(to_balance, supply, to_token.ratio, rate)
+                              : outgoing_smart_token ? calculate_purchase_limit(from_balance, supply, from_token.ratio, rate)
+                              : calculate_cross_reserve_limit(from_balance, from_token.ratio, to_balance, to_token.ratio, rate);
+            if (max_amount < amount) {
+                int64_t fill_amount = max(0.0, max_amount) * power10(quantity.symbol.precision());
+                if (fill_amount == 0)
+                    return asset(0, to_token.currency.symbol);
+                amount = fill_amount / power10(quantity.symbol.precision());
+            }
+        }
+
+        double to_tokens;
+        if (incoming_smart_token)
+            to_tokens = calculate_sale_return(to_balance, amount, supply, to_token.ratio);
+        else if (outgoing_smart_token)
+            to_tokens = calculate_purchase_return(from_balance, amount, supply, from_token.ratio);
+        else
+            to_tokens = calculate_cross_reserve_return(from_balance, amount, from_token.ratio, to_balance, to_token.ratio);
+
+        to_tokens -= calculate_fee(to_tokens, st->fee, magnitude);
+        to_tokens = to_fixed(to_tokens, to_token.currency.symbol.precision());
+
+        quantity = asset(int64_t(to_tokens * power10(to_token.currency.symbol.precision())), to_token.currency.symbol);
+        if (quantity.amount <= 0)
+            return quantity;
+    }
+    return quantity;
+}
+
+// looks up a reserve of a converter, the smart token is reported as a reserve too
+bool BancorNetwork::find_reserve(name converter, symbol_code currency, const settings_t& converter_settings, reserve_t& reserve) {
+    if (converter_settings.smart_currency.symbol.code() == currency) {
+        reserve.contract = converter_settings.smart_contract;
+        reserve.currency = converter_settings.smart_currency;
+        reserve.ratio = 0;
+        reserve.sale_enabled = converter_settings.smart_enabled;
+        return true;
+    }
+    reserves reserves_table(converter, converter.value);
+    auto existing = reserves_table.find(currency.raw());
+    PROBE_READ(1);
+    if (existing == reserves_table.end())
+        return false;
+
+    reserve = *existing;
+    return true;
+}
@@ -8,10 +8,13 @@
 #include <eosio/eosio.hpp>
 #include <eosio/transaction.hpp>
 #include <eosio/asset.hpp>
+#include <eosio/binary_extension.hpp>
 
 using namespace eosio;
 using namespace std;
 
+struct memo_structure;
+
 /**
  * @defgroup BancorNetwork BancorNetwork
  * @brief The BancorNetwork contract is the main entry point for Bancor token conversions.
@@ -25,6 +28,17 @@ using namespace std;
  * - For example, in order to convert 10 EOS into BNT, the caller needs to transfer 10 EOS to the contract
  * and provide the following memo:
  * > `1,bnt2eoscnvrt BNT,1.0000000000,receiver_account_name`
+ * - A single hop conversion may add a price limit as a fifth element, the converter then fills only as much
+ * as keeps the marginal rate (to tokens per from token, after fees) at or above it and refunds the rest to
+ * the sender, who must be the destination:
+ * > `1,bnt2eoscnvrt BNT,0,receiver_account_name,0.0250`
+ * - Several candidate paths may be given separated by "|", they are quoted in order against the converters' current
+ * state, with the price limit if one is given, and the first one whose quote meets the min return is executed; a path
+ * through a converter that does not accept this network, or whose last hop a batching converter would queue, is never selected:
+ * > `1,cnvrt1 SEEDS cnvrt2 HUSD|cnvrt5 HUSD,10.00,receiver_account_name`
+ * - A path registered with `setroute` may be referenced by its id in place of the path, it is then read pre-decoded
+ * from the routes table instead of being carried and parsed at every hop:
+ * > `1,#7,1.0000000000,receiver_account_name`
  * @{
 */
 
@@ -33,8 +47,26 @@ CONTRACT BancorNetwork : public eosio::contract { /*! \endcond */
     public:
         using contract::contract;
 
+        struct route_hop {
+            name        converter;
+            symbol_code to;
+        };
+
         ACTION init();
 
+        /**
+         * @brief registers or replaces a route that memos may reference as "#<id>"
+         * @param id - route id, greater than 0
+         * @param hops - the conversions in order, each a converter and the token it converts to
+         */
+        ACTION setroute(uint64_t id, vector<route_hop> hops);
+
+        /**
+         * @brief deletes a registered route
+         * @param id - route id
+         */
+        ACTION delroute(uint64_t id);
+
         /**
          * @brief transfer intercepts
          * @details conversion will fail if the amount returned is lower "minreturn" element in the `memo`
@@ -62,11 +94,41 @@ CONTRACT BancorNetwork : public eosio::contract { /*! \endcond */
             bool     require_balance;
             uint64_t max_fee;
             uint64_t fee;
+            binary_extension<uint64_t> total_ratio;      // the converter's binary extensions, absent in rows it has not upgraded
+            binary_extension<uint64_t> batch_window;
 
             uint64_t primary_key() const { return "settings"_n.value; }
         };
 
+        TABLE reserve_t {
+            name     contract;
+            asset    currency;
+            uint64_t ratio;
+            bool     sale_enabled;
+            binary_extension<double>         price_cumulative;    // the converter's binary extensions, as in settings_t
+            binary_extension<time_point_sec> price_timestamp;
+
+            uint64_t primary_key() const { return currency.symbol.code().raw(); }
+        };
+
+        /**
+         * @brief registered conversion paths, pre-decoded
+         * @details scope: the network account
+         */
+        TABLE route_t {
+            uint64_t          id;
+            vector<route_hop> hops;
+
+            uint64_t primary_key() const { return id; }
+        };
+
         typedef eosio::multi_index<"settings"_n, settings_t> settings;
+        typedef eosio::multi_index<"reserves"_n, reserve_t> reserves;
+        typedef eosio::multi_index<"routes"_n, route_t> routes;
         bool isConverter(name converter);
+
+        std::string_view select_path(const memo_structure& memo_object, asset quantity);
+        asset quote(std::string_view candidate, asset quantity, std::string_view price_limit);
+        bool find_reserve(name converter, symbol_code currency, const settings_t& converter_settings, reserve_t& reserve);
 };
 /** @}*/ // end of @defgroup bancornetwork BancorNetwork
@@ -0,0 +1,55 @@
+
+/**
+ *  @file
+ *  @copyright defined in ../../../LICENSE
+ *
+ *  Per action bump allocation. Every action runs in a fresh instance of the contract whose memory
+ *  goes away with it, so nothing allocated during an action needs to be given back: in the WASM
+ *  build this header replaces the global operator new and delete with a bump pointer over a static
+ *  block, delete only releases what came from malloc once the block is used up. Strings and vectors
+ *  then cost a few instructions instead of a trip through the allocator.
+ *
+ *  Include it from the contract's .cpp, once per contract: it defines the operators. The native
+ *  build (tools/native) runs every contract in one process alongside the host and keeps the
+ *  standard operators.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+namespace arena {
+
+    constexpr size_t BLOCK = 16 * 1024;   // bytes, beyond which allocations go to malloc
+    constexpr size_t ALIGN = 16;
+
+    alignas(ALIGN) inline char block[BLOCK];
+    inline size_t used = 0;
+
+    inline void* allocate(size_t size) {
+        size = (size + ALIGN - 1) & ~(ALIGN - 1);
+        if (size <= BLOCK - used) {
+            void* p = block + used;
+            used += size;
+            return p;
+        }
+        return malloc(size);
+    }
+
+    inline void release(void* p) {
+        if (p < (void*)block || p >= (void*)(block + BLOCK))
+            free(p);
+    }
+}
+
+#if defined(__wasm__)
+
+void* operator new(size_t size) { return arena::allocate(size); }
+void* operator new[](size_t size) { return arena::allocate(size); }
+void operator delete(void* p) noexcept { arena::release(p); }
+void operator delete[](void* p) noexcept { arena::release(p); }
+void operator delete(void* p, size_t) noexcept { arena::release(p); }
+void operator delete[](void* p, size_t) noexcept { arena::release(p); }
+
+#endif
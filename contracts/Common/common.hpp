@@ -2,119 +2,193 @@
 #pragma once
 
 #include <eosio/eosio.hpp>
-#include <eosio/transaction.hpp>
 #include <eosio/asset.hpp>
 #include <eosio/symbol.hpp>
 
+#include <stdint.h>
 #include <string>
+#include <string_view>
 #include <vector>
-#include <iterator>
-#include <algorithm>
-#include <math.h>
+#include "inline_vector.hpp"
 #include "events.hpp"
+#include "curve.hpp"
 
 using namespace eosio;
 using namespace std;
 
-typedef vector<string> path;
+constexpr size_t MAX_HOPS         = 8;
+constexpr size_t MAX_ALTERNATIVES = 8;
+
+typedef inline_vector<std::string_view, 2 * MAX_HOPS> path;
 
 struct converter {
-    name   account;
-    string sym;
+    name             account;
+    std::string_view sym;
 };
 
+// holds views into the memo it was parsed from, which must outlive it
 struct memo_structure {
-    path              path;
-    vector<converter> converters;   
-    string            version;
-    string            min_return;
-    string            dest_account;
-    string            receiver_memo;
+    path                                                 conversion_path;
+    inline_vector<std::string_view, MAX_ALTERNATIVES>    alternatives;     // candidate paths when several are given separated by "|", conversion_path is the first
+    inline_vector<converter, MAX_HOPS>                   converters;   
+    std::string_view                                     version;
+    std::string_view                                     min_return;
+    std::string_view                                     dest_account;
+    std::string_view                                     price_limit;      // optional, lowest marginal rate (to per from token) to fill at
+    std::string_view                                     receiver_memo;
+    uint64_t                                             route = 0;        // id of a registered route when the path is "#<id>", conversion_path is then empty
+    uint32_t                                             route_hop = 0;    // the hop of the route the memo has reached, "#<id>:<hop>"
 };
 
-#define TELOSD_SWAPS "telosd.swaps"_n
-#define TELOSD_BRIDGE "telosd.io"_n
 #define BANCOR_X "bancorxoneos"_n
-#define BANCOR_NETWORK "thisisbancor"_n
-#define BNT_TOKEN "bntbntbntbnt"_n
 
-vector<string> split(const string& str, const string& delim) {
-    vector<string> tokens;
-    size_t prev = 0, pos = 0;
+// splits at every delim into as many tokens as fit and returns how many there are; a trailing delim adds no empty token
+template<size_t N>
+inline size_t split(std::string_view str, char delim, inline_vector<std::string_view, N>& tokens) {
+    size_t prev = 0, pos = 0, count = 0;
+    tokens.clear();
 
     do
     {
         pos = str.find(delim, prev);
-        if (pos == string::npos) pos = str.length();
-        string token = str.substr(prev, pos-prev);
-        tokens.push_back(token);
-        prev = pos + delim.length();
+        if (pos == std::string_view::npos) pos = str.length();
+        if (count++ < N)
+            tokens.push_back(str.substr(prev, pos-prev));
+        prev = pos + 1;
     }
     while (pos < str.length() && prev < str.length());
-    return tokens;
+    return count;
 }
 
-std::string build_memo(memo_structure data) {
-    std::string pathstr = "";
-    for(auto i=0; i < data.path.size(); i++){
-        if(i != 0)
-            pathstr.append(" ");
-        pathstr.append(data.path[i]);
+// parses a string of decimal digits, returns false on anything else
+inline bool parse_uint(std::string_view s, uint64_t& value) {
+    value = 0;
+    for (char c : s) {
+        if (c < '0' || c > '9' || value > (UINT64_MAX - 9) / 10) return false;
+        value = value * 10 + (c - '0');
     }
+    return !s.empty();
+}
+
+// appends the decimal digits of value, without a temporary string
+inline void append_uint(std::string& out, uint64_t value) {
+    char digits[20];
+    size_t count = 0;
+    do digits[count++] = '0' + value % 10; while (value /= 10);
+    while (count) out.push_back(digits[--count]);
+}
 
-    std::string memo = "";
+inline std::string build_memo(const memo_structure& data) {
+    size_t length = data.version.size() + data.min_return.size() + data.dest_account.size() + data.receiver_memo.size() + 4;
+    if (data.route)
+        length += 32;
+    for (const auto& p : data.conversion_path)
+        length += p.size() + 1;
+    if (!data.price_limit.empty())
+        length += data.price_limit.size() + 1;
+
+    std::string memo;
+    memo.reserve(length);
     memo.append(data.version);
     memo.append(",");
-    memo.append(pathstr);
+    for (size_t i = 0; i < data.conversion_path.size(); i++) {
+        if (i != 0)
+            memo.append(" ");
+        memo.append(data.conversion_path[i]);
+    }
+    if (data.route) {
+        memo.append("#");
+        append_uint(memo, data.route);
+        if (data.route_hop) {
+            memo.append(":");
+            append_uint(memo, data.route_hop);
+        }
+    }
     memo.append(",");
     memo.append(data.min_return);
     memo.append(",");
     memo.append(data.dest_account);
+    if (!data.price_limit.empty()) {
+        memo.append(",");
+        memo.append(data.price_limit);
+    }
     memo.append(";");
     memo.append(data.receiver_memo);
     return memo;
 }
 
-/** @dev to_fixed 
- *  formats a number to a fixed precision
- *  e.g. - to_fixed(14.214212, 3) --> 14.214
-*/
-double to_fixed(double num, int precision) {
-    return (int)(num * pow(10, precision)) / pow(10, precision);
-}
-
-memo_structure parse_memo(std::string memo) {
+inline memo_structure parse_memo(std::string_view memo) {
     auto res = memo_structure();
-    auto split_memos = split(memo, ";"); // we separate concantenated memos with ";"
-    auto parts = split(split_memos[0], ","); // split the first memo by ","
+    inline_vector<std::string_view, 2> split_memos;
+    size_t memo_count = split(memo, ';', split_memos); // we separate concantenated memos with ";"
+    inline_vector<std::string_view, 5> parts;
+    check(split(split_memos[0], ',', parts) >= 4, "invalid memo format"); // split the first memo by ","
 
     res.version = parts[0];
 
-    auto path_elements = split(parts[1], " ");
+    inline_vector<std::string_view, MAX_ALTERNATIVES> candidates;
+    size_t candidate_count = split(parts[1], '|', candidates);
+    check(candidate_count <= MAX_ALTERNATIVES, "too many alternative paths");
+    if (candidate_count > 1)
+        res.alternatives = candidates;
+
+    check(split(candidates[0], ' ', res.conversion_path) <= res.conversion_path.capacity(), "conversion path too long");
+    if (res.conversion_path.size() == 1 && res.conversion_path[0] == "")
+        res.conversion_path.clear();
+
+    // a registered route in place of the path, the hops are read from the network's routes table
+    if (res.conversion_path.size() == 1 && res.conversion_path[0][0] == '#') {
+        inline_vector<std::string_view, 2> route_data;
+        uint64_t hop = 0;
+        check(split(res.conversion_path[0].substr(1), ':', route_data) <= 2 && parse_uint(route_data[0], res.route) && res.route > 0 &&
+              (route_data.size() == 1 || (parse_uint(route_data[1], hop) && hop < MAX_HOPS)), "invalid route");
+        res.route_hop = hop;
+        res.conversion_path.clear();
+    }
 
-    if (path_elements.size() == 1 && path_elements[0] == "") {
-        res.path = {};
-    } else
-        res.path = path_elements;
+    for (size_t i = 0; i < res.conversion_path.size(); i += 2) {
+        inline_vector<std::string_view, 2> converter_data;
+        split(res.conversion_path[i], ':', converter_data);
 
-    res.converters = {};
-    for (int i = 0; i < res.path.size(); i += 2) {
-        auto converter_data = split(res.path[i], ":");
-        
         auto cnvrt = converter();
-        cnvrt.account = name(converter_data[0].c_str());
+        cnvrt.account = name(converter_data[0]);
         cnvrt.sym = converter_data.size() > 1 ? converter_data[1] : "";
         res.converters.push_back(cnvrt);
     }
 
-    if (split_memos.size() == 2) {
+    if (memo_count == 2) {
         res.receiver_memo = split_memos[1];
     } else
         res.receiver_memo = "convert"; // default memo for receiver account
 
     res.min_return = parts[2];
     res.dest_account = parts[3];
+    if (parts.size() > 4)
+        res.price_limit = parts[4];
 
     return res;
 }
 
+// parses a decimal string such as a memo's min_return, returns 0 on malformed input
+constexpr float stof(std::string_view s) {
+    float rez = 0, fact = 1;
+    size_t i = 0;
+    
+    if (i < s.size() && s[i] == '-') {
+        i++;
+        fact = -1;
+    }
+    for (int point_seen = 0; i < s.size(); i++) {
+        if (s[i] == '.') {
+            if (point_seen) return 0;
+            point_seen = 1; 
+            continue;
+        }
+        int d = s[i] - '0';
+        if (d >= 0 && d <= 9) {
+            if (point_seen) fact /= 10.0f;
+            rez = rez * 10.0f + (float)d;
+        } else return 0;
+    }
+    return rez * fact;
+}
@@ -0,0 +1,110 @@
+
+/**
+ *  @file
+ *  @copyright defined in ../../../LICENSE
+ *
+ *  Bancor bonding curve math shared by the converter, which executes conversions, the network,
+ *  which quotes paths before forwarding them, and the off-chain route finder in tools/router
+ */
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+
+constexpr double RATIO_DENOMINATOR = 1000000.0;
+constexpr double FEE_DENOMINATOR = 1000000.0;
+
+// powers of ten for the asset precisions (0-18), scaling amounts needs no libm pow
+constexpr double POWERS_OF_TEN[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+                                     1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18 };
+
+constexpr double power10(uint8_t precision) {
+    return POWERS_OF_TEN[precision];
+}
+
+/** @dev to_fixed 
+ *  formats a number to a fixed precision
+ *  e.g. - to_fixed(14.214212, 3) --> 14.214
+*/
+constexpr double to_fixed(double num, uint8_t precision) {
+    return (int)(num * power10(precision)) / power10(precision);
+}
+
+inline double calculate_fee(double amount, uint64_t fee, uint8_t magnitude) {
+    return amount * (1 - pow((1 - fee / FEE_DENOMINATOR), magnitude));
+}
+
+inline double quick_convert(double balance, double in, double toBalance) {
+    return in / (balance + in) * toBalance;
+}
+
+// given a token supply, reserve balance, ratio and a input amount (in the reserve token),
+// calculates the return for a given conversion (in the main token)
+inline double calculate_purchase_return(double balance, double deposit_amount, double supply, int64_t ratio) {
+    double R(supply);
+    double C(balance);
+    double F(ratio / RATIO_DENOMINATOR);
+    double T(deposit_amount);
+    double ONE(1.0);
+
+    double E = -R * (ONE - pow(ONE + T / C, F));
+    return E;
+}
+
+// given a token supply, reserve balance, ratio and a input amount (in the main token),
+// calculates the return for a given conversion (in the reserve token)
+inline double calculate_sale_return(double balance, double sell_amount, double supply, int64_t ratio) {
+    double R(supply);
+    double C(balance);
+    double F(RATIO_DENOMINATOR / ratio);
+    double E(sell_amount);
+    double ONE(1.0);
+
+    double T = C * (ONE - pow(ONE - E/R, F));
+    return T;
+}
+
+// given the balances and ratios of two reserves and an input amount (in the 'from' reserve token),
+// calculates the return (in the 'to' reserve token); equivalent to a purchase followed by a sale
+// against the same smart token supply, which cancels out
+inline double calculate_cross_reserve_return(double from_balance, double amount, int64_t from_ratio, double to_balance, int64_t to_ratio) {
+    if (from_ratio == to_ratio)
+        return quick_convert(from_balance, amount, to_balance);
+
+    double ONE(1.0);
+    double F(double(from_ratio) / to_ratio);
+
+    return to_balance * (ONE - pow(from_balance / (from_balance + amount), F));
+}
+
+// inverse of the marginal purchase rate: the largest deposit (in the reserve token) after which
+// the next reserve token still buys at least `rate` smart tokens
+inline double calculate_purchase_limit(double balance, double supply, int64_t ratio, double rate) {
+    double F(ratio / RATIO_DENOMINATOR);
+    double spot = supply * F / balance;
+
+    if (spot < rate) return 0;
+    if (F == 1) return INFINITY;   // constant rate
+    return balance * (pow(spot / rate, 1 / (1 - F)) - 1);
+}
+
+// inverse of the marginal sale rate: the largest amount of smart tokens after which
+// the next smart token still sells for at least `rate` reserve tokens
+inline double calculate_sale_limit(double balance, double supply, int64_t ratio, double rate) {
+    double F(ratio / RATIO_DENOMINATOR);
+    double spot = balance / (supply * F);
+
+    if (spot < rate) return 0;
+    if (F == 1) return INFINITY;
+    return supply * (1 - pow(rate / spot, F / (1 - F)));
+}
+
+// inverse of the marginal cross reserve rate: the largest amount of the 'from' reserve token after which
+// the next one still converts to at least `rate` 'to' reserve tokens
+inline double calculate_cross_reserve_limit(double from_balance, int64_t from_ratio, double to_balance, int64_t to_ratio, double rate) {
+    double F(double(from_ratio) / to_ratio);
+    double spot = to_balance * F / from_balance;
+
+    if (spot < rate) return 0;
+    return from_balance * (pow(spot / rate, 1 / (F + 1)) - 1);
+}
@@ -0,0 +1,89 @@
+
+/**
+ *  @file
+ *  @copyright defined in ../../../LICENSE
+ *
+ *  A vector whose elements live inside it, for the short lists of a conversion (the hops of a path,
+ *  the reserves of a converter, the records of a log), which then cost no heap allocation. The
+ *  capacity is fixed: going past it fails the action rather than spilling to the heap, so it is
+ *  chosen above anything a valid input needs.
+ */
+#pragma once
+
+#include <eosio/eosio.hpp>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <initializer_list>
+#include <type_traits>
+
+template<typename T, size_t N>
+class inline_vector {
+    static_assert(std::is_trivially_destructible<T>::value, "inline_vector holds views and plain records only");
+
+    public:
+        using value_type = T;
+        using iterator = T*;
+        using const_iterator = const T*;
+
+        inline_vector() = default;
+        inline_vector(std::initializer_list<T> items) {
+            for (const auto& i : items) push_back(i);
+        }
+
+        static constexpr size_t capacity() { return N; }
+        size_t size() const { return _size; }
+        bool empty() const { return _size == 0; }
+
+        T* begin() { return _items; }
+        T* end() { return _items + _size; }
+        const T* begin() const { return _items; }
+        const T* end() const { return _items + _size; }
+
+        T& operator[](size_t i) { return _items[i]; }
+        const T& operator[](size_t i) const { return _items[i]; }
+        T& front() { return _items[0]; }
+        T& back() { return _items[_size - 1]; }
+        const T& front() const { return _items[0]; }
+        const T& back() const { return _items[_size - 1]; }
+
+        void push_back(const T& item) {
+            eosio::check(_size < N, "too many elements");
+            _items[_size++] = item;
+        }
+
+        void clear() { _size = 0; }
+
+        // removes [first, last), keeping the order of the rest
+        void erase(const T* first, const T* last) {
+            T* to = _items + (first - _items);
+            for (const T* from = last; from != end(); ) *to++ = *from++;
+            _size -= last - first;
+        }
+
+    private:
+        T        _items[N] = {};
+        uint32_t _size = 0;
+};
+
+// the wire format of a vector, an action can take either
+template<typename DataStream, typename T, size_t N>
+DataStream& operator<<(DataStream& ds, const inline_vector<T, N>& v) {
+    ds << eosio::unsigned_int(v.size());
+    for (const auto& i : v) ds << i;
+    return ds;
+}
+
+template<typename DataStream, typename T, size_t N>
+DataStream& operator>>(DataStream& ds, inline_vector<T, N>& v) {
+    eosio::unsigned_int s;
+    ds >> s;
+    eosio::check(s.value <= N, "too many elements");
+    v.clear();
+    for (uint32_t i = 0; i < s.value; i++) {
+        T item;
+        ds >> item;
+        v.push_back(item);
+    }
+    return ds;
+}
@@ -0,0 +1,124 @@
+
+/**
+ *  @file
+ *  @copyright defined in ../../../LICENSE
+ *
+ *  Hot path probes for the instrumentation build (`-DSWAPS_PROBES`). An action opens a root with
+ *  PROBE_ACTION, nested stages with PROBE_SCOPE and sequential ones with PROBE_STAGE; table operations,
+ *  inline actions (and the bytes they pack) and loop iterations are attributed to the innermost open
+ *  stage and, when the root closes, printed as one `probes` event, leaving out stages that counted nothing:
+ *
+ *  {"version":"1.0","etype":"probes","action":"on_transfer","reserves":"r3 w0 i0 b0 n0","balances":"r3 w0 i0 b0 n0",...}
+ *
+ *  In the normal build every macro expands to nothing (PROBE_SEND to a plain `send()`), so production
+ *  WASM is unchanged.
+ */
+#pragma once
+
+#ifdef SWAPS_PROBES
+
+#include <string.h>
+
+#include "events.hpp"
+
+namespace probes {
+
+    struct counters {
+        const char* stage;
+        uint32_t    reads;
+        uint32_t    writes;
+        uint32_t    inlines;
+        uint32_t    bytes;
+        uint32_t    iterations;
+    };
+
+    constexpr int MAX_STAGES = 16;
+
+    inline counters stages[MAX_STAGES];
+    inline int      stage_count = 0;
+    inline int      current = -1;
+    inline int      depth = 0;
+
+    inline int stage_index(const char* stage) {
+        for (int i = 0; i < stage_count; i++)
+            if (stages[i].stage == stage || strcmp(stages[i].stage, stage) == 0) return i;
+        if (stage_count == MAX_STAGES) return MAX_STAGES - 1;
+        stages[stage_count] = { stage, 0, 0, 0, 0, 0 };
+        return stage_count++;
+    }
+
+    inline bool idle(const counters& c) { return !(c.reads | c.writes | c.inlines | c.bytes | c.iterations); }
+
+    inline counters* active() { return current >= 0 ? &stages[current] : nullptr; }
+
+    struct scope {
+        int previous;
+        explicit scope(const char* stage) : previous(current) { depth++; current = stage_index(stage); }
+        ~scope() { current = previous; depth--; }
+    };
+
+    // the root scope, prints the summary when the action's probes close
+    struct action_scope {
+        const char* action;
+        scope       root;
+        explicit action_scope(const char* a) : action(a), root(a) {}
+        ~action_scope() {
+            if (depth > 1) return;   // nested call of another probed entry point, the outer one reports
+
+            bool counted = false;
+            for (int i = 0; i < stage_count; i++)
+                counted |= !idle(stages[i]);
+            if (counted) {
+                START_EVENT("probes", "1.0")
+                print('"'); print("action"); print("\":\""); print(action); print('"');
+                for (int i = 0; i < stage_count; i++) {
+                    const auto& c = stages[i];
+                    if (idle(c)) continue;
+                    print(",\""); print(c.stage); print("\":\"");
+                    print("r", c.reads, " w", c.writes, " i", c.inlines, " b", c.bytes, " n", c.iterations);
+                    print('"');
+                }
+                END_EVENT()
+            }
+            stage_count = 0;   // native runs reuse the globals across actions
+        }
+    };
+
+    // moves to the next stage of the enclosing scope, which restores the outer stage when it closes
+    inline void enter(const char* stage) { current = stage_index(stage); }
+
+    inline void count(uint32_t counters::*field, uint32_t n) {
+        if (auto c = active()) c->*field += n;
+    }
+
+    inline void send(const eosio::action& act) {
+        if (auto c = active()) {
+            c->inlines++;
+            c->bytes += act.data.size();
+        }
+        act.send();
+    }
+}
+
+#define PROBE_CONCAT_(a, b) a##b
+#define PROBE_CONCAT(a, b) PROBE_CONCAT_(a, b)
+
+#define PROBE_ACTION(name)  probes::action_scope PROBE_CONCAT(_probe_action_, __LINE__)(name)
+#define PROBE_SCOPE(name)   probes::scope PROBE_CONCAT(_probe_scope_, __LINE__)(name)
+#define PROBE_STAGE(name)   probes::enter(name)
+#define PROBE_READ(n)       probes::count(&probes::counters::reads, n)
+#define PROBE_WRITE(n)      probes::count(&probes::counters::writes, n)
+#define PROBE_ITERATION()   probes::count(&probes::counters::iterations, 1)
+#define PROBE_SEND(act)     probes::send(act)
+
+#else
+
+#define PROBE_ACTION(name)
+#define PROBE_SCOPE(name)
+#define PROBE_STAGE(name)
+#define PROBE_READ(n)
+#define PROBE_WRITE(n)
+#define PROBE_ITERATION()
+#define PROBE_SEND(act)     (act).send()
+
+#endif
@@ -0,0 +1,101 @@
+
+/**
+ *  @file
+ *  @copyright defined in ../../../LICENSE
+ *
+ *  Fixed size streaming sketches, kept in table rows that are updated in place.
+ *
+ *  Quantiles: values fall in log spaced buckets, bucket i holding (gamma^(i-1), gamma^i], so that
+ *  any quantile is returned within a relative error of (gamma - 1) / (gamma + 1). The counts are a
+ *  window of consecutive buckets starting at `offset`; past `max_buckets` the lowest buckets are
+ *  merged, trading accuracy on the smallest values for a bounded size.
+ *
+ *  Distinct counts: a HyperLogLog, one register per 2^-p of the hash space holding the longest run
+ *  of leading zeros seen there, with a standard error of 1.04 / sqrt(registers).
+ */
+#pragma once
+
+#include <algorithm>
+#include <math.h>
+#include <stdint.h>
+#include <vector>
+
+inline int32_t quantile_bucket(double value, double gamma) {
+    return int32_t(ceil(log(value) / log(gamma)));
+}
+
+inline void quantile_add(int32_t& offset, std::vector<uint32_t>& counts, double value, double gamma, size_t max_buckets) {
+    int32_t bucket = quantile_bucket(value, gamma);
+    if (counts.empty()) {
+        offset = bucket;
+        counts.push_back(1);
+        return;
+    }
+    int32_t top = offset + int32_t(counts.size()) - 1;
+    if (bucket > top) {
+        counts.resize(bucket - offset + 1, 0);
+        if (counts.size() > max_buckets) {
+            // the lowest buckets fold into the lowest one kept
+            size_t fold = counts.size() - max_buckets;
+            for (size_t i = 0; i < fold; i++)
+                counts[fold] += counts[i];
+            counts.erase(counts.begin(), counts.begin() + fold);
+            offset += fold;
+        }
+    }
+    else if (bucket < offset) {
+        bucket = std::max(bucket, top - int32_t(max_buckets) + 1);
+        counts.insert(counts.begin(), offset - bucket, 0);
+        offset = bucket;
+    }
+    counts[bucket - offset]++;
+}
+
+// the value of rank q * (count - 1), 0 for an empty sketch
+inline double quantile_at(int32_t offset, const std::vector<uint32_t>& counts, double q, double gamma) {
+    uint64_t total = 0;
+    for (auto c : counts) total += c;
+    if (total == 0) return 0;
+
+    double rank = q * (total - 1);
+    uint64_t seen = 0;
+    size_t i = 0;
+    for (; i + 1 < counts.size(); i++) {
+        seen += counts[i];
+        if (seen > rank) break;
+    }
+    // the middle of the bucket in relative terms
+    return 2 * pow(gamma, offset + int32_t(i)) / (gamma + 1);
+}
+
+// splitmix64's finaliser, spreads account names over the hash space
+inline uint64_t sketch_hash(uint64_t v) {
+    v ^= v >> 30; v *= 0xbf58476d1ce4e5b9ULL;
+    v ^= v >> 27; v *= 0x94d049bb133111ebULL;
+    return v ^ (v >> 31);
+}
+
+// registers.size() must be a power of 2
+inline void distinct_add(std::vector<uint8_t>& registers, uint64_t value) {
+    uint64_t hash = sketch_hash(value);
+    uint32_t bits = __builtin_ctzll(registers.size());
+    uint64_t rest = hash << bits;
+    uint8_t run = rest == 0 ? 64 - bits + 1 : __builtin_clzll(rest) + 1;
+    auto& r = registers[hash >> (64 - bits)];
+    if (run > r) r = run;
+}
+
+inline uint64_t distinct_estimate(const std::vector<uint8_t>& registers) {
+    double m = registers.size();
+    double sum = 0;
+    size_t zeros = 0;
+    for (auto r : registers) {
+        sum += ldexp(1.0, -int(r));
+        zeros += r == 0;
+    }
+    double estimate = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+    // few distinct values leave registers empty, count those instead
+    if (estimate <= 2.5 * m && zeros > 0)
+        estimate = m * log(m / zeros);
+    return uint64_t(llround(estimate));
+}
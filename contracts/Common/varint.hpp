@@ -0,0 +1,42 @@
+
+/**
+ *  @file
+ *  @copyright defined in ../../../LICENSE
+ *
+ *  LEB128 varints, 7 bits a byte with the high bit marking that more follow, and zigzag mapping of
+ *  signed values so that small deltas of either sign take one or two bytes. Used by compact history
+ *  rows that are appended to in place.
+ */
+#pragma once
+
+#include <eosio/check.hpp>
+
+#include <stdint.h>
+#include <vector>
+
+inline uint64_t zigzag(int64_t v) {
+    return (uint64_t(v) << 1) ^ uint64_t(v >> 63);
+}
+
+inline int64_t unzigzag(uint64_t v) {
+    return int64_t(v >> 1) ^ -int64_t(v & 1);
+}
+
+inline void put_varint(std::vector<char>& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(char(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(char(v));
+}
+
+// reads the varint at `pos` and moves past it
+inline uint64_t get_varint(const std::vector<char>& in, size_t& pos) {
+    uint64_t v = 0;
+    for (int shift = 0; ; shift += 7) {
+        eosio::check(pos < in.size() && shift < 64, "malformed varint");
+        uint8_t b = in[pos++];
+        v |= uint64_t(b & 0x7f) << shift;
+        if (!(b & 0x80)) return v;
+    }
+}
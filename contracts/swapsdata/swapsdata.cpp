@@ -1,23 +1,29 @@
 #include "swapsdata.hpp"
+#include "../Common/probes.hpp"
+#include "../Common/arena.hpp"
+#include "../Common/varint.hpp"
+#include "../Common/sketch.hpp"
 
 /**------------------------------------------------------------------------------------------------
- * @param converter
+ * @param _buffer
  * @param last_state
  * @param swap_data
  */
-void swapsdata::update_day_buffer( name converter, day_buffer_row last_state, vector<swap_record> swap_data ) {
-    day_buffer_table _buffer( get_self(), converter.value );
+void swapsdata::update_day_buffer( day_buffer_table& _buffer, const day_buffer_row& last_state, const vector<swap_record>& swap_data ) {
     const time_point_sec& timestamp = time_point_sec( (current_time_point().sec_since_epoch() / DAY_HISTORY_INTERVALS) * DAY_HISTORY_INTERVALS );
     auto itr = _buffer.find(timestamp.sec_since_epoch());
+    PROBE_READ(1);
 
     if (itr == _buffer.end()) {
+        PROBE_WRITE(1);
         _buffer.emplace( get_self(), [&]( auto& row ) {
             row.timestamp = timestamp;
             // volume_cumulative
             row.volume_cumulative = last_state.volume_cumulative;
             // price
             row.base_price = last_state.base_price;
-            for (const swap_record swap_data_point : swap_data) {
+            for (const swap_record& swap_data_point : swap_data) {
+                PROBE_ITERATION();
                 const auto &sym_code = swap_data_point.quantity.symbol.code();
                 row.volume[sym_code] = swap_data_point.quantity;
                 row.open_price[sym_code] = swap_data_point.price;
@@ -31,8 +37,10 @@ void swapsdata::update_day_buffer( name converter, day_buffer_row last_state, ve
          * note, the assumption has been made that all map objects always have counters for all symbol codes initialised.
          * checks are skipped from this routing. If this is not true it is likely to break the contract
          */
+        PROBE_WRITE(1);
         _buffer.modify( itr, same_payer, [&]( auto & row ) {
-            for ( const swap_record swap_data_point : swap_data ) {
+            for ( const swap_record& swap_data_point : swap_data ) {
+                PROBE_ITERATION();
                 const auto &sym_code = swap_data_point.quantity.symbol.code();
                 // assuming entry is always made into map on record creation, skipping test if symbol in map
                 row.volume[sym_code] += swap_data_point.quantity;
@@ -47,18 +55,20 @@ void swapsdata::update_day_buffer( name converter, day_buffer_row last_state, ve
 
 /**------------------------------------------------------------------------------------------------
  *
- * @param converter
+ * @param _buffer
  * @param swap_data
  */
-void swapsdata::update_month_buffer( name converter, vector<swap_record> swap_data ) {
-    month_buffer_table _buffer( get_self(), converter.value );
+void swapsdata::update_month_buffer( month_buffer_table& _buffer, const vector<swap_record>& swap_data ) {
     const time_point_sec& timestamp = time_point_sec( (current_time_point().sec_since_epoch() / MONTH_HISTORY_INTERVALS) * MONTH_HISTORY_INTERVALS );
     auto itr = _buffer.find(timestamp.sec_since_epoch());
+    PROBE_READ(1);
 
     if ( itr == _buffer.end() ) {
+        PROBE_WRITE(1);
         _buffer.emplace( get_self(), [&]( auto& row ) {
             row.timestamp = timestamp;
-            for (const swap_record swap_data_point : swap_data) {
+            for (const swap_record& swap_data_point : swap_data) {
+                PROBE_ITERATION();
                 const auto& sym_code = swap_data_point.quantity.symbol.code();
                 row.open_smart_price[sym_code] = swap_data_point.smart_price;
             }
@@ -69,27 +79,31 @@ void swapsdata::update_month_buffer( name converter, vector<swap_record> swap_da
 /**------------------------------------------------------------------------------------------------
  *
  */
-swapsdata::day_buffer_row swapsdata::get_last_state( name converter, vector<swap_record> swap_data, day_buffer_row base_data ) {
-    trade_data_table _trade_data(get_self(), get_self().value);
+swapsdata::day_buffer_row swapsdata::get_last_state( const trade_data_table& _trade_data, name converter, const vector<swap_record>& swap_data, const day_buffer_row& base_data ) {
     auto itr = _trade_data.find(converter.value);
+    PROBE_READ(1);
 
     day_buffer_row last_state;
 
     if (itr == _trade_data.end()) {
-        for (const swap_record swap_data_point : swap_data) {
+        for (const swap_record& swap_data_point : swap_data) {
+            PROBE_ITERATION();
             const auto &sym_code = swap_data_point.quantity.symbol.code();
             last_state.volume_cumulative[sym_code] = asset(0, swap_data_point.quantity.symbol);
             last_state.base_price[sym_code] = swap_data_point.price;
         }
     } else {
-        auto td = *itr;
-        for ( const swap_record swap_data_point : swap_data ) {
+        const auto& td = *itr;
+        for ( const swap_record& swap_data_point : swap_data ) {
+            PROBE_ITERATION();
             const auto& sym_code = swap_data_point.quantity.symbol.code();
-            auto base_volume = ( base_data.volume_cumulative.find( sym_code ) == base_data.volume_cumulative.end()) ?
-                    asset(0, swap_data_point.quantity.symbol) : base_data.volume_cumulative[sym_code];
+            auto base_itr = base_data.volume_cumulative.find( sym_code );
+            auto base_volume = ( base_itr == base_data.volume_cumulative.end()) ?
+                    asset(0, swap_data_point.quantity.symbol) : base_itr->second;
 
-            last_state.volume_cumulative[sym_code] = ( td.volume_cumulative.find( sym_code ) == td.volume_cumulative.end()) ?
-                    base_volume : td.volume_cumulative[sym_code];
+            auto td_itr = td.volume_cumulative.find( sym_code );
+            last_state.volume_cumulative[sym_code] = ( td_itr == td.volume_cumulative.end()) ?
+                    base_volume : td_itr->second;
 
             last_state.base_price[sym_code] = swap_data_point.price;
         }
@@ -99,24 +113,31 @@ swapsdata::day_buffer_row swapsdata::get_last_state( name converter, vector<swap
 }
 
 /**------------------------------------------------------------------------------------------------
+ * the tables are the ones the base states were read from, so that no row is deserialized twice
  * @param converter
  * @param swap_data
  * @param base_data
+ * @param smart_base_data
+ * @param _trade_data
+ * @param day_buffer
+ * @param month_buffer
  */
-void swapsdata::update_trade_data( name converter, vector<swap_record> swap_data, day_buffer_row base_data, month_buffer_row smart_base_data ) {
-    trade_data_table _trade_data( get_self(), get_self().value );
-
+void swapsdata::update_trade_data( name converter, const vector<swap_record>& swap_data, const day_buffer_row& base_data, const month_buffer_row& smart_base_data,
+                                   trade_data_table& _trade_data, day_buffer_table& day_buffer, month_buffer_table& month_buffer ) {
     // data for 24hr buffer
-    day_buffer_row last_state = get_last_state( converter, swap_data, base_data );
+    day_buffer_row last_state = get_last_state( _trade_data, converter, swap_data, base_data );
 
     //
     auto itr = _trade_data.find(converter.value);
+    PROBE_READ(1);
 
     if ( itr == _trade_data.end() ) {
+        PROBE_WRITE(1);
         _trade_data.emplace( get_self(), [&]( auto& row ) {
             row.converter = converter;
             row.timestamp = current_time_point();
-            for ( const swap_record swap_data_point : swap_data ) {
+            for ( const swap_record& swap_data_point : swap_data ) {
+                PROBE_ITERATION();
                 const auto& sym_code = swap_data_point.quantity.symbol.code();
                 // volume_24h
                 row.volume_24h[sym_code] = swap_data_point.quantity;
@@ -136,14 +157,17 @@ void swapsdata::update_trade_data( name converter, vector<swap_record> swap_data
         });
 
     } else {
+        PROBE_WRITE(1);
         _trade_data.modify( itr, same_payer, [&]( auto & row ) {
             row.timestamp = current_time_point();
 
-            for ( const swap_record swap_data_point : swap_data ) {
+            for ( const swap_record& swap_data_point : swap_data ) {
+                PROBE_ITERATION();
                 const auto& sym_code = swap_data_point.quantity.symbol.code();
                 // base_data.volume_cumulative[sym_code] - is sufficient
-                auto base_volume = ( base_data.volume_cumulative.find( sym_code ) == base_data.volume_cumulative.end()) ?
-                                   asset(0, swap_data_point.quantity.symbol) : base_data.volume_cumulative[sym_code];
+                auto base_itr = base_data.volume_cumulative.find( sym_code );
+                auto base_volume = ( base_itr == base_data.volume_cumulative.end()) ?
+                                   asset(0, swap_data_point.quantity.symbol) : base_itr->second;
                 // volume_24h
                 row.volume_24h[sym_code] = last_state.volume_cumulative[sym_code] + swap_data_point.quantity - base_volume;
                 // volume_cumulative
@@ -151,8 +175,9 @@ void swapsdata::update_trade_data( name converter, vector<swap_record> swap_data
                 // price
                 row.price[sym_code] = swap_data_point.price;
 
-                auto base_price = ( base_data.base_price.find( sym_code ) == base_data.base_price.end()) ?
-                                  swap_data_point.price : base_data.base_price[sym_code];
+                auto price_itr = base_data.base_price.find( sym_code );
+                auto base_price = ( price_itr == base_data.base_price.end()) ?
+                                  swap_data_point.price : price_itr->second;
                 // price_change_24h
                 row.price_change_24h[sym_code] = swap_data_point.price - base_price;
                 // liquidity depth
@@ -161,40 +186,46 @@ void swapsdata::update_trade_data( name converter, vector<swap_record> swap_data
                 row.smart_price[sym_code] = swap_data_point.smart_price;
 
                 // smart_price_change_30d
-                row.smart_price_change_30d[sym_code] = swap_data_point.smart_price - smart_base_data.open_smart_price[sym_code];
+                auto open_itr = smart_base_data.open_smart_price.find( sym_code );
+                auto open_smart_price = ( open_itr == smart_base_data.open_smart_price.end()) ? 0.0 : open_itr->second;
+                row.smart_price_change_30d[sym_code] = swap_data_point.smart_price - open_smart_price;
             }
         });
     }
 
-    update_day_buffer( converter, last_state, swap_data );
-    update_month_buffer( converter, swap_data );
+    PROBE_STAGE("day_buffer");
+    update_day_buffer( day_buffer, last_state, swap_data );
+    PROBE_STAGE("month_buffer");
+    update_month_buffer( month_buffer, swap_data );
 }
 
 /**------------------------------------------------------------------------------------------------
- * @param converter
+ * @param _buffer
  * @param swap_data
  * @return
  */
 
-swapsdata::month_buffer_row swapsdata::get_smart_base_state(name converter, vector<swap_record> swap_data) {
-    month_buffer_table _buffer( get_self(), converter.value );
-
+swapsdata::month_buffer_row swapsdata::get_smart_base_state(month_buffer_table& _buffer, const vector<swap_record>& swap_data) {
     const time_point_sec& timestamp = time_point_sec( (current_time_point().sec_since_epoch() / MONTH_HISTORY_INTERVALS) * MONTH_HISTORY_INTERVALS );
 
+    PROBE_READ(1);
     // Smart returns based on 30 day history
     if ( _buffer.find(timestamp.sec_since_epoch()) == _buffer.end() ) {
         auto it = _buffer.begin();
         while ( (it != _buffer.end()) && (it->timestamp.sec_since_epoch() < ( current_time_point()-days(30) ).sec_since_epoch()) ) {
+            PROBE_WRITE(1);
             it = _buffer.erase(it);
         }
     }
 
     // combine 30d data
     auto it = _buffer.begin();
+    PROBE_READ(1);
     if ( it == _buffer.end() ) {
         month_buffer_row smart_base_data;
         smart_base_data.timestamp = timestamp;
-        for ( const swap_record swap_data_point : swap_data ) {
+        for ( const swap_record& swap_data_point : swap_data ) {
+            PROBE_ITERATION();
             auto sym_code = swap_data_point.quantity.symbol.code();
             smart_base_data.open_smart_price[sym_code] = swap_data_point.smart_price;
         }
@@ -206,29 +237,31 @@ swapsdata::month_buffer_row swapsdata::get_smart_base_state(name converter, vect
 
 
 /**------------------------------------------------------------------------------------------------
- * @param converter
+ * @param _buffer
  * @param swap_data
  * @return
  */
-swapsdata::day_buffer_row swapsdata::get_base_state(name converter, vector<swap_record> swap_data) {
-    day_buffer_table _buffer( get_self(), converter.value );
-
+swapsdata::day_buffer_row swapsdata::get_base_state(day_buffer_table& _buffer, const vector<swap_record>& swap_data) {
     const time_point_sec& timestamp = time_point_sec( (current_time_point().sec_since_epoch() / DAY_HISTORY_INTERVALS) * DAY_HISTORY_INTERVALS );
 
+    PROBE_READ(1);
     // Limit history to 24 hours (1 day), only clean up if new hour
     if ( _buffer.find(timestamp.sec_since_epoch()) == _buffer.end() ) {
         auto it = _buffer.begin();
         while ( (it != _buffer.end()) && (it->timestamp.sec_since_epoch() < ( current_time_point()-days(1) ).sec_since_epoch()) ) {
+            PROBE_WRITE(1);
             it = _buffer.erase(it);
         }
     }
 
     // combine 24h data
     auto it = _buffer.begin();
+    PROBE_READ(1);
     if ( it == _buffer.end() ) {
         day_buffer_row base_data;
         base_data.timestamp = timestamp;
-        for ( const swap_record swap_data_point : swap_data ) {
+        for ( const swap_record& swap_data_point : swap_data ) {
+            PROBE_ITERATION();
             auto sym_code = swap_data_point.quantity.symbol.code();
             base_data.volume_cumulative[sym_code] = asset(0, swap_data_point.quantity.symbol );
             base_data.base_price[sym_code] = swap_data_point.price;
@@ -240,14 +273,354 @@ swapsdata::day_buffer_row swapsdata::get_base_state(name converter, vector<swap_
 }
 
 /**------------------------------------------------------------------------------------------------
+ * @param open
+ * @param swap_data
+ */
+void swapsdata::add_candles( vector<candle_ticks>& open, const vector<swap_record>& swap_data ) {
+    for ( const swap_record& swap_data_point : swap_data ) {
+        PROBE_ITERATION();
+        if ( !(swap_data_point.price > 0) ) continue;
+        int64_t tick = llround( ::log(swap_data_point.price) / ARCHIVE_PRICE_TICK );   // the log action hides log()
+        auto c = std::find_if( open.begin(), open.end(), [&]( const auto& o ) { return o.sym == swap_data_point.quantity.symbol; } );
+        if ( c == open.end() ) {
+            open.push_back( { swap_data_point.quantity.symbol, tick, tick, tick, tick, swap_data_point.quantity.amount } );
+        } else {
+            c->high = max(c->high, tick);
+            c->low = min(c->low, tick);
+            c->close = tick;
+            c->volume += swap_data_point.quantity.amount;
+        }
+    }
+}
+
+/**------------------------------------------------------------------------------------------------
+ * see candle_block for the layout
+ * @param block
+ */
+void swapsdata::encode_candles( candle_block& block ) {
+    put_varint( block.data, block.current - (block.count == 0 ? block.first : block.last) );
+    put_varint( block.data, block.open.size() );
+    for ( const auto& c : block.open ) {
+        size_t index = std::find( block.symbols.begin(), block.symbols.end(), c.sym ) - block.symbols.begin();
+        if ( index == block.symbols.size() ) {
+            // the first open of a token in a block is stored as is
+            block.symbols.push_back( c.sym );
+            block.closes.push_back( 0 );
+        }
+        put_varint( block.data, index );
+        put_varint( block.data, zigzag(c.open - block.closes[index]) );
+        put_varint( block.data, c.high - max(c.open, c.close) );
+        put_varint( block.data, min(c.open, c.close) - c.low );
+        put_varint( block.data, zigzag(c.close - c.open) );
+        put_varint( block.data, max(c.volume, int64_t(0)) );
+        block.closes[index] = c.close;
+    }
+    block.last = block.current;
+    block.count++;
+    block.open.clear();
+}
+
+/**------------------------------------------------------------------------------------------------
+ * @param interval
+ * @param c
+ * @return the candle in asset and price terms
+ */
+static swapsdata::candle_record to_record( uint32_t interval, const swapsdata::candle_ticks& c ) {
+    return { time_point_sec( interval * ARCHIVE_INTERVAL ), asset( c.volume, c.sym ),
+             exp( c.open * ARCHIVE_PRICE_TICK ), exp( c.high * ARCHIVE_PRICE_TICK ),
+             exp( c.low * ARCHIVE_PRICE_TICK ), exp( c.close * ARCHIVE_PRICE_TICK ) };
+}
+
+/**------------------------------------------------------------------------------------------------
+ * adds the candles of a block whose interval is in [from, to] to result
+ * @param block
+ * @param from
+ * @param to
+ * @param result
+ */
+static void decode_candles( const swapsdata::candle_block& block, uint32_t from, uint32_t to, vector<swapsdata::candle_record>& result ) {
+    vector<int64_t> closes( block.symbols.size(), 0 );
+    uint32_t interval = block.first;
+    size_t pos = 0;
+
+    for ( uint32_t i = 0; i < block.count && interval <= to; i++ ) {
+        interval += get_varint( block.data, pos );
+        uint64_t candles = get_varint( block.data, pos );
+        for ( uint64_t k = 0; k < candles; k++ ) {
+            uint64_t index = get_varint( block.data, pos );
+            check( index < block.symbols.size(), "malformed candle block" );
+
+            swapsdata::candle_ticks c;
+            c.sym    = block.symbols[index];
+            c.open   = closes[index] + unzigzag( get_varint( block.data, pos ) );
+            int64_t above = get_varint( block.data, pos );
+            int64_t below = get_varint( block.data, pos );
+            c.close  = c.open + unzigzag( get_varint( block.data, pos ) );
+            c.high   = max(c.open, c.close) + above;
+            c.low    = min(c.open, c.close) - below;
+            c.volume = get_varint( block.data, pos );
+            closes[index] = c.close;
+
+            if ( interval >= from && interval <= to )
+                result.push_back( to_record(interval, c) );
+        }
+    }
+
+    if ( block.current >= from && block.current <= to ) {
+        for ( const auto& c : block.open )
+            result.push_back( to_record(block.current, c) );
+    }
+}
+
+/**------------------------------------------------------------------------------------------------
+ * adds the swaps to the candles of the current interval, closing the previous interval of the
+ * converter's last archive block first and starting a new block when that one is full
+ * @param converter
+ * @param swap_data
+ */
+void swapsdata::update_archive( name converter, const vector<swap_record>& swap_data ) {
+    candle_block_table _archive( get_self(), converter.value );
+    uint32_t interval = current_time_point().sec_since_epoch() / ARCHIVE_INTERVAL;
+
+    auto start_block = [&]() {
+        PROBE_WRITE(1);
+        _archive.emplace( get_self(), [&]( auto& row ) {
+            row.first = row.last = row.current = interval;
+            row.count = 0;
+            row.sealed = false;
+            add_candles( row.open, swap_data );
+        });
+    };
+
+    PROBE_READ(1);
+    if ( _archive.begin() == _archive.end() ) {
+        start_block();
+        return;
+    }
+
+    auto itr = --_archive.end();
+    bool sealed = false;
+    PROBE_WRITE(1);
+    _archive.modify( itr, same_payer, [&]( auto& row ) {
+        if ( row.current != interval ) {
+            if ( !row.open.empty() ) encode_candles( row );
+            row.sealed = sealed = row.data.size() >= ARCHIVE_BLOCK_BYTES;
+            row.current = interval;
+        }
+        if ( !row.sealed ) add_candles( row.open, swap_data );
+    });
+    if ( sealed ) start_block();
+}
+
+/**------------------------------------------------------------------------------------------------
+ * adds the swap to the converter's flow sketch of the day, starting the day's row when it is the
+ * first swap and rotating out the rows past FLOW_DAYS
  * @param converter
  * @param swap_data
+ * @param trader
+ */
+void swapsdata::update_flow( name converter, const vector<swap_record>& swap_data, const binary_extension<name>& trader ) {
+    flow_sketch_table _flow( get_self(), converter.value );
+    uint32_t day = current_time_point().sec_since_epoch() / FLOW_INTERVAL;
+
+    auto add = [&]( auto& row ) {
+        row.trades++;
+        for ( const swap_record& swap_data_point : swap_data ) {
+            PROBE_ITERATION();
+            if ( swap_data_point.quantity.amount <= 0 ) continue;
+            auto s = std::find_if( row.sizes.begin(), row.sizes.end(), [&]( const auto& k ) { return k.sym == swap_data_point.quantity.symbol; } );
+            if ( s == row.sizes.end() ) {
+                if ( row.sizes.size() >= FLOW_SIZE_TOKENS ) continue;
+                s = row.sizes.insert( s, { swap_data_point.quantity.symbol, 0, {} } );
+            }
+            quantile_add( s->offset, s->counts, swap_data_point.quantity.amount, FLOW_SIZE_GAMMA, FLOW_SIZE_BUCKETS );
+        }
+        if ( trader.has_value() ) distinct_add( row.traders, trader.value().value );
+    };
+
+    auto itr = _flow.find( day );
+    PROBE_READ(1);
+    PROBE_WRITE(1);
+    if ( itr != _flow.end() ) {
+        _flow.modify( itr, same_payer, add );
+        return;
+    }
+
+    for ( auto it = _flow.begin(); it != _flow.end() && it->day + FLOW_DAYS <= day; ) {
+        PROBE_WRITE(1);
+        it = _flow.erase( it );
+    }
+    _flow.emplace( get_self(), [&]( auto& row ) {
+        row.day = day;
+        row.trades = 0;
+        row.traders.assign( FLOW_TRADER_REGISTERS, 0 );
+        add( row );
+    });
+}
+
+/**------------------------------------------------------------------------------------------------
+ * @param converter
+ * @param day
+ * @param quantiles
+ * @return
  */
-void swapsdata::log(name converter, vector<swap_record> swap_data) {
-    // TODO this contract could be called by a fake converter to consume contract RAM. Shut down this exploit
-    // TODO we should use converter whitelist and ignore actions in converter is not whitelisted
+swapsdata::flow_stats swapsdata::flow( name converter, time_point_sec day, vector<double> quantiles ) {
+    for ( double q : quantiles )
+        check( q >= 0 && q <= 1, "quantiles must be between 0 and 1" );
+
+    flow_sketch_table _flow( get_self(), converter.value );
+    const auto& row = _flow.get( day.sec_since_epoch() / FLOW_INTERVAL, "no trade flow kept for that day" );
+
+    flow_stats stats;
+    stats.day = time_point_sec( row.day * FLOW_INTERVAL );
+    stats.trades = row.trades;
+    stats.traders = distinct_estimate( row.traders );
+    for ( const auto& s : row.sizes ) {
+        size_quantiles sizes{ s.sym, {} };
+        for ( double q : quantiles )
+            sizes.sizes.push_back( asset( llround( quantile_at( s.offset, s.counts, q, FLOW_SIZE_GAMMA ) ), s.sym ) );
+        stats.sizes.push_back( sizes );
+    }
+    return stats;
+}
+
+/**------------------------------------------------------------------------------------------------
+ * @param converter
+ * @param from
+ * @param to
+ * @return
+ */
+vector<swapsdata::candle_record> swapsdata::candles(name converter, time_point_sec from, time_point_sec to) {
+    check( from <= to, "from must not be after to" );
+    // the intervals that start in [from, to]
+    return read_candles( converter, (from.sec_since_epoch() + ARCHIVE_INTERVAL - 1) / ARCHIVE_INTERVAL, to.sec_since_epoch() / ARCHIVE_INTERVAL );
+}
+
+/**------------------------------------------------------------------------------------------------
+ * @param converter
+ * @param first
+ * @param last
+ * @return the archived candles of the intervals [first, last]
+ */
+vector<swapsdata::candle_record> swapsdata::read_candles( name converter, uint32_t first, uint32_t last ) {
+    candle_block_table _archive( get_self(), converter.value );
+    auto itr = _archive.upper_bound( first );
+    if ( itr != _archive.begin() ) --itr;   // the block that may hold `first`
+
+    vector<candle_record> result;
+    for ( ; itr != _archive.end() && itr->first <= last; ++itr )
+        decode_candles( *itr, first, last, result );
+    return result;
+}
+
+/**------------------------------------------------------------------------------------------------
+ * @param converter
+ * @param swap_data
+ * @param trader
+ */
+void swapsdata::log(name converter, vector<swap_record> swap_data, binary_extension<name> trader) {
+    PROBE_ACTION("log");
     check(has_auth(converter), "this action can only be called by a swaps converter");
-    update_trade_data( converter, swap_data, get_base_state(converter, swap_data), get_smart_base_state(converter, swap_data) );
+
+    // a converter that is not whitelisted would consume contract RAM, its logs are ignored; one that was
+    // recording before the whitelist existed has trade data and is whitelisted by its first log since
+    converter_table _converters( get_self(), get_self().value );
+    trade_data_table _trade_data( get_self(), get_self().value );
+    PROBE_READ(1);
+    if ( _converters.find(converter.value) == _converters.end() ) {
+        PROBE_READ(1);
+        if ( _trade_data.find(converter.value) == _trade_data.end() ) return;
+        PROBE_WRITE(1);
+        _converters.emplace( get_self(), [&]( auto& row ) {
+            row.converter = converter;
+        });
+    }
+
+    // one instance of each table for the whole log, each keeps the rows it has read
+    day_buffer_table day_buffer( get_self(), converter.value );
+    month_buffer_table month_buffer( get_self(), converter.value );
+
+    PROBE_STAGE("base_state");
+    auto base_data = get_base_state(day_buffer, swap_data);
+    PROBE_STAGE("smart_base_state");
+    auto smart_base_data = get_smart_base_state(month_buffer, swap_data);
+    PROBE_STAGE("trade_data");
+    update_trade_data( converter, swap_data, base_data, smart_base_data, _trade_data, day_buffer, month_buffer );
+    PROBE_STAGE("archive");
+    update_archive( converter, swap_data );
+    PROBE_STAGE("flow");
+    update_flow( converter, swap_data, trader );
+    PROBE_STAGE("changes");
+    stamp( converter );
+}
+
+/**------------------------------------------------------------------------------------------------
+ * gives the converter's rows the next sequence
+ * @param converter
+ */
+void swapsdata::stamp( name converter ) {
+    state_table _state( get_self(), get_self().value );
+    auto state = _state.get_or_default();
+    // time in the high bits lets a cursor tell which intervals were written after it
+    state.sequence = max( state.sequence + 1, uint64_t(current_time_point().sec_since_epoch()) << SEQUENCE_TIME_SHIFT );
+    _state.set( state, get_self() );
+    PROBE_READ(1);
+    PROBE_WRITE(1);
+
+    change_table _changes( get_self(), get_self().value );
+    auto itr = _changes.find( converter.value );
+    PROBE_READ(1);
+    PROBE_WRITE(1);
+    if ( itr == _changes.end() ) {
+        _changes.emplace( get_self(), [&]( auto& row ) {
+            row.converter = converter;
+            row.sequence = state.sequence;
+        });
+    } else {
+        _changes.modify( itr, same_payer, [&]( auto& row ) {
+            row.sequence = state.sequence;
+        });
+    }
+}
+
+/**------------------------------------------------------------------------------------------------
+ * @param cursor
+ * @param limit
+ * @return
+ */
+swapsdata::change_feed swapsdata::changes( uint64_t cursor, uint32_t limit ) {
+    check( limit > 0, "limit must be positive" );
+    uint32_t since = cursor >> SEQUENCE_TIME_SHIFT;
+
+    change_feed feed;
+    feed.cursor = cursor;
+    feed.more = false;
+
+    trade_data_table _trade_data( get_self(), get_self().value );
+    change_table _changes( get_self(), get_self().value );
+    auto by_sequence = _changes.get_index<"bysequence"_n>();
+    for ( auto itr = by_sequence.upper_bound( cursor ); itr != by_sequence.end(); ++itr ) {
+        if ( feed.changes.size() == limit ) {
+            feed.more = true;
+            break;
+        }
+        converter_change change;
+        change.converter = itr->converter;
+        change.sequence = itr->sequence;
+
+        auto td = _trade_data.find( itr->converter.value );
+        if ( td != _trade_data.end() ) change.trade = *td;
+
+        // every day buffer row written after the cursor is in its interval or a later one
+        day_buffer_table day_buffer( get_self(), itr->converter.value );
+        for ( auto d_it = day_buffer.lower_bound( (since / DAY_HISTORY_INTERVALS) * DAY_HISTORY_INTERVALS ); d_it != day_buffer.end(); ++d_it )
+            change.day.push_back( *d_it );
+
+        change.candles = read_candles( itr->converter, since / ARCHIVE_INTERVAL, UINT32_MAX );
+        feed.cursor = itr->sequence;
+        feed.changes.push_back( change );
+    }
+    return feed;
 }
 
 /**------------------------------------------------------------------------------------------------
@@ -255,10 +628,12 @@ void swapsdata::log(name converter, vector<swap_record> swap_data) {
  */
 void swapsdata::reset(name converter) {
     require_auth(get_self());
+    stamp(converter);
 
     trade_data_table _trade_data(get_self(), get_self().value);
     auto itr = _trade_data.find(converter.value);
-    _trade_data.erase(itr);
+    PROBE_READ(1);
+    if (itr != _trade_data.end()) _trade_data.erase(itr);
 
     day_buffer_table day_buffer( get_self(), converter.value );
     auto d_it = day_buffer.begin();
@@ -271,4 +646,101 @@ void swapsdata::reset(name converter) {
     while (m_it != month_buffer.end()) {
         m_it = month_buffer.erase(m_it);
     }
+
+    flow_sketch_table flow( get_self(), converter.value );
+    auto f_it = flow.begin();
+    while (f_it != flow.end()) {
+        f_it = flow.erase(f_it);
+    }
+
+    candle_block_table archive( get_self(), converter.value );
+    auto c_it = archive.begin();
+    while (c_it != archive.end()) {
+        c_it = archive.erase(c_it);
+    }
+}
+
+/**------------------------------------------------------------------------------------------------
+ *
+ */
+void swapsdata::purge(name converter) {
+    require_auth(get_self());
+
+    trade_data_table _trade_data(get_self(), get_self().value);
+    check(_trade_data.find(converter.value) == _trade_data.end(), "reset the converter first");
+
+    change_table _changes( get_self(), get_self().value );
+    _changes.erase( _changes.get(converter.value, "converter has no changes row") );
+}
+
+/**------------------------------------------------------------------------------------------------
+ *
+ */
+void swapsdata::addconverter(name converter) {
+    require_auth(get_self());
+    check(is_account(converter), "converter is not an account");
+
+    converter_table _converters( get_self(), get_self().value );
+    check(_converters.find(converter.value) == _converters.end(), "converter already added");
+    _converters.emplace( get_self(), [&]( auto& row ) {
+        row.converter = converter;
+    });
+}
+
+/**------------------------------------------------------------------------------------------------
+ *
+ */
+void swapsdata::delconverter(name converter) {
+    require_auth(get_self());
+
+    // its next log would whitelist it again
+    trade_data_table _trade_data(get_self(), get_self().value);
+    check(_trade_data.find(converter.value) == _trade_data.end(), "reset the converter first");
+
+    converter_table _converters( get_self(), get_self().value );
+    _converters.erase( _converters.get(converter.value, "converter not found") );
+}
+
+/**------------------------------------------------------------------------------------------------
+ *
+ */
+void swapsdata::seed(name converter, trade_data trade, vector<day_buffer_row> day, vector<month_buffer_row> month, vector<candle_block> candles) {
+    require_auth(get_self());
+    check(trade.converter == converter, "trade data of another converter");
+
+    // a seeded converter goes on recording its logs
+    converter_table _converters(get_self(), get_self().value);
+    if (_converters.find(converter.value) == _converters.end())
+        _converters.emplace(get_self(), [&](auto& row) { row.converter = converter; });
+
+    trade_data_table _trade_data(get_self(), get_self().value);
+    auto itr = _trade_data.find(converter.value);
+    if (itr == _trade_data.end()) {
+        _trade_data.emplace(get_self(), [&](auto& row) { row = trade; });
+    } else {
+        _trade_data.modify(itr, same_payer, [&](auto& row) { row = trade; });
+    }
+
+    day_buffer_table day_buffer(get_self(), converter.value);
+    for (const auto& d : day) {
+        auto d_it = day_buffer.find(d.timestamp.sec_since_epoch());
+        if (d_it == day_buffer.end()) day_buffer.emplace(get_self(), [&](auto& row) { row = d; });
+        else day_buffer.modify(d_it, same_payer, [&](auto& row) { row = d; });
+    }
+
+    month_buffer_table month_buffer(get_self(), converter.value);
+    for (const auto& m : month) {
+        auto m_it = month_buffer.find(m.timestamp.sec_since_epoch());
+        if (m_it == month_buffer.end()) month_buffer.emplace(get_self(), [&](auto& row) { row = m; });
+        else month_buffer.modify(m_it, same_payer, [&](auto& row) { row = m; });
+    }
+
+    candle_block_table archive(get_self(), converter.value);
+    for (const auto& b : candles) {
+        auto b_it = archive.find(b.first);
+        if (b_it == archive.end()) archive.emplace(get_self(), [&](auto& row) { row = b; });
+        else archive.modify(b_it, same_payer, [&](auto& row) { row = b; });
+    }
+
+    stamp(converter);
 }
@@ -1,8 +1,12 @@
+#pragma once
+
 #include <eosio/eosio.hpp>
 #include <eosio/singleton.hpp>
 #include <eosio/asset.hpp>
+#include <eosio/binary_extension.hpp>
 
 #include <math.h>
+#include <optional>
 #include <string>
 
 using namespace eosio;
@@ -10,11 +14,33 @@ using namespace std;
 
 #define MONTH_HISTORY_INTERVALS 3600
 #define DAY_HISTORY_INTERVALS 600
+#define ARCHIVE_INTERVAL 86400          // seconds per archived candle
+#define ARCHIVE_BLOCK_BYTES 2048        // encoded size at which an archive block is sealed
+#define ARCHIVE_PRICE_TICK 1e-5         // archived prices are rounded to multiples of this in log space
+#define SEQUENCE_TIME_SHIFT 20          // change sequences are block time (seconds) << this, plus a counter
+#define FLOW_INTERVAL 86400             // seconds per flow sketch row
+#define FLOW_DAYS 2                     // flow sketch rows kept per converter, the open one included
+#define FLOW_SIZE_GAMMA 1.06            // trade size bucket growth, sizes are returned within 3%
+#define FLOW_SIZE_BUCKETS 256           // trade size buckets per token, at most
+#define FLOW_SIZE_TOKENS 8              // tokens whose trade sizes a flow sketch row keeps, at most
+#define FLOW_TRADER_REGISTERS 256       // HyperLogLog registers, distinct traders are counted within 6.5% (one standard error)
 
 class [[eosio::contract]] swapsdata : public contract {
 public:
     using contract::contract;
 
+    /**
+     * the converters whose logs are recorded, scoped by the contract; logs of any other account are
+     * ignored so that they cannot spend the contract's RAM, but for a converter with trade data, which
+     * predates the whitelist and is added by its log
+     */
+    struct [[eosio::table("converters")]] converter_row {
+        name       converter;
+
+        uint64_t primary_key() const { return converter.value; }
+    };
+    typedef eosio::multi_index< "converters"_n, converter_row > converter_table;
+
     /**
      * a record for each of swap pair
      */
@@ -73,13 +99,160 @@ public:
     };
     typedef eosio::multi_index< "monthbuffer"_n, month_buffer_row > month_buffer_table;
 
+    /**
+     * a candle of one token as archived, prices in ticks of ln(price) / ARCHIVE_PRICE_TICK
+     */
+    struct candle_ticks {
+        symbol   sym;
+        int64_t  open;
+        int64_t  high;
+        int64_t  low;
+        int64_t  close;
+        int64_t  volume;
+    };
+
+    /**
+     * long term archive, one candle per token and ARCHIVE_INTERVAL, scoped by converter;
+     * each row is a block of consecutive intervals appended to as they close and sealed once data
+     * reaches ARCHIVE_BLOCK_BYTES. Per closed interval data holds
+     * varint(intervals since the previous one) varint(candles), then per candle
+     * varint(symbol index) zigzag(open - previous close) varint(high - max(open, close))
+     * varint(min(open, close) - low) zigzag(close - open) varint(volume)
+     */
+    struct [[eosio::table("candles")]] candle_block {
+        uint32_t                   first;       // interval of the first candle, timestamp / ARCHIVE_INTERVAL
+        uint32_t                   last;        // interval of the last encoded candles
+        uint32_t                   current;     // interval of the open candles
+        uint32_t                   count;       // intervals encoded in data
+        bool                       sealed;
+        vector<symbol>             symbols;     // the tokens of the block, encoded by index
+        vector<int64_t>            closes;      // last encoded close per token, base of the next open
+        vector<candle_ticks>       open;        // candles of the current interval, encoded when it closes
+        vector<char>               data;
+
+        uint64_t primary_key() const { return first; }
+    };
+    typedef eosio::multi_index< "candles"_n, candle_block > candle_block_table;
+
+    /**
+     * an archived candle as returned by the candles action
+     */
+    struct candle_record {
+        time_point_sec   timestamp;
+        asset            volume;
+        double           open;
+        double           high;
+        double           low;
+        double           close;
+    };
+
+    /**
+     * the last update of each converter's rows, for the changes feed; sequences increase with every
+     * update and carry its block time in the bits above SEQUENCE_TIME_SHIFT
+     */
+    struct [[eosio::table("changes")]] change_row {
+        name       converter;
+        uint64_t   sequence;
+
+        uint64_t primary_key() const { return converter.value; }
+        uint64_t by_sequence() const { return sequence; }
+    };
+    typedef eosio::multi_index< "changes"_n, change_row,
+        indexed_by< "bysequence"_n, const_mem_fun< change_row, uint64_t, &change_row::by_sequence > > > change_table;
+
+    /**
+     * the last sequence handed out
+     */
+    struct [[eosio::table("state")]] state_row {
+        uint64_t   sequence = 0;
+    };
+    typedef eosio::singleton< "state"_n, state_row > state_table;
+
+    /**
+     * a converter's rows that changed after a cursor, as returned by the changes action
+     */
+    struct converter_change {
+        name                        converter;
+        uint64_t                    sequence;
+        std::optional<trade_data>   trade;      // absent after a reset
+        vector<day_buffer_row>      day;        // the day buffer rows of the intervals updated after the cursor
+        vector<candle_record>       candles;    // the archive candles of the days updated after the cursor
+    };
+
+    /**
+     * trade sizes in one token, counts of log spaced buckets, see Common/sketch.hpp
+     */
+    struct size_sketch {
+        symbol             sym;
+        int32_t            offset;      // bucket of counts[0]
+        vector<uint32_t>   counts;
+    };
+
+    /**
+     * a day of trade flow, scoped by converter; every trade is counted in each token it moved, and
+     * the traders in a HyperLogLog. Rows are bounded in size and only FLOW_DAYS of them are kept, so a
+     * converter's RAM does not grow with its volume
+     */
+    struct [[eosio::table("flowsketch")]] flow_sketch_row {
+        uint32_t              day;          // timestamp / FLOW_INTERVAL
+        uint64_t              trades;
+        vector<size_sketch>   sizes;
+        vector<uint8_t>       traders;      // FLOW_TRADER_REGISTERS registers
+
+        uint64_t primary_key() const { return day; }
+    };
+    typedef eosio::multi_index< "flowsketch"_n, flow_sketch_row > flow_sketch_table;
+
+    /**
+     * trade sizes in one token at the quantiles asked for
+     */
+    struct size_quantiles {
+        symbol           sym;
+        vector<asset>    sizes;
+    };
+
+    /**
+     * a day of trade flow as returned by the flow action
+     */
+    struct flow_stats {
+        time_point_sec           day;
+        uint64_t                 trades;
+        uint64_t                 traders;   // estimated distinct traders, of the trades that name one
+        vector<size_quantiles>   sizes;
+    };
+
+    /**
+     * a page of the changes feed
+     */
+    struct change_feed {
+        uint64_t                    cursor;     // to pass to the next call
+        bool                        more;       // the limit cut the page short, call again right away
+        vector<converter_change>    changes;
+    };
+
+    /**
+     * adds swaps to the open candles of an archive block, shared with the off-chain backfill
+     * @param open
+     * @param swap_data
+     */
+    static void add_candles( vector<candle_ticks>& open, const vector<swap_record>& swap_data );
+
+    /**
+     * appends the open candles of an archive block to its data and clears them, shared with the
+     * off-chain backfill
+     * @param block
+     */
+    static void encode_candles( candle_block& block );
+
     /**
      *
      * @param converter
      * @param swap_data
+     * @param trader - the account the conversion pays out to, absent in batch settlements and the logs
+     * of converters that predate it
      */
     [[eosio::action]]
-    void log(name converter, vector<swap_record> swap_data);
+    void log(name converter, vector<swap_record> swap_data, binary_extension<name> trader);
 
     /**
      *
@@ -88,11 +261,83 @@ public:
     [[eosio::action]]
     void reset(name converter);
 
+    /**
+     * Removes the changes row of a converter that was reset, once the feed's readers have seen the reset
+     * @param converter
+     */
+    [[eosio::action]]
+    void purge(name converter);
+
+    /**
+     * Adds a converter to the ones whose logs are recorded
+     * @param converter
+     */
+    [[eosio::action]]
+    void addconverter(name converter);
+
+    /**
+     * Stops recording the logs of a converter, once it is reset: a converter with trade data is taken
+     * for one that predates the whitelist and whitelisted again by its next log
+     * @param converter
+     */
+    [[eosio::action]]
+    void delconverter(name converter);
+
+    /**
+     * Writes rows rebuilt off chain from the history of `log` actions: replaces the converter's trade
+     * data and the buffer and archive rows of the same intervals, so a long history can be seeded in batches,
+     * and whitelists the converter
+     * @param converter
+     * @param trade
+     * @param day
+     * @param month
+     * @param candles
+     */
+    [[eosio::action]]
+    void seed(name converter, trade_data trade, vector<day_buffer_row> day, vector<month_buffer_row> month, vector<candle_block> candles);
+
+    /**
+     * Read only, decodes the archived candles of a converter whose interval starts in [from, to],
+     * the still open candles of the current interval included
+     * @param converter
+     * @param from
+     * @param to
+     * @return the candles in time order
+     */
+    [[eosio::action, eosio::read_only]]
+    vector<candle_record> candles(name converter, time_point_sec from, time_point_sec to);
+
+    /**
+     * Read only, the converters updated after `cursor` in update order with their current rows: the trade
+     * data and the day buffer rows and archive candles of the intervals written since the cursor's time.
+     * Start with cursor 0, then pass the returned cursor; a converter updated again is returned again
+     * @param cursor
+     * @param limit - converters per call
+     * @return
+     */
+    [[eosio::action, eosio::read_only]]
+    change_feed changes(uint64_t cursor, uint32_t limit);
+
+    /**
+     * Read only, the trade flow of a converter on one of the days kept
+     * @param converter
+     * @param day - any time of the day
+     * @param quantiles - in [0, 1], 0.5 for the median trade size
+     * @return the trade count, distinct traders and the trade sizes at each quantile, per token
+     */
+    [[eosio::action, eosio::read_only]]
+    flow_stats flow(name converter, time_point_sec day, vector<double> quantiles);
+
 private:
-    void update_day_buffer( name converter, day_buffer_row last_state, vector<swap_record> swap_data );
-    void update_month_buffer( name converter, vector<swap_record> swap_data );
-    day_buffer_row get_last_state( name converter, vector<swap_record> swap_data, day_buffer_row base_data );
-    void update_trade_data( name converter, vector<swap_record> swap_data, day_buffer_row base_data, month_buffer_row smart_base_data );
-    month_buffer_row get_smart_base_state( name converter, vector<swap_record> swap_data );
-    day_buffer_row get_base_state(name converter, vector<swap_record> swap_data);
+    void update_day_buffer( day_buffer_table& _buffer, const day_buffer_row& last_state, const vector<swap_record>& swap_data );
+    void update_month_buffer( month_buffer_table& _buffer, const vector<swap_record>& swap_data );
+    day_buffer_row get_last_state( const trade_data_table& _trade_data, name converter, const vector<swap_record>& swap_data, const day_buffer_row& base_data );
+    void update_trade_data( name converter, const vector<swap_record>& swap_data, const day_buffer_row& base_data, const month_buffer_row& smart_base_data,
+                            trade_data_table& _trade_data, day_buffer_table& day_buffer, month_buffer_table& month_buffer );
+    month_buffer_row get_smart_base_state( month_buffer_table& _buffer, const vector<swap_record>& swap_data );
+    day_buffer_row get_base_state(day_buffer_table& _buffer, const vector<swap_record>& swap_data);
+    void update_archive( name converter, const vector<swap_record>& swap_data );
+    void update_flow( name converter, const vector<swap_record>& swap_data, const binary_extension<name>& trader );
+    vector<candle_record> read_candles( name converter, uint32_t first, uint32_t last );
+    void stamp( name converter );
 };
\ No newline at end of file
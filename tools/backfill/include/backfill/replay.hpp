@@ -0,0 +1,45 @@
+/**
+ *  @file
+ *  @copyright defined in ../../../../LICENSE
+ */
+#pragma once
+
+#include "../../../../contracts/swapsdata/swapsdata.hpp"
+
+#include <swaptrace/columns.hpp>
+
+#include <map>
+#include <optional>
+#include <vector>
+
+namespace backfill {
+
+   /**
+    * @brief the rows `swapsdata` keeps for a converter: its `tradedata` row and its `daybuffer`,
+    * `monthbuffer` and `candles` scopes, by primary key
+    */
+   struct converter_rows {
+      eosio::name                                       converter;
+      std::optional<swapsdata::trade_data>              trade;
+      std::map<uint32_t, swapsdata::day_buffer_row>     day;
+      std::map<uint32_t, swapsdata::month_buffer_row>   month;
+      std::map<uint32_t, swapsdata::candle_block>       candles;
+   };
+
+   /**
+    * @brief applies a `log` of `swap_data` at block time `now` (seconds) the way `swapsdata::log`
+    * does, the same steps on the same types so that the rows come out bit for bit the same
+    */
+   void log(converter_rows& rows, uint32_t now, const std::vector<swapsdata::swap_record>& swap_data);
+
+   /**
+    * @brief the from and to records the converter logs for a swap
+    */
+   std::vector<swapsdata::swap_record> records(const swaptrace::swap& s);
+
+   /**
+    * @brief replays the swaps of a trace, in the trace's order per converter, with the converters
+    * shared out among `threads` threads; the result is sorted by converter
+    */
+   std::vector<converter_rows> replay(const swaptrace::reader& trace, unsigned threads);
+}
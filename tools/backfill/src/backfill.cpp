@@ -0,0 +1,115 @@
+/**
+ *  @file
+ *  @copyright defined in ../../../LICENSE
+ *
+ *  Rebuilds the `swapsdata` tables from a swap trace (see tools/swaptrace) and writes them twice:
+ *
+ *  - `<prefix>.rows`, one row per line in the table delta format of tools/quoted:
+ *    `0 1 <account> <scope> <table> <primary_key> <hex row>`
+ *  - `<prefix>.actions.json`, the `seed` actions that write the same rows into a deployed contract,
+ *    one JSON action per line with hex data, at most `--batch-rows` buffer and archive rows each
+ *
+ *  usage: backfill <trace.swt> <prefix> [--threads <cores>] [--account data.tbn] [--batch-rows 128]
+ */
+
+#include <backfill/replay.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+namespace {
+
+   std::string hex(const std::vector<char>& bytes) {
+      static const char* digits = "0123456789abcdef";
+      std::string out;
+      out.reserve(bytes.size() * 2);
+      for (unsigned char b : bytes) {
+         out += digits[b >> 4];
+         out += digits[b & 15];
+      }
+      return out;
+   }
+
+   template<typename Row>
+   void write_row(FILE* out, name account, uint64_t scope, name table, uint64_t primary_key, const Row& row) {
+      fprintf(out, "0 1 %s %llu %s %llu %s\n", account.to_string().c_str(), (unsigned long long)scope, table.to_string().c_str(),
+              (unsigned long long)primary_key, hex(eosio::pack(row)).c_str());
+   }
+}
+
+int main(int argc, char** argv) {
+   try {
+      if (argc < 3) {
+         fprintf(stderr, "usage: backfill <trace.swt> <prefix> [--threads <cores>] [--account data.tbn] [--batch-rows 128]\n");
+         return 1;
+      }
+      unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+      name account = "data.tbn"_n;
+      size_t batch_rows = 128;
+      for (int i = 3; i + 1 < argc; i += 2) {
+         std::string flag = argv[i], value = argv[i + 1];
+         if      (flag == "--threads")    threads = std::stoul(value);
+         else if (flag == "--account")    account = name(value);
+         else if (flag == "--batch-rows") batch_rows = std::max<size_t>(1, std::stoul(value));
+         else eosio::check(false, "unknown option " + flag);
+      }
+
+      auto start = std::chrono::steady_clock::now();
+      swaptrace::reader trace(argv[1]);
+      auto converters = backfill::replay(trace, threads);
+      auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+      std::string prefix = argv[2];
+      FILE* rows = fopen((prefix + ".rows").c_str(), "w");
+      FILE* actions = fopen((prefix + ".actions.json").c_str(), "w");
+      eosio::check(rows && actions, "cannot create the output files");
+
+      size_t row_count = 0, action_count = 0;
+      for (const auto& c : converters) {
+         if (!c.trade) continue;
+         write_row(rows, account, account.value, "tradedata"_n, c.converter.value, *c.trade);
+         for (const auto& [pk, row] : c.day)
+            write_row(rows, account, c.converter.value, "daybuffer"_n, pk, row);
+         for (const auto& [pk, row] : c.month)
+            write_row(rows, account, c.converter.value, "monthbuffer"_n, pk, row);
+         for (const auto& [pk, row] : c.candles)
+            write_row(rows, account, c.converter.value, "candles"_n, pk, row);
+         row_count += 1 + c.day.size() + c.month.size() + c.candles.size();
+
+         // every batch carries the trade row, so any of them can be pushed again on its own
+         std::vector<swapsdata::day_buffer_row> day;
+         std::vector<swapsdata::month_buffer_row> month;
+         std::vector<swapsdata::candle_block> candles;
+         for (const auto& [pk, row] : c.day) day.push_back(row);
+         for (const auto& [pk, row] : c.month) month.push_back(row);
+         for (const auto& [pk, row] : c.candles) candles.push_back(row);
+         size_t d = 0, m = 0, k = 0;
+         do {
+            std::vector<swapsdata::day_buffer_row> day_batch;
+            std::vector<swapsdata::month_buffer_row> month_batch;
+            std::vector<swapsdata::candle_block> candle_batch;
+            while (day_batch.size() + month_batch.size() + candle_batch.size() < batch_rows &&
+                   (d < day.size() || m < month.size() || k < candles.size())) {
+               if (d < day.size()) day_batch.push_back(day[d++]);
+               else if (m < month.size()) month_batch.push_back(month[m++]);
+               else candle_batch.push_back(candles[k++]);
+            }
+            auto data = eosio::pack(std::make_tuple(c.converter, *c.trade, day_batch, month_batch, candle_batch));
+            fprintf(actions, "{\"account\":\"%s\",\"name\":\"seed\",\"authorization\":[{\"actor\":\"%s\",\"permission\":\"active\"}],"
+                             "\"data\":\"%s\"}\n", account.to_string().c_str(), account.to_string().c_str(), hex(data).c_str());
+            ++action_count;
+         } while (d < day.size() || m < month.size() || k < candles.size());
+      }
+      fclose(rows);
+      fclose(actions);
+
+      printf("%zu swaps of %zu converters replayed on %u threads in %.3f s (%.0f swaps/s)\n", trace.rows(), converters.size(), threads,
+             elapsed, trace.rows() / elapsed);
+      printf("%zu rows to %s.rows, %zu seed actions to %s.actions.json\n", row_count, prefix.c_str(), action_count, prefix.c_str());
+      return 0;
+   } catch (const std::exception& e) {
+      fprintf(stderr, "%s\n", e.what());
+      return 1;
+   }
+}
@@ -0,0 +1,256 @@
+/**
+ *  @file
+ *  @copyright defined in ../../../LICENSE
+ *
+ *  The aggregation of `contracts/swapsdata/swapsdata.cpp` over in-memory rows. Every step mirrors its
+ *  counterpart there, including the map lookups that insert defaults, and must be kept in step with it.
+ */
+
+#include <backfill/replay.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <unordered_map>
+
+namespace backfill {
+
+   using swap_record = swapsdata::swap_record;
+   using day_buffer_row = swapsdata::day_buffer_row;
+   using month_buffer_row = swapsdata::month_buffer_row;
+
+   namespace {
+
+      time_point now_point(uint32_t now) { return time_point(seconds(now)); }
+
+      // get_base_state
+      day_buffer_row base_state(converter_rows& rows, uint32_t now, const vector<swap_record>& swap_data) {
+         const time_point_sec timestamp((now / DAY_HISTORY_INTERVALS) * DAY_HISTORY_INTERVALS);
+         if (rows.day.find(timestamp.sec_since_epoch()) == rows.day.end()) {
+            auto it = rows.day.begin();
+            while (it != rows.day.end() && it->second.timestamp.sec_since_epoch() < (now_point(now) - days(1)).sec_since_epoch())
+               it = rows.day.erase(it);
+         }
+
+         if (rows.day.empty()) {
+            day_buffer_row base_data;
+            base_data.timestamp = timestamp;
+            for (const swap_record swap_data_point : swap_data) {
+               auto sym_code = swap_data_point.quantity.symbol.code();
+               base_data.volume_cumulative[sym_code] = asset(0, swap_data_point.quantity.symbol);
+               base_data.base_price[sym_code] = swap_data_point.price;
+            }
+            return base_data;
+         }
+         return rows.day.begin()->second;
+      }
+
+      // get_smart_base_state
+      month_buffer_row smart_base_state(converter_rows& rows, uint32_t now, const vector<swap_record>& swap_data) {
+         const time_point_sec timestamp((now / MONTH_HISTORY_INTERVALS) * MONTH_HISTORY_INTERVALS);
+         if (rows.month.find(timestamp.sec_since_epoch()) == rows.month.end()) {
+            auto it = rows.month.begin();
+            while (it != rows.month.end() && it->second.timestamp.sec_since_epoch() < (now_point(now) - days(30)).sec_since_epoch())
+               it = rows.month.erase(it);
+         }
+
+         if (rows.month.empty()) {
+            month_buffer_row smart_base_data;
+            smart_base_data.timestamp = timestamp;
+            for (const swap_record swap_data_point : swap_data)
+               smart_base_data.open_smart_price[swap_data_point.quantity.symbol.code()] = swap_data_point.smart_price;
+            return smart_base_data;
+         }
+         return rows.month.begin()->second;
+      }
+
+      // get_last_state
+      day_buffer_row last_state_of(const converter_rows& rows, const vector<swap_record>& swap_data, day_buffer_row base_data) {
+         day_buffer_row last_state;
+         if (!rows.trade) {
+            for (const swap_record swap_data_point : swap_data) {
+               const auto& sym_code = swap_data_point.quantity.symbol.code();
+               last_state.volume_cumulative[sym_code] = asset(0, swap_data_point.quantity.symbol);
+               last_state.base_price[sym_code] = swap_data_point.price;
+            }
+         } else {
+            auto td = *rows.trade;
+            for (const swap_record swap_data_point : swap_data) {
+               const auto& sym_code = swap_data_point.quantity.symbol.code();
+               auto base_volume = (base_data.volume_cumulative.find(sym_code) == base_data.volume_cumulative.end()) ?
+                                  asset(0, swap_data_point.quantity.symbol) : base_data.volume_cumulative[sym_code];
+               last_state.volume_cumulative[sym_code] = (td.volume_cumulative.find(sym_code) == td.volume_cumulative.end()) ?
+                                                        base_volume : td.volume_cumulative[sym_code];
+               last_state.base_price[sym_code] = swap_data_point.price;
+            }
+         }
+         return last_state;
+      }
+
+      // update_day_buffer
+      void update_day_buffer(converter_rows& rows, uint32_t now, day_buffer_row last_state, const vector<swap_record>& swap_data) {
+         const time_point_sec timestamp((now / DAY_HISTORY_INTERVALS) * DAY_HISTORY_INTERVALS);
+         auto itr = rows.day.find(timestamp.sec_since_epoch());
+         if (itr == rows.day.end()) {
+            auto& row = rows.day[timestamp.sec_since_epoch()];
+            row.timestamp = timestamp;
+            row.volume_cumulative = last_state.volume_cumulative;
+            row.base_price = last_state.base_price;
+            for (const swap_record swap_data_point : swap_data) {
+               const auto& sym_code = swap_data_point.quantity.symbol.code();
+               row.volume[sym_code] = swap_data_point.quantity;
+               row.open_price[sym_code] = swap_data_point.price;
+               row.high_price[sym_code] = swap_data_point.price;
+               row.low_price[sym_code] = swap_data_point.price;
+               row.close_price[sym_code] = swap_data_point.price;
+            }
+         } else {
+            auto& row = itr->second;
+            for (const swap_record swap_data_point : swap_data) {
+               const auto& sym_code = swap_data_point.quantity.symbol.code();
+               row.volume[sym_code] += swap_data_point.quantity;
+               row.high_price[sym_code] = max(row.high_price[sym_code], swap_data_point.price);
+               row.low_price[sym_code] = min(row.low_price[sym_code], swap_data_point.price);
+               row.close_price[sym_code] = swap_data_point.price;
+            }
+         }
+      }
+
+      // update_month_buffer
+      void update_month_buffer(converter_rows& rows, uint32_t now, const vector<swap_record>& swap_data) {
+         const time_point_sec timestamp((now / MONTH_HISTORY_INTERVALS) * MONTH_HISTORY_INTERVALS);
+         if (rows.month.find(timestamp.sec_since_epoch()) == rows.month.end()) {
+            auto& row = rows.month[timestamp.sec_since_epoch()];
+            row.timestamp = timestamp;
+            for (const swap_record swap_data_point : swap_data)
+               row.open_smart_price[swap_data_point.quantity.symbol.code()] = swap_data_point.smart_price;
+         }
+      }
+
+      // update_trade_data
+      void update_trade_data(converter_rows& rows, uint32_t now, const vector<swap_record>& swap_data, day_buffer_row base_data,
+                             month_buffer_row smart_base_data) {
+         day_buffer_row last_state = last_state_of(rows, swap_data, base_data);
+
+         if (!rows.trade) {
+            auto& row = rows.trade.emplace();
+            row.converter = rows.converter;
+            row.timestamp = time_point_sec(now_point(now));
+            for (const swap_record swap_data_point : swap_data) {
+               const auto& sym_code = swap_data_point.quantity.symbol.code();
+               row.volume_24h[sym_code] = swap_data_point.quantity;
+               row.volume_cumulative[sym_code] = swap_data_point.quantity;
+               row.price[sym_code] = swap_data_point.price;
+               row.price_change_24h[sym_code] = 0.0;
+               row.liquidity_depth[sym_code] = swap_data_point.liquidity_depth;
+               row.smart_price[sym_code] = swap_data_point.smart_price;
+               row.smart_price_change_30d[sym_code] = 0.0;
+            }
+         } else {
+            auto& row = *rows.trade;
+            row.timestamp = time_point_sec(now_point(now));
+            for (const swap_record swap_data_point : swap_data) {
+               const auto& sym_code = swap_data_point.quantity.symbol.code();
+               auto base_volume = (base_data.volume_cumulative.find(sym_code) == base_data.volume_cumulative.end()) ?
+                                  asset(0, swap_data_point.quantity.symbol) : base_data.volume_cumulative[sym_code];
+               row.volume_24h[sym_code] = last_state.volume_cumulative[sym_code] + swap_data_point.quantity - base_volume;
+               row.volume_cumulative[sym_code] = last_state.volume_cumulative[sym_code] + swap_data_point.quantity;
+               row.price[sym_code] = swap_data_point.price;
+               auto base_price = (base_data.base_price.find(sym_code) == base_data.base_price.end()) ?
+                                 swap_data_point.price : base_data.base_price[sym_code];
+               row.price_change_24h[sym_code] = swap_data_point.price - base_price;
+               row.liquidity_depth[sym_code] = swap_data_point.liquidity_depth;
+               row.smart_price[sym_code] = swap_data_point.smart_price;
+               row.smart_price_change_30d[sym_code] = swap_data_point.smart_price - smart_base_data.open_smart_price[sym_code];
+            }
+         }
+
+         update_day_buffer(rows, now, last_state, swap_data);
+         update_month_buffer(rows, now, swap_data);
+      }
+
+      // update_archive, the candles themselves are the contract's own code
+      void update_archive(converter_rows& rows, uint32_t now, const vector<swap_record>& swap_data) {
+         uint32_t interval = now / ARCHIVE_INTERVAL;
+         auto start_block = [&]() {
+            auto& row = rows.candles[interval];
+            row.first = row.last = row.current = interval;
+            row.count = 0;
+            row.sealed = false;
+            swapsdata::add_candles(row.open, swap_data);
+         };
+
+         if (rows.candles.empty()) {
+            start_block();
+            return;
+         }
+
+         auto& row = rows.candles.rbegin()->second;
+         bool sealed = false;
+         if (row.current != interval) {
+            if (!row.open.empty()) swapsdata::encode_candles(row);
+            row.sealed = sealed = row.data.size() >= ARCHIVE_BLOCK_BYTES;
+            row.current = interval;
+         }
+         if (!row.sealed) swapsdata::add_candles(row.open, swap_data);
+         if (sealed) start_block();
+      }
+   }
+
+   void log(converter_rows& rows, uint32_t now, const std::vector<swap_record>& swap_data) {
+      auto base_data = base_state(rows, now, swap_data);
+      auto smart_base_data = smart_base_state(rows, now, swap_data);
+      update_trade_data(rows, now, swap_data, base_data, smart_base_data);
+      update_archive(rows, now, swap_data);
+   }
+
+   std::vector<swap_record> records(const swaptrace::swap& s) {
+      return { { s.from, s.from_price, asset(s.from_depth, s.from.symbol), s.from_smart_price },
+               { s.to, s.to_price, asset(s.to_depth, s.to.symbol), s.to_smart_price } };
+   }
+
+   std::vector<converter_rows> replay(const swaptrace::reader& trace, unsigned threads) {
+      // the rows of each converter, as block and row, in trace order
+      std::unordered_map<uint64_t, size_t> index;
+      std::vector<std::pair<uint64_t, std::vector<std::pair<uint32_t, uint32_t>>>> work;
+      for (uint32_t b = 0; b < trace.block_count(); ++b) {
+         const auto& block = trace.block(b);
+         for (uint32_t i = 0; i < block.rows; ++i) {
+            auto [itr, inserted] = index.emplace(block.converter[i], work.size());
+            if (inserted) work.push_back({ block.converter[i], {} });
+            work[itr->second].second.push_back({ b, i });
+         }
+      }
+      // the busiest converters first so that no thread is left with a long one at the end
+      std::sort(work.begin(), work.end(), [](const auto& a, const auto& b) { return a.second.size() > b.second.size(); });
+
+      std::vector<converter_rows> result(work.size());
+      std::atomic<size_t> next{ 0 };
+      std::vector<std::string> errors(work.size());
+      auto run = [&]() {
+         for (size_t w; (w = next++) < work.size(); ) {
+            auto& rows = result[w];
+            rows.converter = eosio::name(work[w].first);
+            try {
+               for (const auto& [b, i] : work[w].second) {
+                  auto s = trace.block(b).row(i);
+                  log(rows, s.timestamp, records(s));
+               }
+            } catch (const std::exception& e) {
+               // a log the contract would have rejected, so the trace is not a history of this contract
+               errors[w] = rows.converter.to_string() + ": " + e.what();
+            }
+         }
+      };
+      std::vector<std::thread> pool;
+      for (unsigned t = 1; t < std::max(1u, threads); ++t)
+         pool.emplace_back(run);
+      run();
+      for (auto& t : pool) t.join();
+      for (const auto& e : errors)
+         eosio::check(e.empty(), e);
+
+      std::sort(result.begin(), result.end(), [](const auto& a, const auto& b) { return a.converter.value < b.converter.value; });
+      return result;
+   }
+}
@@ -0,0 +1,88 @@
+/**
+ *  @file
+ *  @copyright defined in ../../../../LICENSE
+ */
+#pragma once
+
+#include <swaptrace/columns.hpp>
+
+#include <optional>
+#include <vector>
+
+namespace backtest {
+
+   using eosio::name;
+   using eosio::symbol;
+
+   /**
+    * @brief the swaps of one converter, one column per field
+    * @details the two reserves are ordered by symbol code; `side` is the reserve a swap pays in.
+    * Amounts and balances are asset amounts, the balances those the converter held before the swap
+    * (its `liquidity_depth`s net of the swap).
+    */
+   struct flow {
+      name                  converter;
+      symbol                reserve[2];
+      std::vector<uint8_t>  side;
+      std::vector<int64_t>  in;
+      std::vector<int64_t>  out;
+      std::vector<int64_t>  balance[2];
+      int64_t               final_balance[2] = { 0, 0 };   // after the last swap
+
+      size_t size() const { return side.size(); }
+   };
+
+   /**
+    * @brief a candidate `fee` (`BancorConverter::init`/`update`) and reserve ratios (`setreserve`),
+    * in the contract's units
+    */
+   struct params {
+      uint64_t fee = 0;
+      uint64_t ratio[2] = { 500000, 500000 };
+   };
+
+   struct options {
+      uint64_t history_ratio[2] = { 500000, 500000 };   // the ratios the trace was recorded with
+      double   elasticity = 0;      // a swap priced worse than it was shrinks by (rate / historical rate)^elasticity
+      bool     arbitrage = true;    // bring the pool back to the historical price before each swap
+   };
+
+   /**
+    * @brief what a converter would have earned and charged with a parameter set, values in reserve 0
+    */
+   struct result {
+      name     converter;
+      params   candidate;
+      size_t   swaps = 0;
+      size_t   exact = 0;           // swaps paying out what they paid historically, to the unit
+      double   volume = 0;          // traded in, after elasticity
+      double   historical_volume = 0;
+      double   revenue = 0;         // fees kept by the pool, trader flow and arbitrage
+      double   arbitrage_revenue = 0;
+      double   slippage = 0;        // volume weighted price impact, excluding the fee
+      double   initial_value = 0;
+      double   yield = 0;           // revenue / initial value
+      double   lp_return = 0;       // pool value over holding the initial reserves, at the final price, less one
+   };
+
+   /**
+    * @brief the flows of the two reserve converters of a trace, or of `converter` only
+    */
+   std::vector<flow> flows(const swaptrace::reader& trace, std::optional<name> converter = {});
+
+   /**
+    * @brief replays a flow through the converter's curve and fee functions with `candidate`
+    * @details the pool starts with the historical balance of reserve 0 and as much of reserve 1 as
+    * puts it at the historical price under the candidate ratios (the historical balance when they
+    * are the historical ratios). Swaps are priced, rounded and settled as `BancorConverter::convert`
+    * does on asset amounts, so the historical parameters reproduce the historical payouts.
+    */
+   result run(const flow& f, const params& candidate, const options& opts);
+
+   /**
+    * @brief `run` for every flow and candidate on `threads` threads, flow major: the results of flow
+    * `i` are `[i * candidates.size(), (i + 1) * candidates.size())`
+    */
+   std::vector<result> sweep(const std::vector<flow>& flows, const std::vector<params>& candidates, const options& opts,
+                             unsigned threads);
+}
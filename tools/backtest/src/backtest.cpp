@@ -0,0 +1,157 @@
+/**
+ *  @file
+ *  @copyright defined in ../../../LICENSE
+ *
+ *  Replays the swaps of a swap trace (see tools/swaptrace) through the converter's curve and fee
+ *  functions under a grid of fees and reserve ratios, on all cores, and ranks the parameter sets of
+ *  each converter by what they return to the liquidity providers.
+ *
+ *  Ranges are `value` or `first:last:step`. `--ratio` is the ratio of the converter's first reserve
+ *  (by symbol code), the second gets the rest of RATIO_DENOMINATOR; only their proportion moves
+ *  the price of a reserve to reserve conversion. `--history-fee` and `--history-ratio` are the
+ *  parameters the trace was recorded with: the ratio prices the pool at each swap, and the
+ *  historical parameters are added to the grid as the baseline, which should replay exactly.
+ *
+ *  usage: backtest <trace.swt> [--fee 0:30000:1000] [--ratio 500000] [--max-fee 1000000]
+ *                  [--history-fee <fee>] [--history-ratio 500000] [--elasticity 0] [--arbitrage 1]
+ *                  [--converter <name>] [--threads <cores>] [--top 10] [--csv <file>]
+ */
+
+#include <backtest/sweep.hpp>
+
+#include "../../../contracts/Common/curve.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+using namespace backtest;
+
+namespace {
+
+   std::vector<uint64_t> range(const std::string& text) {
+      std::vector<uint64_t> bounds;
+      size_t begin = 0;
+      for (size_t colon; (colon = text.find(':', begin)) != std::string::npos; begin = colon + 1)
+         bounds.push_back(std::stoull(text.substr(begin, colon - begin)));
+      bounds.push_back(std::stoull(text.substr(begin)));
+      eosio::check(bounds.size() == 1 || (bounds.size() == 3 && bounds[2] > 0 && bounds[0] <= bounds[1]), "malformed range " + text);
+
+      std::vector<uint64_t> values;
+      for (uint64_t v = bounds[0]; v <= (bounds.size() == 3 ? bounds[1] : bounds[0]); v += bounds.size() == 3 ? bounds[2] : 1)
+         values.push_back(v);
+      return values;
+   }
+
+   void print(const char* label, const result& r) {
+      printf("  %-10s fee %6llu ratio %7llu/%-7llu  %8zu swaps %14.4f volume %12.4f revenue (%3.0f%% arbitrage)  yield %7.3f%%  "
+             "slippage %7.2f bps  lp %+8.3f%%  volume kept %5.1f%%\n",
+             label, (unsigned long long)r.candidate.fee, (unsigned long long)r.candidate.ratio[0], (unsigned long long)r.candidate.ratio[1],
+             r.swaps, r.volume, r.revenue, r.revenue > 0 ? 100 * r.arbitrage_revenue / r.revenue : 0.0, 100 * r.yield,
+             1e4 * r.slippage, 100 * r.lp_return, r.historical_volume > 0 ? 100 * r.volume / r.historical_volume : 0.0);
+   }
+}
+
+int main(int argc, char** argv) {
+   try {
+      if (argc < 2) {
+         fprintf(stderr, "usage: backtest <trace.swt> [--fee 0:30000:1000] [--ratio 500000] [--max-fee 1000000]\n"
+                         "                [--history-fee <fee>] [--history-ratio 500000] [--elasticity 0] [--arbitrage 1]\n"
+                         "                [--converter <name>] [--threads <cores>] [--top 10] [--csv <file>]\n");
+         return 1;
+      }
+      std::vector<uint64_t> fees = range("0:30000:1000"), ratios = range("500000");
+      uint64_t max_fee = FEE_DENOMINATOR;
+      std::optional<uint64_t> history_fee;
+      std::optional<name> converter;
+      options opts;
+      unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+      size_t top = 10;
+      std::string csv;
+      for (int i = 2; i + 1 < argc; i += 2) {
+         std::string flag = argv[i], value = argv[i + 1];
+         if      (flag == "--fee")           fees = range(value);
+         else if (flag == "--ratio")         ratios = range(value);
+         else if (flag == "--max-fee")       max_fee = std::stoull(value);
+         else if (flag == "--history-fee")   history_fee = std::stoull(value);
+         else if (flag == "--history-ratio") opts.history_ratio[0] = std::stoull(value), opts.history_ratio[1] = RATIO_DENOMINATOR - opts.history_ratio[0];
+         else if (flag == "--elasticity")    opts.elasticity = std::stod(value);
+         else if (flag == "--arbitrage")     opts.arbitrage = value != "0";
+         else if (flag == "--converter")     converter = name(value);
+         else if (flag == "--threads")       threads = std::stoul(value);
+         else if (flag == "--top")           top = std::stoul(value);
+         else if (flag == "--csv")           csv = value;
+         else eosio::check(false, "unknown option " + flag);
+      }
+
+      // the checks of init, update and setreserve
+      eosio::check(max_fee <= FEE_DENOMINATOR, "maximum fee must be lower or equal to " + std::to_string(uint64_t(FEE_DENOMINATOR)));
+      eosio::check(opts.history_ratio[0] > 0 && opts.history_ratio[0] < RATIO_DENOMINATOR, "history ratio must leave both reserves a share");
+      std::vector<params> candidates;
+      for (auto fee : fees) {
+         if (fee > max_fee) continue;
+         for (auto ratio : ratios) {
+            eosio::check(ratio > 0 && ratio < RATIO_DENOMINATOR, "ratio must leave both reserves a share");
+            params p;
+            p.fee = fee;
+            p.ratio[0] = ratio;
+            p.ratio[1] = RATIO_DENOMINATOR - ratio;
+            candidates.push_back(p);
+         }
+      }
+      std::optional<size_t> baseline;
+      if (history_fee) {
+         params p;
+         p.fee = *history_fee;
+         p.ratio[0] = opts.history_ratio[0];
+         p.ratio[1] = opts.history_ratio[1];
+         baseline = candidates.size();
+         candidates.push_back(p);
+      }
+      eosio::check(!candidates.empty(), "no parameter set within the maximum fee");
+
+      auto start = std::chrono::steady_clock::now();
+      swaptrace::reader trace(argv[1]);
+      auto all = flows(trace, converter);
+      size_t swaps = 0;
+      for (const auto& f : all) swaps += f.size();
+      auto results = sweep(all, candidates, opts, threads);
+      auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+      for (size_t f = 0; f < all.size(); ++f) {
+         auto first = results.begin() + f * candidates.size();
+         std::vector<result> ranked(first, first + candidates.size());
+         printf("%s %s/%s, %zu swaps\n", all[f].converter.to_string().c_str(), all[f].reserve[0].code().to_string().c_str(),
+                all[f].reserve[1].code().to_string().c_str(), all[f].size());
+         if (baseline) {
+            const auto& b = first[*baseline];
+            print("history", b);
+            printf("  %-10s %zu of %zu swaps replayed to the unit\n", "", b.exact, b.swaps);
+         }
+         std::partial_sort(ranked.begin(), ranked.begin() + std::min(top, ranked.size()), ranked.end(),
+                           [](const result& a, const result& b) { return a.lp_return > b.lp_return; });
+         for (size_t i = 0; i < std::min(top, ranked.size()); ++i)
+            print(i == 0 ? "best" : "", ranked[i]);
+      }
+
+      if (!csv.empty()) {
+         FILE* out = fopen(csv.c_str(), "w");
+         eosio::check(out != nullptr, "cannot create " + csv);
+         fprintf(out, "converter,fee,ratio0,ratio1,swaps,exact,volume,historical_volume,revenue,arbitrage_revenue,slippage,initial_value,yield,lp_return\n");
+         for (const auto& r : results)
+            fprintf(out, "%s,%llu,%llu,%llu,%zu,%zu,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g\n", r.converter.to_string().c_str(),
+                    (unsigned long long)r.candidate.fee, (unsigned long long)r.candidate.ratio[0], (unsigned long long)r.candidate.ratio[1],
+                    r.swaps, r.exact, r.volume, r.historical_volume, r.revenue, r.arbitrage_revenue, r.slippage, r.initial_value, r.yield,
+                    r.lp_return);
+         fclose(out);
+      }
+
+      printf("%zu parameter sets x %zu swaps of %zu converters on %u threads in %.3f s, %.1fM swaps/s\n", candidates.size(), swaps,
+             all.size(), threads, elapsed, candidates.size() * swaps / elapsed / 1e6);
+      return 0;
+   } catch (const std::exception& e) {
+      fprintf(stderr, "%s\n", e.what());
+      return 1;
+   }
+}
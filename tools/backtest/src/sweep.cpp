@@ -0,0 +1,178 @@
+/**
+ *  @file
+ *  @copyright defined in ../../../LICENSE
+ */
+
+#include <backtest/sweep.hpp>
+
+#include "../../../contracts/Common/curve.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <unordered_map>
+
+namespace backtest {
+
+   std::vector<flow> flows(const swaptrace::reader& trace, std::optional<name> converter) {
+      std::unordered_map<uint64_t, size_t> index;
+      std::vector<flow> result;
+      std::vector<bool> valid;
+      for (const auto& b : trace.blocks()) {
+         for (size_t i = 0; i < b.rows; ++i) {
+            if (converter && b.converter[i] != converter->value) continue;
+            auto [itr, inserted] = index.emplace(b.converter[i], result.size());
+            if (inserted) {
+               flow f;
+               f.converter = name(b.converter[i]);
+               f.reserve[0] = symbol(std::min(b.from_symbol[i], b.to_symbol[i]));
+               f.reserve[1] = symbol(std::max(b.from_symbol[i], b.to_symbol[i]));
+               result.push_back(std::move(f));
+               valid.push_back(true);
+            }
+            auto& f = result[itr->second];
+            uint8_t side = b.from_symbol[i] == f.reserve[0].raw() ? 0 : 1;
+            if (b.from_symbol[i] != f.reserve[side].raw() || b.to_symbol[i] != f.reserve[1 - side].raw()) {
+               // a converter with more than two reserves, its pairs do not share one curve
+               valid[itr->second] = false;
+               continue;
+            }
+            f.side.push_back(side);
+            f.in.push_back(b.from_amount[i]);
+            f.out.push_back(b.to_amount[i]);
+            f.balance[side].push_back(b.from_depth[i] - b.from_amount[i]);
+            f.balance[1 - side].push_back(b.to_depth[i] + b.to_amount[i]);
+            f.final_balance[side] = b.from_depth[i];
+            f.final_balance[1 - side] = b.to_depth[i];
+         }
+      }
+      std::vector<flow> kept;
+      for (size_t i = 0; i < result.size(); ++i)
+         if (valid[i]) kept.push_back(std::move(result[i]));
+      return kept;
+   }
+
+   namespace {
+
+      // the price of reserve 0 in reserve 1 at the margin, as in calculate_cross_reserve_limit
+      double spot(const int64_t balance[2], const double scale[2], const uint64_t ratio[2]) {
+         return (balance[1] / scale[1] / ratio[1]) / (balance[0] / scale[0] / ratio[0]);
+      }
+
+      struct quote {
+         double  gross = 0;   // before the fee
+         double  fee = 0;
+         int64_t paid = 0;
+      };
+   }
+
+   result run(const flow& f, const params& candidate, const options& opts) {
+      result r;
+      r.converter = f.converter;
+      r.candidate = candidate;
+      if (f.size() == 0) return r;
+
+      const uint64_t* ratio = candidate.ratio;
+      const uint8_t precision[2] = { f.reserve[0].precision(), f.reserve[1].precision() };
+      const double scale[2] = { power10(precision[0]), power10(precision[1]) };
+      // calculate_fee(amount, fee, 2) is amount times this
+      const double fee_factor = calculate_fee(1, candidate.fee, 2);
+      const double net = 1 - fee_factor;
+      const bool historical = ratio[0] == opts.history_ratio[0] && ratio[1] == opts.history_ratio[1];
+
+      int64_t balance[2] = { f.balance[0][0], f.balance[1][0] };
+      double price = spot(balance, scale, opts.history_ratio);
+      if (!historical)
+         balance[1] = int64_t(price * (balance[0] / scale[0]) * ratio[1] / ratio[0] * scale[1]);
+      const int64_t held[2] = { balance[0], balance[1] };
+      r.initial_value = balance[0] / scale[0] + balance[1] / scale[1] / price;
+
+      // BancorConverter::convert for a reserve to reserve conversion paying in reserve `side`
+      auto convert = [&](uint8_t side, int64_t amount) {
+         quote q;
+         double from = balance[side] / scale[side], to = balance[1 - side] / scale[1 - side];
+         q.gross = calculate_cross_reserve_return(from, amount / scale[side], ratio[side], to, ratio[1 - side]);
+         q.fee = q.gross * fee_factor;
+         q.paid = to_fixed(q.gross - q.fee, precision[1 - side]) * scale[1 - side];
+         return q;
+      };
+      auto settle = [&](uint8_t side, int64_t amount, const quote& q) {
+         balance[side] += amount;
+         balance[1 - side] -= q.paid;   // the fee stays in the pool
+      };
+      // in reserve 0 at the historical price
+      auto value = [&](uint8_t side, double units) { return side == 0 ? units : units / price; };
+
+      for (size_t i = 0; i < f.size(); ++i) {
+         const int64_t before[2] = { f.balance[0][i], f.balance[1][i] };
+         price = spot(before, scale, opts.history_ratio);
+
+         // an arbitrageur takes whatever the pool offers above the price net of the fee
+         if (opts.arbitrage && net > 0) {
+            double current = spot(balance, scale, ratio);
+            uint8_t side = current * net > price ? 0 : 1 / current * net > 1 / price ? 1 : 2;
+            if (side < 2) {
+               double rate = (side == 0 ? price : 1 / price) / net;
+               double limit = calculate_cross_reserve_limit(balance[side] / scale[side], ratio[side], balance[1 - side] / scale[1 - side],
+                                                            ratio[1 - side], rate);
+               int64_t amount = limit * scale[side];
+               if (amount > 0) {
+                  auto q = convert(side, amount);
+                  settle(side, amount, q);
+                  r.arbitrage_revenue += value(1 - side, q.fee);
+               }
+            }
+         }
+
+         uint8_t side = f.side[i];
+         int64_t amount = f.in[i];
+         r.historical_volume += value(side, amount / scale[side]);
+         auto q = convert(side, amount);
+         if (opts.elasticity > 0 && double(q.paid) * f.in[i] < double(f.out[i]) * amount) {
+            // priced worse than it was: the trader brings less
+            double rate = double(q.paid) / amount, historical_rate = double(f.out[i]) / f.in[i];
+            amount = int64_t(amount * pow(rate / historical_rate, opts.elasticity));
+            if (amount <= 0) continue;
+            q = convert(side, amount);
+         }
+
+         double marginal = side == 0 ? spot(balance, scale, ratio) : 1 / spot(balance, scale, ratio);
+         double in = value(side, amount / scale[side]);
+         r.slippage += in * (1 - q.gross / (amount / scale[side] * marginal));
+         r.volume += in;
+         r.revenue += value(1 - side, q.fee);
+         r.exact += amount == f.in[i] && q.paid == f.out[i];
+         ++r.swaps;
+         settle(side, amount, q);
+      }
+      price = spot(f.final_balance, scale, opts.history_ratio);
+      r.revenue += r.arbitrage_revenue;
+      if (r.volume > 0) r.slippage /= r.volume;
+      r.yield = r.revenue / r.initial_value;
+      r.lp_return = (balance[0] / scale[0] + balance[1] / scale[1] / price) / (held[0] / scale[0] + held[1] / scale[1] / price) - 1;
+      return r;
+   }
+
+   std::vector<result> sweep(const std::vector<flow>& flows, const std::vector<params>& candidates, const options& opts,
+                             unsigned threads) {
+      // the longest flows first so that no thread is left with a long run at the end
+      std::vector<size_t> order(flows.size());
+      for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+      std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return flows[a].size() > flows[b].size(); });
+
+      std::vector<result> results(flows.size() * candidates.size());
+      std::atomic<size_t> next{ 0 };
+      auto work = [&]() {
+         for (size_t w; (w = next++) < results.size(); ) {
+            size_t f = order[w / candidates.size()], c = w % candidates.size();
+            results[f * candidates.size() + c] = run(flows[f], candidates[c], opts);
+         }
+      };
+      std::vector<std::thread> pool;
+      for (unsigned t = 1; t < std::max(1u, threads); ++t)
+         pool.emplace_back(work);
+      work();
+      for (auto& t : pool) t.join();
+      return results;
+   }
+}
@@ -0,0 +1,676 @@
+/**
+ *  @file
+ *  @copyright defined in ../../LICENSE
+ *
+ *  Checks the converter's actions on the native fixture against expected values: reserve to reserve
+ *  conversions between unequal ratios against the curve functions, the liquidity actions
+ *  against values worked out by hand (fund with "fund" deposits, withdraw of the unused part and
+ *  liquidate, before and after the pool earned conversion fees), a conversion with a price limit
+ *  against the fill of the curve functions and the marginal rate it leaves, a batch settlement of
+ *  opposing orders against its crossing worked out by hand, the time weighted price between two
+ *  `observe` snapshots against the prices held in between, across conversions and a liquidation, a
+ *  conversion along a registered route against the same path spelled out in the memo, and which of
+ *  several "|" alternatives the network takes.
+ *
+ *  usage: action_check
+ */
+
+#include "fixture.hpp"
+
+#include "../../contracts/Common/common.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+
+using namespace fixture;
+
+namespace {
+
+    struct account_row {
+        asset    balance;
+        uint64_t primary_key() const { return balance.symbol.code().raw(); }
+    };
+
+    int64_t balance_of(const chain& c, name contract, name owner, symbol sym) {
+        auto row = c.get_row<account_row>(contract, owner.value, "accounts"_n, sym.code().raw());
+        return row ? row->balance.amount : 0;
+    }
+
+    int64_t deposit_of(const chain& c, name cnv, name owner, symbol sym) {
+        auto row = c.get_row<BancorConverter::deposit_t>(cnv, owner.value, "deposits"_n, sym.code().raw());
+        return row ? row->quantity.amount : 0;
+    }
+
+    bool expect(const char* what, asset actual, asset expected) {
+        bool ok = actual == expected;
+        printf("  %-48s %-18s %s\n", what, expected.to_string().c_str(), ok ? "ok" : ("MISMATCH, chain has " + actual.to_string()).c_str());
+        return ok;
+    }
+
+    bool expect_failure(const char* what, const std::function<void()>& push, const std::string& message) {
+        std::string failed = "nothing";
+        try {
+            push();
+        } catch (const eosio::native::action_exception& e) {
+            failed = e.message;
+        }
+        bool ok = failed == message;
+        printf("  %-48s %-18s %s\n", what, "fails", ok ? "ok" : ("MISMATCH, " + failed).c_str());
+        return ok;
+    }
+
+    // a TLOS/SEEDS converter besides the fixture's, accepting conversions from the given network
+    void add_converter(chain& c, name cnv, symbol relay, name network, double tlos_amount, uint64_t tlos_ratio,
+                       double seeds_amount, uint64_t seeds_ratio, uint64_t fee) {
+        deploy_converter(c, cnv);
+        c.push_action(RELAYS, "create"_n, RELAYS, cnv, units(1e10, relay));
+        c.push_action(cnv, "init"_n, cnv, RELAYS, asset(0, relay), true, true, network, false, uint64_t(30000), fee);
+        c.push_action(cnv, "setreserve"_n, cnv, TOKENS, RESERVES[0], tlos_ratio, true);
+        c.push_action(cnv, "setreserve"_n, cnv, TOKENS, RESERVES[1], seeds_ratio, true);
+        c.push_action(TOKENS, "transfer"_n, LP, LP, cnv, units(tlos_amount, RESERVES[0]), std::string("setup"));
+        c.push_action(TOKENS, "transfer"_n, LP, LP, cnv, units(seeds_amount, RESERVES[1]), std::string("setup"));
+        c.push_action(RELAYS, "issue"_n, cnv, cnv, units(1e6, relay), std::string("setup"));
+    }
+
+    // cnvrt5 holds 300000 TLOS at a ratio of 30% and 600000 SEEDS at 60%, a spot price of 1 off the equal ratio
+    // shortcut; a conversion each way pays the cross reserve return less the fee, charged twice
+    bool check_cross_reserve() {
+        chain c;
+        setup(c);
+        c.max_inline_action_depth = 10;
+
+        const name cnv = "cnvrt5"_n;
+        const symbol tlos = RESERVES[0], seeds = RESERVES[1], relay = symbol("RELE", 4);
+        const uint64_t fee = 2000, tlos_ratio = 300000, seeds_ratio = 600000;
+        printf("cross reserve, %s\n", cnv.to_string().c_str());
+
+        add_converter(c, cnv, relay, NETWORK, 300000, tlos_ratio, 600000, seeds_ratio, fee);
+
+        bool ok = true;
+        ok &= expect_failure("a reserve past the total ratio", [&] {
+            c.push_action(cnv, "setreserve"_n, cnv, TOKENS, RESERVES[2], uint64_t(100001), true);
+        }, "ratio must be between 1 and " + std::to_string(RATIO_DENOMINATOR));
+
+        double tlos_balance = 300000, seeds_balance = 600000;
+        for (bool sell_tlos : { true, false }) {
+            symbol from = sell_tlos ? tlos : seeds, to = sell_tlos ? seeds : tlos;
+            double out = sell_tlos ? calculate_cross_reserve_return(tlos_balance, 1000, tlos_ratio, seeds_balance, seeds_ratio)
+                                   : calculate_cross_reserve_return(seeds_balance, 1000, seeds_ratio, tlos_balance, tlos_ratio);
+            out = to_fixed(out - calculate_fee(out, fee, 2), to.precision());
+
+            int64_t before = balance_of(c, TOKENS, TRADER, to);
+            convert(c, TOKENS, units(1000, from), cnv.to_string() + " " + to.code().to_string());
+            ok &= expect(sell_tlos ? "1000 TLOS for SEEDS" : "1000 SEEDS for TLOS", asset(balance_of(c, TOKENS, TRADER, to) - before, to), units(out, to));
+
+            (sell_tlos ? tlos_balance : seeds_balance) += 1000;
+            (sell_tlos ? seeds_balance : tlos_balance) -= out;
+        }
+        return ok;
+    }
+
+    // cnvrt1 holds 1M TLOS and 1M SEEDS against 1M RELA, so 100 RELA is worth 100 of each reserve
+    bool check_liquidity() {
+        chain c;
+        setup(c);
+        c.max_inline_action_depth = 10;
+
+        const name cnv = CONVERTERS[0];
+        const symbol tlos = RESERVES[0], seeds = RESERVES[1], rela = RELAY_TOKENS[0];
+        printf("liquidity, %s\n", cnv.to_string().c_str());
+
+        int64_t tlos_before = balance_of(c, TOKENS, LP, tlos), seeds_before = balance_of(c, TOKENS, LP, seeds);
+        int64_t rela_before = balance_of(c, RELAYS, LP, rela);
+        c.push_action(TOKENS, "transfer"_n, LP, LP, cnv, units(150, tlos), std::string("fund"));
+        c.push_action(TOKENS, "transfer"_n, LP, LP, cnv, units(100, seeds), std::string("fund"));
+        c.push_action(cnv, "fund"_n, LP, LP, units(100, rela));
+
+        bool ok = true;
+        ok &= expect("fund 100 RELA, issued", asset(balance_of(c, RELAYS, LP, rela) - rela_before, rela), units(100, rela));
+        ok &= expect("fund 100 RELA, TLOS deposit left", asset(deposit_of(c, cnv, LP, tlos), tlos), units(50, tlos));
+        ok &= expect("fund 100 RELA, SEEDS deposit left", asset(deposit_of(c, cnv, LP, seeds), seeds), units(0, seeds));
+
+        c.push_action(cnv, "withdraw"_n, LP, LP, units(50, tlos));
+        ok &= expect("withdraw 50 TLOS, TLOS paid in", asset(tlos_before - balance_of(c, TOKENS, LP, tlos), tlos), units(100, tlos));
+        ok &= expect("withdraw 50 TLOS, TLOS deposit left", asset(deposit_of(c, cnv, LP, tlos), tlos), units(0, tlos));
+
+        c.push_action(RELAYS, "transfer"_n, LP, LP, cnv, units(100, rela), std::string("liquidate"));
+        ok &= expect("liquidate 100 RELA, TLOS returned", asset(balance_of(c, TOKENS, LP, tlos) - tlos_before, tlos), units(0, tlos));
+        ok &= expect("liquidate 100 RELA, SEEDS returned", asset(balance_of(c, TOKENS, LP, seeds) - seeds_before, seeds), units(0, seeds));
+        ok &= expect("liquidate 100 RELA, RELA retired", asset(balance_of(c, RELAYS, LP, rela) - rela_before, rela), units(0, rela));
+
+        // fees stay in the reserves: with equal ratios the product of the balances only grows, so does the
+        // product of what a RELA redeems for
+        convert(c, TOKENS, units(10000, tlos), cnv.to_string() + " SEEDS");
+        convert(c, TOKENS, units(10000, seeds), cnv.to_string() + " TLOS");
+        tlos_before = balance_of(c, TOKENS, LP, tlos);
+        seeds_before = balance_of(c, TOKENS, LP, seeds);
+        c.push_action(RELAYS, "transfer"_n, LP, LP, cnv, units(100, rela), std::string("liquidate"));
+        asset tlos_paid(balance_of(c, TOKENS, LP, tlos) - tlos_before, tlos), seeds_paid(balance_of(c, TOKENS, LP, seeds) - seeds_before, seeds);
+        bool earned = double(tlos_paid.amount) * seeds_paid.amount > double(units(100, tlos).amount) * units(100, seeds).amount;
+        printf("  %-48s %s %s %s\n", "liquidate 100 RELA after fees", tlos_paid.to_string().c_str(), seeds_paid.to_string().c_str(),
+               earned ? "ok" : "MISMATCH, no fees earned");
+        return ok && earned;
+    }
+
+    // 100000 TLOS into cnvrt1 at no less than 0.9 SEEDS per TLOS: the part that keeps the marginal rate above
+    // the limit is converted and the rest refunded to the sender in the same transaction
+    bool check_price_limit() {
+        chain c;
+        setup(c);
+        c.max_inline_action_depth = 10;
+
+        const name cnv = CONVERTERS[0];
+        const symbol tlos = RESERVES[0], seeds = RESERVES[1];
+        // the limit as the contract parses it from the memo, in float
+        const double balance = 1e6, limit = ::stof(std::string_view("0.9"));
+        const uint64_t fee = 2000, ratio = 500000;
+        printf("price limit, %s\n", cnv.to_string().c_str());
+
+        // the limit is net of the fee, charged twice on a reserve to reserve conversion
+        double net = 1 - calculate_fee(1, fee, 2);
+        double fill = int64_t(calculate_cross_reserve_limit(balance, ratio, balance, ratio, limit / net) * 1e4) / 1e4;
+        double out = calculate_cross_reserve_return(balance, fill, ratio, balance, ratio);
+        out = to_fixed(out - calculate_fee(out, fee, 2), seeds.precision());
+
+        int64_t tlos_before = balance_of(c, TOKENS, TRADER, tlos), seeds_before = balance_of(c, TOKENS, TRADER, seeds);
+        c.push_action(TOKENS, "transfer"_n, TRADER, TRADER, NETWORK, units(100000, tlos),
+                      "1," + cnv.to_string() + " SEEDS,0.0," + TRADER.to_string() + ",0.9");
+
+        bool ok = true;
+        ok &= expect("100000 TLOS at 0.9, TLOS filled", asset(tlos_before - balance_of(c, TOKENS, TRADER, tlos), tlos), units(fill, tlos));
+        ok &= expect("100000 TLOS at 0.9, SEEDS paid", asset(balance_of(c, TOKENS, TRADER, seeds) - seeds_before, seeds), units(out, seeds));
+
+        // with equal ratios the marginal rate after x is balance^2 / (balance + x)^2, the fill stops just above the limit
+        double rate = net * balance * balance / ((balance + fill) * (balance + fill));
+        bool at_limit = rate >= limit && rate < limit * (1 + 1e-9);
+        printf("  %-48s %-18.10f %s\n", "marginal rate after the fill", rate, at_limit ? "ok" : "MISMATCH, not at the limit");
+
+        // a limit the order does not reach fills it whole
+        tlos_before = balance_of(c, TOKENS, TRADER, tlos);
+        c.push_action(TOKENS, "transfer"_n, TRADER, TRADER, NETWORK, units(100, tlos),
+                      "1," + cnv.to_string() + " SEEDS,0.0," + TRADER.to_string() + ",0.5");
+        ok &= expect("100 TLOS at 0.5, TLOS filled", asset(tlos_before - balance_of(c, TOKENS, TRADER, tlos), tlos), units(100, tlos));
+
+        // the refund goes to the destination, so one other than the sender would take it
+        ok &= expect_failure("a limit with BancorX as the destination", [&] {
+            c.push_action(TOKENS, "transfer"_n, TRADER, TRADER, NETWORK, units(100000, tlos),
+                          "1," + cnv.to_string() + " SEEDS,0.0," + BANCOR_X.to_string() + ",0.9");
+        }, "a price limit requires the sender to be the destination");
+        return ok && at_limit;
+    }
+
+    // cnvrt1 batched over a minute: 100 TLOS for SEEDS against 50 SEEDS for TLOS cross 50 of each at the spot
+    // price of 1 and only the other 50 TLOS move the curve, 50 * 1e6 / (1e6 + 50) SEEDS; the fee of 0.2% is
+    // charged twice, so the trader is paid 99.99750012 * 0.998^2 = 99.5979 SEEDS and the provider 50 * 0.998^2,
+    // which in doubles is just below 49.8002 and truncates to 49.8001 TLOS
+    bool check_batch() {
+        chain c;
+        setup(c);
+        c.max_inline_action_depth = 10;
+
+        const name cnv = CONVERTERS[0];
+        const symbol tlos = RESERVES[0], seeds = RESERVES[1];
+        printf("batch, %s\n", cnv.to_string().c_str());
+
+        c.push_action(cnv, "setbatch"_n, cnv, uint64_t(60));
+        int64_t trader_tlos = balance_of(c, TOKENS, TRADER, tlos), trader_seeds = balance_of(c, TOKENS, TRADER, seeds);
+        int64_t lp_tlos = balance_of(c, TOKENS, LP, tlos), lp_seeds = balance_of(c, TOKENS, LP, seeds);
+        convert(c, TOKENS, units(100, tlos), cnv.to_string() + " SEEDS");
+        c.push_action(TOKENS, "transfer"_n, LP, LP, NETWORK, units(50, seeds), "1," + cnv.to_string() + " TLOS,0.0," + LP.to_string());
+        convert(c, TOKENS, units(20, tlos), cnv.to_string() + " SEEDS");
+
+        bool ok = true;
+        ok &= expect("queued, SEEDS paid", asset(balance_of(c, TOKENS, TRADER, seeds) - trader_seeds, seeds), units(0, seeds));
+        ok &= expect_failure("settle before the window closes", [&] { c.push_action(cnv, "settle"_n, TRADER, uint32_t(10)); },
+                             "no orders to settle");
+        ok &= expect_failure("cancel by another account", [&] { c.push_action(cnv, "cancel"_n, LP, LP, uint64_t(2)); },
+                             "not the order's owner");
+        c.push_action(cnv, "cancel"_n, TRADER, TRADER, uint64_t(2));
+
+        c.advance(eosio::seconds(60));
+        c.push_action(cnv, "settle"_n, TRADER, uint32_t(2));
+        ok &= expect("settled, trader's TLOS paid in", asset(trader_tlos - balance_of(c, TOKENS, TRADER, tlos), tlos), units(100, tlos));
+        ok &= expect("settled, trader's SEEDS", asset(balance_of(c, TOKENS, TRADER, seeds) - trader_seeds, seeds), asset(995979, seeds));
+        ok &= expect("settled, provider's SEEDS paid in", asset(lp_seeds - balance_of(c, TOKENS, LP, seeds), seeds), units(50, seeds));
+        ok &= expect("settled, provider's TLOS", asset(balance_of(c, TOKENS, LP, tlos) - lp_tlos, tlos), asset(498001, tlos));
+        ok &= expect_failure("settle with no orders left", [&] { c.push_action(cnv, "settle"_n, TRADER, uint32_t(10)); },
+                             "no orders to settle");
+        return ok;
+    }
+
+    // 300000 TLOS against 300000 SEEDS on cnvrt1 cross in full at the spot price of 1, and each side is paid
+    // 300000 * 0.998^2 = 298801.2 of the other reserve, past the 2^31 units an int holds at precision 4
+    bool check_large_batch() {
+        chain c;
+        setup(c);
+        c.max_inline_action_depth = 10;
+
+        const name cnv = CONVERTERS[0];
+        const symbol tlos = RESERVES[0], seeds = RESERVES[1];
+        printf("large batch, %s\n", cnv.to_string().c_str());
+
+        c.push_action(cnv, "setbatch"_n, cnv, uint64_t(60));
+        int64_t trader_seeds = balance_of(c, TOKENS, TRADER, seeds), lp_tlos = balance_of(c, TOKENS, LP, tlos);
+        convert(c, TOKENS, units(300000, tlos), cnv.to_string() + " SEEDS");
+        c.push_action(TOKENS, "transfer"_n, LP, LP, NETWORK, units(300000, seeds), "1," + cnv.to_string() + " TLOS,0.0," + LP.to_string());
+
+        c.advance(eosio::seconds(60));
+        c.push_action(cnv, "settle"_n, TRADER, uint32_t(2));
+        bool ok = true;
+        ok &= expect("settled, trader's SEEDS", asset(balance_of(c, TOKENS, TRADER, seeds) - trader_seeds, seeds), asset(2988012000, seeds));
+        ok &= expect("settled, provider's TLOS", asset(balance_of(c, TOKENS, LP, tlos) - lp_tlos, tlos), asset(2988012000, tlos));
+        return ok;
+    }
+
+    BancorConverter::price_observation observe(chain& c, name cnv, symbol base, symbol quote) {
+        auto traces = c.push_action(cnv, "observe"_n, TRADER, base.code(), quote.code());
+        return eosio::unpack<BancorConverter::price_observation>(traces.front().return_value);
+    }
+
+    // a buy of RELA with 10 TLOS moves the price to 1e6 / 1000010 for an hour, then a liquidation of half the supply
+    // halves both balances and leaves it there for another: fund and liquidate close the interval at the balance
+    // held until then, so the time weighted price over the three hours is the mean of the logs of 1, p and p
+    bool check_twap_liquidity() {
+        chain c;
+        setup(c);
+        c.max_inline_action_depth = 10;
+
+        const name cnv = CONVERTERS[0];
+        const symbol tlos = RESERVES[0], seeds = RESERVES[1], rela = RELAY_TOKENS[0];
+
+        auto first = observe(c, cnv, tlos, seeds);
+        c.advance(eosio::seconds(3600));
+        convert(c, TOKENS, units(10, tlos), cnv.to_string() + " RELA");
+        c.advance(eosio::seconds(3600));
+        c.push_action(RELAYS, "transfer"_n, LP, LP, cnv, units(500000, rela), std::string("liquidate"));
+        double price = double(balance_of(c, TOKENS, cnv, seeds)) / balance_of(c, TOKENS, cnv, tlos);
+        c.advance(eosio::seconds(3600));
+        auto second = observe(c, cnv, tlos, seeds);
+
+        double expected = exp((log(1e6 / 1000010.0) + log(price)) / 3);
+        double twap = exp((second.price_cumulative - first.price_cumulative) / 10800);
+        bool ok = fabs(twap / expected - 1) < 1e-9;
+        printf("  %-48s %.10f %s\n", "buy, liquidate half, time weighted price", twap,
+               ok ? "ok" : ("MISMATCH, expected " + std::to_string(expected)).c_str());
+        return ok;
+    }
+
+    // TLOS in SEEDS on cnvrt1 is 1 for an hour, then a sale of 10000 TLOS moves it to p for another hour: the
+    // time weighted price over the two hours is the geometric mean sqrt(p)
+    bool check_twap() {
+        chain c;
+        setup(c);
+        c.max_inline_action_depth = 10;
+
+        const name cnv = CONVERTERS[0];
+        const symbol tlos = RESERVES[0], seeds = RESERVES[1];
+        printf("price accumulator, %s\n", cnv.to_string().c_str());
+
+        auto first = observe(c, cnv, tlos, seeds);
+        c.advance(eosio::seconds(3600));
+        convert(c, TOKENS, units(10000, tlos), cnv.to_string() + " SEEDS");
+        c.advance(eosio::seconds(3600));
+        auto second = observe(c, cnv, tlos, seeds);
+
+        // equal ratios, the price is the balance ratio
+        double price = double(balance_of(c, TOKENS, cnv, seeds)) / balance_of(c, TOKENS, cnv, tlos);
+        double elapsed = second.timestamp.sec_since_epoch() - first.timestamp.sec_since_epoch();
+        double twap = exp((second.price_cumulative - first.price_cumulative) / elapsed);
+
+        bool ok = first.price == 1 && elapsed == 7200 && fabs(second.price / price - 1) < 1e-12 && fabs(twap / sqrt(price) - 1) < 1e-12;
+        printf("  %-48s %.10f %.10f over %.0f s %s\n", "spot and time weighted price", second.price, twap, elapsed,
+               ok ? "ok" : ("MISMATCH, expected " + std::to_string(price) + " " + std::to_string(sqrt(price))).c_str());
+        return ok;
+    }
+
+    // 1000 TLOS for SEEDS given as "|" alternatives between cnvrt1, cnvrt5 with 10000 of each reserve, which quotes
+    // 10000 * 1000 / 11000 * 0.998^2 = 905.4581 against cnvrt1's 995.0089, cnvrtb batching over a minute and cnvrtx
+    // accepting another network only; the converter the TLOS went to is the alternative taken
+    bool check_alternatives() {
+        chain c;
+        setup(c);
+        c.max_inline_action_depth = 10;
+
+        const symbol tlos = RESERVES[0], seeds = RESERVES[1];
+        const std::vector<name> candidates = { CONVERTERS[0], "cnvrt5"_n, "cnvrtb"_n, "cnvrtx"_n };
+        printf("alternatives, cnvrt1 cnvrt5 cnvrtb cnvrtx\n");
+
+        add_converter(c, candidates[1], symbol("RELE", 4), NETWORK, 10000, 500000, 10000, 500000, 2000);
+        add_converter(c, candidates[2], symbol("RELF", 4), NETWORK, 1e6, 500000, 1e6, 500000, 2000);
+        add_converter(c, candidates[3], symbol("RELG", 4), "othernet"_n, 1e6, 500000, 1e6, 500000, 2000);
+        c.push_action(candidates[2], "setbatch"_n, candidates[2], uint64_t(60));
+
+        auto convert_any = [&](const std::string& paths, const std::string& min_return, const std::string& limit = "") {
+            c.push_action(TOKENS, "transfer"_n, TRADER, TRADER, NETWORK, units(1000, tlos),
+                          "1," + paths + "," + min_return + "," + TRADER.to_string() + (limit.empty() ? "" : "," + limit));
+        };
+        auto expect_taken = [&](const char* what, const std::string& paths, const std::string& min_return, name expected) {
+            std::vector<int64_t> before;
+            for (auto cnv : candidates)
+                before.push_back(balance_of(c, TOKENS, cnv, tlos));
+            convert_any(paths, min_return);
+            name taken;
+            for (size_t i = 0; i < candidates.size(); ++i)
+                if (balance_of(c, TOKENS, candidates[i], tlos) != before[i])
+                    taken = candidates[i];
+            bool ok = taken == expected;
+            printf("  %-48s %-18s %s\n", what, expected.to_string().c_str(), ok ? "ok" : ("MISMATCH, taken by " + taken.to_string()).c_str());
+            return ok;
+        };
+
+        bool ok = true;
+        ok &= expect_taken("the first that meets the min return", "cnvrt5 SEEDS|cnvrt1 SEEDS", "0.0", candidates[1]);
+        int64_t before = balance_of(c, TOKENS, TRADER, seeds);
+        ok &= expect_taken("the first below the min return", "cnvrt5 SEEDS|cnvrt1 SEEDS", "950", candidates[0]);
+        ok &= expect("the first below the min return, SEEDS paid", asset(balance_of(c, TOKENS, TRADER, seeds) - before, seeds),
+                     units(995.0089, seeds));
+        ok &= expect_taken("a last hop the batch would queue", "cnvrtb SEEDS|cnvrt1 SEEDS", "0.0", candidates[0]);
+        ok &= expect_taken("a converter of another network", "cnvrtx SEEDS|cnvrt1 SEEDS", "0.0", candidates[0]);
+        ok &= expect_failure("none of them", [&] { convert_any("cnvrt5 SEEDS|cnvrtb SEEDS|cnvrtx SEEDS", "950"); }, "below min return");
+        ok &= expect_failure("a malformed price limit", [&] { convert_any("cnvrt1 SEEDS", "0.0", "O.9"); }, "invalid price limit");
+        return ok;
+    }
+
+    // the logs of a converter that recorded before the whitelist existed, that is with trade data but no converters
+    // row, whitelist it; those of a converter never added are ignored, and a seeded one is whitelisted
+    bool check_whitelist() {
+        chain c;
+        setup(c);
+        c.max_inline_action_depth = 10;
+
+        const name cnv = CONVERTERS[0], other = "cnvrt5"_n;
+        const symbol tlos = RESERVES[0];
+        printf("swapsdata whitelist, %s %s\n", cnv.to_string().c_str(), other.to_string().c_str());
+
+        auto whitelisted = [&](name converter) { return bool(c.get_row<swapsdata::converter_row>(DATA, DATA.value, "converters"_n, converter.value)); };
+        auto volume = [&](name converter) {
+            auto td = c.get_row<swapsdata::trade_data>(DATA, DATA.value, "tradedata"_n, converter.value);
+            return td ? td->volume_cumulative.at(tlos.code()) : asset(0, tlos);
+        };
+        auto expect_whitelisted = [&](const char* what, name converter, bool expected) {
+            bool ok = whitelisted(converter) == expected;
+            printf("  %-48s %-18s %s\n", what, expected ? "whitelisted" : "not whitelisted", ok ? "ok" : "MISMATCH");
+            return ok;
+        };
+
+        bool ok = true;
+        convert(c, TOKENS, units(1000, tlos), cnv.to_string() + " SEEDS");
+        ok &= expect_failure("delconverter before the reset", [&] { c.push_action(DATA, "delconverter"_n, DATA, cnv); }, "reset the converter first");
+
+        // the converters row dropped, the rows as an upgraded contract finds them
+        c.set_action(DATA, "forget"_n, [&](name, name, const std::vector<char>&) {
+            swapsdata::converter_table converters(DATA, DATA.value);
+            converters.erase(converters.get(cnv.value));
+        });
+        c.push_action(DATA, "forget"_n, DATA);
+        convert(c, TOKENS, units(1000, tlos), cnv.to_string() + " SEEDS");
+        ok &= expect_whitelisted("a log with trade data", cnv, true);
+        ok &= expect("a log with trade data, TLOS volume", volume(cnv), units(2000, tlos));
+
+        add_converter(c, other, symbol("RELE", 4), NETWORK, 1e6, 500000, 1e6, 500000, 2000);
+        convert(c, TOKENS, units(1000, tlos), other.to_string() + " SEEDS");
+        ok &= expect_whitelisted("a log without trade data", other, false);
+        ok &= expect("a log without trade data, TLOS volume", volume(other), units(0, tlos));
+
+        c.push_action(DATA, "reset"_n, DATA, cnv);
+        c.push_action(DATA, "delconverter"_n, DATA, cnv);
+        convert(c, TOKENS, units(1000, tlos), cnv.to_string() + " SEEDS");
+        ok &= expect_whitelisted("a log once reset and deleted", cnv, false);
+
+        swapsdata::trade_data trade{};
+        trade.converter = other;
+        c.push_action(DATA, "seed"_n, DATA, other, trade, std::vector<swapsdata::day_buffer_row>{},
+                      std::vector<swapsdata::month_buffer_row>{}, std::vector<swapsdata::candle_block>{});
+        ok &= expect_whitelisted("a seeded converter", other, true);
+        return ok;
+    }
+
+    // cnvrt1 logs 1000 trades a day, each from another trader, for 64 days, sizes spread over 1 to 1000 TLOS:
+    // each day's size quantiles are within 3% of the sizes logged, and the root mean square error of the trader
+    // counts is within the HyperLogLog's standard error of 6.5%
+    bool check_flow() {
+        chain c;
+        setup(c);
+
+        const name cnv = CONVERTERS[0];
+        const symbol tlos = RESERVES[0];
+        const std::vector<double> quantiles = { 0, 0.1, 0.5, 0.9, 0.99, 1 };
+        const size_t days = 64, trades = 1000, traders = 1000;
+        printf("flow sketch, %s\n", cnv.to_string().c_str());
+
+        double size_error = 0, trader_error = 0;
+        for (size_t d = 0; d < days; ++d) {
+            std::vector<int64_t> sizes;
+            for (size_t t = 0; t < trades; ++t) {
+                sizes.push_back(units(pow(1000, double((t * 7919 + d) % trades) / trades), tlos).amount);
+                std::vector<swapsdata::swap_record> swap = { { asset(sizes.back(), tlos), 1.0, asset(0, tlos), 1.0 } };
+                c.push_action(DATA, "log"_n, cnv, cnv, swap, name(d * traders + t % traders + 1));
+            }
+            auto traces = c.push_action(DATA, "flow"_n, TRADER, cnv, eosio::time_point_sec(c.now()), quantiles);
+            auto stats = eosio::unpack<swapsdata::flow_stats>(traces.front().return_value);
+
+            std::sort(sizes.begin(), sizes.end());
+            for (size_t i = 0; i < quantiles.size(); ++i) {
+                double exact = sizes[size_t(quantiles[i] * (trades - 1))];
+                size_error = std::max(size_error, fabs(stats.sizes.front().sizes[i].amount / exact - 1));
+            }
+            trader_error += pow(double(stats.traders) / traders - 1, 2);
+            c.advance(eosio::days(1));
+        }
+        trader_error = sqrt(trader_error / days);
+
+        bool ok = size_error <= 0.03 && trader_error <= 0.065;
+        printf("  %-48s %.4f %.4f %s\n", "size and trader count errors", size_error, trader_error,
+               ok ? "ok" : "MISMATCH, beyond 0.03 and 0.065");
+        return ok;
+    }
+
+    // a log of one swap of `amount` TLOS at `price`, as the converter sends it
+    void log_swap(chain& c, name cnv, double amount, double price) {
+        const symbol tlos = RESERVES[0];
+        std::vector<swapsdata::swap_record> swap = { { units(amount, tlos), price, units(1e6, tlos), price } };
+        c.push_action(DATA, "log"_n, cnv, cnv, swap, TRADER);
+    }
+
+    // the changes feed read in pages of two from cursor 0 lists the converters in the order they were last logged,
+    // each page resuming after the last one; a converter logged again, or reset, comes up again after the cursor,
+    // and purging the changes row of a reset converter leaves the cursor valid
+    bool check_changes() {
+        chain c;
+        setup(c);
+        printf("changes feed, %s to %s\n", CONVERTERS.front().to_string().c_str(), CONVERTERS.back().to_string().c_str());
+
+        auto read = [&](uint64_t cursor, uint32_t limit) {
+            auto traces = c.push_action(DATA, "changes"_n, TRADER, cursor, limit);
+            return eosio::unpack<swapsdata::change_feed>(traces.front().return_value);
+        };
+        auto expect_page = [&](const char* what, const swapsdata::change_feed& feed, const std::vector<name>& expected, bool more) {
+            std::string listed, wanted;
+            bool ordered = true;
+            for (size_t i = 0; i < feed.changes.size(); ++i) {
+                listed += (i ? " " : "") + feed.changes[i].converter.to_string();
+                ordered &= i == 0 || feed.changes[i - 1].sequence < feed.changes[i].sequence;
+            }
+            for (size_t i = 0; i < expected.size(); ++i)
+                wanted += (i ? " " : "") + expected[i].to_string();
+            wanted = wanted.empty() ? "nothing" : more ? wanted + " ..." : wanted;
+            listed = listed.empty() ? "nothing" : feed.more ? listed + " ..." : listed;
+            bool ok = listed == wanted && ordered && (feed.changes.empty() || feed.cursor == feed.changes.back().sequence);
+            printf("  %-48s %-18s %s\n", what, wanted.c_str(), ok ? "ok" : ("MISMATCH, listed " + listed).c_str());
+            return ok;
+        };
+
+        bool ok = true;
+        for (size_t i = 0; i < 3; ++i)
+            log_swap(c, CONVERTERS[i], 100, 1);
+        auto page = read(0, 2);
+        ok &= expect_page("from cursor 0", page, { CONVERTERS[0], CONVERTERS[1] }, true);
+        page = read(page.cursor, 2);
+        ok &= expect_page("the next page", page, { CONVERTERS[2] }, false);
+        uint64_t cursor = page.cursor;
+        ok &= expect_page("again from its cursor", read(cursor, 2), {}, false);
+
+        c.advance(eosio::seconds(10));
+        log_swap(c, CONVERTERS[3], 100, 1);
+        log_swap(c, CONVERTERS[0], 100, 1);
+        page = read(cursor, 10);
+        ok &= expect_page("logged again after the cursor", page, { CONVERTERS[3], CONVERTERS[0] }, false);
+        cursor = page.cursor;
+
+        c.push_action(DATA, "reset"_n, DATA, CONVERTERS[1]);
+        page = read(cursor, 10);
+        ok &= expect_page("reset after the cursor", page, { CONVERTERS[1] }, false);
+        bool reset = !page.changes.empty() && !page.changes.front().trade;
+        printf("  %-48s %-18s %s\n", "reset, trade data", "absent", reset ? "ok" : "MISMATCH, present");
+        ok &= reset;
+
+        c.push_action(DATA, "purge"_n, DATA, CONVERTERS[1]);
+        log_swap(c, CONVERTERS[2], 100, 1);
+        ok &= expect_page("purged, from the cursor before", read(cursor, 10), { CONVERTERS[2] }, false);
+        ok &= expect_page("purged, from the last cursor", read(page.cursor, 10), { CONVERTERS[2] }, false);
+        ok &= expect_page("purged, from cursor 0", read(0, 10), { CONVERTERS[3], CONVERTERS[0], CONVERTERS[2] }, false);
+        return ok;
+    }
+
+    // cnvrt1 logs four swaps a day of TLOS for SEEDS at prices along a random walk, leaving out every fifth day,
+    // for 400 days: the candles read back over a range are those worked out from the swaps, volumes summed and
+    // prices rounded to ticks, across intervals closed into the archive, blocks sealed when full and the last
+    // interval, still open
+    bool check_candles() {
+        chain c;
+        setup(c);
+
+        const name cnv = CONVERTERS[0];
+        const symbol tlos = RESERVES[0], seeds = RESERVES[1];
+        const uint32_t days = 400;
+        printf("candles, %s\n", cnv.to_string().c_str());
+
+        // by interval, then in the order the tokens were first logged in it
+        std::map<uint32_t, std::vector<swapsdata::candle_ticks>> expected;
+        auto add = [&](uint32_t interval, asset quantity, double price) {
+            int64_t tick = llround(log(price) / ARCHIVE_PRICE_TICK);
+            auto& candles = expected[interval];
+            auto k = std::find_if(candles.begin(), candles.end(), [&](const auto& t) { return t.sym == quantity.symbol; });
+            if (k == candles.end()) {
+                candles.push_back({ quantity.symbol, tick, tick, tick, tick, quantity.amount });
+                return;
+            }
+            k->high = std::max(k->high, tick);
+            k->low = std::min(k->low, tick);
+            k->close = tick;
+            k->volume += quantity.amount;
+        };
+
+        uint32_t first = c.now().sec_since_epoch() / ARCHIVE_INTERVAL + 1;
+        std::mt19937_64 random(7);
+        std::normal_distribution<double> step(0, 0.01);
+        std::uniform_real_distribution<double> size(1, 10000);
+        double price = 1;
+        for (uint32_t d = 0; d < days; ++d) {
+            for (int h = 0; h < 4; ++h) {
+                price *= exp(step(random));
+                asset sold = units(size(random), tlos), bought = units(sold.amount / 1e4 * price, seeds);
+                if (d % 5 == 2) continue;
+                c.set_time(eosio::time_point(eosio::seconds(int64_t(first + d) * ARCHIVE_INTERVAL + h * ARCHIVE_INTERVAL / 4)));
+                std::vector<swapsdata::swap_record> swap = { { sold, price, units(1e6, tlos), price }, { bought, 1 / price, units(1e6, seeds), 1 / price } };
+                c.push_action(DATA, "log"_n, cnv, cnv, swap, TRADER);
+                add(first + d, sold, price);
+                add(first + d, bought, 1 / price);
+            }
+        }
+
+        // the sealed blocks, each one's current interval is the first of the next
+        size_t blocks = 0, sealed = 0;
+        for (auto b = c.get_row<swapsdata::candle_block>(DATA, cnv.value, "candles"_n, first); b;
+             b = b->sealed ? c.get_row<swapsdata::candle_block>(DATA, cnv.value, "candles"_n, b->current) : std::nullopt) {
+            blocks++;
+            sealed += b->sealed;
+        }
+
+        auto expect_candles = [&](const char* what, eosio::time_point_sec from, eosio::time_point_sec to, uint32_t from_interval, uint32_t to_interval) {
+            auto traces = c.push_action(DATA, "candles"_n, TRADER, cnv, from, to);
+            auto read = eosio::unpack<std::vector<swapsdata::candle_record>>(traces.front().return_value);
+
+            std::vector<swapsdata::candle_record> wanted;
+            for (auto it = expected.lower_bound(from_interval); it != expected.end() && it->first <= to_interval; ++it)
+                for (const auto& t : it->second)
+                    wanted.push_back({ eosio::time_point_sec(it->first * ARCHIVE_INTERVAL), asset(t.volume, t.sym), exp(t.open * ARCHIVE_PRICE_TICK),
+                                       exp(t.high * ARCHIVE_PRICE_TICK), exp(t.low * ARCHIVE_PRICE_TICK), exp(t.close * ARCHIVE_PRICE_TICK) });
+
+            size_t mismatched = read.size() == wanted.size() ? 0 : std::max(read.size(), wanted.size());
+            for (size_t i = 0; mismatched == 0 && i < read.size(); ++i) {
+                const auto &r = read[i], &w = wanted[i];
+                mismatched += r.timestamp != w.timestamp || r.volume != w.volume || r.open != w.open || r.high != w.high ||
+                              r.low != w.low || r.close != w.close;
+            }
+            bool ok = mismatched == 0 && !wanted.empty();
+            printf("  %-48s %-18s %s\n", what, (std::to_string(wanted.size()) + " candles").c_str(),
+                   ok ? "ok" : ("MISMATCH, " + std::to_string(read.size()) + " read, " + std::to_string(mismatched) + " differ").c_str());
+            return ok;
+        };
+        auto at = [](uint32_t interval) { return eosio::time_point_sec(interval * ARCHIVE_INTERVAL); };
+        const uint32_t last = first + days - 1;
+
+        bool ok = blocks > 1 && sealed == blocks - 1;
+        printf("  %-48s %-18s %s\n", "archive blocks", (std::to_string(blocks) + " blocks").c_str(), ok ? "ok" : "MISMATCH, none sealed");
+        ok &= expect_candles("all of them", at(0), at(last), first, last);
+        auto b = c.get_row<swapsdata::candle_block>(DATA, cnv.value, "candles"_n, first);
+        uint32_t boundary = b ? b->current : first;
+        ok &= expect_candles("across the first sealed block's end", at(boundary - 10), at(boundary + 10), boundary - 10, boundary + 10);
+        ok &= expect_candles("from within an interval", eosio::time_point_sec(at(first + 20).sec_since_epoch() + 1), at(first + 30),
+                             first + 21, first + 30);
+        ok &= expect_candles("rolled over into the last interval", at(last - 1), at(last - 1), last - 1, last - 1);
+        ok &= expect_candles("the open interval", at(last), at(last), last, last);
+        return ok;
+    }
+
+    // 1000 TLOS along cnvrt1 SEEDS cnvrt2 HUSD: 1e6 * 1000 / 1001000 * 0.998^2 = 995.0089 SEEDS, then
+    // 1e6 * 995.0089 / 1000995.0089 * 0.998^2 = 990.04 HUSD, the same whether the memo names the route or the path
+    bool check_route() {
+        const symbol tlos = RESERVES[0], husd = RESERVES[2];
+        const std::vector<BancorNetwork::route_hop> hops = { { CONVERTERS[0], RESERVES[1].code() }, { CONVERTERS[1], husd.code() } };
+        printf("route, #1 = %s\n", fixture::path(0, 2, false).c_str());
+
+        bool ok = true;
+        for (bool registered : { true, false }) {
+            chain c;
+            setup(c);
+            c.max_inline_action_depth = 10;
+
+            if (registered)
+                c.push_action(NETWORK, "setroute"_n, NETWORK, uint64_t(1), hops);
+            int64_t before = balance_of(c, TOKENS, TRADER, husd);
+            convert(c, TOKENS, units(1000, tlos), registered ? "#1" : fixture::path(0, 2, false));
+            ok &= expect(registered ? "1000 TLOS along #1" : "1000 TLOS along the path", asset(balance_of(c, TOKENS, TRADER, husd) - before, husd),
+                         units(990.04, husd));
+
+            if (registered) {
+                c.push_action(NETWORK, "delroute"_n, NETWORK, uint64_t(1));
+                ok &= expect_failure("1000 TLOS along #1 once deleted", [&] { convert(c, TOKENS, units(1000, tlos), "#1"); }, "route not found");
+            }
+        }
+        return ok;
+    }
+}
+
+int main() {
+    bool ok = check_cross_reserve();
+    ok = check_liquidity() && ok;
+    ok = check_price_limit() && ok;
+    ok = check_batch() && ok;
+    ok = check_large_batch() && ok;
+    ok = check_twap() && ok;
+    ok = check_twap_liquidity() && ok;
+    ok = check_route() && ok;
+    ok = check_alternatives() && ok;
+    ok = check_whitelist() && ok;
+    ok = check_flow() && ok;
+    ok = check_changes() && ok;
+    ok = check_candles() && ok;
+    return ok ? 0 : 1;
+}
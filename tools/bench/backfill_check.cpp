@@ -0,0 +1,169 @@
+/**
+ *  @file
+ *  @copyright defined in ../../LICENSE
+ *
+ *  Checks tools/backfill against the contract: trades the benchmark fixture with random swaps at
+ *  uneven intervals (minutes, with the odd gap of days or months so that the buffer cleanup runs),
+ *  writes the `log` traces to a swap trace, replays it and compares every replayed row byte for byte
+ *  with the rows `swapsdata` wrote. Then seeds a fresh `swapsdata` with the replayed rows and
+ *  compares again.
+ *
+ *  usage: backfill_check [swaps] [threads]
+ */
+
+#include "fixture.hpp"
+
+#include <backfill/replay.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <tuple>
+#include <unistd.h>
+
+using namespace fixture;
+
+namespace {
+
+    // table, scope, primary key
+    using row_key = std::tuple<uint64_t, uint64_t, uint64_t>;
+    using row_set = std::map<row_key, std::vector<char>>;
+
+    void track(chain& c, name code, row_set& rows) {
+        c.on_deltas = [&rows, code](const std::vector<eosio::native::table_delta>& deltas) {
+            for (const auto& d : deltas) {
+                // the changes feed numbers the updates of one deployment, backfill has no part in it; the
+                // flow sketches count traders, which a swap trace does not record; the whitelist is set up
+                // before the fixture's logs and written by seed
+                if (d.code != code || d.table == "changes"_n || d.table == "state"_n || d.table == "flowsketch"_n ||
+                    d.table == "converters"_n)
+                    continue;
+                row_key key{ d.table.value, d.scope, d.primary_key };
+                if (d.present) rows[key] = d.value;
+                else rows.erase(key);
+            }
+        };
+    }
+
+    row_set replayed_rows(const std::vector<backfill::converter_rows>& converters) {
+        row_set rows;
+        for (const auto& c : converters) {
+            if (!c.trade) continue;
+            rows[{ "tradedata"_n.value, DATA.value, c.converter.value }] = eosio::pack(*c.trade);
+            for (const auto& [pk, row] : c.day)
+                rows[{ "daybuffer"_n.value, c.converter.value, pk }] = eosio::pack(row);
+            for (const auto& [pk, row] : c.month)
+                rows[{ "monthbuffer"_n.value, c.converter.value, pk }] = eosio::pack(row);
+            for (const auto& [pk, row] : c.candles)
+                rows[{ "candles"_n.value, c.converter.value, pk }] = eosio::pack(row);
+        }
+        return rows;
+    }
+
+    bool compare(const char* what, const row_set& expected, const row_set& actual) {
+        size_t mismatches = 0;
+        for (const auto& [key, value] : expected) {
+            auto itr = actual.find(key);
+            if (itr == actual.end() || itr->second != value) {
+                if (mismatches++ < 5)
+                    fprintf(stderr, "%s: %s scope %s pk %llu %s\n", what, name(std::get<0>(key)).to_string().c_str(),
+                            name(std::get<1>(key)).to_string().c_str(), (unsigned long long)std::get<2>(key),
+                            itr == actual.end() ? "missing" : "differs");
+            }
+        }
+        bool ok = mismatches == 0 && expected.size() == actual.size();
+        printf("%s: %zu rows expected, %zu found, %zu mismatched, %s\n", what, expected.size(), actual.size(), mismatches,
+               ok ? "ok" : "FAILED");
+        return ok;
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t swaps = argc > 1 ? strtoull(argv[1], nullptr, 10) : 2000;
+    unsigned threads = argc > 2 ? strtoul(argv[2], nullptr, 10) : 4;
+
+    std::string path = "/tmp/backfill_check." + std::to_string(getpid()) + ".swt";
+    row_set contract_rows;
+    {
+        // one native chain at a time: the fixture's goes before the one seeded below
+        chain c;
+        setup(c);
+        c.max_inline_action_depth = 10;
+        track(c, DATA, contract_rows);
+
+        std::mt19937_64 rng(13);
+        std::uniform_int_distribution<size_t> pick_hops(1, CONVERTERS.size());
+        std::uniform_real_distribution<double> pick_amount(1, 1000);
+        std::uniform_int_distribution<uint32_t> pick_gap(30, 1200);
+        {
+            // small blocks so the replay reads across many of them
+            swaptrace::writer trace(path, 512);
+            for (size_t i = 0; i < swaps; ++i) {
+                uint32_t gap = pick_gap(rng);
+                if (rng() % 100 == 0) gap = 2 * 86400;
+                if (rng() % 500 == 0) gap = 40 * 86400;
+                c.advance(eosio::seconds(gap));
+
+                size_t hops = pick_hops(rng);
+                bool reverse = rng() & 1;
+                size_t from = reverse ? hops + rng() % (CONVERTERS.size() - hops + 1) : rng() % (CONVERTERS.size() - hops + 1);
+                auto traces = c.push_action(TOKENS, "transfer"_n, TRADER, TRADER, NETWORK, units(pick_amount(rng), RESERVES[from]),
+                                            "1," + fixture::path(from, hops, reverse) + ",0.0," + TRADER.to_string());
+                for (const auto& t : traces) {
+                    if (t.receiver != DATA || t.account != DATA || t.action != "log"_n) continue;
+                    auto [converter, records] = eosio::unpack<std::tuple<name, std::vector<swapsdata::swap_record>>>(t.data);
+                    swaptrace::swap s;
+                    s.timestamp = c.now().sec_since_epoch();
+                    s.converter = converter;
+                    s.from = records[0].quantity;
+                    s.to = records[1].quantity;
+                    s.from_price = records[0].price;
+                    s.to_price = records[1].price;
+                    s.from_depth = records[0].liquidity_depth.amount;
+                    s.to_depth = records[1].liquidity_depth.amount;
+                    s.from_smart_price = records[0].smart_price;
+                    s.to_smart_price = records[1].smart_price;
+                    trace.append(s);
+                }
+            }
+            trace.close();
+        }
+        c.on_deltas = nullptr;
+    }
+
+    swaptrace::reader trace(path);
+    auto start = std::chrono::steady_clock::now();
+    auto converters = backfill::replay(trace, threads);
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    unlink(path.c_str());
+    printf("%zu logs of %zu converters replayed on %u threads in %.3f ms\n", trace.rows(), converters.size(), threads, elapsed * 1e3);
+
+    auto rows = replayed_rows(converters);
+    bool ok = compare("replay", contract_rows, rows);
+
+    // seed actions like the ones the backfill tool writes, in small batches so that rows are split across them
+    chain fresh;
+    deploy_swapsdata(fresh, DATA);
+    row_set seeded_rows;
+    track(fresh, DATA, seeded_rows);
+    size_t actions = 0;
+    for (const auto& cr : converters) {
+        std::vector<swapsdata::day_buffer_row> day;
+        std::vector<swapsdata::month_buffer_row> month;
+        std::vector<swapsdata::candle_block> candles;
+        for (const auto& [pk, row] : cr.day) day.push_back(row);
+        for (const auto& [pk, row] : cr.month) month.push_back(row);
+        for (const auto& [pk, row] : cr.candles) candles.push_back(row);
+        for (size_t i = 0; i == 0 || i < day.size(); i += 16, ++actions)
+            fresh.push_action(DATA, "seed"_n, DATA, cr.converter, *cr.trade,
+                              std::vector<swapsdata::day_buffer_row>(day.begin() + std::min(i, day.size()), day.begin() + std::min(i + 16, day.size())),
+                              i == 0 ? month : std::vector<swapsdata::month_buffer_row>(),
+                              i == 0 ? candles : std::vector<swapsdata::candle_block>());
+    }
+    fresh.on_deltas = nullptr;
+    printf("%zu seed actions\n", actions);
+    ok = compare("seed", contract_rows, seeded_rows) && ok;
+    return ok ? 0 : 1;
+}
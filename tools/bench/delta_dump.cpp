@@ -0,0 +1,81 @@
+/**
+ *  @file
+ *  @copyright defined in ../../LICENSE
+ *
+ *  Writes the table deltas of the benchmark fixture, set up and then traded with random swaps, in
+ *  the dump format quoted/quoted.cpp ingests. Finally converts 1000 TLOS to TESTA (not dumped) and
+ *  prints the payout, which `quote tokens 1000.0000 TLOS tokens TESTA` must match.
+ *
+ *  usage: delta_dump <file> [swaps] [transactions per block]
+ */
+
+#include "fixture.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+using namespace fixture;
+
+namespace {
+
+    struct account_row {
+        asset    balance;
+        uint64_t primary_key() const { return balance.symbol.code().raw(); }
+    };
+
+    int64_t balance_of(const chain& c, name contract, name owner, symbol sym) {
+        auto row = c.get_row<account_row>(contract, owner.value, "accounts"_n, sym.code().raw());
+        return row ? row->balance.amount : 0;
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: delta_dump <file> [swaps] [transactions per block]\n");
+        return 1;
+    }
+    size_t swaps = argc > 2 ? strtoull(argv[2], nullptr, 10) : 1000;
+    size_t per_block = argc > 3 ? strtoull(argv[3], nullptr, 10) : 10;
+
+    FILE* out = fopen(argv[1], "w");
+    if (!out) {
+        fprintf(stderr, "cannot open %s\n", argv[1]);
+        return 1;
+    }
+
+    chain c;
+    size_t transactions = 0, rows = 0;
+    c.on_deltas = [&](const std::vector<eosio::native::table_delta>& deltas) {
+        uint32_t block = 1 + transactions++ / per_block;
+        for (const auto& d : deltas) {
+            fprintf(out, "%u %d %s %llu %s %llu ", block, int(d.present), d.code.to_string().c_str(), (unsigned long long)d.scope,
+                    d.table.to_string().c_str(), (unsigned long long)d.primary_key);
+            for (unsigned char b : d.value) fprintf(out, "%02x", b);
+            fputc('\n', out);
+        }
+        rows += deltas.size();
+    };
+
+    setup(c);
+    c.max_inline_action_depth = 10;
+
+    std::mt19937_64 rng(7);
+    std::uniform_int_distribution<size_t> pick_hops(1, CONVERTERS.size());
+    std::uniform_real_distribution<double> pick_amount(1, 1000);
+    for (size_t i = 0; i < swaps; ++i) {
+        size_t hops = pick_hops(rng);
+        bool reverse = rng() & 1;
+        size_t from = reverse ? hops + rng() % (CONVERTERS.size() - hops + 1) : rng() % (CONVERTERS.size() - hops + 1);
+        convert(c, TOKENS, units(pick_amount(rng), RESERVES[from]), path(from, hops, reverse));
+    }
+    fclose(out);
+    c.on_deltas = nullptr;
+
+    auto before = balance_of(c, TOKENS, TRADER, RESERVES[4]);
+    convert(c, TOKENS, units(1000, RESERVES[0]), path(0, 4, false));
+    printf("%zu transactions, %zu deltas, %zu blocks\n", transactions, rows, (transactions + per_block - 1) / per_block);
+    printf("1000.0000 TLOS -> %s via %s\n", asset(balance_of(c, TOKENS, TRADER, RESERVES[4]) - before, RESERVES[4]).to_string().c_str(),
+           path(0, 4, false).c_str());
+    return 0;
+}
@@ -0,0 +1,64 @@
+/**
+ *  @file
+ *  @copyright defined in ../../LICENSE
+ */
+#pragma once
+
+#include <native/chain.hpp>
+
+#include <math.h>
+
+#include "../../contracts/BancorConverter/BancorConverter.hpp"
+#include "../../contracts/BancorNetwork/BancorNetwork.hpp"
+#include "../../contracts/Token/Token.hpp"
+#include "../../contracts/swapsdata/swapsdata.hpp"
+
+/**
+ * the native equivalents of the dispatchers eosio-cpp generates for each contract
+ */
+inline void deploy_token(eosio::native::chain& c, eosio::name account) {
+    c.deploy<Token>(account)
+        .action<&Token::create>("create"_n)
+        .action<&Token::issue>("issue"_n)
+        .action<&Token::retire>("retire"_n)
+        .action<&Token::transfer>("transfer"_n)
+        .action<&Token::transferbyid>("transferbyid"_n)
+        .action<&Token::open>("open"_n)
+        .action<&Token::close>("close"_n);
+}
+
+inline void deploy_converter(eosio::native::chain& c, eosio::name account) {
+    c.deploy<BancorConverter>(account)
+        .action<&BancorConverter::init>("init"_n)
+        .action<&BancorConverter::update>("update"_n)
+        .action<&BancorConverter::setbatch>("setbatch"_n)
+        .action<&BancorConverter::settle>("settle"_n)
+        .action<&BancorConverter::cancel>("cancel"_n)
+        .action<&BancorConverter::observe>("observe"_n)
+        .action<&BancorConverter::setreserve>("setreserve"_n)
+        .action<&BancorConverter::delreserve>("delreserve"_n)
+        .action<&BancorConverter::fund>("fund"_n)
+        .action<&BancorConverter::withdraw>("withdraw"_n)
+        .notify<&BancorConverter::on_transfer>(eosio::name(), "transfer"_n);
+}
+
+inline void deploy_network(eosio::native::chain& c, eosio::name account) {
+    c.deploy<BancorNetwork>(account)
+        .action<&BancorNetwork::init>("init"_n)
+        .action<&BancorNetwork::setroute>("setroute"_n)
+        .action<&BancorNetwork::delroute>("delroute"_n)
+        .notify<&BancorNetwork::on_transfer>(eosio::name(), "transfer"_n);
+}
+
+inline void deploy_swapsdata(eosio::native::chain& c, eosio::name account) {
+    c.deploy<swapsdata>(account)
+        .action<&swapsdata::log>("log"_n)
+        .action<&swapsdata::reset>("reset"_n)
+        .action<&swapsdata::purge>("purge"_n)
+        .action<&swapsdata::addconverter>("addconverter"_n)
+        .action<&swapsdata::delconverter>("delconverter"_n)
+        .action<&swapsdata::seed>("seed"_n)
+        .action<&swapsdata::candles>("candles"_n)
+        .action<&swapsdata::changes>("changes"_n)
+        .action<&swapsdata::flow>("flow"_n);
+}
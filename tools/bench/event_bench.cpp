@@ -0,0 +1,213 @@
+/**
+ *  @file
+ *  @copyright defined in ../../LICENSE
+ *
+ *  Decodes a dump of event lines with events::decoder and with general purpose JSON parsers (the
+ *  trace parser of tools/swaptrace and, when found at configure time, jsoncpp), checks that they
+ *  read the same fields and compares their throughput.
+ *
+ *  `--record <swaps>` first writes the console output of random swaps on the benchmark fixture to
+ *  the dump; it holds `probes` events only in a build configured with -DSWAPS_PROBES=ON.
+ *
+ *  usage: event_bench <dump> [--record <swaps>] [--repeat 5]
+ */
+
+#include "fixture.hpp"
+
+#include <events/decoder.hpp>
+
+#include "../swaptrace/src/json.hpp"
+
+#ifdef EVENTS_JSONCPP
+#include <json/json.h>
+#endif
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <random>
+
+using namespace fixture;
+
+namespace {
+
+    // what every decoder must agree on: the number of events and of fields, and the length of their
+    // text or, on the checking run, a hash of it; timed runs only touch the lengths
+    struct digest {
+        bool     hashing = false;
+        size_t   events = 0;
+        size_t   fields = 0;
+        uint64_t hash = 1469598103934665603ull;
+
+        void add(std::string_view text) {
+            if (!hashing) {
+                hash += text.size();
+                return;
+            }
+            for (unsigned char c : text) hash = (hash ^ c) * 1099511628211ull;
+            hash = (hash ^ 0xff) * 1099511628211ull;
+        }
+        bool operator==(const digest& o) const { return events == o.events && fields == o.fields && hash == o.hash; }
+    };
+
+    std::string read_all(const char* path) {
+        FILE* in = fopen(path, "rb");
+        if (!in) return {};
+        std::string data;
+        char buf[1 << 16];
+        for (size_t n; (n = fread(buf, 1, sizeof(buf), in)) > 0; )
+            data.append(buf, n);
+        fclose(in);
+        return data;
+    }
+
+    size_t record(const char* path, size_t swaps) {
+        FILE* out = fopen(path, "w");
+        if (!out) return 0;
+        chain c;
+        setup(c);
+        c.max_inline_action_depth = 10;
+        std::mt19937_64 rng(5);
+        std::uniform_int_distribution<size_t> pick_hops(1, CONVERTERS.size());
+        std::uniform_real_distribution<double> pick_amount(1, 1000);
+        size_t bytes = 0;
+        for (size_t i = 0; i < swaps; ++i, c.advance(eosio::seconds(30))) {
+            size_t hops = pick_hops(rng);
+            bool reverse = rng() & 1;
+            size_t from = reverse ? hops + rng() % (CONVERTERS.size() - hops + 1) : rng() % (CONVERTERS.size() - hops + 1);
+            auto traces = c.push_action(TOKENS, "transfer"_n, TRADER, TRADER, NETWORK, units(pick_amount(rng), RESERVES[from]),
+                                        "1," + fixture::path(from, hops, reverse) + ",0.0," + TRADER.to_string());
+            for (const auto& t : traces) {
+                fwrite(t.console.data(), 1, t.console.size(), out);
+                bytes += t.console.size();
+            }
+        }
+        fclose(out);
+        return bytes;
+    }
+
+    // the lines a JSON parser is handed: the ones that open an object, as the decoder sees them
+    template<typename F>
+    void for_each_object(std::string_view data, F&& f) {
+        for (size_t line = 0; line < data.size(); ) {
+            size_t end = data.find('\n', line);
+            if (end == std::string_view::npos) end = data.size();
+            if (end > line && data[line] == '{') f(data.substr(line, end - line));
+            line = end + 1;
+        }
+    }
+
+    digest with_decoder(std::string_view data, bool hashing) {
+        digest d;
+        d.hashing = hashing;
+        events::decoder decoder;
+        decoder.decode(data, [&](const events::event& e) {
+            ++d.events;
+            d.fields += e.size + 2;
+            d.add("version"); d.add(e.version);
+            d.add("etype"); d.add(e.etype);
+            for (size_t i = 0; i < e.size; ++i) {
+                d.add(e.fields[i].key);
+                d.add(e.fields[i].value);
+            }
+        });
+        return d;
+    }
+
+    digest with_trace_parser(std::string_view data, bool hashing) {
+        digest d;
+        d.hashing = hashing;
+        for_each_object(data, [&](std::string_view line) {
+            auto j = swaptrace::json_parser(line).parse();
+            ++d.events;
+            for (const auto& [key, value] : j.fields) {
+                ++d.fields;
+                d.add(key);
+                d.add(value.text);
+            }
+        });
+        return d;
+    }
+
+#ifdef EVENTS_JSONCPP
+    digest with_jsoncpp(std::string_view data, bool hashing) {
+        digest d;
+        d.hashing = hashing;
+        Json::CharReaderBuilder builder;
+        std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+        for_each_object(data, [&](std::string_view line) {
+            Json::Value root;
+            std::string errors;
+            eosio::check(reader->parse(line.data(), line.data() + line.size(), &root, &errors), errors);
+            ++d.events;
+            // jsoncpp keeps members sorted, the event's order is in the text
+            for (size_t pos = 1; pos < line.size(); ) {
+                size_t k0 = line.find('"', pos), k1 = line.find('"', k0 + 1);
+                if (k0 == std::string_view::npos) break;
+                std::string key(line.substr(k0 + 1, k1 - k0 - 1));
+                ++d.fields;
+                d.add(key);
+                d.add(root[key].asString());
+                pos = line.find('"', line.find('"', k1 + 1) + 1) + 1;
+            }
+        });
+        return d;
+    }
+#endif
+
+    // the best time of `repeat` runs, and the hashed digest of one more
+    double best_of(size_t repeat, const std::function<digest(bool)>& run, digest& result) {
+        double best = 1e30;
+        for (size_t i = 0; i < repeat; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            run(false);
+            best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        }
+        result = run(true);
+        return best;
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: event_bench <dump> [--record <swaps>] [--repeat 5]\n");
+        return 1;
+    }
+    size_t repeat = 5;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        if (flag == "--record") {
+            size_t bytes = record(argv[1], strtoull(argv[i + 1], nullptr, 10));
+            printf("recorded %zu bytes of console output\n", bytes);
+        } else if (flag == "--repeat") {
+            repeat = std::max<size_t>(1, strtoull(argv[i + 1], nullptr, 10));
+        }
+    }
+
+    std::string data = read_all(argv[1]);
+    digest expected;
+    double decoder_time = best_of(repeat, [&](bool hashing) { return with_decoder(data, hashing); }, expected);
+    if (expected.events == 0) {
+        fprintf(stderr, "no events in %s; record with a build configured with -DSWAPS_PROBES=ON\n", argv[1]);
+        return 1;
+    }
+    auto report = [&](const char* what, double seconds, const digest& d) {
+        printf("%-12s %9zu events %10zu fields  %8.3f ms  %7.1f MB/s  %6.2fM events/s  %s\n", what, d.events, d.fields, seconds * 1e3,
+               data.size() / seconds / 1e6, d.events / seconds / 1e6, d == expected ? "same fields" : "FIELDS DIFFER");
+        return d == expected;
+    };
+
+    bool ok = report("decoder", decoder_time, expected);
+    digest d;
+    double t = best_of(repeat, [&](bool hashing) { return with_trace_parser(data, hashing); }, d);
+    ok = report("swaptrace", t, d) && ok;
+    printf("%-12s %.1fx faster than swaptrace::json_parser\n", "", t / decoder_time);
+#ifdef EVENTS_JSONCPP
+    t = best_of(repeat, [&](bool hashing) { return with_jsoncpp(data, hashing); }, d);
+    ok = report("jsoncpp", t, d) && ok;
+    printf("%-12s %.1fx faster than jsoncpp\n", "", t / decoder_time);
+#endif
+    return ok ? 0 : 1;
+}
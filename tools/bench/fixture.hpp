@@ -0,0 +1,93 @@
+/**
+ *  @file
+ *  @copyright defined in ../../LICENSE
+ *
+ *  The benchmark fixture shared by the native tools: four converters chained by their reserves.
+ */
+#pragma once
+
+#include "deploy.hpp"
+
+#include <string>
+#include <vector>
+
+using eosio::asset;
+using eosio::name;
+using eosio::symbol;
+using eosio::native::chain;
+
+namespace fixture {
+
+    const name TOKENS   = "tokens"_n;
+    const name RELAYS   = "relays"_n;
+    const name NETWORK  = "network"_n;
+    const name DATA     = "data.tbn"_n;
+    const name LP       = "provider"_n;
+    const name TRADER   = "alice"_n;
+
+    const std::vector<symbol> RESERVES = { symbol("TLOS", 4), symbol("SEEDS", 4), symbol("HUSD", 2), symbol("USDT", 4), symbol("TESTA", 4) };
+    const std::vector<symbol> RELAY_TOKENS = { symbol("RELA", 4), symbol("RELB", 4), symbol("RELC", 4), symbol("RELD", 4) };
+    const std::vector<name> CONVERTERS = { "cnvrt1"_n, "cnvrt2"_n, "cnvrt3"_n, "cnvrt4"_n };
+
+    inline asset units(double amount, symbol sym) {
+        int64_t scale = 1;
+        for (int i = 0; i < sym.precision(); ++i) scale *= 10;
+        return asset(int64_t(amount * scale), sym);
+    }
+
+    /**
+     * four converters chained by their reserves: cnvrt1 TLOS/SEEDS, cnvrt2 SEEDS/HUSD, cnvrt3 HUSD/USDT,
+     * cnvrt4 USDT/TESTA, each with a 50/50 ratio, 1M of each reserve and 1M relay tokens outstanding
+     */
+    inline void setup(chain& c) {
+        for (auto account : { LP, TRADER })
+            c.create_account(account);
+
+        deploy_token(c, TOKENS);
+        deploy_token(c, RELAYS);
+        deploy_network(c, NETWORK);
+        deploy_swapsdata(c, DATA);
+        for (auto cnv : CONVERTERS)
+            deploy_converter(c, cnv);
+
+        c.push_action(NETWORK, "init"_n, NETWORK);
+
+        for (auto sym : RESERVES) {
+            c.push_action(TOKENS, "create"_n, TOKENS, TOKENS, units(1e10, sym));
+            c.push_action(TOKENS, "issue"_n, TOKENS, TOKENS, units(1e9, sym), std::string("bench"));
+            c.push_action(TOKENS, "transfer"_n, TOKENS, TOKENS, LP, units(1e8, sym), std::string("bench"));
+            c.push_action(TOKENS, "transfer"_n, TOKENS, TOKENS, TRADER, units(1e8, sym), std::string("bench"));
+        }
+
+        for (size_t i = 0; i < CONVERTERS.size(); ++i) {
+            auto cnv = CONVERTERS[i];
+            auto relay = RELAY_TOKENS[i];
+
+            c.push_action(RELAYS, "create"_n, RELAYS, cnv, units(1e10, relay));
+            c.push_action(cnv, "init"_n, cnv, RELAYS, asset(0, relay), true, true, NETWORK, false, uint64_t(30000), uint64_t(2000));
+            c.push_action(DATA, "addconverter"_n, DATA, cnv);
+            c.push_action(cnv, "setreserve"_n, cnv, TOKENS, RESERVES[i], uint64_t(500000), true);
+            c.push_action(cnv, "setreserve"_n, cnv, TOKENS, RESERVES[i + 1], uint64_t(500000), true);
+
+            c.push_action(TOKENS, "transfer"_n, LP, LP, cnv, units(1e6, RESERVES[i]), std::string("setup"));
+            c.push_action(TOKENS, "transfer"_n, LP, LP, cnv, units(1e6, RESERVES[i + 1]), std::string("setup"));
+            c.push_action(RELAYS, "issue"_n, cnv, cnv, units(1e6, relay), std::string("setup"));
+            c.push_action(RELAYS, "transfer"_n, cnv, cnv, LP, units(1e6, relay), std::string("setup"));
+            c.push_action(RELAYS, "transfer"_n, LP, LP, TRADER, units(1e4, relay), std::string("bench"));
+        }
+    }
+
+    inline std::string path(size_t from, size_t hops, bool reverse) {
+        std::string p;
+        for (size_t h = 0; h < hops; ++h) {
+            size_t i = reverse ? from - h - 1 : from + h;
+            if (!p.empty()) p += " ";
+            p += CONVERTERS[i].to_string() + " " + RESERVES[reverse ? i : i + 1].code().to_string();
+        }
+        return p;
+    }
+
+    inline void convert(chain& c, name token_contract, asset quantity, const std::string& path) {
+        c.push_action(token_contract, "transfer"_n, TRADER, TRADER, NETWORK, quantity, "1," + path + ",0.0," + TRADER.to_string());
+    }
+}
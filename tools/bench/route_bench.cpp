@@ -0,0 +1,272 @@
+/**
+ *  @file
+ *  @copyright defined in ../../LICENSE
+ *
+ *  Route finder benchmark. First checks on the native fixture that the routes found pay out exactly
+ *  what the contracts pay when the path is executed, then times queries and incremental updates on a
+ *  synthetic graph of converters.
+ *
+ *  usage: route_bench [converters] [tokens] [queries]
+ */
+
+#include "fixture.hpp"
+
+#include <router/arbitrage.hpp>
+#include <router/route_finder.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace fixture;
+
+namespace {
+
+    struct account_row {
+        asset    balance;
+        uint64_t primary_key() const { return balance.symbol.code().raw(); }
+    };
+
+    struct stats_row {
+        asset    supply;
+        asset    max_supply;
+        name     issuer;
+        uint64_t primary_key() const { return supply.symbol.code().raw(); }
+    };
+
+    int64_t balance_of(const chain& c, name contract, name owner, symbol sym) {
+        auto row = c.get_row<account_row>(contract, owner.value, "accounts"_n, sym.code().raw());
+        return row ? row->balance.amount : 0;
+    }
+
+    router::converter_snapshot snapshot(const chain& c, name cnv, const std::vector<symbol>& reserves) {
+        auto st = *c.get_row<BancorConverter::settings_t>(cnv, cnv.value, "settings"_n, "settings"_n.value);
+        auto supply = *c.get_row<stats_row>(st.smart_contract, st.smart_currency.symbol.code().raw(), "stat"_n, st.smart_currency.symbol.code().raw());
+
+        router::converter_snapshot s{ cnv, st.enabled, st.smart_contract, st.smart_currency.symbol,
+                                      supply.supply.amount + st.smart_currency.amount, st.smart_enabled, st.fee, uint32_t(st.batch_window.value_or(0)), {} };
+        for (auto sym : reserves) {
+            auto r = *c.get_row<BancorConverter::reserve_t>(cnv, cnv.value, "reserves"_n, sym.code().raw());
+            s.reserves.push_back({ r.contract, r.currency.symbol, balance_of(c, r.contract, cnv, r.currency.symbol) + r.currency.amount,
+                                   r.ratio, r.sale_enabled });
+        }
+        return s;
+    }
+
+    // executes the best route on the chain and compares the payout with the quote, then applies it
+    bool check_route(chain& c, router::route_finder& finder, name contract, asset quantity, name to_contract, symbol to) {
+        auto r = finder.best_route(contract, quantity, to_contract, to.code());
+        if (!r) {
+            printf("  %s -> %s: no route\n", quantity.to_string().c_str(), to.code().to_string().c_str());
+            return false;
+        }
+
+        auto before = balance_of(c, to_contract, TRADER, to);
+        convert(c, contract, quantity, r->path());
+        asset paid(balance_of(c, to_contract, TRADER, to) - before, to);
+        finder.apply(r->hops, contract, quantity);
+
+        bool ok = paid == r->expected;
+        printf("  %-16s -> %-18s via %-40s %s\n", quantity.to_string().c_str(), r->expected.to_string().c_str(), r->path().c_str(),
+               ok ? "ok" : ("MISMATCH, chain paid " + paid.to_string()).c_str());
+        return ok;
+    }
+
+    bool check_fixture() {
+        chain c;
+        setup(c);
+        c.max_inline_action_depth = 10;
+
+        router::route_finder finder;
+        for (size_t i = 0; i < CONVERTERS.size(); ++i)
+            finder.add_converter(snapshot(c, CONVERTERS[i], { RESERVES[i], RESERVES[i + 1] }));
+
+        printf("fixture: %zu converters, %zu tokens\n", finder.converter_count(), finder.token_count());
+        bool ok = true;
+        // the second round runs on the state the first one left behind, kept current by apply()
+        for (int round = 0; round < 2; ++round) {
+            ok &= check_route(c, finder, TOKENS, units(1000, RESERVES[0]), TOKENS, RESERVES[4]);
+            ok &= check_route(c, finder, TOKENS, units(250, RESERVES[3]), TOKENS, RESERVES[1]);
+            ok &= check_route(c, finder, TOKENS, units(500, RESERVES[2]), RELAYS, RELAY_TOKENS[1]);
+            ok &= check_route(c, finder, RELAYS, units(10, RELAY_TOKENS[0]), TOKENS, RESERVES[2]);
+        }
+
+        // a second, shallower TLOS/SEEDS converter gives a large order two disjoint paths
+        const name parallel = "cnvrt5"_n;
+        const symbol relay_token("RELE", 4);
+        deploy_converter(c, parallel);
+        c.push_action(RELAYS, "create"_n, RELAYS, parallel, units(1e10, relay_token));
+        c.push_action(parallel, "init"_n, parallel, RELAYS, asset(0, relay_token), true, true, NETWORK, false, uint64_t(30000), uint64_t(2000));
+        for (auto sym : { RESERVES[0], RESERVES[1] }) {
+            c.push_action(parallel, "setreserve"_n, parallel, TOKENS, sym, uint64_t(500000), true);
+            c.push_action(TOKENS, "transfer"_n, LP, LP, parallel, units(2.5e5, sym), std::string("setup"));
+        }
+        c.push_action(RELAYS, "issue"_n, parallel, parallel, units(2.5e5, relay_token), std::string("setup"));
+        finder.add_converter(snapshot(c, parallel, { RESERVES[0], RESERVES[1] }));
+
+        auto quantity = units(100000, RESERVES[0]);
+        auto routes = finder.disjoint_routes(TOKENS, quantity, TOKENS, RESERVES[1].code(), 8, 1);
+        auto order = finder.split_across(routes, TOKENS, quantity);
+        auto single = finder.quote(routes.front().hops, TOKENS, quantity);
+
+        auto before = balance_of(c, TOKENS, TRADER, RESERVES[1]);
+        for (const auto& t : router::transfers(order, TOKENS, TRADER, 0.01))
+            c.push_action(t.contract, "transfer"_n, TRADER, TRADER, NETWORK, t.quantity, t.memo);
+        asset paid(balance_of(c, TOKENS, TRADER, RESERVES[1]) - before, RESERVES[1]);
+
+        printf("  split %s over %zu routes -> %s (one route: %s) %s\n", quantity.to_string().c_str(), order.splits.size(),
+               order.expected.to_string().c_str(), single.to_string().c_str(),
+               paid == order.expected ? "ok" : ("MISMATCH, chain paid " + paid.to_string()).c_str());
+        ok &= paid == order.expected && order.expected > single;
+
+        // a large TLOS sale into cnvrt1 alone leaves SEEDS cheaper there than in cnvrt5
+        router::arbitrage arb(finder);
+        for (auto cnv : { CONVERTERS[0], parallel })
+            finder.add_converter(snapshot(c, cnv, { RESERVES[0], RESERVES[1] }));
+        auto push = units(50000, RESERVES[0]);
+        auto hops = finder.best_route(TOKENS, push, TOKENS, RESERVES[1].code(), 1)->hops;
+        convert(c, TOKENS, push, hops.front().converter.to_string() + " SEEDS");
+        finder.apply(hops, TOKENS, push);
+        arb.touched(hops.front().converter);
+
+        auto found = arb.opportunities();
+        if (found.empty()) {
+            printf("  arbitrage: no cycle found in %zu\n", arb.cycle_count());
+            return false;
+        }
+        const auto& o = found.front();
+        auto t = router::arbitrage::to_transfer(o, TRADER);
+        before = balance_of(c, o.contract, TRADER, o.quantity.symbol);
+        c.push_action(t.contract, "transfer"_n, TRADER, TRADER, NETWORK, t.quantity, t.memo);
+        asset gained(balance_of(c, o.contract, TRADER, o.quantity.symbol) - before, o.quantity.symbol);
+        finder.apply(o.path.hops, o.contract, o.quantity);
+        for (const auto& h : o.path.hops) arb.touched(h.converter);
+
+        printf("  arbitrage %s via %s, profit %s of %zu cycles, %zu left profitable %s\n", o.quantity.to_string().c_str(),
+               o.path.path().c_str(), o.profit.to_string().c_str(), arb.cycle_count(), arb.opportunities().size(),
+               gained == o.profit ? "ok" : ("MISMATCH, chain paid " + gained.to_string()).c_str());
+        return ok && gained == o.profit;
+    }
+
+    // the i-th of a series of codes: a, b, ..., z, ba, bb, ...
+    std::string letters(size_t i, char first) {
+        std::string code;
+        do {
+            code.insert(code.begin(), char(first + i % 26));
+            i /= 26;
+        } while (i > 0);
+        return code;
+    }
+
+    symbol synthetic_token(size_t i) { return symbol("T" + letters(i, 'A'), 4); }
+
+    /**
+     * converters with two or three reserves drawn from `tokens` shared tokens, random depths and ratios
+     */
+    router::route_finder synthetic(size_t converters, size_t tokens, std::mt19937_64& rng) {
+        router::route_finder finder;
+        std::uniform_int_distribution<size_t> pick(0, tokens - 1);
+        std::uniform_int_distribution<int64_t> depth(1e8, 1e11);
+        for (size_t i = 0; i < converters; ++i) {
+            router::converter_snapshot s{ name(("cnv" + letters(i, 'a')).c_str()), true, RELAYS, symbol("R" + letters(i, 'A'), 4),
+                                          depth(rng), true, 2000, 0, {} };
+            size_t count = 2 + i % 2;
+            uint64_t ratio = 1000000 / count;
+            for (size_t r = 0; r < count; ++r) {
+                auto sym = synthetic_token(pick(rng));
+                bool duplicate = false;
+                for (const auto& existing : s.reserves) duplicate |= existing.currency == sym;
+                if (!duplicate)
+                    s.reserves.push_back({ TOKENS, sym, depth(rng), ratio, true });
+            }
+            finder.add_converter(s);
+        }
+        return finder;
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t converters = argc > 1 ? strtoull(argv[1], nullptr, 10) : 2000;
+    size_t tokens = argc > 2 ? strtoull(argv[2], nullptr, 10) : 500;
+    size_t queries = argc > 3 ? strtoull(argv[3], nullptr, 10) : 10000;
+
+    if (!check_fixture()) {
+        printf("route quotes do not match the contracts\n");
+        return 1;
+    }
+
+    std::mt19937_64 rng(42);
+    auto finder = synthetic(converters, tokens, rng);
+    printf("\nsynthetic: %zu converters, %zu tokens\n", finder.converter_count(), finder.token_count());
+
+    std::vector<std::pair<symbol, symbol>> pairs;
+    std::uniform_int_distribution<size_t> pick(0, tokens - 1);
+    for (size_t i = 0; i < queries; ++i)
+        pairs.push_back({ synthetic_token(pick(rng)), synthetic_token(pick(rng)) });
+
+    for (size_t hops : { 1, 2, 3, 4 }) {
+        size_t found = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (const auto& [from, to] : pairs)
+            found += finder.best_route(TOKENS, asset(1000000, from), TOKENS, to.code(), hops).has_value();
+        auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        printf("  best route, up to %zu hops %10.2f us/query %6.1f%% routed\n", hops, elapsed / queries, 100.0 * found / queries);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < queries; ++i) {
+        const auto& [from, to] = pairs[i];
+        auto r = finder.best_route(TOKENS, asset(1000000, from), TOKENS, to.code(), 2);
+        if (r) finder.apply(r->hops, TOKENS, asset(1000000, from));
+    }
+    auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    printf("  route and apply, up to 2 hops %6.2f us/swap\n", elapsed / queries);
+
+    double routes_us = 0, split_us = 0;
+    size_t orders = 0, routes_total = 0;
+    for (size_t i = 0; i < queries / 100; ++i) {
+        const auto& [from, to] = pairs[i];
+        asset quantity(10000000000, from);
+        auto start = std::chrono::steady_clock::now();
+        auto routes = finder.disjoint_routes(TOKENS, quantity, TOKENS, to.code(), 24, 3);
+        auto found = std::chrono::steady_clock::now();
+        if (routes.size() < 2) continue;
+        auto order = finder.split_across(routes, TOKENS, quantity);
+        routes_us += std::chrono::duration<double, std::micro>(found - start).count();
+        split_us += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - found).count();
+        routes_total += routes.size();
+        ++orders;
+    }
+    if (orders > 0)
+        printf("  split order, %5.1f routes of up to 3 hops: %8.2f us to find the routes, %8.2f us to split\n",
+               double(routes_total) / orders, routes_us / orders, split_us / orders);
+
+    start = std::chrono::steady_clock::now();
+    router::arbitrage arb(finder);
+    elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    printf("  arbitrage: %zu cycles of up to 3 hops enumerated in %.0f us, %zu profitable\n", arb.cycle_count(), elapsed,
+           arb.candidate_count());
+
+    double touch_us = 0, size_us = 0;
+    size_t swaps = 0;
+    for (size_t i = 0; i < queries; ++i) {
+        const auto& [from, to] = pairs[i];
+        auto r = finder.best_route(TOKENS, asset(100000000, from), TOKENS, to.code(), 2);
+        if (!r) continue;
+        finder.apply(r->hops, TOKENS, asset(100000000, from));
+        auto start = std::chrono::steady_clock::now();
+        for (const auto& h : r->hops) arb.touched(h.converter);
+        auto touched = std::chrono::steady_clock::now();
+        arb.opportunities(1);
+        size_us += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - touched).count();
+        touch_us += std::chrono::duration<double, std::micro>(touched - start).count();
+        ++swaps;
+    }
+    if (swaps > 0)
+        printf("  arbitrage after each swap: %6.2f us to re-weigh, %8.2f us to size the touched ones of %zu candidates\n", touch_us / swaps,
+               size_us / swaps, arb.candidate_count());
+    return 0;
+}
@@ -0,0 +1,114 @@
+/**
+ *  @file
+ *  @copyright defined in ../../LICENSE
+ *
+ *  Whole-contract swap benchmark: deploys Token, BancorNetwork, four BancorConverters and swapsdata
+ *  on the native chain and reports, per swap, the wall time and the work metered at the intrinsic
+ *  boundary. Build with symbols and run under `perf record` / `valgrind --tool=callgrind` to profile.
+ *
+ *  usage: swap_bench [iterations] [scenario substring]
+ */
+
+#include "fixture.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+
+// every heap allocation of the process, split into the contracts' (their handlers, outside the
+// intrinsics) and the host's: the runtime's own tables, traces and queues, which nodeos keeps elsewhere
+static std::atomic<uint64_t> heap_calls{ 0 }, contract_heap_calls{ 0 };
+
+void* operator new(size_t size) {
+    ++heap_calls;
+    if (eosio::native::in_contract_code()) ++contract_heap_calls;
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t size) { return operator new(size); }
+// not inlined, where gcc sees free() on the result of a new expression it warns of a mismatched pair
+__attribute__((noinline)) void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { operator delete(p); }
+void operator delete(void* p, size_t) noexcept { operator delete(p); }
+void operator delete[](void* p, size_t) noexcept { operator delete(p); }
+
+using eosio::native::counters;
+
+using namespace fixture;
+
+namespace {
+
+    struct scenario {
+        std::string name;
+        uint32_t    inline_depth;
+        std::function<void(chain&, uint64_t)> swap;   // iteration parity alternates the direction
+    };
+
+    std::vector<scenario> scenarios() {
+        auto hop_scenario = [](size_t hops) {
+            return scenario{ std::to_string(hops) + "-hop reserve conversion", uint32_t(2 * hops),
+                [hops](chain& c, uint64_t i) {
+                    if (i % 2 == 0) convert(c, TOKENS, units(10, RESERVES[0]), path(0, hops, false));
+                    else            convert(c, TOKENS, units(10, RESERVES[hops]), path(hops, hops, true));
+                } };
+        };
+
+        return {
+            hop_scenario(1),
+            hop_scenario(2),
+            hop_scenario(4),
+            { "smart token buy", 2, [](chain& c, uint64_t) {
+                convert(c, TOKENS, units(10, RESERVES[0]), CONVERTERS[0].to_string() + " " + RELAY_TOKENS[0].code().to_string());
+            } },
+            { "smart token sell", 2, [](chain& c, uint64_t) {
+                convert(c, RELAYS, units(1, RELAY_TOKENS[0]), CONVERTERS[0].to_string() + " " + RESERVES[0].code().to_string());
+            } },
+        };
+    }
+
+    void report(const std::string& name, uint64_t n, double ns, const counters& d, uint64_t heap, uint64_t contract_heap) {
+        printf("%-28s %10.0f %7.1f %7.1f %7.1f %7.1f %7.1f %8.1f %8.1f %8.1f %9.1f %9.1f %8.1f\n", name.c_str(), ns / n,
+               double(contract_heap) / n, double(heap - contract_heap) / n,
+               double(d.actions) / n, double(d.notifications) / n, double(d.inline_actions) / n,
+               double(d.table_reads) / n, double(d.table_writes) / n, double(d.table_erases) / n,
+               double(d.bytes_packed) / n, double(d.bytes_unpacked) / n, double(d.ram_delta) / n);
+    }
+}
+
+int main(int argc, char** argv) {
+    uint64_t iterations = argc > 1 ? strtoull(argv[1], nullptr, 10) : 2000;
+    std::string filter = argc > 2 ? argv[2] : "";
+
+    printf("%-28s %10s %7s %7s %7s %7s %7s %8s %8s %8s %9s %9s %8s\n", "per swap", "ns", "heap.c", "heap.h", "actions", "notify", "inline",
+           "t.reads", "t.writes", "t.erases", "b.packed", "b.unpack", "ram");
+
+    for (const auto& s : scenarios()) {
+        if (!filter.empty() && s.name.find(filter) == std::string::npos)
+            continue;
+
+        chain c;
+        setup(c);
+        // every hop adds two inline levels (network -> converter -> network), nodeos' default of 4 stops at two hops
+        c.max_inline_action_depth = std::max(c.max_inline_action_depth, s.inline_depth);
+        c.rollback = false;
+
+        for (uint64_t i = 0; i < 10; ++i, c.advance(eosio::milliseconds(500)))
+            s.swap(c, i);
+
+        auto before = c.stats();
+        uint64_t heap_before = heap_calls, contract_heap_before = contract_heap_calls;
+        auto start = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < iterations; ++i, c.advance(eosio::milliseconds(500)))
+            s.swap(c, i);
+        auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        uint64_t heap = heap_calls - heap_before, contract_heap = contract_heap_calls - contract_heap_before;
+
+        report(s.name, iterations, elapsed, c.stats() - before, heap, contract_heap);
+    }
+    return 0;
+}
@@ -0,0 +1,87 @@
+/**
+ *  @file
+ *  @copyright defined in ../../LICENSE
+ *
+ *  Writes the action traces of random swaps on the benchmark fixture as JSON lines, in the shape
+ *  `get_actions` returns them, to feed `swaptrace convert`. One swap every 30 seconds of chain time.
+ *
+ *  usage: trace_dump <file> [swaps]
+ */
+
+#include "fixture.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <random>
+
+using namespace fixture;
+
+namespace {
+
+    std::string iso_time(uint32_t sec) {
+        char buf[32];
+        time_t t = sec;
+        strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S.000", gmtime(&t));
+        return buf;
+    }
+
+    // the ABI's JSON form of the log arguments, doubles as strings the way abieos prints them
+    std::string log_data(const std::vector<char>& data) {
+        auto [converter, records] = eosio::unpack<std::tuple<name, std::vector<swapsdata::swap_record>>>(data);
+        std::string json = "{\"converter\":\"" + converter.to_string() + "\",\"swap_data\":[";
+        for (size_t i = 0; i < records.size(); ++i) {
+            char price[64], smart_price[64];
+            snprintf(price, sizeof(price), "%.17g", records[i].price);
+            snprintf(smart_price, sizeof(smart_price), "%.17g", records[i].smart_price);
+            json += std::string(i ? "," : "") + "{\"quantity\":\"" + records[i].quantity.to_string() + "\",\"price\":\"" + price +
+                    "\",\"liquidity_depth\":\"" + records[i].liquidity_depth.to_string() + "\",\"smart_price\":\"" + smart_price + "\"}";
+        }
+        return json + "]}";
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: trace_dump <file> [swaps]\n");
+        return 1;
+    }
+    size_t swaps = argc > 2 ? strtoull(argv[2], nullptr, 10) : 1000;
+
+    FILE* out = fopen(argv[1], "w");
+    if (!out) {
+        fprintf(stderr, "cannot open %s\n", argv[1]);
+        return 1;
+    }
+
+    chain c;
+    setup(c);
+    c.max_inline_action_depth = 10;
+
+    std::mt19937_64 rng(11);
+    std::uniform_int_distribution<size_t> pick_hops(1, CONVERTERS.size());
+    std::uniform_real_distribution<double> pick_amount(1, 1000);
+    size_t lines = 0, logs = 0;
+    for (size_t i = 0; i < swaps; ++i, c.advance(eosio::seconds(30))) {
+        size_t hops = pick_hops(rng);
+        bool reverse = rng() & 1;
+        size_t from = reverse ? hops + rng() % (CONVERTERS.size() - hops + 1) : rng() % (CONVERTERS.size() - hops + 1);
+        auto quantity = units(pick_amount(rng), RESERVES[from]);
+        auto traces = c.push_action(TOKENS, "transfer"_n, TRADER, TRADER, NETWORK, quantity,
+                                    "1," + path(from, hops, reverse) + ",0.0," + TRADER.to_string());
+
+        std::string time = iso_time(c.now().sec_since_epoch());
+        for (const auto& t : traces) {
+            bool log = t.account == DATA && t.action == "log"_n;
+            fprintf(out, "{\"block_num\":%zu,\"block_time\":\"%s\",\"action_trace\":{\"receiver\":\"%s\",\"act\":{\"account\":\"%s\","
+                         "\"name\":\"%s\",\"data\":%s}}}\n",
+                    i + 1, time.c_str(), t.receiver.to_string().c_str(), t.account.to_string().c_str(), t.action.to_string().c_str(),
+                    log ? log_data(t.data).c_str() : "{}");
+            ++lines;
+            logs += log && t.receiver == DATA;
+        }
+    }
+    fclose(out);
+    printf("%zu swaps, %zu traces, %zu logs\n", swaps, lines, logs);
+    return 0;
+}
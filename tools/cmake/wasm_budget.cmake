@@ -0,0 +1,43 @@
+# Fails when a contract's .wasm, built by the CDT into CONTRACTS_DIR/<contract>/, is more than MARGIN percent
+# larger than its measured size in SIZES_FILE; with UPDATE=ON records the sizes of this build there instead.
+#
+#   cmake -DCONTRACTS_DIR=<contracts> -DCONTRACTS=BancorConverter,... -DSIZES_FILE=<wasm_sizes.cmake> -DMARGIN=10 [-DUPDATE=ON] -P wasm_budget.cmake
+
+include(${SIZES_FILE})
+string(REPLACE "," ";" CONTRACTS "${CONTRACTS}")
+
+set(over_budget "")
+set(measured "")
+foreach(contract ${CONTRACTS})
+    set(wasm ${CONTRACTS_DIR}/${contract}/${contract}.wasm)
+    if(NOT EXISTS ${wasm})
+        list(APPEND over_budget "${contract} (no ${contract}.wasm built)")
+        continue()
+    endif()
+
+    file(SIZE ${wasm} size)
+    string(APPEND measured "set(WASM_SIZE_${contract} ${size})\n")
+    if(UPDATE)
+        message(STATUS "${contract}: ${size} bytes recorded")
+    elseif(NOT DEFINED WASM_SIZE_${contract})
+        message(STATUS "${contract}: ${size} bytes, no measured size to budget against, record one with the wasm_budget_update target")
+    else()
+        math(EXPR limit "${WASM_SIZE_${contract}} * (100 + ${MARGIN}) / 100")
+        math(EXPR percent "${size} * 100 / ${limit}")
+        message(STATUS "${contract}: ${size} of ${limit} bytes (${percent}%), measured ${WASM_SIZE_${contract}}")
+        if(size GREATER limit)
+            list(APPEND over_budget "${contract} (${size} > ${limit})")
+        endif()
+    endif()
+endforeach()
+
+if(over_budget)
+    message(FATAL_ERROR "wasm over budget or missing: ${over_budget}")
+endif()
+
+if(UPDATE)
+    file(READ ${SIZES_FILE} previous)
+    string(REGEX REPLACE "\nset\\(WASM_SIZE_.*" "" header "${previous}")
+    string(REGEX REPLACE "\n+$" "" header "${header}")
+    file(WRITE ${SIZES_FILE} "${header}\n\n${measured}")
+endif()
@@ -0,0 +1,4 @@
+# Size in bytes of each contract's .wasm as last built with CDT 3 or later, measured by the
+# wasm_budget_update target, which rewrites the settings below; wasm_budget fails a build whose .wasm is
+# more than WASM_BUDGET_MARGIN percent larger. Record them again after a change that is meant to grow a
+# contract, in the same commit. A contract without an entry is reported but not budgeted.
@@ -0,0 +1,104 @@
+/**
+ *  @file
+ *  @copyright defined in ../../../../LICENSE
+ */
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace events {
+
+   struct field {
+      std::string_view key;
+      std::string_view value;
+   };
+
+   /**
+    * @brief an event as `START_EVENT`/`EVENTKV`/`END_EVENT` print it; its views point into the
+    * decoded input, its fields into the decoder's buffer, which the next line reuses
+    */
+   struct event {
+      std::string_view version;
+      std::string_view etype;
+      const field*     fields = nullptr;   // the fields after version and etype
+      size_t           size = 0;
+
+      std::string_view find(std::string_view key) const {
+         for (size_t i = 0; i < size; ++i)
+            if (fields[i].key == key) return fields[i].value;
+         return {};
+      }
+   };
+
+   /**
+    * @brief decodes the event lines of console output
+    * @details the dialect is what the macros of `contracts/Common/events.hpp` print: one flat object
+    * per line whose keys and values are all strings, printed as they are, so none holds a quote, a
+    * backslash escape or a newline, and a trailing comma before the closing brace when the last
+    * field came from EVENTKV:
+    *
+    *    {"version":"1.0","etype":"probes","action":"on_transfer","balances":"r3 w0 i0 b0 n0"}
+    *
+    * Every quote is therefore structural. The input is first scanned 64 bytes at a time, with SSE2
+    * compares where available, for the positions of its quotes and newlines; each line is then
+    * checked and cut into fields from those positions alone, into buffers reused from call to call.
+    * Lines that are not events (other console output) are skipped, lines that start like one but do
+    * not parse are counted as malformed.
+    */
+   class decoder {
+      public:
+         template<typename F>
+         size_t decode(std::string_view input, F&& on_event) {
+            index(input);
+            size_t count = 0;
+            size_t q = 0, line = 0;
+            for (uint32_t end : _newlines) {
+               event e;
+               if (line < end && input[line] == '{') {
+                  if (parse(input, line, end, q, e)) {
+                     on_event(e);
+                     ++count;
+                  } else {
+                     ++_malformed;
+                  }
+               }
+               // the quotes of this line, parsed or not
+               while (q < _quotes.size() && _quotes[q] < end) ++q;
+               line = end + 1;
+            }
+            return count;
+         }
+
+         size_t malformed() const { return _malformed; }
+
+      private:
+         // the positions of the quotes and newlines of `input`, a newline added at its end if missing
+         void index(std::string_view input);
+         bool parse(std::string_view input, size_t begin, size_t end, size_t first_quote, event& e);
+
+         std::vector<uint32_t> _quotes;
+         std::vector<uint32_t> _newlines;
+         std::vector<field>    _fields;
+         size_t                _malformed = 0;
+   };
+
+   /**
+    * @brief the counters of a stage of a `probes` event (see `contracts/Common/probes.hpp`)
+    */
+   struct probe_stage {
+      std::string_view stage;
+      uint32_t         reads = 0;
+      uint32_t         writes = 0;
+      uint32_t         inlines = 0;
+      uint32_t         bytes = 0;
+      uint32_t         iterations = 0;
+   };
+
+   /**
+    * @brief the stages of a `probes` event into `stages` (cleared first), false if the event is not
+    * one or a counter does not parse
+    */
+   bool probe_stages(const event& e, std::vector<probe_stage>& stages);
+}
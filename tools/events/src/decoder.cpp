@@ -0,0 +1,114 @@
+/**
+ *  @file
+ *  @copyright defined in ../../../LICENSE
+ */
+
+#include <events/decoder.hpp>
+
+#include <eosio/check.hpp>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace events {
+
+   namespace {
+
+      // appends the positions of the set bits of `mask`, bit 0 being `base`
+      inline void flatten(uint64_t mask, uint32_t base, std::vector<uint32_t>& positions) {
+         size_t n = positions.size();
+         positions.resize(n + __builtin_popcountll(mask));
+         for (; mask; mask &= mask - 1)
+            positions[n++] = base + __builtin_ctzll(mask);
+      }
+   }
+
+   void decoder::index(std::string_view input) {
+      eosio::check(input.size() < UINT32_MAX, "decode the input in pieces of less than 4 GB");
+      _quotes.clear();
+      _newlines.clear();
+
+      const char* data = input.data();
+      size_t n = input.size(), i = 0;
+#ifdef __SSE2__
+      const __m128i quote = _mm_set1_epi8('"');
+      const __m128i newline = _mm_set1_epi8('\n');
+      for (; i + 64 <= n; i += 64) {
+         uint64_t quotes = 0, newlines = 0;
+         for (int k = 0; k < 4; ++k) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 16 * k));
+            quotes |= uint64_t(uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, quote)))) << (16 * k);
+            newlines |= uint64_t(uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline)))) << (16 * k);
+         }
+         if (quotes) flatten(quotes, i, _quotes);
+         if (newlines) flatten(newlines, i, _newlines);
+      }
+#endif
+      for (; i < n; ++i) {
+         if (data[i] == '"') _quotes.push_back(i);
+         else if (data[i] == '\n') _newlines.push_back(i);
+      }
+      if (n == 0 || data[n - 1] != '\n') _newlines.push_back(n);
+   }
+
+   bool decoder::parse(std::string_view input, size_t begin, size_t end, size_t q, event& e) {
+      if (end > begin + 1 && input[end - 1] == '\r') --end;
+      _fields.clear();
+      size_t pos = begin + 1;
+      for (;;) {
+         // "key":"value" with the key's opening quote at pos
+         if (q + 3 >= _quotes.size() || _quotes[q] != pos || _quotes[q + 3] >= end) return false;
+         size_t k0 = _quotes[q], k1 = _quotes[q + 1], v0 = _quotes[q + 2], v1 = _quotes[q + 3];
+         if (v0 != k1 + 2 || input[k1 + 1] != ':') return false;
+         _fields.push_back({ input.substr(k0 + 1, k1 - k0 - 1), input.substr(v0 + 1, v1 - v0 - 1) });
+         q += 4;
+
+         pos = v1 + 1;
+         if (pos < end && input[pos] == ',') ++pos;
+         if (pos < end && input[pos] == '}') break;   // a trailing comma is what EVENTKV leaves
+         if (pos == v1 + 1) return false;             // neither a comma nor the end
+      }
+      if (pos + 1 != end || _fields.size() < 2 || _fields[0].key != "version" || _fields[1].key != "etype") return false;
+
+      e.version = _fields[0].value;
+      e.etype = _fields[1].value;
+      e.fields = _fields.data() + 2;
+      e.size = _fields.size() - 2;
+      return true;
+   }
+
+   namespace {
+
+      // `<letter><digits>`, then a space unless it is the last counter
+      bool counter(std::string_view text, size_t& pos, char letter, uint32_t& value, bool last) {
+         if (pos >= text.size() || text[pos] != letter) return false;
+         size_t start = ++pos;
+         uint64_t v = 0;
+         for (; pos < text.size() && text[pos] >= '0' && text[pos] <= '9'; ++pos)
+            v = v * 10 + (text[pos] - '0');
+         if (pos == start || pos - start > 10 || v > UINT32_MAX) return false;
+         value = v;
+         if (last) return pos == text.size();
+         return pos < text.size() && text[pos++] == ' ';
+      }
+   }
+
+   bool probe_stages(const event& e, std::vector<probe_stage>& stages) {
+      stages.clear();
+      if (e.etype != "probes") return false;
+      for (size_t i = 0; i < e.size; ++i) {
+         const auto& f = e.fields[i];
+         if (f.key == "action") continue;
+         probe_stage s;
+         s.stage = f.key;
+         size_t pos = 0;
+         if (!counter(f.value, pos, 'r', s.reads, false) || !counter(f.value, pos, 'w', s.writes, false) ||
+             !counter(f.value, pos, 'i', s.inlines, false) || !counter(f.value, pos, 'b', s.bytes, false) ||
+             !counter(f.value, pos, 'n', s.iterations, true))
+            return false;
+         stages.push_back(s);
+      }
+      return true;
+   }
+}
@@ -0,0 +1,91 @@
+/**
+ *  @file
+ *  @copyright defined in ../../../LICENSE
+ *
+ *  Decodes the events in console output (see contracts/Common/events.hpp) and summarises them: the
+ *  events of each type and, for `probes` events, the counters of each action's stages summed up.
+ *
+ *  usage: events <console dump|->
+ */
+
+#include <events/decoder.hpp>
+
+#include <eosio/check.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <string>
+
+namespace {
+
+   std::string read_all(const std::string& path) {
+      FILE* in = path == "-" ? stdin : fopen(path.c_str(), "rb");
+      eosio::check(in != nullptr, "cannot open " + path);
+      std::string data;
+      char buf[1 << 16];
+      for (size_t n; (n = fread(buf, 1, sizeof(buf), in)) > 0; )
+         data.append(buf, n);
+      if (in != stdin) fclose(in);
+      return data;
+   }
+
+   struct totals {
+      uint64_t calls = 0, reads = 0, writes = 0, inlines = 0, bytes = 0, iterations = 0;
+   };
+}
+
+int main(int argc, char** argv) {
+   try {
+      if (argc != 2) {
+         fprintf(stderr, "usage: events <console dump|->\n");
+         return 1;
+      }
+      std::string data = read_all(argv[1]);
+
+      auto start = std::chrono::steady_clock::now();
+      events::decoder decoder;
+      std::map<std::string, size_t, std::less<>> types;
+      std::map<std::pair<std::string, std::string>, totals> stages;   // action, stage
+      std::vector<events::probe_stage> probe;
+      size_t bad_probes = 0;
+      size_t count = decoder.decode(data, [&](const events::event& e) {
+         auto itr = types.find(e.etype);
+         if (itr == types.end()) itr = types.emplace(std::string(e.etype), 0).first;
+         ++itr->second;
+         if (e.etype != "probes") return;
+         if (!events::probe_stages(e, probe)) {
+            ++bad_probes;
+            return;
+         }
+         std::string action(e.find("action"));
+         for (const auto& s : probe) {
+            auto& t = stages[{ action, std::string(s.stage) }];
+            ++t.calls;
+            t.reads += s.reads;
+            t.writes += s.writes;
+            t.inlines += s.inlines;
+            t.bytes += s.bytes;
+            t.iterations += s.iterations;
+         }
+      });
+      auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+      printf("%zu events, %zu malformed lines, %.1f MB in %.3f ms\n", count, decoder.malformed(), data.size() / 1e6, elapsed * 1e3);
+      for (const auto& [type, n] : types)
+         printf("  %-16s %zu\n", type.c_str(), n);
+      if (bad_probes) printf("  %zu probes events with unreadable counters\n", bad_probes);
+      if (!stages.empty()) {
+         printf("%-16s %-18s %10s %10s %10s %10s %12s %10s\n", "action", "stage", "calls", "reads", "writes", "inlines", "bytes", "iterations");
+         for (const auto& [key, t] : stages)
+            printf("%-16s %-18s %10llu %10llu %10llu %10llu %12llu %10llu\n", key.first.c_str(), key.second.c_str(),
+                   (unsigned long long)t.calls, (unsigned long long)t.reads, (unsigned long long)t.writes, (unsigned long long)t.inlines,
+                   (unsigned long long)t.bytes, (unsigned long long)t.iterations);
+      }
+      return 0;
+   } catch (const std::exception& e) {
+      fprintf(stderr, "%s\n", e.what());
+      return 1;
+   }
+}
@@ -0,0 +1,121 @@
+/**
+ *  @file
+ *  @copyright defined in ../../../../LICENSE
+ */
+#pragma once
+
+#include <history/pool_model.hpp>
+
+#include <cstdio>
+#include <map>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace history {
+
+   /**
+    * @brief appends the converters' state, block by block, to a history file
+    * @details the file is a series of segments followed by an index of them. A segment opens with a
+    * checkpoint, every converter as it was before the segment's first block, and then holds for each
+    * block the converters that changed in it. A converter whose settings and set of reserves did not
+    * change, the case of a swap, is stored as the change of its smart supply and of each reserve
+    * balance, a few bytes of zigzag varints; any other change stores it in full. Converters are
+    * numbered per segment in the order of the checkpoint:
+    *
+    *    "STHIST01" segment... index{first_block, last_block, offset, bytes}... segment_count "STHIST01"
+    *
+    *    segment:    varint converters, full record...
+    *                { varint blocks since the previous one, varint records, record... }...
+    *    record:     varint (slot << 1 | full), name if the slot is new, then the full or the balance fields
+    *
+    * A segment ends after `checkpoint_blocks` blocks, so a state is at most that many blocks past a
+    * checkpoint.
+    */
+   class writer {
+      public:
+         /**
+          * @param append - continue an existing file, the blocks appended must follow its last one
+          */
+         explicit writer(const std::string& path, uint32_t checkpoint_blocks = 1000, bool append = false);
+         ~writer();
+
+         writer(const writer&) = delete;
+         writer& operator=(const writer&) = delete;
+
+         /**
+          * @brief the converters that changed in `block`, as pool_model::flush returns them; blocks
+          * must come in increasing order
+          */
+         void append(uint32_t block, const std::vector<converter_snapshot>& changed);
+
+         /**
+          * @brief writes the last segment and the index, the file is incomplete until then
+          */
+         void close();
+
+         size_t records() const { return _records; }
+
+      private:
+         struct segment {
+            uint32_t first_block;
+            uint32_t last_block;
+            uint64_t offset;
+            uint64_t bytes;
+         };
+
+         void open_segment(uint32_t block);
+         void flush_segment();
+
+         FILE*                                  _file = nullptr;
+         uint32_t                               _checkpoint_blocks;
+         uint64_t                               _offset = 0;
+         size_t                                 _records = 0;
+         std::vector<segment>                   _index;
+         std::map<uint64_t, converter_snapshot> _state;    // as of the last block appended
+         std::unordered_map<uint64_t, uint32_t> _slots;    // of the open segment
+         std::vector<char>                      _pending;  // the open segment
+         uint32_t                               _first_block = 0;
+         uint32_t                               _last_block = 0;
+
+         friend class reader;
+   };
+
+   /**
+    * @brief a history file mapped read only
+    * @details a state is found in O(log segments) and rebuilt from the checkpoint before it and at
+    * most `checkpoint_blocks` blocks of changes
+    */
+   class reader {
+      public:
+         explicit reader(const std::string& path);
+         ~reader();
+
+         reader(const reader&) = delete;
+         reader& operator=(const reader&) = delete;
+
+         /**
+          * @brief every converter as of the end of `block`, in account order
+          */
+         std::vector<converter_snapshot> at(uint32_t block) const;
+
+         std::optional<converter_snapshot> at(uint32_t block, name converter) const;
+
+         bool empty() const { return _index.empty(); }
+         uint32_t first_block() const { return _index.empty() ? 0 : _index.front().first_block; }
+         uint32_t last_block() const { return _index.empty() ? 0 : _index.back().last_block; }
+         size_t segment_count() const { return _index.size(); }
+         size_t bytes() const { return _size; }
+
+      private:
+         // the offset at which the index starts, where appending resumes
+         uint64_t index_offset() const;
+
+         const char*                  _data = nullptr;
+         size_t                       _size = 0;
+         std::vector<writer::segment> _index;
+
+         friend class writer;
+   };
+}
@@ -0,0 +1,77 @@
+/**
+ *  @file
+ *  @copyright defined in ../../../../LICENSE
+ */
+#pragma once
+
+#include <router/route_finder.hpp>
+
+#include <map>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace history {
+
+   using eosio::name;
+   using eosio::symbol;
+   using router::converter_snapshot;
+   using router::reserve_snapshot;
+
+   /**
+    * @brief a `contract_row` delta as the state history plugin reports it, one line of a delta dump:
+    *
+    *     <block_num> <present 0|1> <code> <scope> <table> <primary_key> <hex value>
+    *
+    * with the row hex encoded, empty when the row was removed
+    */
+   struct delta {
+      uint32_t          block = 0;
+      bool              present = false;
+      name              code;
+      uint64_t          scope = 0;
+      name              table;
+      uint64_t          primary_key = 0;
+      std::vector<char> value;
+   };
+
+   delta parse_delta(const std::string& line);
+
+   /**
+    * @brief the rows the converters' state depends on, as of the last delta applied
+    * @details follows the converters' `settings`/`reserves` rows and the token `accounts`/`stat` rows;
+    * a converter's snapshot is rebuilt from its own rows and the balances and supply they point to
+    * whenever any of them changes, tokens and converters may appear in any order
+    */
+   class pool_model {
+      public:
+         void apply(const delta& d);
+
+         bool dirty() const { return !_dirty.empty() || !_dirty_supplies.empty(); }
+
+         /**
+          * @brief the converters whose rows changed since the last flush; a deleted one comes back
+          * disabled, without reserves
+          */
+         std::vector<converter_snapshot> flush();
+
+         /**
+          * @brief the reserve tokens of all converters
+          */
+         std::vector<std::pair<name, symbol>> reserve_tokens() const;
+
+      private:
+         int64_t balance(name contract, name owner, symbol sym) const;
+         int64_t supply(name contract, symbol sym) const;
+
+         // the settings of a converter, `smart_supply` holding the `smart_currency.amount` offset
+         std::map<uint64_t, converter_snapshot>                         _settings;
+         // `balance` holding the `currency.amount` offset
+         std::map<uint64_t, std::map<uint64_t, reserve_snapshot>>       _reserves;
+         std::map<std::tuple<uint64_t, uint64_t, uint64_t>, int64_t>    _balances;   // contract, owner, symbol code
+         std::map<std::pair<uint64_t, uint64_t>, int64_t>               _supplies;   // contract, symbol code
+         std::set<uint64_t>                                             _dirty;
+         std::set<std::pair<uint64_t, uint64_t>>                        _dirty_supplies;
+   };
+}
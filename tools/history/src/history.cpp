@@ -0,0 +1,153 @@
+/**
+ *  @file
+ *  @copyright defined in ../../../LICENSE
+ *
+ *  Builds a history file of the converters' state from a dump of table deltas (the format of
+ *  tools/quoted) and answers from it what the converters held, and what a conversion would have
+ *  paid out, as of any block.
+ *
+ *  usage: history build <dump|-> <out.sth> [--checkpoint-blocks 1000] [--append]
+ *         history state <file.sth> <block> [converter]
+ *         history quote <file.sth> <block> <contract> <amount> <SYM> <to_contract> <TO> [max_hops]
+ *         history bench <file.sth> [lookups]
+ */
+
+#include <history/index.hpp>
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+using namespace history;
+using eosio::asset;
+using eosio::symbol_code;
+
+namespace {
+
+   /**
+    * @brief `amount` in the units of a symbol with as many decimals as it has, `1.5000` `TLOS`
+    */
+   asset parse_asset(const std::string& amount, const std::string& sym) {
+      auto dot = amount.find('.');
+      uint8_t precision = dot == std::string::npos ? 0 : amount.size() - dot - 1;
+      std::string digits = amount;
+      if (dot != std::string::npos) digits.erase(dot, 1);
+      return asset(std::stoll(digits), symbol(sym, precision));
+   }
+
+   int build(int argc, char** argv) {
+      uint32_t checkpoint_blocks = 1000;
+      bool append = false;
+      for (int i = 4; i < argc; ++i) {
+         std::string flag = argv[i];
+         if (flag == "--append") append = true;
+         else if (flag == "--checkpoint-blocks" && i + 1 < argc) checkpoint_blocks = std::stoul(argv[++i]);
+         else eosio::check(false, "unknown option " + flag);
+      }
+
+      std::ifstream file;
+      if (std::string(argv[2]) != "-") {
+         file.open(argv[2]);
+         eosio::check(file.is_open(), std::string("cannot open ") + argv[2]);
+      }
+      std::istream& input = std::string(argv[2]) == "-" ? std::cin : file;
+
+      auto start = std::chrono::steady_clock::now();
+      writer out(argv[3], checkpoint_blocks, append);
+      pool_model model;
+      uint32_t block = 0;
+      size_t deltas = 0;
+      std::string line;
+      while (std::getline(input, line)) {
+         if (line.empty() || line[0] == '#') continue;
+         auto d = parse_delta(line);
+         if (d.block != block && model.dirty()) out.append(block, model.flush());
+         block = d.block;
+         model.apply(d);
+         ++deltas;
+      }
+      if (model.dirty()) out.append(block, model.flush());
+      out.close();
+      auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+      reader check(argv[3]);
+      printf("%zu deltas, %zu converter records in %zu segments, blocks %u to %u, %zu bytes (%.1f per record), %.3f s\n", deltas,
+             out.records(), check.segment_count(), check.first_block(), check.last_block(), check.bytes(),
+             out.records() ? double(check.bytes()) / out.records() : 0.0, elapsed);
+      return 0;
+   }
+
+   void print(const converter_snapshot& c) {
+      printf("%s %s fee %llu supply %s", c.account.to_string().c_str(), c.enabled ? "enabled" : "disabled", (unsigned long long)c.fee,
+             asset(c.smart_supply, c.smart_currency).to_string().c_str());
+      for (const auto& r : c.reserves)
+         printf(" | %s %s ratio %llu%s", r.contract.to_string().c_str(), asset(r.balance, r.currency).to_string().c_str(),
+                (unsigned long long)r.ratio, r.sale_enabled ? "" : " no sale");
+      printf("\n");
+   }
+
+   int state(int argc, char** argv) {
+      reader in(argv[2]);
+      uint32_t block = std::stoul(argv[3]);
+      if (argc > 4) {
+         auto c = in.at(block, name(argv[4]));
+         eosio::check(c.has_value(), std::string("no converter ") + argv[4] + " at that block");
+         print(*c);
+      }
+      else
+         for (const auto& c : in.at(block)) print(c);
+      return 0;
+   }
+
+   int quote(int argc, char** argv) {
+      eosio::check(argc >= 9, "usage: history quote <file.sth> <block> <contract> <amount> <SYM> <to_contract> <TO> [max_hops]");
+      reader in(argv[2]);
+      uint32_t block = std::stoul(argv[3]);
+      router::route_finder finder;
+      for (const auto& c : in.at(block)) finder.add_converter(c);
+
+      auto r = finder.best_route(name(argv[4]), parse_asset(argv[5], argv[6]), name(argv[7]), symbol_code(argv[8]),
+                                 argc > 9 ? std::stoul(argv[9]) : 4);
+      if (!r) printf("none %u\n", block);
+      else printf("ok %u %s %s\n", block, r->expected.to_string().c_str(), r->path().c_str());
+      return 0;
+   }
+
+   // states at random blocks, and what the deepest lookup into a segment costs
+   int bench(int argc, char** argv) {
+      reader in(argv[2]);
+      eosio::check(!in.empty(), "empty history file");
+      size_t lookups = argc > 3 ? std::stoull(argv[3]) : 10000;
+
+      std::mt19937 rng(1);
+      std::uniform_int_distribution<uint32_t> pick(in.first_block(), in.last_block());
+      size_t converters = 0;
+      auto start = std::chrono::steady_clock::now();
+      for (size_t i = 0; i < lookups; ++i)
+         converters += in.at(pick(rng)).size();
+      auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      printf("%zu bytes in %zu segments, blocks %u to %u\n", in.bytes(), in.segment_count(), in.first_block(), in.last_block());
+      printf("%zu lookups at random blocks: %.2f us each, %.1f converters per state\n", lookups, elapsed * 1e6 / lookups,
+             double(converters) / lookups);
+      return 0;
+   }
+}
+
+int main(int argc, char** argv) {
+   try {
+      std::string command = argc > 1 ? argv[1] : "";
+      if (command == "build" && argc >= 4) return build(argc, argv);
+      if (command == "state" && argc >= 4) return state(argc, argv);
+      if (command == "quote" && argc >= 4) return quote(argc, argv);
+      if (command == "bench" && argc >= 3) return bench(argc, argv);
+      fprintf(stderr, "usage: history build <dump|-> <out.sth> [--checkpoint-blocks 1000] [--append]\n"
+                      "       history state <file.sth> <block> [converter]\n"
+                      "       history quote <file.sth> <block> <contract> <amount> <SYM> <to_contract> <TO> [max_hops]\n"
+                      "       history bench <file.sth> [lookups]\n");
+      return 1;
+   } catch (const std::exception& e) {
+      fprintf(stderr, "%s\n", e.what());
+      return 1;
+   }
+}
@@ -0,0 +1,294 @@
+/**
+ *  @file
+ *  @copyright defined in ../../../LICENSE
+ */
+
+#include <history/index.hpp>
+
+#include "../../../contracts/Common/varint.hpp"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace history {
+
+   static const char MAGIC[8] = { 'S', 'T', 'H', 'I', 'S', 'T', '0', '1' };
+   static const size_t SEGMENT_ENTRY = 24;
+   static const size_t TRAILER = sizeof(uint64_t) + sizeof(MAGIC);
+
+   namespace {
+
+      void put_fixed(std::vector<char>& out, uint64_t v) {
+         out.insert(out.end(), reinterpret_cast<const char*>(&v), reinterpret_cast<const char*>(&v) + sizeof(v));
+      }
+
+      void put_full(std::vector<char>& out, const converter_snapshot& c) {
+         put_varint(out, uint64_t(c.enabled) | uint64_t(c.smart_enabled) << 1);
+         put_fixed(out, c.smart_contract.value);
+         put_fixed(out, c.smart_currency.raw());
+         put_varint(out, zigzag(c.smart_supply));
+         put_varint(out, c.fee);
+         put_varint(out, c.batch_window);
+         put_varint(out, c.reserves.size());
+         for (const auto& r : c.reserves) {
+            put_fixed(out, r.contract.value);
+            put_fixed(out, r.currency.raw());
+            put_varint(out, zigzag(r.balance));
+            put_varint(out, r.ratio);
+            put_varint(out, r.sale_enabled);
+         }
+      }
+
+      // whether only the smart supply and the reserve balances differ, the change a swap makes
+      bool same_shape(const converter_snapshot& a, const converter_snapshot& b) {
+         if (a.enabled != b.enabled || a.smart_contract != b.smart_contract || a.smart_currency != b.smart_currency ||
+             a.smart_enabled != b.smart_enabled || a.fee != b.fee || a.batch_window != b.batch_window || a.reserves.size() != b.reserves.size())
+            return false;
+         for (size_t i = 0; i < a.reserves.size(); ++i) {
+            const auto& x = a.reserves[i];
+            const auto& y = b.reserves[i];
+            if (x.contract != y.contract || x.currency != y.currency || x.ratio != y.ratio || x.sale_enabled != y.sale_enabled)
+               return false;
+         }
+         return true;
+      }
+
+      // reads a segment in place
+      struct cursor {
+         const char* at;
+         const char* end;
+
+         bool done() const { return at == end; }
+
+         uint64_t varint() {
+            uint64_t v = 0;
+            for (int shift = 0; ; shift += 7) {
+               eosio::check(at < end && shift < 64, "corrupt history segment");
+               uint8_t b = *at++;
+               v |= uint64_t(b & 0x7f) << shift;
+               if (!(b & 0x80)) return v;
+            }
+         }
+
+         uint64_t fixed() {
+            eosio::check(end - at >= 8, "corrupt history segment");
+            uint64_t v;
+            memcpy(&v, at, sizeof(v));
+            at += sizeof(v);
+            return v;
+         }
+
+         void full(converter_snapshot& c) {
+            uint64_t flags = varint();
+            c.enabled = flags & 1;
+            c.smart_enabled = flags & 2;
+            c.smart_contract = name(fixed());
+            c.smart_currency = symbol(fixed());
+            c.smart_supply = unzigzag(varint());
+            c.fee = varint();
+            c.batch_window = varint();
+            c.reserves.resize(varint());
+            for (auto& r : c.reserves) {
+               r.contract = name(fixed());
+               r.currency = symbol(fixed());
+               r.balance = unzigzag(varint());
+               r.ratio = varint();
+               r.sale_enabled = varint();
+            }
+         }
+
+         void balances(converter_snapshot& c) {
+            c.smart_supply += unzigzag(varint());
+            for (auto& r : c.reserves)
+               r.balance += unzigzag(varint());
+         }
+      };
+   }
+
+   writer::writer(const std::string& path, uint32_t checkpoint_blocks, bool append) : _checkpoint_blocks(std::max(1u, checkpoint_blocks)) {
+      if (append && access(path.c_str(), F_OK) == 0) {
+         {
+            reader existing(path);
+            _index = existing._index;
+            _offset = existing.index_offset();
+            _last_block = existing.last_block();
+            for (auto& c : existing.at(_last_block))
+               _state[c.account.value] = std::move(c);
+         }
+         // the index goes, it is written again after the segments appended
+         eosio::check(truncate(path.c_str(), _offset) == 0, "cannot truncate " + path);
+         _file = fopen(path.c_str(), "r+b");
+         eosio::check(_file != nullptr && fseek(_file, _offset, SEEK_SET) == 0, "cannot open " + path);
+         return;
+      }
+      _file = fopen(path.c_str(), "wb");
+      eosio::check(_file != nullptr, "cannot create " + path);
+      fwrite(MAGIC, 1, sizeof(MAGIC), _file);
+      _offset = sizeof(MAGIC);
+   }
+
+   writer::~writer() {
+      if (_file) close();
+   }
+
+   void writer::open_segment(uint32_t block) {
+      _first_block = block;
+      _pending.clear();
+      _slots.clear();
+      put_varint(_pending, _state.size());
+      uint32_t slot = 0;
+      for (const auto& [account, c] : _state) {
+         _slots[account] = slot++;
+         put_fixed(_pending, account);
+         put_full(_pending, c);
+      }
+   }
+
+   void writer::flush_segment() {
+      if (_pending.empty())
+         return;
+      fwrite(_pending.data(), 1, _pending.size(), _file);
+      _index.push_back({ _first_block, _last_block, _offset, _pending.size() });
+      _offset += _pending.size();
+      _pending.clear();
+   }
+
+   void writer::append(uint32_t block, const std::vector<converter_snapshot>& changed) {
+      if (changed.empty())
+         return;
+      eosio::check(block > _last_block || (_index.empty() && _pending.empty()), "blocks must be appended in increasing order");
+      if (!_pending.empty() && block - _first_block >= _checkpoint_blocks)
+         flush_segment();
+      uint32_t previous = _last_block;
+      if (_pending.empty()) {
+         open_segment(block);
+         previous = block;
+      }
+
+      put_varint(_pending, block - previous);
+      put_varint(_pending, changed.size());
+      for (const auto& c : changed) {
+         auto slot = _slots.find(c.account.value);
+         auto state = _state.find(c.account.value);
+         bool full = slot == _slots.end() || !same_shape(state->second, c);
+         if (slot == _slots.end()) {
+            slot = _slots.emplace(c.account.value, uint32_t(_slots.size())).first;
+            put_varint(_pending, uint64_t(slot->second) << 1 | 1);
+            put_fixed(_pending, c.account.value);
+         }
+         else
+            put_varint(_pending, uint64_t(slot->second) << 1 | full);
+
+         if (full)
+            put_full(_pending, c);
+         else {
+            put_varint(_pending, zigzag(c.smart_supply - state->second.smart_supply));
+            for (size_t i = 0; i < c.reserves.size(); ++i)
+               put_varint(_pending, zigzag(c.reserves[i].balance - state->second.reserves[i].balance));
+         }
+         _state[c.account.value] = c;
+      }
+      _last_block = block;
+      _records += changed.size();
+   }
+
+   void writer::close() {
+      flush_segment();
+      for (const auto& s : _index) {
+         fwrite(&s.first_block, sizeof(s.first_block), 1, _file);
+         fwrite(&s.last_block, sizeof(s.last_block), 1, _file);
+         fwrite(&s.offset, sizeof(s.offset), 1, _file);
+         fwrite(&s.bytes, sizeof(s.bytes), 1, _file);
+      }
+      uint64_t count = _index.size();
+      fwrite(&count, sizeof(count), 1, _file);
+      fwrite(MAGIC, 1, sizeof(MAGIC), _file);
+      eosio::check(fclose(_file) == 0, "cannot write the history file");
+      _file = nullptr;
+   }
+
+   reader::reader(const std::string& path) {
+      int fd = open(path.c_str(), O_RDONLY);
+      eosio::check(fd >= 0, "cannot open " + path);
+      struct stat st;
+      fstat(fd, &st);
+      _size = st.st_size;
+      if (_size > 0) {
+         void* p = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+         eosio::check(p != MAP_FAILED, "cannot map " + path);
+         _data = static_cast<const char*>(p);
+      }
+      ::close(fd);
+
+      eosio::check(_size >= sizeof(MAGIC) + TRAILER && memcmp(_data, MAGIC, sizeof(MAGIC)) == 0 &&
+                   memcmp(_data + _size - sizeof(MAGIC), MAGIC, sizeof(MAGIC)) == 0, path + " is not a complete history file");
+      uint64_t count;
+      memcpy(&count, _data + _size - TRAILER, sizeof(count));
+      eosio::check(count * SEGMENT_ENTRY + TRAILER + sizeof(MAGIC) <= _size, path + " has a corrupt index");
+
+      const char* index = _data + _size - TRAILER - count * SEGMENT_ENTRY;
+      _index.resize(count);
+      for (uint64_t i = 0; i < count; ++i) {
+         auto& s = _index[i];
+         const char* at = index + i * SEGMENT_ENTRY;
+         memcpy(&s.first_block, at, sizeof(s.first_block));
+         memcpy(&s.last_block, at + 4, sizeof(s.last_block));
+         memcpy(&s.offset, at + 8, sizeof(s.offset));
+         memcpy(&s.bytes, at + 16, sizeof(s.bytes));
+         eosio::check(s.offset + s.bytes <= size_t(index - _data) && (i == 0 || s.first_block > _index[i - 1].last_block),
+                      path + " has a segment past its index");
+      }
+   }
+
+   reader::~reader() {
+      if (_data) munmap(const_cast<char*>(_data), _size);
+   }
+
+   uint64_t reader::index_offset() const {
+      return _size - TRAILER - _index.size() * SEGMENT_ENTRY;
+   }
+
+   std::vector<converter_snapshot> reader::at(uint32_t block) const {
+      auto seg = std::upper_bound(_index.begin(), _index.end(), block, [](uint32_t b, const writer::segment& s) { return b < s.first_block; });
+      if (seg == _index.begin())
+         return {};
+      --seg;
+
+      cursor c{ _data + seg->offset, _data + seg->offset + seg->bytes };
+      std::vector<converter_snapshot> slots(c.varint());
+      for (auto& s : slots) {
+         s.account = name(c.fixed());
+         c.full(s);
+      }
+      for (uint32_t b = seg->first_block; !c.done(); ) {
+         b += c.varint();
+         if (b > block)
+            break;
+         for (uint64_t records = c.varint(); records > 0; --records) {
+            uint64_t v = c.varint();
+            size_t slot = v >> 1;
+            eosio::check(slot <= slots.size(), "corrupt history segment");
+            if (slot == slots.size()) {
+               slots.emplace_back();
+               slots.back().account = name(c.fixed());
+            }
+            if (v & 1) c.full(slots[slot]);
+            else c.balances(slots[slot]);
+         }
+      }
+      std::sort(slots.begin(), slots.end(), [](const auto& a, const auto& b) { return a.account < b.account; });
+      return slots;
+   }
+
+   std::optional<converter_snapshot> reader::at(uint32_t block, name converter) const {
+      for (auto& c : at(block))
+         if (c.account == converter)
+            return std::move(c);
+      return std::nullopt;
+   }
+}
@@ -0,0 +1,127 @@
+/**
+ *  @file
+ *  @copyright defined in ../../../LICENSE
+ */
+
+#include "../../../contracts/BancorConverter/BancorConverter.hpp"
+
+#include <history/pool_model.hpp>
+
+namespace history {
+
+   namespace {
+
+      struct account_row {
+         asset balance;
+      };
+
+      struct stats_row {
+         asset supply;
+         asset max_supply;
+         name  issuer;
+      };
+
+      std::vector<char> unhex(const char* hex, size_t size) {
+         auto digit = [](char c) { return c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10; };
+         eosio::check(size % 2 == 0, "odd length hex value");
+         std::vector<char> bytes(size / 2);
+         for (size_t i = 0; i < bytes.size(); ++i)
+            bytes[i] = char(digit(hex[2 * i]) << 4 | digit(hex[2 * i + 1]));
+         return bytes;
+      }
+   }
+
+   delta parse_delta(const std::string& line) {
+      // whitespace separated words; the contract headers put eosio's datastream operators in scope,
+      // which take over `>>` on standard streams
+      std::vector<std::pair<size_t, size_t>> w;
+      for (size_t pos = 0; (pos = line.find_first_not_of(" \t\r", pos)) != std::string::npos; ) {
+         size_t end = std::min(line.find_first_of(" \t\r", pos), line.size());
+         w.push_back({ pos, end - pos });
+         pos = end;
+      }
+      eosio::check(w.size() == 6 || w.size() == 7, "malformed delta: " + line);
+      auto word = [&](size_t i) { return line.substr(w[i].first, w[i].second); };
+
+      delta d;
+      d.block = std::stoul(word(0));
+      d.present = word(1) != "0";
+      d.code = name(word(2));
+      d.scope = std::stoull(word(3));
+      d.table = name(word(4));
+      d.primary_key = std::stoull(word(5));
+      if (w.size() == 7) d.value = unhex(line.data() + w[6].first, w[6].second);
+      return d;
+   }
+
+   void pool_model::apply(const delta& d) {
+      if (d.table == "settings"_n && d.scope == d.code.value) {
+         if (d.present) {
+            auto s = eosio::unpack<BancorConverter::settings_t>(d.value);
+            _settings[d.code.value] = { d.code, s.enabled, s.smart_contract, s.smart_currency.symbol, s.smart_currency.amount,
+                                        s.smart_enabled, s.fee, uint32_t(s.batch_window.value_or(0)), {} };
+         }
+         else _settings.erase(d.code.value);
+         _dirty.insert(d.code.value);
+      } else if (d.table == "reserves"_n && d.scope == d.code.value) {
+         if (d.present) {
+            auto r = eosio::unpack<BancorConverter::reserve_t>(d.value);
+            _reserves[d.code.value][d.primary_key] = { r.contract, r.currency.symbol, r.currency.amount, r.ratio, r.sale_enabled };
+         }
+         else _reserves[d.code.value].erase(d.primary_key);
+         _dirty.insert(d.code.value);
+      } else if (d.table == "accounts"_n) {
+         _balances[{ d.code.value, d.scope, d.primary_key }] = d.present ? eosio::unpack<account_row>(d.value).balance.amount : 0;
+         if (_settings.count(d.scope)) _dirty.insert(d.scope);
+      } else if (d.table == "stat"_n) {
+         _supplies[{ d.code.value, d.primary_key }] = d.present ? eosio::unpack<stats_row>(d.value).supply.amount : 0;
+         _dirty_supplies.insert({ d.code.value, d.primary_key });
+      }
+   }
+
+   std::vector<converter_snapshot> pool_model::flush() {
+      for (const auto& [account, s] : _settings)
+         if (_dirty_supplies.count({ s.smart_contract.value, s.smart_currency.code().raw() }))
+            _dirty.insert(account);
+
+      std::vector<converter_snapshot> changed;
+      for (auto account : _dirty) {
+         auto st = _settings.find(account);
+         if (st == _settings.end()) {
+            // deleted, kept but disabled
+            changed.push_back({ name(account), false, {}, {}, 0, false, 0, 0, {} });
+            continue;
+         }
+         converter_snapshot snap = st->second;
+         snap.smart_supply += supply(snap.smart_contract, snap.smart_currency);
+         for (auto r : _reserves[account]) {
+            r.second.balance += balance(r.second.contract, name(account), r.second.currency);
+            snap.reserves.push_back(r.second);
+         }
+         changed.push_back(std::move(snap));
+      }
+      _dirty.clear();
+      _dirty_supplies.clear();
+      return changed;
+   }
+
+   std::vector<std::pair<name, symbol>> pool_model::reserve_tokens() const {
+      std::set<std::pair<uint64_t, uint64_t>> seen;
+      std::vector<std::pair<name, symbol>> tokens;
+      for (const auto& [account, reserves] : _reserves)
+         for (const auto& [code, r] : reserves)
+            if (seen.insert({ r.contract.value, code }).second)
+               tokens.push_back({ r.contract, r.currency });
+      return tokens;
+   }
+
+   int64_t pool_model::balance(name contract, name owner, symbol sym) const {
+      auto itr = _balances.find({ contract.value, owner.value, sym.code().raw() });
+      return itr == _balances.end() ? 0 : itr->second;
+   }
+
+   int64_t pool_model::supply(name contract, symbol sym) const {
+      auto itr = _supplies.find({ contract.value, sym.code().raw() });
+      return itr == _supplies.end() ? 0 : itr->second;
+   }
+}
@@ -0,0 +1,131 @@
+/**
+ *  @file
+ *  @copyright defined in ../../LICENSE
+ *
+ *  Minimal blocking HTTP/1.1 client for talking to a local nodeos/keosd: keep-alive, plain TCP,
+ *  `Content-Length` bodies only (what the eosio http_plugin sends).
+ */
+#pragma once
+
+#include <netdb.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace loadgen {
+
+   struct http_response {
+      int         status = 0;
+      std::string body;
+   };
+
+   class http_connection {
+      public:
+         /**
+          * @param url - `http://host:port`, the path part is ignored
+          */
+         explicit http_connection(const std::string& url) {
+            auto rest = url.substr(url.find("://") == std::string::npos ? 0 : url.find("://") + 3);
+            auto colon = rest.find(':');
+            auto slash = rest.find('/');
+            _host = rest.substr(0, std::min(colon, slash));
+            _port = colon == std::string::npos ? "80" : rest.substr(colon + 1, slash == std::string::npos ? std::string::npos : slash - colon - 1);
+         }
+
+         ~http_connection() { disconnect(); }
+
+         http_connection(const http_connection&) = delete;
+         http_connection& operator=(const http_connection&) = delete;
+
+         http_response post(const std::string& path, const std::string& body) {
+            for (int attempt = 0; ; ++attempt) {
+               try {
+                  if (_fd < 0) connect();
+                  send_all("POST " + path + " HTTP/1.1\r\nHost: " + _host + "\r\nContent-Type: application/json\r\n"
+                           "Content-Length: " + std::to_string(body.size()) + "\r\nConnection: keep-alive\r\n\r\n" + body);
+                  return receive();
+               } catch (const std::runtime_error&) {
+                  // the server may close an idle keep-alive connection, retry once on a fresh one
+                  disconnect();
+                  if (attempt > 0) throw;
+               }
+            }
+         }
+
+      private:
+         void connect() {
+            addrinfo hints{}, *res = nullptr;
+            hints.ai_family = AF_UNSPEC;
+            hints.ai_socktype = SOCK_STREAM;
+            if (getaddrinfo(_host.c_str(), _port.c_str(), &hints, &res) != 0 || !res)
+               throw std::runtime_error("cannot resolve " + _host);
+
+            _fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+            int ok = _fd >= 0 ? ::connect(_fd, res->ai_addr, res->ai_addrlen) : -1;
+            freeaddrinfo(res);
+            if (ok != 0) {
+               disconnect();
+               throw std::runtime_error("cannot connect to " + _host + ":" + _port);
+            }
+            int one = 1;
+            setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+         }
+
+         void disconnect() {
+            if (_fd >= 0) close(_fd);
+            _fd = -1;
+            _buffer.clear();
+         }
+
+         void send_all(const std::string& data) {
+            for (size_t sent = 0; sent < data.size(); ) {
+               auto n = ::send(_fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+               if (n <= 0) throw std::runtime_error("send failed");
+               sent += n;
+            }
+         }
+
+         void fill() {
+            char chunk[16384];
+            auto n = ::recv(_fd, chunk, sizeof(chunk), 0);
+            if (n <= 0) throw std::runtime_error("connection closed");
+            _buffer.append(chunk, n);
+         }
+
+         http_response receive() {
+            size_t header_end;
+            while ((header_end = _buffer.find("\r\n\r\n")) == std::string::npos)
+               fill();
+
+            http_response r;
+            auto headers = _buffer.substr(0, header_end);
+            r.status = std::atoi(headers.c_str() + headers.find(' ') + 1);
+
+            size_t length = 0;
+            for (size_t pos = 0; pos < headers.size(); ) {
+               auto eol = headers.find("\r\n", pos);
+               auto line = headers.substr(pos, eol == std::string::npos ? std::string::npos : eol - pos);
+               if (strncasecmp(line.c_str(), "content-length:", 15) == 0)
+                  length = std::strtoull(line.c_str() + 15, nullptr, 10);
+               if (eol == std::string::npos) break;
+               pos = eol + 2;
+            }
+
+            while (_buffer.size() < header_end + 4 + length)
+               fill();
+            r.body = _buffer.substr(header_end + 4, length);
+            _buffer.erase(0, header_end + 4 + length);
+            return r;
+         }
+
+         std::string _host;
+         std::string _port;
+         int         _fd = -1;
+         std::string _buffer;
+   };
+}
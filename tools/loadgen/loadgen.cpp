@@ -0,0 +1,311 @@
+/**
+ *  @file
+ *  @copyright defined in ../../LICENSE
+ *
+ *  Sustained swap load generator for a local node running the nodebench fixture
+ *  (`nodebench/node_bench.py --setup-only`). Builds conversion transfers with a weighted mix of
+ *  paths, memos via `build_memo`, has keosd sign them up front, then pushes them open loop at the
+ *  requested rate and reports the achieved TPS, failure reasons, billed CPU and latency percentiles.
+ *
+ *  usage: loadgen [--rate 200] [--duration 30] [--threads 16] [--mix 1:60,2:25,4:10,buy:3,sell:2]
+ *                 [--url http://127.0.0.1:8888] [--wallet-url http://127.0.0.1:8900] [--key EOS...]
+ */
+
+#include "../../contracts/Common/common.hpp"
+#include "http.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <map>
+#include <random>
+#include <thread>
+
+using eosio::asset;
+using eosio::name;
+using eosio::symbol;
+using loadgen::http_connection;
+
+namespace {
+
+   const name TOKENS   = "tokens"_n;
+   const name RELAYS   = "relays"_n;
+   const name NETWORK  = "network"_n;
+   const name TRADER   = "alice"_n;
+
+   const std::vector<symbol> RESERVES = { symbol("TLOS", 4), symbol("SEEDS", 4), symbol("HUSD", 2), symbol("USDT", 4), symbol("TESTA", 4) };
+   const std::vector<name> CONVERTERS = { "cnvrt1"_n, "cnvrt2"_n, "cnvrt3"_n, "cnvrt4"_n };
+   const symbol RELA = symbol("RELA", 4);
+
+   asset units(double amount, symbol sym) {
+      return asset(int64_t(amount * pow(10, sym.precision())), sym);
+   }
+
+   std::vector<std::string> tokens(std::string_view text, char delim) {
+      std::vector<std::string> result;
+      for (size_t start = 0;;) {
+         size_t end = text.find(delim, start);
+         result.emplace_back(text.substr(start, end - start));
+         if (end == std::string_view::npos) return result;
+         start = end + 1;
+      }
+   }
+
+   struct options {
+      std::string url        = "http://127.0.0.1:8888";
+      std::string wallet_url = "http://127.0.0.1:8900";
+      std::string key        = "EOS6MRyAjQq8ud7hVNYcfnVPJqcVpscN5So8BhtHuGYqET5GDW5CV";
+      double      rate       = 200;
+      double      duration   = 30;
+      uint32_t    threads    = 16;
+      std::string mix        = "1:60,2:25,4:10,buy:3,sell:2";
+   };
+
+   struct order {
+      std::string kind;
+      name        token_contract;
+      asset       quantity;
+      std::string path;
+   };
+
+   struct result {
+      bool        ok = false;
+      double      latency_ms = 0;
+      int64_t     cpu_us = 0;
+      std::string error;
+   };
+
+   // -------------------------------------------------------------------------------------------
+   // just enough JSON for the get_info, sign_transaction and push_transaction replies
+
+   std::string json_string(const std::string& body, const std::string& key, size_t from = 0) {
+      auto pos = body.find("\"" + key + "\":", from);
+      if (pos == std::string::npos) return "";
+      pos = body.find('"', pos + key.size() + 3);
+      if (pos == std::string::npos) return "";
+      std::string out;
+      for (++pos; pos < body.size() && body[pos] != '"'; ++pos) {
+         if (body[pos] == '\\' && pos + 1 < body.size()) ++pos;
+         out += body[pos];
+      }
+      return out;
+   }
+
+   int64_t json_number(const std::string& body, const std::string& key) {
+      auto pos = body.find("\"" + key + "\":");
+      return pos == std::string::npos ? 0 : std::strtoll(body.c_str() + pos + key.size() + 3, nullptr, 10);
+   }
+
+   std::string hex(const std::vector<char>& bytes) {
+      static const char* digits = "0123456789abcdef";
+      std::string out;
+      out.reserve(bytes.size() * 2);
+      for (unsigned char b : bytes) {
+         out += digits[b >> 4];
+         out += digits[b & 15];
+      }
+      return out;
+   }
+
+   std::string iso_time(uint32_t sec) {
+      char buf[32];
+      time_t t = sec;
+      strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", gmtime(&t));
+      return buf;
+   }
+
+   uint32_t parse_time(const std::string& iso) {
+      tm t{};
+      strptime(iso.c_str(), "%Y-%m-%dT%H:%M:%S", &t);
+      return timegm(&t);
+   }
+
+   // -------------------------------------------------------------------------------------------
+
+   /**
+    * @brief the conversions of the mix, the same fixture and paths as bench/swap_bench.cpp
+    */
+   std::vector<order> orders_for(const std::string& kind) {
+      auto hops = [](size_t n) {
+         std::string forward, back;
+         for (size_t h = 0; h < n; ++h) {
+            forward += (h ? " " : "") + CONVERTERS[h].to_string() + " " + RESERVES[h + 1].code().to_string();
+            back += (h ? " " : "") + CONVERTERS[n - h - 1].to_string() + " " + RESERVES[n - h - 1].code().to_string();
+         }
+         return std::vector<order>{ { std::to_string(n) + "-hop", TOKENS, units(10, RESERVES[0]), forward },
+                                    { std::to_string(n) + "-hop", TOKENS, units(10, RESERVES[n]), back } };
+      };
+
+      if (kind == "buy")  return { { kind, TOKENS, units(10, RESERVES[0]), "cnvrt1 RELA" } };
+      if (kind == "sell") return { { kind, RELAYS, units(0.1, RELA), "cnvrt1 TLOS" } };
+      size_t n = std::strtoul(kind.c_str(), nullptr, 10);
+      eosio::check(n >= 1 && n <= CONVERTERS.size(), "unknown mix entry " + kind);
+      return hops(n);
+   }
+
+   std::vector<char> pack_transaction(uint32_t expiration, uint16_t ref_block_num, uint32_t ref_block_prefix, const eosio::action& act) {
+      auto packed_action = std::make_tuple(act.account, act.name, act.authorization, act.data);
+      return eosio::pack(std::make_tuple(
+         expiration, ref_block_num, ref_block_prefix,
+         eosio::unsigned_int(0), uint8_t(0), eosio::unsigned_int(0),                  // max net, max cpu, delay
+         std::vector<decltype(packed_action)>{},                                        // context free actions
+         std::vector<decltype(packed_action)>{ packed_action },
+         std::vector<std::pair<uint16_t, std::vector<char>>>{}));                       // extensions
+   }
+
+   std::string transaction_json(uint32_t expiration, uint16_t ref_block_num, uint32_t ref_block_prefix, const eosio::action& act) {
+      return "{\"expiration\":\"" + iso_time(expiration) + "\",\"ref_block_num\":" + std::to_string(ref_block_num) +
+             ",\"ref_block_prefix\":" + std::to_string(ref_block_prefix) +
+             ",\"max_net_usage_words\":0,\"max_cpu_usage_ms\":0,\"delay_sec\":0,\"context_free_actions\":[],\"actions\":[{"
+             "\"account\":\"" + act.account.to_string() + "\",\"name\":\"" + act.name.to_string() + "\",\"authorization\":[{"
+             "\"actor\":\"" + act.authorization[0].actor.to_string() + "\",\"permission\":\"" + act.authorization[0].permission.to_string() +
+             "\"}],\"data\":\"" + hex(act.data) + "\"}],\"transaction_extensions\":[],\"signatures\":[],\"context_free_data\":[]}";
+   }
+
+   options parse_options(int argc, char** argv) {
+      options o;
+      for (int i = 1; i + 1 < argc; i += 2) {
+         std::string flag = argv[i], value = argv[i + 1];
+         if      (flag == "--url")        o.url = value;
+         else if (flag == "--wallet-url") o.wallet_url = value;
+         else if (flag == "--key")        o.key = value;
+         else if (flag == "--rate")       o.rate = std::atof(value.c_str());
+         else if (flag == "--duration")   o.duration = std::atof(value.c_str());
+         else if (flag == "--threads")    o.threads = std::atoi(value.c_str());
+         else if (flag == "--mix")        o.mix = value;
+         else eosio::check(false, "unknown option " + flag);
+      }
+      return o;
+   }
+
+   double percentile(std::vector<double>& sorted, double p) {
+      if (sorted.empty()) return 0;
+      return sorted[std::min(sorted.size() - 1, size_t(p * sorted.size()))];
+   }
+}
+
+int main(int argc, char** argv) {
+   try {
+      auto opts = parse_options(argc, argv);
+
+      // weighted mix, expanded to a cycle of orders
+      std::vector<order> cycle;
+      for (const auto& entry : tokens(opts.mix, ',')) {
+         auto kv = tokens(entry, ':');
+         auto orders = orders_for(kv[0]);
+         int weight = kv.size() > 1 ? std::atoi(kv[1].c_str()) : 1;
+         for (int w = 0; w < weight; ++w)
+            cycle.push_back(orders[w % orders.size()]);
+      }
+      std::mt19937 shuffle_rng(42);
+      std::shuffle(cycle.begin(), cycle.end(), shuffle_rng);
+
+      http_connection node(opts.url);
+      auto info = node.post("/v1/chain/get_info", "{}").body;
+      auto chain_id = json_string(info, "chain_id");
+      auto head_id = json_string(info, "head_block_id");
+      eosio::check(!chain_id.empty() && head_id.size() == 64, "unexpected get_info reply: " + info);
+
+      uint16_t ref_block_num = std::strtoul(head_id.substr(0, 8).c_str(), nullptr, 16) & 0xffff;
+      uint32_t ref_block_prefix = 0;
+      for (int b = 0; b < 4; ++b)
+         ref_block_prefix |= uint32_t(std::strtoul(head_id.substr(16 + 2 * b, 2).c_str(), nullptr, 16)) << (8 * b);
+
+      size_t total = size_t(opts.rate * opts.duration);
+      uint32_t expiration = parse_time(json_string(info, "head_block_time")) + std::min(3500.0, opts.duration + total / 100.0 + 120);
+
+      // sign everything before the run so that keosd does not limit the rate
+      std::vector<std::string> signed_trx(total);
+      std::atomic<size_t> next{ 0 };
+      auto sign = [&]() {
+         http_connection wallet(opts.wallet_url);
+         for (size_t i; (i = next++) < total; ) {
+            const auto& o = cycle[i % cycle.size()];
+
+            std::string dest_account = TRADER.to_string();
+            std::string receiver_memo = "load " + std::to_string(i);   // also keeps the transaction ids unique
+
+            memo_structure memo;
+            memo.version = "1";
+            split(o.path, ' ', memo.conversion_path);
+            memo.min_return = "0.0";
+            memo.dest_account = dest_account;
+            memo.receiver_memo = receiver_memo;
+
+            eosio::action act(eosio::permission_level(TRADER, "active"_n), o.token_contract, "transfer"_n, std::make_tuple(TRADER, NETWORK, o.quantity, build_memo(memo)));
+            auto reply = wallet.post("/v1/wallet/sign_transaction",
+                                     "[" + transaction_json(expiration, ref_block_num, ref_block_prefix, act) + ",[\"" + opts.key + "\"],\"" + chain_id + "\"]");
+            auto signature = json_string(reply.body, "signatures");
+            eosio::check(reply.status == 201 || reply.status == 200, "sign_transaction failed: " + reply.body);
+
+            signed_trx[i] = "{\"signatures\":[\"" + signature + "\"],\"compression\":\"none\",\"packed_context_free_data\":\"\",\"packed_trx\":\"" +
+                            hex(pack_transaction(expiration, ref_block_num, ref_block_prefix, act)) + "\"}";
+         }
+      };
+      {
+         std::vector<std::thread> signers;
+         for (uint32_t t = 0; t < opts.threads; ++t) signers.emplace_back(sign);
+         for (auto& t : signers) t.join();
+      }
+      printf("signed %zu transactions\n", total);
+
+      // open loop: transaction i is due at start + i / rate, late workers send immediately
+      std::vector<result> results(total);
+      next = 0;
+      auto start = std::chrono::steady_clock::now();
+      auto push = [&]() {
+         http_connection conn(opts.url);
+         for (size_t i; (i = next++) < total; ) {
+            std::this_thread::sleep_until(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(i / opts.rate)));
+
+            auto sent = std::chrono::steady_clock::now();
+            auto& r = results[i];
+            try {
+               auto reply = conn.post("/v1/chain/push_transaction", signed_trx[i]);
+               r.ok = reply.status == 202 || reply.status == 200;
+               if (r.ok)
+                  r.cpu_us = json_number(reply.body, "cpu_usage_us");
+               else {
+                  auto error = reply.body.find("\"error\"");
+                  r.error = json_string(reply.body, "message", error == std::string::npos ? 0 : error);
+                  if (r.error.empty()) r.error = json_string(reply.body, "what");
+                  r.error = r.error.substr(0, 100);
+               }
+            } catch (const std::exception& e) {
+               r.error = e.what();
+            }
+            r.latency_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - sent).count();
+         }
+      };
+      {
+         std::vector<std::thread> pushers;
+         for (uint32_t t = 0; t < opts.threads; ++t) pushers.emplace_back(push);
+         for (auto& t : pushers) t.join();
+      }
+      double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+      std::vector<double> latencies;
+      std::map<std::string, size_t> failures;
+      size_t ok = 0;
+      int64_t cpu = 0;
+      for (const auto& r : results) {
+         latencies.push_back(r.latency_ms);
+         if (r.ok) { ++ok; cpu += r.cpu_us; }
+         else failures[r.error]++;
+      }
+      std::sort(latencies.begin(), latencies.end());
+
+      printf("target %.0f tps, sent %zu in %.1f s\n", opts.rate, total, elapsed);
+      printf("achieved %.1f tps (%zu ok, %zu failed), billed cpu %.0f us/trx\n", ok / elapsed, ok, total - ok, ok ? double(cpu) / ok : 0.0);
+      printf("latency ms p50 %.2f p90 %.2f p99 %.2f max %.2f\n", percentile(latencies, 0.5), percentile(latencies, 0.9),
+             percentile(latencies, 0.99), latencies.empty() ? 0.0 : latencies.back());
+      for (const auto& f : failures)
+         printf("%8zu  %s\n", f.second, f.first.c_str());
+      return failures.empty() ? 0 : 1;
+   } catch (const std::exception& e) {
+      fprintf(stderr, "%s\n", e.what());
+      return 2;
+   }
+}
@@ -0,0 +1,143 @@
+/**
+ *  @file
+ *  @copyright defined in ../../../../LICENSE
+ */
+#pragma once
+
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "check.hpp"
+#include "name.hpp"
+#include "serialize.hpp"
+
+namespace eosio {
+
+   struct permission_level {
+      permission_level(name a, name p) : actor(a), permission(p) {}
+      permission_level() {}
+
+      friend bool operator==(const permission_level& a, const permission_level& b) {
+         return a.actor == b.actor && a.permission == b.permission;
+      }
+
+      name actor;
+      name permission;
+   };
+
+   template<typename DataStream>
+   DataStream& operator<<(DataStream& ds, const permission_level& p) { return ds << p.actor << p.permission; }
+   template<typename DataStream>
+   DataStream& operator>>(DataStream& ds, permission_level& p) { return ds >> p.actor >> p.permission; }
+
+   struct action;
+
+   namespace native {
+      // the native counterparts of the action/context intrinsics, implemented by the chain
+      name current_receiver();
+      bool has_auth(name n);
+      void require_auth(name n);
+      void require_auth(const permission_level& level);
+      void require_recipient(name n);
+      bool is_account(name n);
+      void send_inline(const action& act);
+      void set_action_return_value(std::vector<char> value);
+   }
+
+   inline bool has_auth(name n) { return native::has_auth(n); }
+   inline void require_auth(name n) { native::require_auth(n); }
+   inline void require_auth(const permission_level& level) { native::require_auth(level); }
+   inline bool is_account(name n) { return native::is_account(n); }
+   inline name current_receiver() { return native::current_receiver(); }
+
+   inline void require_recipient(name n) { native::require_recipient(n); }
+
+   template<typename... Names>
+   void require_recipient(name n, Names... rest) {
+      native::require_recipient(n);
+      require_recipient(rest...);
+   }
+
+   /**
+    * @brief an action to be dispatched inline, packs its arguments exactly as the WASM version does
+    */
+   struct action {
+      eosio::name account;
+      eosio::name name;
+      std::vector<permission_level> authorization;
+      std::vector<char> data;
+
+      action() = default;
+
+      template<typename T>
+      action(const permission_level& auth, struct name a, struct name n, T&& value)
+         : account(a), name(n), authorization(1, auth), data(pack(std::forward<T>(value))) {}
+
+      template<typename T>
+      action(std::vector<permission_level> auths, struct name a, struct name n, T&& value)
+         : account(a), name(n), authorization(std::move(auths)), data(pack(std::forward<T>(value))) {}
+
+      void send() const { native::send_inline(*this); }
+
+      template<typename T>
+      T data_as() const { return unpack<T>(data); }
+   };
+
+   namespace detail {
+      template<typename T>
+      struct member_args;
+
+      template<typename R, typename C, typename... Args>
+      struct member_args<R (C::*)(Args...)> {
+         using contract_type = C;
+         using return_type = R;
+         using arg_tuple = std::tuple<std::decay_t<Args>...>;
+      };
+
+      template<typename R, typename C, typename... Args>
+      struct member_args<R (C::*)(Args...) const> : member_args<R (C::*)(Args...)> {};
+   }
+
+   /**
+    * @brief typed wrapper used to send an action of a known contract, mirrors the CDT `action_wrapper`
+    */
+   template<name::raw Name, auto Action>
+   struct action_wrapper {
+      using args = typename detail::member_args<decltype(Action)>::arg_tuple;
+
+      template<typename Code>
+      action_wrapper(Code&& code, std::vector<permission_level>&& perms) : code_name(std::forward<Code>(code)), permissions(std::move(perms)) {}
+
+      template<typename Code>
+      action_wrapper(Code&& code, const permission_level& perm) : code_name(std::forward<Code>(code)), permissions(1, perm) {}
+
+      template<typename... Args>
+      action to_action(Args&&... a) const {
+         return action(permissions, code_name, name(Name), args{std::forward<Args>(a)...});
+      }
+
+      template<typename... Args>
+      void send(Args&&... a) const { to_action(std::forward<Args>(a)...).send(); }
+
+      name code_name;
+      std::vector<permission_level> permissions;
+   };
+
+   template<typename Method>
+   struct inline_dispatcher {
+      using args = typename detail::member_args<Method>::arg_tuple;
+
+      static void call(name code, name act, const permission_level& perm, args a) {
+         action(perm, code, act, std::move(a)).send();
+      }
+
+      static void call(name code, name act, std::vector<permission_level> perms, args a) {
+         action(std::move(perms), code, act, std::move(a)).send();
+      }
+   };
+}
+
+#define SEND_INLINE_ACTION(CONTRACT, NAME, ...) \
+   ::eosio::inline_dispatcher<decltype(&std::decay_t<decltype(CONTRACT)>::NAME)>::call((CONTRACT).get_self(), ::eosio::name(#NAME), __VA_ARGS__);
@@ -0,0 +1,112 @@
+/**
+ *  @file
+ *  @copyright defined in ../../../../LICENSE
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "check.hpp"
+#include "print.hpp"
+#include "serialize.hpp"
+#include "symbol.hpp"
+
+namespace eosio {
+
+   /**
+    * @brief amount plus symbol, with the same overflow and symbol checks as the on-chain type
+    */
+   struct asset {
+      static constexpr int64_t max_amount = (1LL << 62) - 1;
+
+      int64_t amount = 0;
+      eosio::symbol symbol;
+
+      asset() {}
+      asset(int64_t a, class symbol s) : amount(a), symbol{s} {
+         check(is_amount_within_range(), "magnitude of asset amount must be less than 2^62");
+         check(symbol.is_valid(), "invalid symbol name");
+      }
+
+      bool is_amount_within_range() const { return -max_amount <= amount && amount <= max_amount; }
+      bool is_valid() const { return is_amount_within_range() && symbol.is_valid(); }
+
+      asset operator-() const {
+         asset r = *this;
+         r.amount = -r.amount;
+         return r;
+      }
+
+      asset& operator-=(const asset& a) {
+         check(a.symbol == symbol, "attempt to subtract asset with different symbol");
+         amount -= a.amount;
+         check(-max_amount <= amount, "subtraction underflow");
+         check(amount <= max_amount, "subtraction overflow");
+         return *this;
+      }
+
+      asset& operator+=(const asset& a) {
+         check(a.symbol == symbol, "attempt to add asset with different symbol");
+         amount += a.amount;
+         check(-max_amount <= amount, "addition underflow");
+         check(amount <= max_amount, "addition overflow");
+         return *this;
+      }
+
+      friend asset operator+(const asset& a, const asset& b) {
+         asset result = a;
+         result += b;
+         return result;
+      }
+
+      friend asset operator-(const asset& a, const asset& b) {
+         asset result = a;
+         result -= b;
+         return result;
+      }
+
+      friend bool operator==(const asset& a, const asset& b) {
+         check(a.symbol == b.symbol, "comparison of assets with different symbols is not allowed");
+         return a.amount == b.amount;
+      }
+
+      friend bool operator!=(const asset& a, const asset& b) { return !(a == b); }
+
+      friend bool operator<(const asset& a, const asset& b) {
+         check(a.symbol == b.symbol, "comparison of assets with different symbols is not allowed");
+         return a.amount < b.amount;
+      }
+
+      friend bool operator<=(const asset& a, const asset& b) { return !(b < a); }
+      friend bool operator>(const asset& a, const asset& b) { return b < a; }
+      friend bool operator>=(const asset& a, const asset& b) { return !(a < b); }
+
+      std::string to_string() const {
+         bool negative = amount < 0;
+         uint64_t abs_amount = negative ? -(uint64_t)amount : (uint64_t)amount;
+         std::string digits = std::to_string(abs_amount);
+         uint8_t precision = symbol.precision();
+
+         std::string result;
+         if (precision > 0) {
+            if (digits.size() <= precision)
+               digits.insert(0, precision + 1 - digits.size(), '0');
+            result = digits.substr(0, digits.size() - precision) + "." + digits.substr(digits.size() - precision);
+         } else
+            result = digits;
+
+         return (negative ? "-" : "") + result + " " + symbol.code().to_string();
+      }
+
+      void print() const { eosio::print(to_string()); }
+   };
+
+   template<typename DataStream>
+   DataStream& operator<<(DataStream& ds, const asset& a) { return ds << a.amount << a.symbol; }
+
+   template<typename DataStream>
+   DataStream& operator>>(DataStream& ds, asset& a) { return ds >> a.amount >> a.symbol; }
+
+   inline void print(const asset& a) { a.print(); }
+}
@@ -0,0 +1,63 @@
+/**
+ *  @file
+ *  @copyright defined in ../../../../LICENSE
+ */
+#pragma once
+
+#include <optional>
+#include <utility>
+
+#include "check.hpp"
+
+namespace eosio {
+
+   /**
+    * @brief a trailing field or action argument that older data may lack, with the wire format of the
+    * CDT's: nothing is written when it holds no value, and it is read only if bytes are left
+    */
+   template<typename T>
+   class binary_extension {
+      public:
+         binary_extension() = default;
+         binary_extension(const T& v) : _value(v) {}
+         binary_extension(T&& v) : _value(std::move(v)) {}
+
+         bool has_value() const { return _value.has_value(); }
+
+         const T& value() const {
+            check(_value.has_value(), "cannot get value of empty binary_extension");
+            return *_value;
+         }
+
+         T value_or(const T& fallback = T()) const { return _value.value_or(fallback); }
+
+         const T& operator*() const { return value(); }
+
+         template<typename... Args>
+         binary_extension& emplace(Args&&... args) {
+            _value.emplace(std::forward<Args>(args)...);
+            return *this;
+         }
+
+         void reset() { _value.reset(); }
+
+      private:
+         std::optional<T> _value;
+   };
+
+   template<typename DataStream, typename T>
+   DataStream& operator<<(DataStream& ds, const binary_extension<T>& v) {
+      if (v.has_value()) ds << v.value();
+      return ds;
+   }
+
+   template<typename DataStream, typename T>
+   DataStream& operator>>(DataStream& ds, binary_extension<T>& v) {
+      if (ds.remaining() > 0) {
+         T t;
+         ds >> t;
+         v.emplace(std::move(t));
+      }
+      return ds;
+   }
+}
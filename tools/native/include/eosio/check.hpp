@@ -0,0 +1,35 @@
+/**
+ *  @file
+ *  @copyright defined in ../../../../LICENSE
+ */
+#pragma once
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace eosio {
+
+   /**
+    * @brief thrown by `check` when an assertion fails, the native counterpart of `eosio_assert`
+    */
+   struct assert_exception : std::runtime_error {
+      using std::runtime_error::runtime_error;
+   };
+
+   inline void check(bool pred, const char* msg) {
+      if (!pred) throw assert_exception(msg);
+   }
+
+   inline void check(bool pred, const std::string& msg) {
+      if (!pred) throw assert_exception(msg);
+   }
+
+   inline void check(bool pred, std::string_view msg) {
+      if (!pred) throw assert_exception(std::string(msg));
+   }
+
+   inline void check(bool pred, uint64_t code) {
+      if (!pred) throw assert_exception("assertion failure with error code: " + std::to_string(code));
+   }
+}
@@ -0,0 +1,21 @@
+/**
+ *  @file
+ *  @copyright defined in ../../../../LICENSE
+ */
+#pragma once
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "action.hpp"
+#include "binary_extension.hpp"
+#include "check.hpp"
+#include "contract.hpp"
+#include "multi_index.hpp"
+#include "name.hpp"
+#include "print.hpp"
+#include "serialize.hpp"
+#include "symbol.hpp"
+#include "time.hpp"
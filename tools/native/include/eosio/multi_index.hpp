@@ -0,0 +1,413 @@
+/**
+ *  @file
+ *  @copyright defined in ../../../../LICENSE
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "action.hpp"
+#include "check.hpp"
+#include "name.hpp"
+#include "serialize.hpp"
+
+namespace eosio {
+
+   namespace native {
+      // primary table intrinsics, reads may target any contract, writes always target the current receiver
+      bool db_get(name code, uint64_t scope, name table, uint64_t pk, std::vector<char>& out);
+      bool db_lower_bound(name code, uint64_t scope, name table, uint64_t pk, uint64_t& found);
+      bool db_next(name code, uint64_t scope, name table, uint64_t pk, uint64_t& next);
+      bool db_previous(name code, uint64_t scope, name table, uint64_t pk, uint64_t& prev);
+      bool db_last(name code, uint64_t scope, name table, uint64_t& pk);
+      void db_store(uint64_t scope, name table, name payer, uint64_t pk, std::vector<char> data);
+      void db_update(uint64_t scope, name table, name payer, uint64_t pk, std::vector<char> data);
+      void db_remove(uint64_t scope, name table, uint64_t pk);
+
+      // uint64_t secondary index intrinsics, entries are ordered by (secondary, primary)
+      void idx64_store(uint64_t scope, name table, uint8_t index, uint64_t pk, uint64_t secondary);
+      void idx64_update(uint64_t scope, name table, uint8_t index, uint64_t pk, uint64_t secondary);
+      void idx64_remove(uint64_t scope, name table, uint8_t index, uint64_t pk);
+      bool idx64_lower_bound(name code, uint64_t scope, name table, uint8_t index, uint64_t& secondary, uint64_t& pk);
+      bool idx64_next(name code, uint64_t scope, name table, uint8_t index, uint64_t& secondary, uint64_t& pk);
+      bool idx64_previous(name code, uint64_t scope, name table, uint8_t index, uint64_t& secondary, uint64_t& pk);
+      bool idx64_last(name code, uint64_t scope, name table, uint8_t index, uint64_t& secondary, uint64_t& pk);
+   }
+
+   constexpr static inline name same_payer{};
+
+   template<class Class, typename Type, Type (Class::*PtrToMemberFunction)() const>
+   struct const_mem_fun {
+      typedef typename std::remove_reference<Type>::type result_type;
+      Type operator()(const Class& x) const { return (x.*PtrToMemberFunction)(); }
+   };
+
+   template<name::raw IndexName, typename Extractor>
+   struct indexed_by {
+      enum constants { index_name = static_cast<uint64_t>(IndexName) };
+      typedef Extractor secondary_extractor_type;
+   };
+
+   /**
+    * @brief in-memory `multi_index` backed by the native chain database
+    * @details keeps the on-chain semantics the contracts rely on: rows are serialized with the same
+    * wire format, loaded objects are cached per table instance (so references stay valid while the
+    * instance lives) and every intrinsic call is metered by the chain
+    */
+   template<name::raw TableName, typename T, typename... Indices>
+   class multi_index {
+      private:
+         static_assert(sizeof...(Indices) <= 16, "multi_index only supports a maximum of 16 secondary indices");
+
+         template<size_t I>
+         using index_at = std::tuple_element_t<I, std::tuple<Indices...>>;
+
+         template<size_t I>
+         static uint64_t secondary_key(const T& obj) {
+            using extractor = typename index_at<I>::secondary_extractor_type;
+            static_assert(std::is_same_v<std::decay_t<decltype(extractor{}(obj))>, uint64_t>, "only uint64_t secondary keys are supported natively");
+            return extractor{}(obj);
+         }
+
+         template<size_t... I>
+         static std::array<uint64_t, sizeof...(Indices)> secondary_keys(const T& obj, std::index_sequence<I...>) {
+            return { secondary_key<I>(obj)... };
+         }
+
+         static std::array<uint64_t, sizeof...(Indices)> secondary_keys(const T& obj) {
+            return secondary_keys(obj, std::index_sequence_for<Indices...>{});
+         }
+
+         name _code;
+         uint64_t _scope;
+         mutable std::map<uint64_t, std::unique_ptr<T>> _items;
+
+         const T* load(uint64_t pk) const {
+            auto cached = _items.find(pk);
+            if (cached != _items.end())
+               return cached->second.get();
+
+            std::vector<char> bytes;
+            if (!native::db_get(_code, _scope, name(TableName), pk, bytes))
+               return nullptr;
+
+            auto obj = std::make_unique<T>(unpack<T>(bytes));
+            auto ptr = obj.get();
+            _items.emplace(pk, std::move(obj));
+            return ptr;
+         }
+
+      public:
+         typedef T value_type;
+
+         class const_iterator {
+            public:
+               using iterator_category = std::bidirectional_iterator_tag;
+               using value_type = const T;
+               using difference_type = std::ptrdiff_t;
+               using pointer = const T*;
+               using reference = const T&;
+
+               const_iterator() {}
+
+               const T& operator*() const {
+                  check(_item != nullptr, "cannot dereference end iterator");
+                  return *_item;
+               }
+
+               const T* operator->() const { return &operator*(); }
+
+               const_iterator operator++(int) {
+                  const_iterator result(*this);
+                  ++(*this);
+                  return result;
+               }
+
+               const_iterator operator--(int) {
+                  const_iterator result(*this);
+                  --(*this);
+                  return result;
+               }
+
+               const_iterator& operator++() {
+                  check(_item != nullptr, "cannot increment end iterator");
+                  uint64_t next = 0;
+                  if (native::db_next(_idx->_code, _idx->_scope, name(TableName), _item->primary_key(), next))
+                     _item = _idx->load(next);
+                  else
+                     _item = nullptr;
+                  return *this;
+               }
+
+               const_iterator& operator--() {
+                  uint64_t prev = 0;
+                  bool found = _item == nullptr
+                     ? native::db_last(_idx->_code, _idx->_scope, name(TableName), prev)
+                     : native::db_previous(_idx->_code, _idx->_scope, name(TableName), _item->primary_key(), prev);
+                  check(found, "cannot decrement iterator at beginning of table");
+                  _item = _idx->load(prev);
+                  return *this;
+               }
+
+               friend bool operator==(const const_iterator& a, const const_iterator& b) { return a._item == b._item; }
+               friend bool operator!=(const const_iterator& a, const const_iterator& b) { return a._item != b._item; }
+
+            private:
+               friend class multi_index;
+               const_iterator(const multi_index* idx, const T* item = nullptr) : _idx(idx), _item(item) {}
+
+               const multi_index* _idx = nullptr;
+               const T* _item = nullptr;
+         };
+
+         /**
+          * @brief ordered view over one `indexed_by` secondary index
+          */
+         template<size_t I>
+         class index {
+            public:
+               class const_iterator {
+                  public:
+                     using iterator_category = std::bidirectional_iterator_tag;
+                     using value_type = const T;
+                     using difference_type = std::ptrdiff_t;
+                     using pointer = const T*;
+                     using reference = const T&;
+
+                     const_iterator() {}
+
+                     const T& operator*() const {
+                        check(_item != nullptr, "cannot dereference end iterator");
+                        return *_item;
+                     }
+
+                     const T* operator->() const { return &operator*(); }
+
+                     const_iterator& operator++() {
+                        check(_item != nullptr, "cannot increment end iterator");
+                        if (native::idx64_next(_mi->_code, _mi->_scope, name(TableName), I, _secondary, _pk))
+                           _item = _mi->load(_pk);
+                        else
+                           _item = nullptr;
+                        return *this;
+                     }
+
+                     const_iterator& operator--() {
+                        bool found = _item == nullptr
+                           ? native::idx64_last(_mi->_code, _mi->_scope, name(TableName), I, _secondary, _pk)
+                           : native::idx64_previous(_mi->_code, _mi->_scope, name(TableName), I, _secondary, _pk);
+                        check(found, "cannot decrement iterator at beginning of index");
+                        _item = _mi->load(_pk);
+                        return *this;
+                     }
+
+                     const_iterator operator++(int) {
+                        const_iterator result(*this);
+                        ++(*this);
+                        return result;
+                     }
+
+                     friend bool operator==(const const_iterator& a, const const_iterator& b) { return a._item == b._item; }
+                     friend bool operator!=(const const_iterator& a, const const_iterator& b) { return a._item != b._item; }
+
+                  private:
+                     friend class index;
+                     const_iterator(const multi_index* mi, const T* item, uint64_t secondary, uint64_t pk)
+                        : _mi(mi), _item(item), _secondary(secondary), _pk(pk) {}
+
+                     const multi_index* _mi = nullptr;
+                     const T* _item = nullptr;
+                     uint64_t _secondary = 0;
+                     uint64_t _pk = 0;
+               };
+
+               const_iterator lower_bound(uint64_t secondary) const {
+                  uint64_t pk = 0;
+                  if (!native::idx64_lower_bound(_mi->_code, _mi->_scope, name(TableName), I, secondary, pk))
+                     return end();
+                  return const_iterator(_mi, _mi->load(pk), secondary, pk);
+               }
+
+               const_iterator upper_bound(uint64_t secondary) const {
+                  if (secondary == std::numeric_limits<uint64_t>::max())
+                     return end();
+                  return lower_bound(secondary + 1);
+               }
+
+               const_iterator find(uint64_t secondary) const {
+                  auto itr = lower_bound(secondary);
+                  if (itr == end() || itr._secondary != secondary)
+                     return end();
+                  return itr;
+               }
+
+               const T& get(uint64_t secondary, const char* error_msg = "unable to find secondary key") const {
+                  auto result = find(secondary);
+                  check(result != end(), error_msg);
+                  return *result;
+               }
+
+               const_iterator begin() const { return lower_bound(0); }
+               const_iterator end() const { return const_iterator(_mi, nullptr, 0, 0); }
+               const_iterator cbegin() const { return begin(); }
+               const_iterator cend() const { return end(); }
+
+               const_iterator iterator_to(const T& obj) const {
+                  return const_iterator(_mi, &obj, secondary_key<I>(obj), obj.primary_key());
+               }
+
+               template<typename Lambda>
+               void modify(const_iterator itr, name payer, Lambda&& updater) {
+                  const_cast<multi_index*>(_mi)->modify(*itr, payer, std::forward<Lambda>(updater));
+               }
+
+               const_iterator erase(const_iterator itr) {
+                  auto next = itr;
+                  ++next;
+                  const_cast<multi_index*>(_mi)->erase(*itr);
+                  return next;
+               }
+
+            private:
+               friend class multi_index;
+               explicit index(const multi_index* mi) : _mi(mi) {}
+               const multi_index* _mi;
+         };
+
+         multi_index(name code, uint64_t scope) : _code(code), _scope(scope) {}
+
+         multi_index(const multi_index&) = delete;
+         multi_index& operator=(const multi_index&) = delete;
+
+         name get_code() const { return _code; }
+         uint64_t get_scope() const { return _scope; }
+
+         const_iterator cbegin() const { return begin(); }
+         const_iterator cend() const { return end(); }
+
+         const_iterator begin() const { return lower_bound(0); }
+         const_iterator end() const { return const_iterator(this); }
+
+         const_iterator lower_bound(uint64_t primary) const {
+            uint64_t pk = 0;
+            if (!native::db_lower_bound(_code, _scope, name(TableName), primary, pk))
+               return end();
+            return const_iterator(this, load(pk));
+         }
+
+         const_iterator upper_bound(uint64_t primary) const {
+            if (primary == std::numeric_limits<uint64_t>::max())
+               return end();
+            return lower_bound(primary + 1);
+         }
+
+         uint64_t available_primary_key() const {
+            uint64_t pk = 0;
+            if (!native::db_last(_code, _scope, name(TableName), pk))
+               return 0;
+            check(pk < std::numeric_limits<uint64_t>::max() - 1, "next primary key in table is at autoincrement limit");
+            return pk + 1;
+         }
+
+         template<name::raw IndexName>
+         auto get_index() const {
+            constexpr size_t pos = []() {
+               constexpr uint64_t names[] = { uint64_t(Indices::index_name)..., 0 };
+               for (size_t i = 0; i < sizeof...(Indices); ++i)
+                  if (names[i] == static_cast<uint64_t>(IndexName)) return i;
+               return sizeof...(Indices);
+            }();
+            static_assert(pos < sizeof...(Indices), "name provided is not the name of any secondary index within multi_index");
+            return index<pos>(this);
+         }
+
+         const_iterator iterator_to(const T& obj) const { return const_iterator(this, &obj); }
+
+         const_iterator find(uint64_t primary) const {
+            auto item = load(primary);
+            return const_iterator(this, item);
+         }
+
+         const_iterator require_find(uint64_t primary, const char* error_msg = "unable to find key") const {
+            auto item = load(primary);
+            check(item != nullptr, error_msg);
+            return const_iterator(this, item);
+         }
+
+         const T& get(uint64_t primary, const char* error_msg = "unable to find key") const {
+            auto item = load(primary);
+            check(item != nullptr, error_msg);
+            return *item;
+         }
+
+         template<typename Lambda>
+         const_iterator emplace(name payer, Lambda&& constructor) {
+            check(_code == current_receiver(), "cannot create objects in table of another contract");
+
+            auto obj = std::make_unique<T>();
+            constructor(*obj);
+
+            auto pk = obj->primary_key();
+            native::db_store(_scope, name(TableName), payer, pk, pack(*obj));
+
+            auto keys = secondary_keys(*obj);
+            for (size_t i = 0; i < keys.size(); ++i)
+               native::idx64_store(_scope, name(TableName), uint8_t(i), pk, keys[i]);
+
+            auto ptr = obj.get();
+            _items[pk] = std::move(obj);
+            return const_iterator(this, ptr);
+         }
+
+         template<typename Lambda>
+         void modify(const_iterator itr, name payer, Lambda&& updater) {
+            check(itr != end(), "cannot pass end iterator to modify");
+            modify(*itr, payer, std::forward<Lambda>(updater));
+         }
+
+         template<typename Lambda>
+         void modify(const T& obj, name payer, Lambda&& updater) {
+            check(_code == current_receiver(), "cannot modify objects in table of another contract");
+
+            auto& mutableobj = const_cast<T&>(obj);
+            auto pk = obj.primary_key();
+            auto old_keys = secondary_keys(obj);
+
+            updater(mutableobj);
+
+            check(pk == mutableobj.primary_key(), "updater cannot change primary key when modifying an object");
+            native::db_update(_scope, name(TableName), payer, pk, pack(mutableobj));
+
+            auto keys = secondary_keys(mutableobj);
+            for (size_t i = 0; i < keys.size(); ++i)
+               if (keys[i] != old_keys[i])
+                  native::idx64_update(_scope, name(TableName), uint8_t(i), pk, keys[i]);
+         }
+
+         const_iterator erase(const_iterator itr) {
+            check(itr != end(), "cannot pass end iterator to erase");
+            auto next = itr;
+            ++next;
+            erase(*itr);
+            return next;
+         }
+
+         void erase(const T& obj) {
+            check(_code == current_receiver(), "cannot erase objects in table of another contract");
+
+            auto pk = obj.primary_key();
+            for (size_t i = 0; i < sizeof...(Indices); ++i)
+               native::idx64_remove(_scope, name(TableName), uint8_t(i), pk);
+            native::db_remove(_scope, name(TableName), pk);
+            _items.erase(pk);
+         }
+   };
+}
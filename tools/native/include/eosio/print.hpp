@@ -0,0 +1,52 @@
+/**
+ *  @file
+ *  @copyright defined in ../../../../LICENSE
+ */
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "name.hpp"
+#include "symbol.hpp"
+
+namespace eosio {
+
+   namespace native {
+      /**
+       * @brief appends to the console of the action currently executing, see `chain::console()`
+       */
+      void prints(std::string_view s);
+   }
+
+   inline void print(const char* s) { native::prints(s); }
+   inline void print(const std::string& s) { native::prints(s); }
+   inline void print(std::string_view s) { native::prints(s); }
+   inline void print(char c) { native::prints(std::string_view(&c, 1)); }
+   inline void print(bool b) { native::prints(b ? "true" : "false"); }
+
+   template<typename T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, char> && !std::is_same_v<T, bool>, int> = 0>
+   inline void print(T v) { native::prints(std::to_string(v)); }
+
+   inline void print(double d) {
+      char buf[32];
+      snprintf(buf, sizeof(buf), "%.17g", d);
+      native::prints(buf);
+   }
+
+   inline void print(float f) { print(double(f)); }
+   inline void print(name n) { native::prints(n.to_string()); }
+   inline void print(symbol_code sc) { native::prints(sc.to_string()); }
+   inline void print(symbol s) { native::prints(s.to_string()); }
+
+   template<typename T>
+   inline auto print(const T& t) -> decltype(t.print(), void()) { t.print(); }
+
+   template<typename Arg, typename Arg2, typename... Args>
+   inline void print(Arg&& a, Arg2&& a2, Args&&... rest) {
+      print(std::forward<Arg>(a));
+      print(std::forward<Arg2>(a2), std::forward<Args>(rest)...);
+   }
+}
@@ -0,0 +1,349 @@
+/**
+ *  @file
+ *  @copyright defined in ../../../../LICENSE
+ */
+#pragma once
+
+#include <array>
+#include <cstring>
+#include <map>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "check.hpp"
+#include "name.hpp"
+#include "symbol.hpp"
+
+namespace eosio {
+
+   /**
+    * @brief byte stream with the same wire format as the on-chain `datastream`
+    * @details `datastream<const char*>` reads, `datastream<char*>` writes into a caller owned buffer
+    * and `datastream<size_t>` only measures
+    */
+   template<typename T>
+   class datastream;
+
+   template<>
+   class datastream<const char*> {
+      public:
+         datastream(const char* start, size_t size) : _start(start), _pos(start), _end(start + size) {}
+
+         void read(char* d, size_t s) {
+            check(size_t(_end - _pos) >= s, "datastream attempted to read past the end");
+            memcpy(d, _pos, s);
+            _pos += s;
+         }
+
+         void skip(size_t s) { _pos += s; }
+         size_t tellp() const { return size_t(_pos - _start); }
+         size_t remaining() const { return size_t(_end - _pos); }
+         const char* pos() const { return _pos; }
+
+      private:
+         const char* _start;
+         const char* _pos;
+         const char* _end;
+   };
+
+   template<>
+   class datastream<char*> {
+      public:
+         datastream(char* start, size_t size) : _start(start), _pos(start), _end(start + size) {}
+
+         void write(const char* d, size_t s) {
+            check(size_t(_end - _pos) >= s, "datastream attempted to write past the end");
+            memcpy(_pos, d, s);
+            _pos += s;
+         }
+
+         size_t tellp() const { return size_t(_pos - _start); }
+         size_t remaining() const { return size_t(_end - _pos); }
+
+      private:
+         char* _start;
+         char* _pos;
+         char* _end;
+   };
+
+   template<>
+   class datastream<size_t> {
+      public:
+         void write(const char*, size_t s) { _size += s; }
+         size_t tellp() const { return _size; }
+
+      private:
+         size_t _size = 0;
+   };
+
+   /**
+    * @brief variable length unsigned integer, LEB128 like the on-chain `unsigned_int`
+    */
+   struct unsigned_int {
+      unsigned_int(uint32_t v = 0) : value(v) {}
+      operator uint32_t() const { return value; }
+      uint32_t value;
+   };
+
+   template<typename DataStream>
+   DataStream& operator<<(DataStream& ds, const unsigned_int& v) {
+      uint64_t val = v.value;
+      do {
+         uint8_t b = uint8_t(val) & 0x7f;
+         val >>= 7;
+         b |= ((val > 0) << 7);
+         ds.write((const char*)&b, 1);
+      } while (val);
+      return ds;
+   }
+
+   template<typename DataStream>
+   DataStream& operator>>(DataStream& ds, unsigned_int& vi) {
+      uint64_t v = 0;
+      char b = 0;
+      uint8_t by = 0;
+      do {
+         ds.read(&b, 1);
+         v |= uint32_t(uint8_t(b) & 0x7f) << by;
+         by += 7;
+      } while (uint8_t(b) & 0x80 && by < 32);
+      vi.value = static_cast<uint32_t>(v);
+      return ds;
+   }
+
+   template<typename DataStream, typename T, std::enable_if_t<std::is_arithmetic_v<T>, int> = 0>
+   DataStream& operator<<(DataStream& ds, const T& v) {
+      if constexpr (std::is_same_v<T, bool>) {
+         char c = v ? 1 : 0;
+         ds.write(&c, 1);
+      } else
+         ds.write((const char*)&v, sizeof(T));
+      return ds;
+   }
+
+   template<typename DataStream, typename T, std::enable_if_t<std::is_arithmetic_v<T>, int> = 0>
+   DataStream& operator>>(DataStream& ds, T& v) {
+      if constexpr (std::is_same_v<T, bool>) {
+         char c = 0;
+         ds.read(&c, 1);
+         v = c != 0;
+      } else
+         ds.read((char*)&v, sizeof(T));
+      return ds;
+   }
+
+   template<typename DataStream>
+   DataStream& operator<<(DataStream& ds, const name& v) { return ds << v.value; }
+   template<typename DataStream>
+   DataStream& operator>>(DataStream& ds, name& v) { return ds >> v.value; }
+
+   template<typename DataStream>
+   DataStream& operator<<(DataStream& ds, const symbol_code& v) { return ds << v.value; }
+   template<typename DataStream>
+   DataStream& operator>>(DataStream& ds, symbol_code& v) { return ds >> v.value; }
+
+   template<typename DataStream>
+   DataStream& operator<<(DataStream& ds, const symbol& v) { return ds << v.value; }
+   template<typename DataStream>
+   DataStream& operator>>(DataStream& ds, symbol& v) { return ds >> v.value; }
+
+   template<typename DataStream>
+   DataStream& operator<<(DataStream& ds, const std::string& v) {
+      ds << unsigned_int(v.size());
+      if (v.size()) ds.write(v.data(), v.size());
+      return ds;
+   }
+
+   template<typename DataStream>
+   DataStream& operator>>(DataStream& ds, std::string& v) {
+      unsigned_int s;
+      ds >> s;
+      v.resize(s.value);
+      if (s.value) ds.read(v.data(), s.value);
+      return ds;
+   }
+
+   template<typename DataStream, typename T>
+   DataStream& operator<<(DataStream& ds, const std::vector<T>& v) {
+      ds << unsigned_int(v.size());
+      if constexpr (std::is_same_v<T, char> || std::is_same_v<T, uint8_t>) {
+         if (v.size()) ds.write((const char*)v.data(), v.size());
+      } else
+         for (const auto& i : v) ds << i;
+      return ds;
+   }
+
+   template<typename DataStream, typename T>
+   DataStream& operator>>(DataStream& ds, std::vector<T>& v) {
+      unsigned_int s;
+      ds >> s;
+      v.resize(s.value);
+      if constexpr (std::is_same_v<T, char> || std::is_same_v<T, uint8_t>) {
+         if (s.value) ds.read((char*)v.data(), s.value);
+      } else
+         for (auto& i : v) ds >> i;
+      return ds;
+   }
+
+   template<typename DataStream, typename T, std::size_t N>
+   DataStream& operator<<(DataStream& ds, const std::array<T, N>& v) {
+      for (const auto& i : v) ds << i;
+      return ds;
+   }
+
+   template<typename DataStream, typename T, std::size_t N>
+   DataStream& operator>>(DataStream& ds, std::array<T, N>& v) {
+      for (auto& i : v) ds >> i;
+      return ds;
+   }
+
+   template<typename DataStream, typename K, typename V>
+   DataStream& operator<<(DataStream& ds, const std::pair<K, V>& v) { return ds << v.first << v.second; }
+
+   template<typename DataStream, typename K, typename V>
+   DataStream& operator>>(DataStream& ds, std::pair<K, V>& v) { return ds >> v.first >> v.second; }
+
+   template<typename DataStream, typename K, typename V>
+   DataStream& operator<<(DataStream& ds, const std::map<K, V>& m) {
+      ds << unsigned_int(m.size());
+      for (const auto& i : m) ds << i.first << i.second;
+      return ds;
+   }
+
+   template<typename DataStream, typename K, typename V>
+   DataStream& operator>>(DataStream& ds, std::map<K, V>& m) {
+      m.clear();
+      unsigned_int s;
+      ds >> s;
+      for (uint32_t i = 0; i < s.value; ++i) {
+         K k;
+         V v;
+         ds >> k >> v;
+         m.emplace(std::move(k), std::move(v));
+      }
+      return ds;
+   }
+
+   template<typename DataStream, typename T>
+   DataStream& operator<<(DataStream& ds, const std::optional<T>& v) {
+      ds << bool(v);
+      if (v) ds << *v;
+      return ds;
+   }
+
+   template<typename DataStream, typename T>
+   DataStream& operator>>(DataStream& ds, std::optional<T>& v) {
+      bool has = false;
+      ds >> has;
+      if (has) {
+         T t;
+         ds >> t;
+         v = std::move(t);
+      } else
+         v.reset();
+      return ds;
+   }
+
+   template<typename DataStream, typename... Args>
+   DataStream& operator<<(DataStream& ds, const std::tuple<Args...>& t) {
+      std::apply([&](const auto&... a) { ((ds << a), ...); }, t);
+      return ds;
+   }
+
+   template<typename DataStream, typename... Args>
+   DataStream& operator>>(DataStream& ds, std::tuple<Args...>& t) {
+      std::apply([&](auto&... a) { ((ds >> a), ...); }, t);
+      return ds;
+   }
+
+   namespace reflect {
+      // stands in for the clang-only field reflection the CDT uses for tables and action structs
+      struct any_field {
+         template<typename T>
+         operator T() const;
+      };
+
+      template<typename T, typename... A>
+      constexpr auto is_brace_constructible(int) -> decltype(T{std::declval<A>()...}, std::true_type{});
+      template<typename T, typename... A>
+      constexpr std::false_type is_brace_constructible(...);
+
+      template<typename T, typename... A>
+      constexpr size_t field_count() {
+         if constexpr (sizeof...(A) > 16)
+            return sizeof...(A);
+         else if constexpr (decltype(is_brace_constructible<T, A..., any_field>(0))::value)
+            return field_count<T, A..., any_field>();
+         else
+            return sizeof...(A);
+      }
+
+      template<typename T, typename F>
+      void for_each_field(T& t, F&& f) {
+         constexpr size_t n = field_count<std::remove_const_t<T>>();
+         static_assert(n <= 16, "reflection supports up to 16 fields");
+         if constexpr (n == 0) {
+         } else if constexpr (n == 1) { auto& [a] = t; f(a); }
+         else if constexpr (n == 2) { auto& [a, b] = t; f(a); f(b); }
+         else if constexpr (n == 3) { auto& [a, b, c] = t; f(a); f(b); f(c); }
+         else if constexpr (n == 4) { auto& [a, b, c, d] = t; f(a); f(b); f(c); f(d); }
+         else if constexpr (n == 5) { auto& [a, b, c, d, e] = t; f(a); f(b); f(c); f(d); f(e); }
+         else if constexpr (n == 6) { auto& [a, b, c, d, e, g] = t; f(a); f(b); f(c); f(d); f(e); f(g); }
+         else if constexpr (n == 7) { auto& [a, b, c, d, e, g, h] = t; f(a); f(b); f(c); f(d); f(e); f(g); f(h); }
+         else if constexpr (n == 8) { auto& [a, b, c, d, e, g, h, i] = t; f(a); f(b); f(c); f(d); f(e); f(g); f(h); f(i); }
+         else if constexpr (n == 9) { auto& [a, b, c, d, e, g, h, i, j] = t; f(a); f(b); f(c); f(d); f(e); f(g); f(h); f(i); f(j); }
+         else if constexpr (n == 10) { auto& [a, b, c, d, e, g, h, i, j, k] = t; f(a); f(b); f(c); f(d); f(e); f(g); f(h); f(i); f(j); f(k); }
+         else if constexpr (n == 11) { auto& [a, b, c, d, e, g, h, i, j, k, l] = t; f(a); f(b); f(c); f(d); f(e); f(g); f(h); f(i); f(j); f(k); f(l); }
+         else if constexpr (n == 12) { auto& [a, b, c, d, e, g, h, i, j, k, l, m] = t; f(a); f(b); f(c); f(d); f(e); f(g); f(h); f(i); f(j); f(k); f(l); f(m); }
+         else if constexpr (n == 13) { auto& [a, b, c, d, e, g, h, i, j, k, l, m, o] = t; f(a); f(b); f(c); f(d); f(e); f(g); f(h); f(i); f(j); f(k); f(l); f(m); f(o); }
+         else if constexpr (n == 14) { auto& [a, b, c, d, e, g, h, i, j, k, l, m, o, p] = t; f(a); f(b); f(c); f(d); f(e); f(g); f(h); f(i); f(j); f(k); f(l); f(m); f(o); f(p); }
+         else if constexpr (n == 15) { auto& [a, b, c, d, e, g, h, i, j, k, l, m, o, p, q] = t; f(a); f(b); f(c); f(d); f(e); f(g); f(h); f(i); f(j); f(k); f(l); f(m); f(o); f(p); f(q); }
+         else if constexpr (n == 16) { auto& [a, b, c, d, e, g, h, i, j, k, l, m, o, p, q, r] = t; f(a); f(b); f(c); f(d); f(e); f(g); f(h); f(i); f(j); f(k); f(l); f(m); f(o); f(p); f(q); f(r); }
+      }
+
+      template<typename T>
+      constexpr bool is_reflectable_v = std::is_class_v<T> && std::is_aggregate_v<T>;
+   }
+
+   template<typename DataStream, typename T, std::enable_if_t<reflect::is_reflectable_v<T>, int> = 0>
+   DataStream& operator<<(DataStream& ds, const T& t) {
+      reflect::for_each_field(t, [&](const auto& f) { ds << f; });
+      return ds;
+   }
+
+   template<typename DataStream, typename T, std::enable_if_t<reflect::is_reflectable_v<T>, int> = 0>
+   DataStream& operator>>(DataStream& ds, T& t) {
+      reflect::for_each_field(t, [&](auto& f) { ds >> f; });
+      return ds;
+   }
+
+   template<typename T>
+   size_t pack_size(const T& value) {
+      datastream<size_t> ps;
+      ps << value;
+      return ps.tellp();
+   }
+
+   template<typename T>
+   std::vector<char> pack(const T& value) {
+      std::vector<char> result(pack_size(value));
+      datastream<char*> ds(result.data(), result.size());
+      ds << value;
+      return result;
+   }
+
+   template<typename T>
+   T unpack(const char* buffer, size_t len) {
+      T result{};
+      datastream<const char*> ds(buffer, len);
+      ds >> result;
+      return result;
+   }
+
+   template<typename T>
+   T unpack(const std::vector<char>& bytes) { return unpack<T>(bytes.data(), bytes.size()); }
+}
@@ -0,0 +1,8 @@
+/**
+ *  @file
+ *  @copyright defined in ../../../../LICENSE
+ */
+#pragma once
+
+#include "action.hpp"
+#include "time.hpp"
@@ -0,0 +1,251 @@
+/**
+ *  @file
+ *  @copyright defined in ../../../../LICENSE
+ */
+#pragma once
+
+#include <eosio/eosio.hpp>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace eosio { namespace native {
+
+   /**
+    * @brief work done by the contracts, metered at the intrinsic boundary
+    */
+   struct counters {
+      uint64_t actions = 0;          // every handler invocation, notifications included
+      uint64_t notifications = 0;    // handler invocations with receiver != code
+      uint64_t inline_actions = 0;   // actions queued with `action::send()`
+      uint64_t table_reads = 0;      // row fetches plus lookups/navigation (find, lower_bound, next, ...)
+      uint64_t table_writes = 0;     // row stores and updates, secondary entries included
+      uint64_t table_erases = 0;     // row and secondary entry removals
+      uint64_t bytes_packed = 0;     // row and inline action bytes serialised by the contracts
+      uint64_t bytes_unpacked = 0;   // row and action bytes deserialised by the contracts
+      int64_t  ram_delta = 0;        // billable RAM bytes, all payers
+
+      counters operator-(const counters& o) const {
+         return { actions - o.actions, notifications - o.notifications, inline_actions - o.inline_actions,
+                  table_reads - o.table_reads, table_writes - o.table_writes, table_erases - o.table_erases,
+                  bytes_packed - o.bytes_packed, bytes_unpacked - o.bytes_unpacked, ram_delta - o.ram_delta };
+      }
+   };
+
+   /**
+    * @brief true on the thread running a contract's handler, outside the intrinsics it calls; lets a
+    * heap counter tell the contracts' allocations from the runtime's
+    */
+   bool in_contract_code();
+
+   /**
+    * @brief a failed action, `what()` names the receiver and action, `message` is the bare `check` text
+    */
+   struct action_exception : assert_exception {
+      action_exception(const std::string& what, std::string msg) : assert_exception(what), message(std::move(msg)) {}
+      std::string message;
+   };
+
+   struct action_trace {
+      name        receiver;
+      name        account;
+      name        action;
+      uint32_t    depth = 0;
+      std::string console;
+      std::vector<char> return_value;
+      std::vector<char> data;        // the action's packed arguments
+   };
+
+   /**
+    * @brief a row changed by a transaction, `present` is false when it was removed
+    */
+   struct table_delta {
+      name              code;
+      uint64_t          scope = 0;
+      name              table;
+      uint64_t          primary_key = 0;
+      bool              present = false;
+      std::vector<char> value;
+   };
+
+   /**
+    * @brief single node, single block producer stand-in for nodeos that executes contracts natively
+    * @details contracts are compiled against the headers in `tools/native/include` and registered
+    * with `deploy<Contract>(account)`; `push_action` then runs a one action transaction with the
+    * same ordering rules as nodeos: the receiver, then every `require_recipient` notification, then
+    * the queued inline actions depth first. A failed `check` rolls the whole transaction back.
+    */
+   class chain {
+      public:
+         using handler = std::function<void(name receiver, name code, const std::vector<char>& data)>;
+
+         template<typename Contract>
+         class deployment {
+            public:
+               deployment(chain& c, name account) : _chain(c), _account(account) {}
+
+               template<auto Method>
+               deployment& action(name act) {
+                  _chain.set_action(_account, act, make_handler<Method>());
+                  return *this;
+               }
+
+               /**
+                * @param code - first receiver to react to, `name()` stands in for the `*` wildcard
+                */
+               template<auto Method>
+               deployment& notify(name code, name act) {
+                  _chain.set_notify(_account, code, act, make_handler<Method>());
+                  return *this;
+               }
+
+            private:
+               chain& _chain;
+               name   _account;
+         };
+
+         chain();
+         ~chain();
+
+         chain(const chain&) = delete;
+         chain& operator=(const chain&) = delete;
+
+         static chain& active();
+
+         void create_account(name account);
+         bool account_exists(name account) const;
+
+         template<typename Contract>
+         deployment<Contract> deploy(name account) {
+            create_account(account);
+            _contracts[account];
+            return deployment<Contract>(*this, account);
+         }
+
+         void set_action(name account, name act, handler h);
+         void set_notify(name account, name code, name act, handler h);
+
+         std::vector<action_trace> push_action(name code, name act, std::vector<permission_level> auths, std::vector<char> data);
+
+         template<typename... Args>
+         std::vector<action_trace> push_action(name code, name act, name actor, Args&&... args) {
+            return push_action(code, act, { permission_level(actor, name("active")) }, pack(std::make_tuple(std::forward<Args>(args)...)));
+         }
+
+         template<typename T>
+         std::optional<T> get_row(name code, uint64_t scope, name table, uint64_t pk) const {
+            auto t = _state.db.find({ code.value, scope, table.value });
+            if (t == _state.db.end()) return {};
+            auto r = t->second.find(pk);
+            if (r == t->second.end()) return {};
+            return unpack<T>(r->second.data);
+         }
+
+         time_point now() const { return _now; }
+         void set_time(time_point t) { _now = t; }
+         void advance(microseconds m) { _now += m; }
+
+         const counters& stats() const { return _stats; }
+         int64_t ram_usage(name account) const;
+
+         /**
+          * @brief when set the console of every action is echoed to stdout as it finishes
+          */
+         bool echo_console = false;
+
+         /**
+          * @brief deepest nesting at which an action may still send inline actions, nodeos defaults
+          * `max_inline_action_depth` to 4 which caps network conversions at two hops
+          */
+         uint32_t max_inline_action_depth = 4;
+
+         /**
+          * @brief snapshot state before each transaction so that a failure leaves no trace,
+          * disable for benchmarks that only push transactions which are expected to succeed
+          */
+         bool rollback = true;
+
+         /**
+          * @brief called after every successful transaction with the rows it changed, as their final
+          * values, the way the state history plugin reports `contract_row` deltas
+          */
+         std::function<void(const std::vector<table_delta>&)> on_deltas;
+
+      private:
+         friend struct intrinsics;
+
+         template<auto Method>
+         static handler make_handler() {
+            using traits = detail::member_args<decltype(Method)>;
+            using contract_type = typename traits::contract_type;
+
+            return [](name receiver, name code, const std::vector<char>& data) {
+               contract_type obj(receiver, code, datastream<const char*>(data.data(), data.size()));
+               auto args = unpack<typename traits::arg_tuple>(data);
+               if constexpr (std::is_void_v<typename traits::return_type>)
+                  std::apply([&](auto&... a) { (obj.*Method)(a...); }, args);
+               else
+                  set_action_return_value(pack(std::apply([&](auto&... a) { return (obj.*Method)(a...); }, args)));
+            };
+         }
+
+         struct code_t {
+            std::map<uint64_t, handler>                          actions;
+            std::map<std::pair<uint64_t, uint64_t>, handler>     notifications;  // (code, action), code 0 matches any
+         };
+
+         struct row_t {
+            std::vector<char> data;
+            name              payer;
+         };
+
+         struct table_id {
+            uint64_t code, scope, table;
+            bool operator<(const table_id& o) const { return std::tie(code, scope, table) < std::tie(o.code, o.scope, o.table); }
+         };
+
+         struct index_id {
+            uint64_t code, scope, table, index;
+            bool operator<(const index_id& o) const { return std::tie(code, scope, table, index) < std::tie(o.code, o.scope, o.table, o.index); }
+         };
+
+         struct secondary_t {
+            std::set<std::pair<uint64_t, uint64_t>> entries;   // (secondary, primary)
+            std::map<uint64_t, std::pair<uint64_t, name>> by_primary;  // primary -> (secondary, payer)
+         };
+
+         struct state_t {
+            std::map<table_id, std::map<uint64_t, row_t>> db;
+            std::map<index_id, secondary_t>                idx;
+            std::map<uint64_t, int64_t>                    ram;
+         };
+
+         struct context_t {
+            action                       act;
+            name                         receiver;
+            uint32_t                     depth = 0;
+            std::vector<name>            notified;
+            std::vector<eosio::action>   inlines;
+            std::string                  console;
+            std::vector<char>            return_value;
+         };
+
+         void execute(const eosio::action& act, uint32_t depth, std::vector<action_trace>& traces);
+         void bill(name payer, int64_t bytes);
+         context_t& context();
+
+         std::set<uint64_t>                   _accounts;
+         std::map<name, code_t>               _contracts;
+         state_t                              _state;
+         std::vector<context_t*>              _stack;
+         time_point                           _now;
+         counters                             _stats;
+         std::set<std::pair<table_id, uint64_t>> _touched;   // rows written by the transaction, for on_deltas
+   };
+}}
@@ -0,0 +1,483 @@
+/**
+ *  @file
+ *  @copyright defined in ../../../LICENSE
+ */
+
+#include <native/chain.hpp>
+
+#include <cstdio>
+
+namespace eosio { namespace native {
+
+   // billable sizes used by nodeos for a contract table, a primary row and a uint64_t secondary row
+   constexpr int64_t table_overhead = 108;
+   constexpr int64_t row_overhead = 108;
+   constexpr int64_t idx64_overhead = 128;
+
+   static chain* active_chain = nullptr;
+
+   // set around a handler and cleared again by the intrinsics that allocate for the runtime
+   static thread_local bool contract_code = false;
+
+   bool in_contract_code() { return contract_code; }
+
+   struct code_scope {
+      bool saved = contract_code;
+      explicit code_scope(bool contract) { contract_code = contract; }
+      ~code_scope() { contract_code = saved; }
+   };
+
+   chain::chain() : _now(seconds(1577836800)) {
+      check(active_chain == nullptr, "only one native chain may exist at a time");
+      active_chain = this;
+   }
+
+   chain::~chain() { active_chain = nullptr; }
+
+   chain& chain::active() {
+      check(active_chain != nullptr, "no native chain is active");
+      return *active_chain;
+   }
+
+   void chain::create_account(name account) { _accounts.insert(account.value); }
+   bool chain::account_exists(name account) const { return _accounts.count(account.value) > 0; }
+
+   void chain::set_action(name account, name act, handler h) { _contracts[account].actions[act.value] = std::move(h); }
+
+   void chain::set_notify(name account, name code, name act, handler h) {
+      _contracts[account].notifications[{ code.value, act.value }] = std::move(h);
+   }
+
+   int64_t chain::ram_usage(name account) const {
+      auto itr = _state.ram.find(account.value);
+      return itr == _state.ram.end() ? 0 : itr->second;
+   }
+
+   void chain::bill(name payer, int64_t bytes) {
+      _state.ram[payer.value] += bytes;
+      _stats.ram_delta += bytes;
+   }
+
+   chain::context_t& chain::context() {
+      check(!_stack.empty(), "no action is executing");
+      return *_stack.back();
+   }
+
+   std::vector<action_trace> chain::push_action(name code, name act, std::vector<permission_level> auths, std::vector<char> data) {
+      check(_stack.empty(), "push_action cannot be called from within an action");
+      for (const auto& auth : auths)
+         check(account_exists(auth.actor), "authorizing actor does not exist");
+
+      eosio::action a;
+      a.account = code;
+      a.name = act;
+      a.authorization = std::move(auths);
+      a.data = std::move(data);
+
+      std::vector<action_trace> traces;
+      std::optional<state_t> snapshot;
+      if (rollback)
+         snapshot = _state;
+
+      _touched.clear();
+      try {
+         execute(a, 0, traces);
+      } catch (...) {
+         _stack.clear();
+         _touched.clear();
+         if (snapshot) {
+            for (const auto& [account, bytes] : _state.ram)
+               _stats.ram_delta -= bytes;
+            _state = std::move(*snapshot);
+            for (const auto& [account, bytes] : _state.ram)
+               _stats.ram_delta += bytes;
+         }
+         throw;
+      }
+
+      if (on_deltas && !_touched.empty()) {
+         std::vector<table_delta> deltas;
+         for (const auto& [id, pk] : _touched) {
+            const row_t* row = nullptr;
+            auto t = _state.db.find(id);
+            if (t != _state.db.end()) {
+               auto r = t->second.find(pk);
+               if (r != t->second.end()) row = &r->second;
+            }
+            deltas.push_back({ name(id.code), id.scope, name(id.table), pk, row != nullptr, row ? row->data : std::vector<char>() });
+         }
+         _touched.clear();
+         on_deltas(deltas);
+      }
+      return traces;
+   }
+
+   void chain::execute(const eosio::action& act, uint32_t depth, std::vector<action_trace>& traces) {
+      check(account_exists(act.account), "action's code account does not exist");
+
+      context_t ctx;
+      ctx.act = act;
+      ctx.depth = depth;
+      ctx.notified.push_back(act.account);
+
+      _stack.push_back(&ctx);
+      for (size_t i = 0; i < ctx.notified.size(); ++i) {
+         ctx.receiver = ctx.notified[i];
+         ctx.console.clear();
+         ctx.return_value.clear();
+
+         auto code = _contracts.find(ctx.receiver);
+         if (code != _contracts.end()) {
+            const handler* h = nullptr;
+            if (ctx.receiver == act.account) {
+               auto itr = code->second.actions.find(act.name.value);
+               check(itr != code->second.actions.end(), "unknown action " + act.name.to_string() + " on " + act.account.to_string());
+               h = &itr->second;
+            } else {
+               auto itr = code->second.notifications.find({ act.account.value, act.name.value });
+               if (itr == code->second.notifications.end())
+                  itr = code->second.notifications.find({ 0, act.name.value });
+               if (itr != code->second.notifications.end())
+                  h = &itr->second;
+            }
+
+            if (h) {
+               ++_stats.actions;
+               if (ctx.receiver != act.account)
+                  ++_stats.notifications;
+               _stats.bytes_unpacked += act.data.size();
+               try {
+                  code_scope scope(true);
+                  (*h)(ctx.receiver, act.account, act.data);
+               } catch (const action_exception&) {
+                  throw;
+               } catch (const std::exception& e) {
+                  throw action_exception(std::string(e.what()) + " (" + ctx.receiver.to_string() + " <- " +
+                                         act.account.to_string() + "::" + act.name.to_string() + ")", e.what());
+               }
+            }
+         }
+
+         if (echo_console && !ctx.console.empty())
+            fwrite(ctx.console.data(), 1, ctx.console.size(), stdout);
+
+         traces.push_back({ ctx.receiver, act.account, act.name, depth, ctx.console, ctx.return_value, act.data });
+      }
+      _stack.pop_back();
+
+      if (!ctx.inlines.empty())
+         check(depth < max_inline_action_depth, "max inline action depth per transaction reached");
+      for (const auto& inl : ctx.inlines)
+         execute(inl, depth + 1, traces);
+   }
+
+   /**
+    * the intrinsics below are what the headers in `include/eosio` call into, they resolve the
+    * active chain and the executing action and meter every call
+    */
+   struct intrinsics {
+      static chain& c() { return chain::active(); }
+
+      using row_t = chain::row_t;
+
+      static counters& stats() { return c()._stats; }
+      static void bill(name payer, int64_t bytes) { c().bill(payer, bytes); }
+
+      static bool executing() { return active_chain != nullptr && !active_chain->_stack.empty(); }
+
+      static chain::context_t& ctx() { return c().context(); }
+
+      static std::map<uint64_t, chain::row_t>* find_table(name code, uint64_t scope, name table) {
+         auto& db = c()._state.db;
+         auto itr = db.find({ code.value, scope, table.value });
+         return itr == db.end() ? nullptr : &itr->second;
+      }
+
+      static std::map<uint64_t, chain::row_t>& own_table(uint64_t scope, name table, name payer) {
+         auto& db = c()._state.db;
+         chain::table_id id{ ctx().receiver.value, scope, table.value };
+         auto itr = db.find(id);
+         if (itr == db.end()) {
+            itr = db.emplace(id, std::map<uint64_t, chain::row_t>()).first;
+            c().bill(payer, table_overhead);
+         }
+         return itr->second;
+      }
+
+      static void touch(uint64_t scope, name table, uint64_t pk) {
+         if (c().on_deltas)
+            c()._touched.insert({ { ctx().receiver.value, scope, table.value }, pk });
+      }
+
+      static void release_table(uint64_t scope, name table) {
+         auto& db = c()._state.db;
+         auto itr = db.find({ ctx().receiver.value, scope, table.value });
+         if (itr != db.end() && itr->second.empty()) {
+            // nodeos bills the table to the payer of its first row, the receiver is close enough here
+            c().bill(ctx().receiver, -table_overhead);
+            db.erase(itr);
+         }
+      }
+
+      static chain::secondary_t* find_index(name code, uint64_t scope, name table, uint8_t index) {
+         auto& idx = c()._state.idx;
+         auto itr = idx.find({ code.value, scope, table.value, index });
+         return itr == idx.end() ? nullptr : &itr->second;
+      }
+
+      static chain::secondary_t& own_index(uint64_t scope, name table, uint8_t index) {
+         return c()._state.idx[{ ctx().receiver.value, scope, table.value, index }];
+      }
+
+      static name payer_or(name payer, name fallback) { return payer == same_payer ? fallback : payer; }
+
+      static void check_payer(name payer) {
+         check(c().account_exists(payer), "cannot bill RAM to an account that does not exist");
+         if (payer != ctx().receiver)
+            check(native::has_auth(payer), "cannot charge RAM to other accounts during notify");
+      }
+   };
+
+   void prints(std::string_view s) {
+      code_scope host(false);
+      if (!intrinsics::executing()) {
+         fwrite(s.data(), 1, s.size(), stdout);
+         return;
+      }
+      intrinsics::ctx().console.append(s.data(), s.size());
+   }
+
+   time_point current_time() { return intrinsics::c().now(); }
+
+   name current_receiver() { return intrinsics::ctx().receiver; }
+
+   bool has_auth(name n) {
+      for (const auto& auth : intrinsics::ctx().act.authorization)
+         if (auth.actor == n)
+            return true;
+      return false;
+   }
+
+   void require_auth(name n) { check(native::has_auth(n), "missing authority of " + n.to_string()); }
+
+   void require_auth(const permission_level& level) {
+      for (const auto& auth : intrinsics::ctx().act.authorization)
+         if (auth == level)
+            return;
+      check(false, "missing authority of " + level.actor.to_string() + "/" + level.permission.to_string());
+   }
+
+   void require_recipient(name n) {
+      auto& notified = intrinsics::ctx().notified;
+      for (const auto& r : notified)
+         if (r == n) return;
+      notified.push_back(n);
+   }
+
+   bool is_account(name n) { return intrinsics::c().account_exists(n); }
+
+   void send_inline(const action& act) {
+      code_scope host(false);
+      auto& ctx = intrinsics::ctx();
+      // a contract may only authorize inline actions with its own permission (eosio.code) or
+      // with an authorization it was given by the action that invoked it
+      for (const auto& auth : act.authorization) {
+         bool satisfied = auth.actor == ctx.receiver;
+         for (const auto& parent : ctx.act.authorization)
+            satisfied = satisfied || parent == auth;
+         check(satisfied, "inline action authorization " + auth.actor.to_string() + " is not satisfied");
+      }
+
+      auto& s = intrinsics::stats();
+      ++s.inline_actions;
+      s.bytes_packed += act.data.size();
+      ctx.inlines.push_back(act);
+   }
+
+   void set_action_return_value(std::vector<char> value) {
+      code_scope host(false);
+      intrinsics::stats().bytes_packed += value.size();
+      intrinsics::ctx().return_value = std::move(value);
+   }
+
+   bool db_get(name code, uint64_t scope, name table, uint64_t pk, std::vector<char>& out) {
+      auto& s = intrinsics::stats();
+      ++s.table_reads;
+      auto t = intrinsics::find_table(code, scope, table);
+      if (!t) return false;
+      auto r = t->find(pk);
+      if (r == t->end()) return false;
+      out = r->second.data;
+      s.bytes_unpacked += out.size();
+      return true;
+   }
+
+   bool db_lower_bound(name code, uint64_t scope, name table, uint64_t pk, uint64_t& found) {
+      ++intrinsics::stats().table_reads;
+      auto t = intrinsics::find_table(code, scope, table);
+      if (!t) return false;
+      auto r = t->lower_bound(pk);
+      if (r == t->end()) return false;
+      found = r->first;
+      return true;
+   }
+
+   bool db_next(name code, uint64_t scope, name table, uint64_t pk, uint64_t& next) {
+      ++intrinsics::stats().table_reads;
+      auto t = intrinsics::find_table(code, scope, table);
+      if (!t) return false;
+      auto r = t->upper_bound(pk);
+      if (r == t->end()) return false;
+      next = r->first;
+      return true;
+   }
+
+   bool db_previous(name code, uint64_t scope, name table, uint64_t pk, uint64_t& prev) {
+      ++intrinsics::stats().table_reads;
+      auto t = intrinsics::find_table(code, scope, table);
+      if (!t) return false;
+      auto r = t->lower_bound(pk);
+      if (r == t->begin()) return false;
+      prev = (--r)->first;
+      return true;
+   }
+
+   bool db_last(name code, uint64_t scope, name table, uint64_t& pk) {
+      ++intrinsics::stats().table_reads;
+      auto t = intrinsics::find_table(code, scope, table);
+      if (!t || t->empty()) return false;
+      pk = t->rbegin()->first;
+      return true;
+   }
+
+   void db_store(uint64_t scope, name table, name payer, uint64_t pk, std::vector<char> data) {
+      code_scope host(false);
+      intrinsics::check_payer(payer);
+      auto& t = intrinsics::own_table(scope, table, payer);
+      check(t.find(pk) == t.end(), "could not insert object, most likely a uniqueness constraint was violated");
+
+      auto& s = intrinsics::stats();
+      ++s.table_writes;
+      s.bytes_packed += data.size();
+      intrinsics::bill(payer, row_overhead + int64_t(data.size()));
+      t.emplace(pk, intrinsics::row_t{ std::move(data), payer });
+      intrinsics::touch(scope, table, pk);
+   }
+
+   void db_update(uint64_t scope, name table, name payer, uint64_t pk, std::vector<char> data) {
+      code_scope host(false);
+      auto t = intrinsics::find_table(intrinsics::ctx().receiver, scope, table);
+      check(t != nullptr, "cannot update a row in a table that does not exist");
+      auto r = t->find(pk);
+      check(r != t->end(), "cannot update a row that does not exist");
+
+      auto& row = r->second;
+      auto new_payer = intrinsics::payer_or(payer, row.payer);
+      if (new_payer != row.payer || data.size() != row.data.size())
+         intrinsics::check_payer(new_payer);
+
+      auto& s = intrinsics::stats();
+      ++s.table_writes;
+      s.bytes_packed += data.size();
+      intrinsics::bill(row.payer, -(row_overhead + int64_t(row.data.size())));
+      intrinsics::bill(new_payer, row_overhead + int64_t(data.size()));
+      row.payer = new_payer;
+      row.data = std::move(data);
+      intrinsics::touch(scope, table, pk);
+   }
+
+   void db_remove(uint64_t scope, name table, uint64_t pk) {
+      code_scope host(false);
+      auto t = intrinsics::find_table(intrinsics::ctx().receiver, scope, table);
+      check(t != nullptr, "cannot remove a row from a table that does not exist");
+      auto r = t->find(pk);
+      check(r != t->end(), "cannot remove a row that does not exist");
+
+      ++intrinsics::stats().table_erases;
+      intrinsics::bill(r->second.payer, -(row_overhead + int64_t(r->second.data.size())));
+      t->erase(r);
+      intrinsics::touch(scope, table, pk);
+      intrinsics::release_table(scope, table);
+   }
+
+   void idx64_store(uint64_t scope, name table, uint8_t index, uint64_t pk, uint64_t secondary) {
+      code_scope host(false);
+      auto t = intrinsics::find_table(intrinsics::ctx().receiver, scope, table);
+      check(t != nullptr && t->count(pk), "secondary index entry requires its primary row");
+      auto payer = t->at(pk).payer;
+
+      auto& idx = intrinsics::own_index(scope, table, index);
+      idx.entries.emplace(secondary, pk);
+      idx.by_primary[pk] = { secondary, payer };
+
+      ++intrinsics::stats().table_writes;
+      intrinsics::bill(payer, idx64_overhead);
+   }
+
+   void idx64_update(uint64_t scope, name table, uint8_t index, uint64_t pk, uint64_t secondary) {
+      code_scope host(false);
+      auto& idx = intrinsics::own_index(scope, table, index);
+      auto itr = idx.by_primary.find(pk);
+      check(itr != idx.by_primary.end(), "secondary index entry does not exist");
+
+      idx.entries.erase({ itr->second.first, pk });
+      idx.entries.emplace(secondary, pk);
+      itr->second.first = secondary;
+      ++intrinsics::stats().table_writes;
+   }
+
+   void idx64_remove(uint64_t scope, name table, uint8_t index, uint64_t pk) {
+      code_scope host(false);
+      auto& idx = intrinsics::own_index(scope, table, index);
+      auto itr = idx.by_primary.find(pk);
+      check(itr != idx.by_primary.end(), "secondary index entry does not exist");
+
+      idx.entries.erase({ itr->second.first, pk });
+      intrinsics::bill(itr->second.second, -idx64_overhead);
+      idx.by_primary.erase(itr);
+      ++intrinsics::stats().table_erases;
+   }
+
+   bool idx64_lower_bound(name code, uint64_t scope, name table, uint8_t index, uint64_t& secondary, uint64_t& pk) {
+      ++intrinsics::stats().table_reads;
+      auto idx = intrinsics::find_index(code, scope, table, index);
+      if (!idx) return false;
+      auto itr = idx->entries.lower_bound({ secondary, 0 });
+      if (itr == idx->entries.end()) return false;
+      secondary = itr->first;
+      pk = itr->second;
+      return true;
+   }
+
+   bool idx64_next(name code, uint64_t scope, name table, uint8_t index, uint64_t& secondary, uint64_t& pk) {
+      ++intrinsics::stats().table_reads;
+      auto idx = intrinsics::find_index(code, scope, table, index);
+      if (!idx) return false;
+      auto itr = idx->entries.upper_bound({ secondary, pk });
+      if (itr == idx->entries.end()) return false;
+      secondary = itr->first;
+      pk = itr->second;
+      return true;
+   }
+
+   bool idx64_previous(name code, uint64_t scope, name table, uint8_t index, uint64_t& secondary, uint64_t& pk) {
+      ++intrinsics::stats().table_reads;
+      auto idx = intrinsics::find_index(code, scope, table, index);
+      if (!idx) return false;
+      auto itr = idx->entries.lower_bound({ secondary, pk });
+      if (itr == idx->entries.begin()) return false;
+      --itr;
+      secondary = itr->first;
+      pk = itr->second;
+      return true;
+   }
+
+   bool idx64_last(name code, uint64_t scope, name table, uint8_t index, uint64_t& secondary, uint64_t& pk) {
+      ++intrinsics::stats().table_reads;
+      auto idx = intrinsics::find_index(code, scope, table, index);
+      if (!idx || idx->entries.empty()) return false;
+      secondary = idx->entries.rbegin()->first;
+      pk = idx->entries.rbegin()->second;
+      return true;
+   }
+}}
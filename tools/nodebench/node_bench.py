@@ -0,0 +1,246 @@
+#!/usr/bin/env python3
+"""
+Billed resource regression benchmark against a local single producer node.
+
+Deploys the .wasm/.abi of Token, BancorNetwork, BancorConverter and swapsdata freshly built by the
+contracts target (build/contracts, see tools/CMakeLists.txt) with the same fixture as bench/swap_bench.cpp, runs the canonical scenarios and records, per scenario, the billed
+CPU (us), NET (bytes) and RAM delta (bytes, all payers) of the transaction. The results are compared
+with a stored baseline: NET and RAM are deterministic and must match exactly, CPU is allowed to
+drift by --cpu-tolerance percent.
+
+    ./start_node.sh                      # fresh chain, see genesis.json
+    ./node_bench.py --update-baseline    # record baseline.json
+    ./node_bench.py                      # compare, exits 1 on a regression
+
+cleos must be on PATH with an unlocked wallet holding the eosio development key.
+"""
+
+import argparse
+import calendar
+import json
+import os
+import statistics
+import subprocess
+import sys
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+CONTRACTS = os.path.join(HERE, "..", "..", "build", "contracts")
+CONTRACT_NAMES = ["Token", "BancorNetwork", "BancorConverter", "swapsdata"]
+
+DEV_KEY = "EOS6MRyAjQq8ud7hVNYcfnVPJqcVpscN5So8BhtHuGYqET5GDW5CV"
+
+TOKENS, RELAYS, NETWORK, DATA = "tokens", "relays", "network", "data.tbn"
+LP, TRADER = "provider", "alice"
+RESERVES = [("TLOS", 4), ("SEEDS", 4), ("HUSD", 2), ("USDT", 4), ("TESTA", 4)]
+RELAY_TOKENS = [("RELA", 4), ("RELB", 4), ("RELC", 4), ("RELD", 4)]
+CONVERTERS = ["cnvrt1", "cnvrt2", "cnvrt3", "cnvrt4"]
+
+DAY_HISTORY_INTERVALS = 600
+BULK_TRANSFERS = 20
+
+
+class Cleos:
+    def __init__(self, url, wallet_url):
+        self.base = ["cleos", "-u", url] + (["--wallet-url", wallet_url] if wallet_url else [])
+
+    def run(self, *args):
+        res = subprocess.run(self.base + list(args), capture_output=True, text=True)
+        if res.returncode != 0:
+            raise RuntimeError("cleos %s: %s" % (" ".join(args[:3]), res.stderr.strip().splitlines()[-1:]))
+        return res.stdout
+
+    def push(self, contract, action, data, actor):
+        out = self.run("push", "action", contract, action, json.dumps(data), "-p", actor + "@active", "-j", "-f")
+        return json.loads(out)
+
+    def push_transaction(self, actions):
+        trx = {"actions": [{"account": contract, "name": action, "data": data,
+                            "authorization": [{"actor": actor, "permission": "active"}]}
+                           for contract, action, data, actor in actions]}
+        return json.loads(self.run("push", "transaction", json.dumps(trx), "-j", "-f"))
+
+    def head_time(self):
+        info = json.loads(self.run("get", "info"))
+        return calendar.timegm(time.strptime(info["head_block_time"].split(".")[0], "%Y-%m-%dT%H:%M:%S"))
+
+
+def units(amount, sym):
+    code, precision = sym
+    return "%.*f %s" % (precision, amount, code)
+
+
+def cost(trace):
+    """billed CPU, NET and the RAM delta of every action in the transaction"""
+    processed = trace["processed"]
+    ram = 0
+    for act in processed["action_traces"]:
+        ram += sum(d["delta"] for d in act.get("account_ram_deltas", []))
+    return {
+        "cpu_us": processed["receipt"]["cpu_usage_us"],
+        "net_bytes": processed["receipt"]["net_usage_words"] * 8,
+        "ram_bytes": ram,
+        "actions": len(processed["action_traces"]),
+    }
+
+
+def setup(c, contracts):
+    for account in [TOKENS, RELAYS, NETWORK, DATA, LP, TRADER] + CONVERTERS:
+        c.run("create", "account", "eosio", account, DEV_KEY, DEV_KEY)
+
+    def deploy(account, name):
+        c.run("set", "contract", account, os.path.join(contracts, name), name + ".wasm", name + ".abi")
+
+    deploy(TOKENS, "Token")
+    deploy(RELAYS, "Token")
+    deploy(NETWORK, "BancorNetwork")
+    deploy(DATA, "swapsdata")
+    for cnv in CONVERTERS:
+        deploy(cnv, "BancorConverter")
+    for account in [NETWORK] + CONVERTERS:
+        c.run("set", "account", "permission", account, "active", "--add-code")
+
+    c.push(NETWORK, "init", {}, NETWORK)
+    for sym in RESERVES:
+        c.push(TOKENS, "create", [TOKENS, units(1e10, sym)], TOKENS)
+        c.push(TOKENS, "issue", [TOKENS, units(1e9, sym), "bench"], TOKENS)
+        for holder in (LP, TRADER):
+            c.push(TOKENS, "transfer", [TOKENS, holder, units(1e8, sym), "bench"], TOKENS)
+
+    for i, cnv in enumerate(CONVERTERS):
+        relay = RELAY_TOKENS[i]
+        c.push(RELAYS, "create", [cnv, units(1e10, relay)], RELAYS)
+        c.push(cnv, "init", [RELAYS, units(0, relay), True, True, NETWORK, False, 30000, 2000], cnv)
+        c.push(DATA, "addconverter", [cnv], DATA)
+        for sym in (RESERVES[i], RESERVES[i + 1]):
+            c.push(cnv, "setreserve", [TOKENS, "%d,%s" % (sym[1], sym[0]), 500000, True], cnv)
+            c.push(TOKENS, "transfer", [LP, cnv, units(1e6, sym), "setup"], LP)
+        c.push(RELAYS, "issue", [cnv, units(1e6, relay), "setup"], cnv)
+        c.push(RELAYS, "transfer", [cnv, LP, units(1e6, relay), "setup"], cnv)
+        c.push(RELAYS, "transfer", [LP, TRADER, units(1e4, relay), "bench"], LP)
+
+
+def path(start, hops, reverse):
+    elements = []
+    for h in range(hops):
+        i = start - h - 1 if reverse else start + h
+        elements += [CONVERTERS[i], RESERVES[i if reverse else i + 1][0]]
+    return " ".join(elements)
+
+
+def scenarios(c, skip_boundaries):
+    def convert(contract, quantity, conversion_path):
+        memo = "1,%s,0.0,%s" % (conversion_path, TRADER)
+        return lambda i: c.push(contract, "transfer", [TRADER, NETWORK, quantity, memo], TRADER)
+
+    def hops(n):
+        forward = convert(TOKENS, units(10, RESERVES[0]), path(0, n, False))
+        back = convert(TOKENS, units(10, RESERVES[n]), path(n, n, True))
+        return lambda i: (forward if i % 2 == 0 else back)(i)
+
+    records = [
+        {"quantity": units(10, RESERVES[0]), "price": 1.0, "liquidity_depth": units(1e6, RESERVES[0]), "smart_price": 1.0},
+        {"quantity": units(10, RESERVES[1]), "price": 1.0, "liquidity_depth": units(1e6, RESERVES[1]), "smart_price": 1.0},
+    ]
+
+    def log(i):
+        return c.push(DATA, "log", [CONVERTERS[0], records], CONVERTERS[0])
+
+    def log_at_boundary(i):
+        # the first log of a day interval creates the buffer rows, wait for the chain to cross into a new one
+        head = c.head_time()
+        time.sleep((int(head) // DAY_HISTORY_INTERVALS + 1) * DAY_HISTORY_INTERVALS - head + 1)
+        return log(i)
+
+    def bulk_transfer(i):
+        return c.push_transaction([(TOKENS, "transfer", [TRADER, LP, units(1, RESERVES[0]), "bench"], TRADER)] * BULK_TRANSFERS)
+
+    # (name, run, iterations or None for --iterations)
+    result = [
+        ("1-hop reserve conversion", hops(1), None),
+        ("2-hop reserve conversion", hops(2), None),
+        ("4-hop reserve conversion", hops(4), None),
+        ("smart token buy", convert(TOKENS, units(10, RESERVES[0]), "%s %s" % (CONVERTERS[0], RELAY_TOKENS[0][0])), None),
+        ("smart token sell", convert(RELAYS, units(1, RELAY_TOKENS[0]), "%s %s" % (CONVERTERS[0], RESERVES[0][0])), None),
+        ("swapsdata log, same interval", log, None),
+        ("%d token transfers" % BULK_TRANSFERS, bulk_transfer, None),
+    ]
+    if not skip_boundaries:
+        result.append(("swapsdata log, new interval", log_at_boundary, 2))
+    return result
+
+
+def measure(c, iterations, skip_boundaries):
+    results = {}
+    for name, run, count in scenarios(c, skip_boundaries):
+        samples = [cost(run(i)) for i in range(count or iterations)]
+        results[name] = {
+            "cpu_us": statistics.median(s["cpu_us"] for s in samples),
+            "net_bytes": max(s["net_bytes"] for s in samples),
+            "ram_bytes": max(s["ram_bytes"] for s in samples),
+            "actions": max(s["actions"] for s in samples),
+        }
+        print("%-32s %8.0f cpu_us %6d net %6d ram %3d actions" % (name, results[name]["cpu_us"],
+              results[name]["net_bytes"], results[name]["ram_bytes"], results[name]["actions"]))
+    return results
+
+
+def compare(results, baseline, cpu_tolerance):
+    regressions = []
+    for name, now in results.items():
+        was = baseline.get(name)
+        if was is None:
+            print("%-32s no baseline" % name)
+            continue
+        if now["cpu_us"] > was["cpu_us"] * (1 + cpu_tolerance / 100.0):
+            regressions.append("%s: cpu %d us -> %d us" % (name, was["cpu_us"], now["cpu_us"]))
+        for key in ("net_bytes", "ram_bytes", "actions"):
+            if now[key] > was[key]:
+                regressions.append("%s: %s %d -> %d" % (name, key, was[key], now[key]))
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0].strip())
+    parser.add_argument("--url", default="http://127.0.0.1:8888")
+    parser.add_argument("--wallet-url", default=None)
+    parser.add_argument("--contracts", default=CONTRACTS, help="directory the contracts target builds into")
+    parser.add_argument("--baseline", default=os.path.join(HERE, "baseline.json"))
+    parser.add_argument("--update-baseline", action="store_true")
+    parser.add_argument("--iterations", type=int, default=10)
+    parser.add_argument("--cpu-tolerance", type=float, default=15.0, help="allowed CPU increase, percent")
+    parser.add_argument("--setup-only", action="store_true", help="deploy the fixture and exit, e.g. for loadgen")
+    parser.add_argument("--skip-boundaries", action="store_true", help="skip scenarios that wait for an interval boundary")
+    args = parser.parse_args()
+
+    # the committed .wasm next to the sources is the last deployed build, not the code being measured
+    missing = [n for n in CONTRACT_NAMES if not os.path.exists(os.path.join(args.contracts, n, n + ".wasm"))]
+    if missing:
+        print("no %s built in %s, build the contracts target first" % (", ".join(missing), args.contracts))
+        return 1
+
+    c = Cleos(args.url, args.wallet_url)
+    setup(c, args.contracts)
+    if args.setup_only:
+        return 0
+    results = measure(c, args.iterations, args.skip_boundaries)
+
+    if args.update_baseline:
+        with open(args.baseline, "w") as f:
+            json.dump(results, f, indent=2, sort_keys=True)
+        print("baseline written to %s" % args.baseline)
+        return 0
+
+    if not os.path.exists(args.baseline):
+        print("no baseline at %s, run with --update-baseline first" % args.baseline)
+        return 1
+
+    with open(args.baseline) as f:
+        regressions = compare(results, json.load(f), args.cpu_tolerance)
+    for r in regressions:
+        print("REGRESSION " + r)
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
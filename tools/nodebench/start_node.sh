@@ -0,0 +1,19 @@
+#!/usr/bin/env bash
+# starts a fresh single producer node for node_bench.py; max_inline_action_depth is raised to 10
+# in genesis.json because every conversion hop adds two inline levels
+set -e
+
+DATA_DIR=${DATA_DIR:-/tmp/swaps-nodebench}
+HERE=$(cd "$(dirname "$0")" && pwd)
+
+rm -rf "$DATA_DIR"
+mkdir -p "$DATA_DIR"
+
+exec nodeos -e -p eosio \
+    --data-dir "$DATA_DIR/data" --config-dir "$DATA_DIR/config" \
+    --genesis-json "$HERE/genesis.json" \
+    --plugin eosio::producer_plugin --plugin eosio::producer_api_plugin \
+    --plugin eosio::chain_api_plugin --plugin eosio::http_plugin \
+    --http-server-address 127.0.0.1:8888 \
+    --max-transaction-time 1000 --abi-serializer-max-time-ms 1000 \
+    --contracts-console --disable-replay-opts "$@"
@@ -0,0 +1,330 @@
+/**
+ *  @file
+ *  @copyright defined in ../../LICENSE
+ *
+ *  Local quote server. Follows the converters' `settings`/`reserves` rows and the token `accounts`/
+ *  `stat` rows from a dump of table deltas, keeps a route_finder over them and answers quotes on a
+ *  unix socket from immutable snapshots, so that quoting never waits on ingestion and scales with
+ *  the workers.
+ *
+ *  The dump has one `contract_row` delta per line, as the state history plugin reports them, with
+ *  the row hex encoded (empty when the row was removed):
+ *
+ *     <block_num> <present 0|1> <code> <scope> <table> <primary_key> <hex value>
+ *
+ *  A snapshot is published whenever the block number changes and when the input runs dry. The
+ *  protocol is a line per request and a line per reply:
+ *
+ *     quote <contract> <amount> <SYM> <to_contract> <TO> [max_hops]   ok <block> <expected> <path> | none <block>
+ *     split <contract> <amount> <SYM> <to_contract> <TO> <receiver> [slippage]
+ *                                                                      ok <block> <expected> <n>, then n lines
+ *                                                                      <token contract> <quantity> <memo>
+ *     status                                                           ok <block> <converters> <tokens>
+ *
+ *  usage: quoted --input <dump|-> [--follow] [--socket /tmp/quoted.sock] [--workers 4]
+ *         quoted --input <dump> --bench <max readers> [--duration 2]
+ */
+
+#include "../../contracts/BancorConverter/BancorConverter.hpp"
+#include "rcu.hpp"
+
+#include <history/pool_model.hpp>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <thread>
+
+using eosio::asset;
+using eosio::name;
+using eosio::symbol;
+using eosio::symbol_code;
+using history::parse_delta;
+using history::pool_model;
+
+namespace {
+
+   struct options {
+      std::string input;
+      bool        follow   = false;
+      std::string socket   = "/tmp/quoted.sock";
+      uint32_t    workers  = 4;
+      uint32_t    bench    = 0;
+      double      duration = 2;
+   };
+
+   struct snapshot {
+      router::route_finder finder;
+      uint32_t             block = 0;
+   };
+
+   // whitespace separated words; the contract headers put eosio's datastream operators in scope,
+   // which take over `>>` on standard streams
+   std::vector<std::string> words(const std::string& line) {
+      std::vector<std::string> out;
+      for (size_t pos = 0; (pos = line.find_first_not_of(" \t\r", pos)) != std::string::npos; ) {
+         size_t end = std::min(line.find_first_of(" \t\r", pos), line.size());
+         out.push_back(line.substr(pos, end - pos));
+         pos = end;
+      }
+      return out;
+   }
+
+   /**
+    * @brief `amount` in the units of a symbol with as many decimals as it has, `1.5000` `TLOS`
+    */
+   asset parse_asset(const std::string& amount, const std::string& sym) {
+      auto dot = amount.find('.');
+      uint8_t precision = dot == std::string::npos ? 0 : amount.size() - dot - 1;
+      std::string digits = amount;
+      if (dot != std::string::npos) digits.erase(dot, 1);
+      return asset(std::stoll(digits), symbol(sym, precision));
+   }
+
+   // -------------------------------------------------------------------------------------------
+   // requests
+
+   std::string quote_request(const snapshot& s, const std::vector<std::string>& w) {
+      if (w.size() < 6) return "error usage: quote <contract> <amount> <SYM> <to_contract> <TO> [max_hops]";
+      size_t max_hops = w.size() > 6 ? std::stoul(w[6]) : 4;
+
+      auto r = s.finder.best_route(name(w[1]), parse_asset(w[2], w[3]), name(w[4]), symbol_code(w[5]), max_hops);
+      if (!r) return "none " + std::to_string(s.block);
+      return "ok " + std::to_string(s.block) + " " + r->expected.to_string() + " " + r->path();
+   }
+
+   std::string split_request(const snapshot& s, const std::vector<std::string>& w) {
+      if (w.size() < 7) return "error usage: split <contract> <amount> <SYM> <to_contract> <TO> <receiver> [slippage]";
+      double slippage = w.size() > 7 ? std::stod(w[7]) : 0.01;
+
+      name contract(w[1]);
+      auto quantity = parse_asset(w[2], w[3]);
+      auto routes = s.finder.disjoint_routes(contract, quantity, name(w[4]), symbol_code(w[5]));
+      if (routes.empty()) return "none " + std::to_string(s.block);
+      auto order = s.finder.split_across(routes, contract, quantity);
+      auto transfers = router::transfers(order, contract, name(w[6]), slippage);
+
+      std::string reply = "ok " + std::to_string(s.block) + " " + order.expected.to_string() + " " + std::to_string(transfers.size());
+      for (const auto& t : transfers)
+         reply += "\n" + t.contract.to_string() + " " + t.quantity.to_string() + " " + t.memo;
+      return reply;
+   }
+
+   std::string handle(const quoted::rcu_cell<snapshot>& cell, const std::string& line) {
+      try {
+         auto w = words(line);
+         if (w.empty()) return "error empty request";
+         return cell.read([&](const snapshot& s) {
+            if (w[0] == "quote")  return quote_request(s, w);
+            if (w[0] == "split")  return split_request(s, w);
+            if (w[0] == "status") return "ok " + std::to_string(s.block) + " " + std::to_string(s.finder.converter_count()) + " " +
+                                         std::to_string(s.finder.token_count());
+            return "error unknown command " + w[0];
+         });
+      } catch (const std::exception& e) {
+         return std::string("error ") + e.what();
+      }
+   }
+
+   /**
+    * @brief a worker, serves one connection at a time until the listener closes
+    */
+   void serve(int listener, const quoted::rcu_cell<snapshot>& cell) {
+      for (;;) {
+         int fd = accept(listener, nullptr, nullptr);
+         if (fd < 0) {
+            if (errno == EINTR) continue;
+            return;
+         }
+         std::string buffer;
+         char chunk[4096];
+         for (ssize_t n; (n = read(fd, chunk, sizeof(chunk))) > 0; ) {
+            buffer.append(chunk, n);
+            size_t start = 0;
+            for (size_t end; (end = buffer.find('\n', start)) != std::string::npos; start = end + 1) {
+               auto reply = handle(cell, buffer.substr(start, end - start)) + "\n";
+               if (write(fd, reply.data(), reply.size()) < 0) break;
+            }
+            buffer.erase(0, start);
+         }
+         close(fd);
+      }
+   }
+
+   int listen_on(const std::string& path) {
+      sockaddr_un addr{};
+      addr.sun_family = AF_UNIX;
+      eosio::check(path.size() < sizeof(addr.sun_path), "socket path too long");
+      strcpy(addr.sun_path, path.c_str());
+      unlink(path.c_str());
+
+      int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+      eosio::check(fd >= 0, "socket failed");
+      eosio::check(bind(fd, (sockaddr*)&addr, sizeof(addr)) == 0, "cannot bind " + path);
+      eosio::check(listen(fd, 64) == 0, "listen failed");
+      return fd;
+   }
+
+   // -------------------------------------------------------------------------------------------
+   // ingestion
+
+   /**
+    * @brief applies the deltas of `input`, publishing a snapshot at every block boundary and when the
+    * input runs dry; with `follow` it then waits for more, like `tail -f`
+    */
+   void ingest(std::istream& input, bool follow, pool_model& model, quoted::rcu_cell<snapshot>& cell) {
+      uint32_t block = cell.current().block;
+      auto publish = [&]() {
+         auto next = std::make_unique<snapshot>(cell.current());
+         for (const auto& c : model.flush())
+            next->finder.add_converter(c);
+         next->block = block;
+         cell.publish(std::move(next));
+      };
+
+      std::string line, partial;
+      for (;;) {
+         if (!std::getline(input, line) || input.eof()) {
+            partial += line;   // a last line without its newline, the rest is still being written
+            if (model.dirty()) publish();
+            if (!follow) break;
+            input.clear();
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            continue;
+         }
+         if (!partial.empty()) {
+            line = partial + line;
+            partial.clear();
+         }
+         if (line.empty() || line[0] == '#') continue;
+
+         auto d = parse_delta(line);
+         if (d.block != block && model.dirty()) publish();
+         block = d.block;
+         model.apply(d);
+      }
+      if (!partial.empty()) {
+         model.apply(parse_delta(partial));
+         publish();
+      }
+   }
+
+   // -------------------------------------------------------------------------------------------
+
+   /**
+    * @brief quotes per second over 1, 2, 4 ... `max_readers` reader threads while the writer keeps
+    * publishing snapshots that moved by a swap
+    */
+   void bench(quoted::rcu_cell<snapshot>& cell, const std::vector<std::pair<name, symbol>>& tokens, uint32_t max_readers, double duration) {
+      eosio::check(tokens.size() >= 2, "the dump has fewer than two reserve tokens");
+      printf("%zu converters, %zu reserve tokens, block %u\n", cell.current().finder.converter_count(), tokens.size(), cell.current().block);
+
+      for (uint32_t readers = 1; readers <= max_readers; readers *= 2) {
+         std::atomic<bool> done{ false };
+         std::atomic<uint64_t> quotes{ 0 };
+         std::vector<std::thread> threads;
+         for (uint32_t t = 0; t < readers; ++t)
+            threads.emplace_back([&, t]() {
+               std::mt19937_64 rng(t);
+               std::uniform_int_distribution<size_t> pick(0, tokens.size() - 1);
+               uint64_t n = 0;
+               while (!done.load(std::memory_order_relaxed)) {
+                  const auto& [from_contract, from] = tokens[pick(rng)];
+                  const auto& [to_contract, to] = tokens[pick(rng)];
+                  if (from == to) continue;
+                  asset quantity(10 * int64_t(power10(from.precision())), from);
+                  cell.read([&](const snapshot& s) { return s.finder.best_route(from_contract, quantity, to_contract, to.code(), 3); });
+                  ++n;
+               }
+               quotes += n;
+            });
+
+         // the writer: every snapshot moves one pool the way a small swap would
+         std::mt19937_64 rng(readers);
+         std::uniform_int_distribution<size_t> pick(0, tokens.size() - 1);
+         uint64_t published = 0;
+         auto start = std::chrono::steady_clock::now();
+         while (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() < duration) {
+            auto next = std::make_unique<snapshot>(cell.current());
+            const auto& [from_contract, from] = tokens[pick(rng)];
+            const auto& [to_contract, to] = tokens[pick(rng)];
+            asset quantity(int64_t(power10(from.precision())), from);
+            if (auto r = next->finder.best_route(from_contract, quantity, to_contract, to.code(), 1))
+               next->finder.apply(r->hops, from_contract, quantity);
+            next->block++;
+            cell.publish(std::move(next));
+            ++published;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+         }
+         done = true;
+         for (auto& t : threads) t.join();
+         auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+         printf("  %2u readers %12.0f quotes/s %10.0f per reader, %6.0f snapshots/s published\n", readers, quotes / elapsed,
+                quotes / elapsed / readers, published / elapsed);
+      }
+   }
+
+   options parse_options(int argc, char** argv) {
+      options o;
+      for (int i = 1; i < argc; ++i) {
+         std::string flag = argv[i];
+         if (flag == "--follow") {
+            o.follow = true;
+            continue;
+         }
+         eosio::check(i + 1 < argc, "missing value for " + flag);
+         std::string value = argv[++i];
+         if      (flag == "--input")    o.input = value;
+         else if (flag == "--socket")   o.socket = value;
+         else if (flag == "--workers")  o.workers = std::atoi(value.c_str());
+         else if (flag == "--bench")    o.bench = std::atoi(value.c_str());
+         else if (flag == "--duration") o.duration = std::atof(value.c_str());
+         else eosio::check(false, "unknown option " + flag);
+      }
+      eosio::check(!o.input.empty(), "--input is required");
+      return o;
+   }
+}
+
+int main(int argc, char** argv) {
+   try {
+      auto opts = parse_options(argc, argv);
+
+      std::ifstream file;
+      if (opts.input != "-") {
+         file.open(opts.input);
+         eosio::check(file.is_open(), "cannot open " + opts.input);
+      }
+      std::istream& input = opts.input == "-" ? std::cin : file;
+
+      pool_model model;
+      quoted::rcu_cell<snapshot> cell(std::make_unique<snapshot>());
+
+      if (opts.bench > 0) {
+         ingest(input, false, model, cell);
+         bench(cell, model.reserve_tokens(), opts.bench, opts.duration);
+         return 0;
+      }
+
+      signal(SIGPIPE, SIG_IGN);
+      int listener = listen_on(opts.socket);
+      for (uint32_t i = 0; i < opts.workers; ++i)
+         std::thread(serve, listener, std::cref(cell)).detach();
+
+      printf("serving on %s\n", opts.socket.c_str());
+      fflush(stdout);
+      ingest(input, opts.follow, model, cell);
+      for (;;) pause();   // the input is done, keep serving the last snapshot
+   } catch (const std::exception& e) {
+      fprintf(stderr, "%s\n", e.what());
+      return 1;
+   }
+}
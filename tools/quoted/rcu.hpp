@@ -0,0 +1,134 @@
+/**
+ *  @file
+ *  @copyright defined in ../../LICENSE
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace quoted {
+
+   /**
+    * @brief a value published as immutable snapshots: readers take no lock and never wait on the
+    * writer, the writer builds the next snapshot aside and swaps it in
+    * @details epoch based reclamation. A reader announces the epoch it starts in, in a slot of its
+    * own, before it loads the snapshot and clears the slot when it is done. A replaced snapshot is
+    * retired with the epoch that follows the swap and freed once no slot holds an older epoch, as
+    * every reader that could still see it announced one. Readers are threads, each takes a free slot
+    * on its first read and gives it back when it exits, so `max_readers` bounds the threads reading
+    * at once, not over the cell's life; publishing is for a single writer thread.
+    */
+   template<typename T>
+   class rcu_cell {
+      public:
+         explicit rcu_cell(std::unique_ptr<T> initial, size_t max_readers = 256)
+            : _current(initial.release()), _slots(std::make_shared<std::vector<slot>>(max_readers)) {}
+
+         ~rcu_cell() {
+            delete _current.load();
+            for (auto& r : _retired) delete r.value;
+         }
+
+         rcu_cell(const rcu_cell&) = delete;
+         rcu_cell& operator=(const rcu_cell&) = delete;
+
+         /**
+          * @brief calls `f` with the current snapshot, which stays valid until `f` returns
+          */
+         template<typename F>
+         auto read(F&& f) const {
+            auto& slot = (*_slots)[reader_slot()].epoch;
+            slot.store(_epoch.load());   // seq_cst, ordered before the load of the snapshot
+            struct leave {
+               std::atomic<uint64_t>& slot;
+               ~leave() { slot.store(0, std::memory_order_release); }
+            } guard{ slot };
+            return f(*static_cast<const T*>(_current.load()));
+         }
+
+         /**
+          * @brief the snapshot readers get from now on, the previous one is freed when they are done
+          */
+         void publish(std::unique_ptr<T> next) {
+            T* previous = _current.exchange(next.release());
+            _retired.push_back({ previous, ++_epoch });
+            reclaim();
+         }
+
+         /**
+          * @brief the current snapshot, only for the writer
+          */
+         const T& current() const { return *_current.load(std::memory_order_relaxed); }
+
+         /**
+          * @brief frees the retired snapshots no reader can hold any more, the number still retired
+          */
+         size_t reclaim() {
+            uint64_t oldest = UINT64_MAX;
+            size_t used = _used.load();
+            for (size_t i = 0; i < used; ++i) {
+               uint64_t e = (*_slots)[i].epoch.load();
+               if (e != 0 && e < oldest) oldest = e;
+            }
+            size_t kept = 0;
+            for (auto& r : _retired) {
+               if (r.epoch <= oldest) delete r.value;
+               else _retired[kept++] = r;
+            }
+            _retired.resize(kept);
+            return kept;
+         }
+
+      private:
+         struct alignas(64) slot {
+            std::atomic<uint64_t> epoch{ 0 };   // zero while the reader is outside `read`
+            std::atomic<bool>     taken{ false };
+         };
+
+         /**
+          * the slots a thread holds, given back when it exits; each keeps the slots of its cell alive, so
+          * a thread that outlives a cell neither writes to freed memory nor mistakes a new cell for it
+          */
+         struct owned_slots {
+            std::vector<std::pair<std::shared_ptr<std::vector<slot>>, size_t>> held;
+
+            ~owned_slots() {
+               for (auto& [slots, index] : held)
+                  (*slots)[index].taken.store(false, std::memory_order_release);
+            }
+         };
+
+         struct retired {
+            T*       value;
+            uint64_t epoch;
+         };
+
+         size_t reader_slot() const {
+            // one slot per thread and cell
+            thread_local owned_slots owned;
+            for (const auto& [slots, index] : owned.held)
+               if (slots == _slots) return index;
+
+            for (size_t index = 0; index < _slots->size(); ++index) {
+               bool free = false;
+               if (!(*_slots)[index].taken.compare_exchange_strong(free, true, std::memory_order_acquire)) continue;
+               // reclaim scans the slots ever taken
+               size_t used = _used.load();
+               while (used <= index && !_used.compare_exchange_weak(used, index + 1)) {}
+               owned.held.push_back({ _slots, index });
+               return index;
+            }
+            throw std::runtime_error("rcu_cell: too many reader threads");
+         }
+
+         std::atomic<T*>           _current;
+         std::atomic<uint64_t>     _epoch{ 1 };
+         std::shared_ptr<std::vector<slot>> _slots;
+         mutable std::atomic<size_t> _used{ 0 };
+         std::vector<retired>      _retired;
+   };
+}
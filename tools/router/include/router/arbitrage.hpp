@@ -0,0 +1,86 @@
+/**
+ *  @file
+ *  @copyright defined in ../../../../LICENSE
+ */
+#pragma once
+
+#include <router/route_finder.hpp>
+
+namespace router {
+
+   /**
+    * @brief a profitable cycle sized for the most profit, `path.expected` is what it pays back
+    */
+   struct opportunity {
+      name   contract;    // of the token the cycle starts and ends in
+      asset  quantity;
+      route  path;
+      asset  profit;
+   };
+
+   /**
+    * @brief finds the cycles of conversions that pay back more than they take
+    * @details the cycles of up to `max_length` hops through distinct converters are enumerated once,
+    * each weighted with the sum of the logarithms of its hops' marginal rates net of fees; a cycle
+    * with a positive weight pays back more than it takes for a small enough amount. When a swap
+    * moves a converter only the cycles through it are re-weighted, the others keep their weights.
+    * The candidates are then sized against the converters' own formulas, `route_finder`'s rounding
+    * included, for the amount with the largest profit; a sizing is kept until one of the cycle's
+    * converters is touched again.
+    *
+    * Keep the route_finder current and call `touched` with every converter whose balances moved;
+    * call `rebuild` after converters were added.
+    */
+   class arbitrage {
+      public:
+         explicit arbitrage(const route_finder& finder, size_t max_length = 3);
+
+         /**
+          * @brief enumerates the cycles again, after converters were added or replaced
+          */
+         void rebuild();
+
+         /**
+          * @brief re-weights the cycles through `converter` after its balances or supply moved
+          */
+         void touched(name converter);
+
+         /**
+          * @brief the profitable cycles, sized, most profitable first
+          */
+         std::vector<opportunity> opportunities(size_t max_count = 8);
+
+         /**
+          * @brief the network transfer executing `o` that fails unless it pays back at least the
+          * quantity plus `min_profit` of its expected profit (a fraction)
+          */
+         static transfer to_transfer(const opportunity& o, name receiver, double min_profit = 0.5);
+
+         size_t cycle_count() const { return _cycles.size(); }
+         size_t candidate_count() const { return _candidates.size(); }
+
+      private:
+         using edge = route_finder::edge;
+
+         struct cycle {
+            std::vector<edge>          edges;
+            double                     weight = 0;
+            bool                       sized = false;
+            std::optional<opportunity> best;          // the sizing, none if rounding eats the profit
+         };
+
+         double log_rate(const edge& e) const;
+         void weigh(uint32_t cycle_index);
+         void enumerate(uint32_t start, std::vector<edge>& path, std::vector<uint8_t>& on_path);
+         bool executable(const std::vector<edge>& edges) const;
+         int64_t run(const cycle& c, int64_t amount) const;
+         std::optional<opportunity> size(const cycle& c) const;
+
+         const route_finder&                _finder;
+         size_t                             _max_length;
+         std::vector<cycle>                 _cycles;
+         std::vector<std::vector<uint32_t>> _by_pool;      // the cycles through each pool
+         std::vector<uint32_t>              _candidates;   // the cycles of positive weight
+         std::vector<int32_t>               _candidate_at; // per cycle, its place in _candidates or -1
+   };
+}
@@ -0,0 +1,228 @@
+/**
+ *  @file
+ *  @copyright defined in ../../../../LICENSE
+ */
+#pragma once
+
+#include <eosio/asset.hpp>
+#include <eosio/name.hpp>
+
+#include <map>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace router {
+
+   using eosio::asset;
+   using eosio::name;
+   using eosio::symbol;
+   using eosio::symbol_code;
+
+   /**
+    * @brief a reserve row of a converter together with the converter's balance of it
+    */
+   struct reserve_snapshot {
+      name     contract;
+      symbol   currency;
+      int64_t  balance = 0;          // the converter's token balance plus the reserve's `currency.amount` offset
+      uint64_t ratio = 0;
+      bool     sale_enabled = false;
+   };
+
+   /**
+    * @brief the `settings` and `reserves` of a converter and the supply of its smart token
+    */
+   struct converter_snapshot {
+      name     account;
+      bool     enabled = false;
+      name     smart_contract;
+      symbol   smart_currency;
+      int64_t  smart_supply = 0;     // the smart token supply plus the `smart_currency.amount` offset
+      bool     smart_enabled = false;
+      uint64_t fee = 0;
+      uint32_t batch_window = 0;
+      std::vector<reserve_snapshot> reserves;
+   };
+
+   struct hop {
+      name   converter;
+      name   contract;               // of the token the hop pays out
+      symbol currency;
+   };
+
+   struct route {
+      std::vector<hop> hops;
+      asset            expected;     // what the last hop pays out
+
+      /**
+       * @brief the conversion path as the network expects it in the memo, `cnvrt1 SEEDS cnvrt2 HUSD`
+       */
+      std::string path() const;
+   };
+
+   /**
+    * @brief a part of an order and the path it takes, `path.expected` is what the part pays out
+    */
+   struct split {
+      route path;
+      asset quantity;
+   };
+
+   struct split_order {
+      std::vector<split> splits;
+      asset              expected;     // the total payout
+   };
+
+   /**
+    * @brief a transfer to the network, the token contract it is pushed to, amount and memo
+    */
+   struct transfer {
+      name        contract;
+      asset       quantity;
+      std::string memo;
+   };
+
+   /**
+    * @brief one network transfer per split, to be submitted as the actions of a single transaction;
+    * each memo asks for the split's expected payout less `slippage` (a fraction) as its min return
+    */
+   std::vector<transfer> transfers(const split_order& order, name contract, name receiver, double slippage);
+
+   /**
+    * @brief the network memo converting along `path` for `receiver`, `1,<path>,<min return>,<receiver>`
+    */
+   std::string memo(const route& path, asset min_return, name receiver);
+
+   /**
+    * @brief finds the best conversion path across converters from a snapshot of their state
+    * @details converters form a graph whose nodes are tokens (contract and symbol) and whose edges
+    * are the conversions a converter offers: reserve to reserve, reserve to smart token and back.
+    * Every hop is priced with the curve functions of `contracts/Common/curve.hpp` and rounded the way
+    * `BancorConverter::convert` rounds it, so a route's `expected` is what the chain pays out as long
+    * as the snapshot is current. Keep it current with `update_balance`/`update_supply`, or `apply` the
+    * routes that were executed.
+    *
+    * A query first walks back from the target to learn which tokens can still reach it in the hops
+    * left, then keeps, for each hop count, the best amount that reaches each of those tokens; a
+    * converter is used at most once per route. The search buffers are per thread, so const
+    * queries on one route_finder may run concurrently.
+    */
+   class route_finder {
+      public:
+         /**
+          * @brief adds a converter, or replaces the one with the same account
+          */
+         void add_converter(const converter_snapshot& snapshot);
+
+         void update_balance(name converter, symbol_code currency, int64_t balance);
+         void update_supply(name converter, int64_t supply);
+
+         /**
+          * @brief moves the balances and supplies the way executing the route with `quantity` of `contract` does
+          */
+         void apply(const std::vector<hop>& hops, name contract, asset quantity);
+
+         /**
+          * @brief what the path pays out for `quantity` of the token issued by `contract`, zero if
+          * any hop cannot be executed
+          */
+         asset quote(const std::vector<hop>& hops, name contract, asset quantity) const;
+
+         std::optional<route> best_route(name contract, asset quantity, name to_contract, symbol_code to, size_t max_hops = 4) const;
+
+         /**
+          * @brief up to `max_routes` routes that share no converter, each the best one left when
+          * quoting a `max_routes`th of `quantity`
+          */
+         std::vector<route> disjoint_routes(name contract, asset quantity, name to_contract, symbol_code to,
+                                            size_t max_routes = 8, size_t max_hops = 4) const;
+
+         /**
+          * @brief divides `quantity` among `routes`, which must not share a converter, to maximise the
+          * total payout
+          * @details the order is cut into `steps` equal parts that go, one by one, to the route whose
+          * payout grows the most by taking it. The payouts for all the multiples of a part are computed
+          * hop by hop over arrays of amounts; a hop between reserves of equal ratio (or to or from the
+          * smart token at a 100% ratio) converts the whole array at once in a vector loop, any other
+          * hop calls pow for each amount.
+          */
+         split_order split_across(const std::vector<route>& routes, name contract, asset quantity, size_t steps = 256) const;
+
+         size_t converter_count() const { return _pools.size(); }
+         size_t token_count() const { return _tokens.size(); }
+
+      private:
+         friend class arbitrage;
+
+         struct token {
+            name   contract;
+            symbol currency;
+         };
+
+         struct side {
+            uint32_t token;
+            uint8_t  precision;
+            int64_t  balance;
+            uint64_t ratio;
+            bool     sale_enabled;
+         };
+
+         // sides[0] is the smart token, balance holding its supply, the reserves follow
+         struct pool {
+            name              account;
+            bool              enabled;
+            uint64_t          fee;
+            double            fee_factor[3];   // calculate_fee's (1 - (1 - fee)^magnitude) for magnitudes 1 and 2
+            uint32_t          batch_window;
+            std::vector<side> sides;
+         };
+
+         struct edge {
+            uint32_t pool;
+            uint16_t from;
+            uint16_t to;
+            uint32_t token;   // the token paid out, saves reaching into the pool while pruning
+         };
+
+         struct state {
+            int64_t  amount;
+            uint32_t token;
+            int32_t  parent;
+            edge     via;
+         };
+
+         using token_key = std::pair<uint64_t, uint64_t>;   // contract, symbol code
+
+         struct scratch {
+            std::vector<state>    states;
+            std::vector<int32_t>  open;        // per token, the best state of the hop count that may take another hop
+            std::vector<int32_t>  frontier;
+            std::vector<int32_t>  next;
+            std::vector<uint8_t>  distance;    // per token, hops left to the target
+            std::vector<uint32_t> queue;
+            std::vector<uint8_t>  excluded;    // per pool, skipped by best_route
+            std::vector<double>   values;
+         };
+
+         uint32_t token_index(name contract, symbol currency);
+         std::optional<uint32_t> find_token(name contract, symbol_code currency) const;
+         int find_side(const pool& p, symbol_code currency) const;
+         void link(uint32_t pool_index);
+         int64_t convert(const pool& p, uint16_t from, uint16_t to, int64_t amount) const;
+         scratch& scratch_space() const;
+         bool uses(const scratch& sc, int32_t state_index, uint32_t pool_index) const;
+         std::vector<edge> resolve(const std::vector<hop>& hops, name contract, symbol_code currency) const;
+         void convert_batch(const pool& p, uint16_t from, uint16_t to, int64_t* amounts, size_t n) const;
+         void measure_distances(scratch& sc, uint32_t target, size_t depth) const;
+
+         std::vector<token>                        _tokens;
+         std::map<token_key, uint32_t>             _token_index;
+         std::vector<pool>                         _pools;
+         std::unordered_map<uint64_t, uint32_t>    _pool_index;
+         std::vector<std::vector<edge>>            _edges;         // outgoing, per token
+         std::vector<std::vector<edge>>            _into;          // incoming, per token
+
+   };
+}
@@ -0,0 +1,192 @@
+/**
+ *  @file
+ *  @copyright defined in ../../../LICENSE
+ */
+
+#include <router/arbitrage.hpp>
+
+#include "../../../contracts/Common/curve.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace router {
+
+   arbitrage::arbitrage(const route_finder& finder, size_t max_length) : _finder(finder), _max_length(max_length) {
+      rebuild();
+   }
+
+   // log of the rate a marginal amount converts at, net of the fee
+   double arbitrage::log_rate(const edge& e) const {
+      const auto& p = _finder._pools[e.pool];
+      const auto& f = p.sides[e.from];
+      const auto& t = p.sides[e.to];
+      if (!p.enabled || !t.sale_enabled || f.balance <= 0 || t.balance <= 0 || p.sides[0].balance <= 0)
+         return -std::numeric_limits<double>::infinity();
+
+      double from_balance = f.balance / power10(f.precision);
+      double to_balance = t.balance / power10(t.precision);
+      double supply = p.sides[0].balance / power10(p.sides[0].precision);
+      bool cross = e.from != 0 && e.to != 0;
+
+      // the derivatives at zero of the purchase, sale and cross reserve returns
+      double rate;
+      if (e.from == 0)
+         rate = to_balance / (supply * (t.ratio / RATIO_DENOMINATOR));
+      else if (e.to == 0)
+         rate = supply * (f.ratio / RATIO_DENOMINATOR) / from_balance;
+      else
+         rate = to_balance / from_balance * (double(f.ratio) / t.ratio);
+      return std::log(rate) + std::log1p(-p.fee_factor[cross ? 2 : 1]);
+   }
+
+   // the constraints route_finder::quote puts on a path: a bought smart token ends it and a batching
+   // converter cannot pay out the last hop of a cross conversion
+   bool arbitrage::executable(const std::vector<edge>& edges) const {
+      for (size_t i = 0; i < edges.size(); ++i) {
+         bool last = i + 1 == edges.size();
+         if (edges[i].to == 0 && !last) return false;
+         if (last && edges[i].from != 0 && edges[i].to != 0 && _finder._pools[edges[i].pool].batch_window > 0) return false;
+      }
+      return true;
+   }
+
+   // simple cycles through `start` whose other tokens all come after it, so each is found once
+   void arbitrage::enumerate(uint32_t start, std::vector<edge>& path, std::vector<uint8_t>& on_path) {
+      uint32_t at = path.empty() ? start : path.back().token;
+      for (const auto& e : _finder._edges[at]) {
+         if (e.token < start) continue;
+         if (std::any_of(path.begin(), path.end(), [&](const edge& p) { return p.pool == e.pool; })) continue;
+
+         if (e.token == start) {
+            // of the rotations, keep the first the network can execute
+            path.push_back(e);
+            for (size_t r = 0; r < path.size(); ++r) {
+               std::vector<edge> rotated(path.begin() + r, path.end());
+               rotated.insert(rotated.end(), path.begin(), path.begin() + r);
+               if (executable(rotated)) {
+                  _cycles.push_back({ std::move(rotated), 0, false, std::nullopt });
+                  break;
+               }
+            }
+            path.pop_back();
+            continue;
+         }
+         if (on_path[e.token] || path.size() + 1 >= _max_length) continue;
+
+         on_path[e.token] = 1;
+         path.push_back(e);
+         enumerate(start, path, on_path);
+         path.pop_back();
+         on_path[e.token] = 0;
+      }
+   }
+
+   void arbitrage::rebuild() {
+      _cycles.clear();
+      _candidates.clear();
+      _by_pool.assign(_finder._pools.size(), {});
+
+      std::vector<edge> path;
+      std::vector<uint8_t> on_path(_finder._tokens.size(), 0);
+      for (uint32_t start = 0; start < _finder._tokens.size(); ++start)
+         enumerate(start, path, on_path);
+
+      _candidate_at.assign(_cycles.size(), -1);
+      for (uint32_t c = 0; c < _cycles.size(); ++c) {
+         for (const auto& e : _cycles[c].edges)
+            _by_pool[e.pool].push_back(c);
+         weigh(c);
+      }
+   }
+
+   void arbitrage::weigh(uint32_t cycle_index) {
+      auto& c = _cycles[cycle_index];
+      c.sized = false;
+      c.weight = 0;
+      for (const auto& e : c.edges)
+         c.weight += log_rate(e);
+
+      int32_t& at = _candidate_at[cycle_index];
+      if (c.weight > 0 && at < 0) {
+         at = int32_t(_candidates.size());
+         _candidates.push_back(cycle_index);
+      } else if (!(c.weight > 0) && at >= 0) {
+         _candidate_at[_candidates.back()] = at;
+         _candidates[at] = _candidates.back();
+         _candidates.pop_back();
+         at = -1;
+      }
+   }
+
+   void arbitrage::touched(name converter) {
+      auto itr = _finder._pool_index.find(converter.value);
+      eosio::check(itr != _finder._pool_index.end(), "unknown converter");
+      if (itr->second >= _by_pool.size()) {
+         rebuild();
+         return;
+      }
+      for (uint32_t c : _by_pool[itr->second])
+         weigh(c);
+   }
+
+   int64_t arbitrage::run(const cycle& c, int64_t amount) const {
+      for (const auto& e : c.edges) {
+         amount = _finder.convert(_finder._pools[e.pool], e.from, e.to, amount);
+         if (amount <= 0) return 0;
+      }
+      return amount;
+   }
+
+   std::optional<opportunity> arbitrage::size(const cycle& c) const {
+      const auto& first = c.edges.front();
+      auto profit = [&](int64_t amount) { return run(c, amount) - amount; };
+
+      // the payout is concave in the amount, so is the profit; no cycle can take more than the
+      // first converter holds of the token it starts in
+      int64_t lo = 1, hi = _finder._pools[first.pool].sides[first.from].balance;
+      while (hi - lo > 2) {
+         int64_t m1 = lo + (hi - lo) / 3, m2 = hi - (hi - lo) / 3;
+         if (profit(m1) < profit(m2)) lo = m1;
+         else hi = m2;
+      }
+      int64_t best = lo;
+      for (int64_t x = lo + 1; x <= hi; ++x)
+         if (profit(x) > profit(best)) best = x;
+      if (profit(best) <= 0) return {};
+
+      const auto& start = _finder._tokens[_finder._pools[first.pool].sides[first.from].token];
+      opportunity o{ start.contract, asset(best, start.currency), {}, asset(profit(best), start.currency) };
+      for (const auto& e : c.edges) {
+         const auto& t = _finder._tokens[e.token];
+         o.path.hops.push_back({ _finder._pools[e.pool].account, t.contract, t.currency });
+      }
+      o.path.expected = o.quantity + o.profit;
+      return o;
+   }
+
+   std::vector<opportunity> arbitrage::opportunities(size_t max_count) {
+      std::vector<opportunity> result;
+      for (uint32_t ci : _candidates) {
+         auto& c = _cycles[ci];
+         if (!c.sized) {
+            c.best = size(c);
+            c.sized = true;
+         }
+         if (c.best) result.push_back(*c.best);
+      }
+
+      // the cycles start in different tokens, rank them by profit over quantity
+      std::sort(result.begin(), result.end(), [](const opportunity& a, const opportunity& b) {
+         return double(a.profit.amount) / a.quantity.amount > double(b.profit.amount) / b.quantity.amount;
+      });
+      if (result.size() > max_count) result.resize(max_count);
+      return result;
+   }
+
+   transfer arbitrage::to_transfer(const opportunity& o, name receiver, double min_profit) {
+      asset min_return(o.quantity.amount + std::max<int64_t>(1, int64_t(o.profit.amount * min_profit)), o.quantity.symbol);
+      return { o.contract, o.quantity, memo(o.path, min_return, receiver) };
+   }
+}
@@ -0,0 +1,417 @@
+/**
+ *  @file
+ *  @copyright defined in ../../../LICENSE
+ */
+
+#include <router/route_finder.hpp>
+
+#include "../../../contracts/Common/curve.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+
+namespace router {
+
+   constexpr uint8_t UNMEASURED = 0xff;
+   constexpr size_t  MEASURED_HOPS = 2;
+
+   std::string route::path() const {
+      std::string p;
+      for (const auto& h : hops) {
+         if (!p.empty()) p += " ";
+         p += h.converter.to_string() + " " + h.currency.code().to_string();
+      }
+      return p;
+   }
+
+   uint32_t route_finder::token_index(name contract, symbol currency) {
+      auto [itr, inserted] = _token_index.emplace(token_key{ contract.value, currency.code().raw() }, uint32_t(_tokens.size()));
+      if (inserted) {
+         _tokens.push_back({ contract, currency });
+         _edges.emplace_back();
+         _into.emplace_back();
+      }
+      return itr->second;
+   }
+
+   std::optional<uint32_t> route_finder::find_token(name contract, symbol_code currency) const {
+      auto itr = _token_index.find({ contract.value, currency.raw() });
+      if (itr == _token_index.end()) return {};
+      return itr->second;
+   }
+
+   int route_finder::find_side(const pool& p, symbol_code currency) const {
+      for (size_t i = 0; i < p.sides.size(); ++i)
+         if (_tokens[p.sides[i].token].currency.code() == currency) return int(i);
+      return -1;
+   }
+
+   void route_finder::add_converter(const converter_snapshot& snapshot) {
+      auto [itr, inserted] = _pool_index.emplace(snapshot.account.value, uint32_t(_pools.size()));
+      uint32_t index = itr->second;
+      if (inserted) {
+         _pools.emplace_back();
+      } else {
+         for (const auto& s : _pools[index].sides) {
+            for (auto* edges : { &_edges[s.token], &_into[s.token] })
+               edges->erase(std::remove_if(edges->begin(), edges->end(), [&](const edge& e) { return e.pool == index; }), edges->end());
+         }
+      }
+
+      pool p{ snapshot.account, snapshot.enabled, snapshot.fee, { 0, calculate_fee(1, snapshot.fee, 1), calculate_fee(1, snapshot.fee, 2) },
+              snapshot.batch_window, {} };
+      p.sides.push_back({ token_index(snapshot.smart_contract, snapshot.smart_currency), snapshot.smart_currency.precision(),
+                          snapshot.smart_supply, 0, snapshot.smart_enabled });
+      for (const auto& r : snapshot.reserves)
+         p.sides.push_back({ token_index(r.contract, r.currency), r.currency.precision(), r.balance, r.ratio, r.sale_enabled });
+      _pools[index] = std::move(p);
+      link(index);
+   }
+
+   void route_finder::link(uint32_t pool_index) {
+      const auto& p = _pools[pool_index];
+      for (uint16_t from = 0; from < p.sides.size(); ++from)
+         for (uint16_t to = 0; to < p.sides.size(); ++to)
+            if (from != to && p.sides[to].sale_enabled) {
+               _edges[p.sides[from].token].push_back({ pool_index, from, to, p.sides[to].token });
+               _into[p.sides[to].token].push_back({ pool_index, from, to, p.sides[to].token });
+            }
+   }
+
+   void route_finder::update_balance(name converter, symbol_code currency, int64_t balance) {
+      auto itr = _pool_index.find(converter.value);
+      eosio::check(itr != _pool_index.end(), "unknown converter");
+      auto& p = _pools[itr->second];
+      int s = find_side(p, currency);
+      eosio::check(s > 0, "reserve not found");
+      p.sides[s].balance = balance;
+   }
+
+   void route_finder::update_supply(name converter, int64_t supply) {
+      auto itr = _pool_index.find(converter.value);
+      eosio::check(itr != _pool_index.end(), "unknown converter");
+      _pools[itr->second].sides[0].balance = supply;
+   }
+
+   // one hop of BancorConverter::convert without the price limit, 0 when it cannot be executed
+   int64_t route_finder::convert(const pool& p, uint16_t from, uint16_t to, int64_t amount) const {
+      const auto& f = p.sides[from];
+      const auto& t = p.sides[to];
+      if (!p.enabled || !t.sale_enabled || amount <= 0)
+         return 0;
+
+      bool incoming_smart_token = from == 0;
+      bool outgoing_smart_token = to == 0;
+      bool cross = !incoming_smart_token && !outgoing_smart_token;
+
+      double from_amount = amount / power10(f.precision);
+      double supply = p.sides[0].balance / power10(p.sides[0].precision);
+
+      double to_tokens;
+      if (incoming_smart_token)
+         to_tokens = calculate_sale_return(t.balance / power10(t.precision), from_amount, supply, t.ratio);
+      else if (outgoing_smart_token)
+         to_tokens = calculate_purchase_return(f.balance / power10(f.precision), from_amount, supply, f.ratio);
+      else
+         to_tokens = calculate_cross_reserve_return(f.balance / power10(f.precision), from_amount, f.ratio, t.balance / power10(t.precision), t.ratio);
+
+      to_tokens -= to_tokens * p.fee_factor[cross ? 2 : 1];
+      to_tokens = to_fixed(to_tokens, t.precision);
+      return int64_t(to_tokens * power10(t.precision));
+   }
+
+   asset route_finder::quote(const std::vector<hop>& hops, name contract, asset quantity) const {
+      asset none(0, hops.empty() ? quantity.symbol : hops.back().currency);
+      for (size_t i = 0; i < hops.size(); ++i) {
+         auto itr = _pool_index.find(hops[i].converter.value);
+         if (itr == _pool_index.end()) return none;
+         const auto& p = _pools[itr->second];
+
+         int from = find_side(p, quantity.symbol.code());
+         int to = find_side(p, hops[i].currency.code());
+         if (from < 0 || to < 0 || from == to || _tokens[p.sides[from].token].contract != contract)
+            return none;
+         // a bought smart token ends the path, and a batching converter queues a final cross conversion
+         bool last = i + 1 == hops.size();
+         if ((to == 0 && !last) || (last && from != 0 && to != 0 && p.batch_window > 0))
+            return none;
+
+         int64_t out = convert(p, from, to, quantity.amount);
+         if (out <= 0) return none;
+         contract = _tokens[p.sides[to].token].contract;
+         quantity = asset(out, _tokens[p.sides[to].token].currency);
+      }
+      return quantity;
+   }
+
+   void route_finder::apply(const std::vector<hop>& hops, name contract, asset quantity) {
+      for (const auto& h : hops) {
+         auto itr = _pool_index.find(h.converter.value);
+         eosio::check(itr != _pool_index.end(), "unknown converter");
+         auto& p = _pools[itr->second];
+
+         int from = find_side(p, quantity.symbol.code());
+         int to = find_side(p, h.currency.code());
+         eosio::check(from >= 0 && to >= 0 && from != to && _tokens[p.sides[from].token].contract == contract, "invalid hop");
+         int64_t out = convert(p, from, to, quantity.amount);
+
+         // the smart side's balance is the supply: sold smart tokens are retired, bought ones issued
+         p.sides[from].balance += from == 0 ? -quantity.amount : quantity.amount;
+         p.sides[to].balance += to == 0 ? out : -out;
+         contract = _tokens[p.sides[to].token].contract;
+         quantity = asset(out, _tokens[p.sides[to].token].currency);
+      }
+   }
+
+   // the search state of the calling thread, const queries on one route_finder may run concurrently
+   route_finder::scratch& route_finder::scratch_space() const {
+      thread_local scratch sc;
+      if (sc.open.size() < _tokens.size()) sc.open.resize(_tokens.size(), -1);
+      if (sc.excluded.size() < _pools.size()) sc.excluded.resize(_pools.size(), 0);
+      return sc;
+   }
+
+   bool route_finder::uses(const scratch& sc, int32_t state_index, uint32_t pool_index) const {
+      for (; sc.states[state_index].parent >= 0; state_index = sc.states[state_index].parent)
+         if (sc.states[state_index].via.pool == pool_index) return true;
+      return false;
+   }
+
+   // breadth first from the target over the incoming edges, up to `depth` hops; the outer rings hold
+   // most of the graph and cost more to walk than the few states they would prune
+   void route_finder::measure_distances(scratch& sc, uint32_t target, size_t depth) const {
+      sc.distance.assign(_tokens.size(), UNMEASURED);
+      sc.distance[target] = 0;
+      sc.queue.assign(1, target);
+      for (size_t head = 0; head < sc.queue.size(); ++head) {
+         uint32_t t = sc.queue[head];
+         if (sc.distance[t] >= depth) break;
+         for (const auto& e : _into[t]) {
+            uint32_t source = _pools[e.pool].sides[e.from].token;
+            if (sc.distance[source] == UNMEASURED) {
+               sc.distance[source] = sc.distance[t] + 1;
+               sc.queue.push_back(source);
+            }
+         }
+      }
+   }
+
+   std::optional<route> route_finder::best_route(name contract, asset quantity, name to_contract, symbol_code to, size_t max_hops) const {
+      auto& sc = scratch_space();
+      auto start = find_token(contract, quantity.symbol.code());
+      auto target = find_token(to_contract, to);
+      if (!start || !target || *start == *target || max_hops == 0)
+         return {};
+
+      size_t measured = std::min(max_hops - 1, MEASURED_HOPS);
+      measure_distances(sc, *target, measured);
+
+      sc.states.clear();
+      sc.states.push_back({ quantity.amount, *start, -1, {} });
+      sc.frontier.assign(1, 0);
+      int32_t best = -1;
+
+      for (size_t h = 1; h <= max_hops && !sc.frontier.empty(); ++h) {
+         sc.next.clear();
+         for (int32_t s : sc.frontier) {
+            for (const auto& e : _edges[sc.states[s].token]) {
+               uint32_t t = e.token;
+               // only tokens from which the target is still in reach are worth pricing
+               size_t left = max_hops - h;
+               bool out_of_reach = sc.distance[t] == UNMEASURED ? left <= measured : sc.distance[t] > left;
+               if (t != *target && (e.to == 0 || out_of_reach))
+                  continue;
+               const auto& p = _pools[e.pool];
+               if ((t == *target && e.from != 0 && e.to != 0 && p.batch_window > 0) || sc.excluded[e.pool])
+                  continue;
+               if (uses(sc, s, e.pool)) continue;
+
+               int64_t out = convert(p, e.from, e.to, sc.states[s].amount);
+               if (out <= 0) continue;
+
+               int32_t& open = sc.open[t];
+               bool finishes = t == *target && (best < 0 || out > sc.states[best].amount);
+               bool extends = t != *target && (open < 0 || out > sc.states[open].amount);
+               if (!finishes && !extends) continue;
+
+               int32_t index = int32_t(sc.states.size());
+               sc.states.push_back({ out, t, s, e });
+               if (finishes) best = index;
+               if (extends) {
+                  if (open < 0) sc.next.push_back(int32_t(t));
+                  open = index;
+               }
+            }
+         }
+
+         // next holds the tokens reached, swap in their best states and reset open for the next hop count
+         sc.frontier.clear();
+         for (int32_t t : sc.next) {
+            sc.frontier.push_back(sc.open[t]);
+            sc.open[t] = -1;
+         }
+      }
+
+      if (best < 0)
+         return {};
+
+      route r;
+      r.expected = asset(sc.states[best].amount, _tokens[*target].currency);
+      for (int32_t s = best; sc.states[s].parent >= 0; s = sc.states[s].parent) {
+         const auto& e = sc.states[s].via;
+         const auto& t = _tokens[_pools[e.pool].sides[e.to].token];
+         r.hops.push_back({ _pools[e.pool].account, t.contract, t.currency });
+      }
+      std::reverse(r.hops.begin(), r.hops.end());
+      return r;
+   }
+
+   std::vector<route> route_finder::disjoint_routes(name contract, asset quantity, name to_contract, symbol_code to,
+                                                    size_t max_routes, size_t max_hops) const {
+      auto& sc = scratch_space();
+      std::vector<route> routes;
+      asset probe(std::max<int64_t>(1, quantity.amount / int64_t(std::max<size_t>(1, max_routes))), quantity.symbol);
+      while (routes.size() < max_routes) {
+         auto r = best_route(contract, probe, to_contract, to, max_hops);
+         if (!r) break;
+         for (const auto& h : r->hops)
+            sc.excluded[_pool_index.at(h.converter.value)] = 1;
+         routes.push_back(std::move(*r));
+      }
+      std::fill(sc.excluded.begin(), sc.excluded.end(), 0);
+      return routes;
+   }
+
+   std::vector<route_finder::edge> route_finder::resolve(const std::vector<hop>& hops, name contract, symbol_code currency) const {
+      std::vector<edge> edges;
+      for (const auto& h : hops) {
+         auto itr = _pool_index.find(h.converter.value);
+         eosio::check(itr != _pool_index.end(), "unknown converter");
+         const auto& p = _pools[itr->second];
+         int from = find_side(p, currency);
+         int to = find_side(p, h.currency.code());
+         eosio::check(from >= 0 && to >= 0 && from != to && _tokens[p.sides[from].token].contract == contract, "invalid hop");
+         edges.push_back({ itr->second, uint16_t(from), uint16_t(to), p.sides[to].token });
+         contract = h.contract;
+         currency = h.currency.code();
+      }
+      return edges;
+   }
+
+   // convert() over an array of amounts, in place. Each step is its own loop over the array so the
+   // compiler can vectorise the ones free of libm calls: the scaling, the fee and rounding and, where the
+   // curve's exponent is 1 (reserves of equal ratio, or a 100% ratio to or from the smart token), the
+   // whole conversion; the other curves call pow per amount and stay scalar
+   void route_finder::convert_batch(const pool& p, uint16_t from, uint16_t to, int64_t* amounts, size_t n) const {
+      auto& sc = scratch_space();
+      const auto& f = p.sides[from];
+      const auto& t = p.sides[to];
+      if (!p.enabled || !t.sale_enabled) {
+         std::fill(amounts, amounts + n, 0);
+         return;
+      }
+
+      sc.values.resize(n);
+      double* x = sc.values.data();
+      const double from_scale = power10(f.precision);
+      const double to_scale = power10(t.precision);
+      const double from_balance = f.balance / from_scale;
+      const double to_balance = t.balance / to_scale;
+      const double supply = p.sides[0].balance / power10(p.sides[0].precision);
+      const bool cross = from != 0 && to != 0;
+      const double fee_factor = p.fee_factor[cross ? 2 : 1];
+
+      for (size_t i = 0; i < n; ++i)
+         x[i] = amounts[i] / from_scale;
+
+      if (cross && f.ratio == t.ratio) {
+         for (size_t i = 0; i < n; ++i)
+            x[i] = quick_convert(from_balance, x[i], to_balance);
+      } else if (cross) {
+         for (size_t i = 0; i < n; ++i)
+            x[i] = calculate_cross_reserve_return(from_balance, x[i], f.ratio, to_balance, t.ratio);
+      } else if (from == 0 && t.ratio == RATIO_DENOMINATOR) {
+         // calculate_sale_return with pow(y, 1) == y, the same operations so the result is the same
+         for (size_t i = 0; i < n; ++i)
+            x[i] = to_balance * (1.0 - (1.0 - x[i] / supply));
+      } else if (from == 0) {
+         for (size_t i = 0; i < n; ++i)
+            x[i] = calculate_sale_return(to_balance, x[i], supply, t.ratio);
+      } else if (f.ratio == RATIO_DENOMINATOR) {
+         for (size_t i = 0; i < n; ++i)
+            x[i] = -supply * (1.0 - (1.0 + x[i] / from_balance));
+      } else {
+         for (size_t i = 0; i < n; ++i)
+            x[i] = calculate_purchase_return(from_balance, x[i], supply, f.ratio);
+      }
+
+      for (size_t i = 0; i < n; ++i)
+         x[i] = to_fixed(x[i] - x[i] * fee_factor, t.precision) * to_scale;
+
+      // double to int64 has no vector instruction before AVX-512
+      for (size_t i = 0; i < n; ++i)
+         amounts[i] = amounts[i] > 0 ? int64_t(x[i]) : 0;
+   }
+
+   split_order route_finder::split_across(const std::vector<route>& routes, name contract, asset quantity, size_t steps) const {
+      split_order order;
+      if (routes.empty())
+         return order;
+      order.expected = asset(0, routes.front().expected.symbol);
+      steps = std::max<size_t>(1, std::min<size_t>(steps, quantity.amount));
+      const int64_t part = quantity.amount / int64_t(steps);
+
+      // payout[r * (steps + 1) + k]: what route r pays for k parts
+      std::vector<int64_t> payout(routes.size() * (steps + 1));
+      for (size_t r = 0; r < routes.size(); ++r) {
+         int64_t* amounts = &payout[r * (steps + 1)];
+         for (size_t k = 0; k <= steps; ++k)
+            amounts[k] = int64_t(k) * part;
+         for (const auto& e : resolve(routes[r].hops, contract, quantity.symbol.code()))
+            convert_batch(_pools[e.pool], e.from, e.to, amounts, steps + 1);
+      }
+
+      // the payouts are concave in the amount, handing out parts by the largest gain is optimal
+      std::vector<size_t> taken(routes.size(), 0);
+      auto gain = [&](size_t r) {
+         return taken[r] == steps ? INT64_MIN : payout[r * (steps + 1) + taken[r] + 1] - payout[r * (steps + 1) + taken[r]];
+      };
+      auto best = [&]() {
+         size_t b = 0;
+         for (size_t r = 1; r < routes.size(); ++r)
+            if (gain(r) > gain(b)) b = r;
+         return b;
+      };
+      for (size_t k = 0; k < steps; ++k)
+         ++taken[best()];
+
+      // what does not divide into parts goes to the route that would have taken the next one
+      size_t rest = best();
+      for (size_t r = 0; r < routes.size(); ++r) {
+         int64_t amount = int64_t(taken[r]) * part + (r == rest ? quantity.amount - int64_t(steps) * part : 0);
+         if (amount <= 0)
+            continue;
+         asset q(amount, quantity.symbol);
+         route path{ routes[r].hops, quote(routes[r].hops, contract, q) };
+         order.expected += path.expected;
+         order.splits.push_back({ std::move(path), q });
+      }
+      return order;
+   }
+
+   std::vector<transfer> transfers(const split_order& order, name contract, name receiver, double slippage) {
+      std::vector<transfer> result;
+      for (const auto& s : order.splits) {
+         const auto& expected = s.path.expected;
+         result.push_back({ contract, s.quantity, memo(s.path, asset(int64_t(expected.amount * (1 - slippage)), expected.symbol), receiver) });
+      }
+      return result;
+   }
+
+   std::string memo(const route& path, asset min_return, name receiver) {
+      char amount[32];
+      snprintf(amount, sizeof(amount), "%.*f", int(min_return.symbol.precision()), min_return.amount / power10(min_return.symbol.precision()));
+      return "1," + path.path() + "," + amount + "," + receiver.to_string();
+   }
+}
@@ -0,0 +1,117 @@
+/**
+ *  @file
+ *  @copyright defined in ../../../../LICENSE
+ */
+#pragma once
+
+#include <eosio/asset.hpp>
+#include <eosio/name.hpp>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace swaptrace {
+
+   using eosio::asset;
+   using eosio::name;
+   using eosio::symbol;
+
+   /**
+    * @brief one cross reserve conversion as the converter logs it to `swapsdata::log`, the `from` and
+    * `to` fields are its two `swap_record`s
+    */
+   struct swap {
+      uint32_t timestamp = 0;   // block time, seconds since the epoch
+      name     converter;
+      asset    from;
+      asset    to;
+      double   from_price = 0;
+      double   to_price = 0;
+      int64_t  from_depth = 0;   // liquidity_depth, in the symbol of `from`
+      int64_t  to_depth = 0;
+      double   from_smart_price = 0;
+      double   to_smart_price = 0;
+   };
+
+   /**
+    * @brief the columns of a block of rows, pointing into the mapped file
+    */
+   struct block_view {
+      size_t          rows = 0;
+      const uint32_t* timestamp = nullptr;
+      const uint64_t* converter = nullptr;
+      const uint64_t* from_symbol = nullptr;   // symbol::raw(), precision included
+      const uint64_t* to_symbol = nullptr;
+      const int64_t*  from_amount = nullptr;
+      const int64_t*  to_amount = nullptr;
+      const double*   from_price = nullptr;
+      const double*   to_price = nullptr;
+      const int64_t*  from_depth = nullptr;
+      const int64_t*  to_depth = nullptr;
+      const double*   from_smart_price = nullptr;
+      const double*   to_smart_price = nullptr;
+
+      swap row(size_t i) const;
+   };
+
+   /**
+    * @brief streams swaps into a columnar trace file
+    * @details the file is a series of blocks of up to `rows_per_block` rows followed by an index of
+    * the blocks. A block holds each column as one array, little endian, 8 byte aligned, so a reader
+    * can map the file and scan a column in place:
+    *
+    *    "SWPTRC01" block... index{offset, rows}... block_count total_rows "SWPTRC01"
+    */
+   class writer {
+      public:
+         explicit writer(const std::string& path, size_t rows_per_block = 65536);
+         ~writer();
+
+         writer(const writer&) = delete;
+         writer& operator=(const writer&) = delete;
+
+         void append(const swap& s);
+
+         /**
+          * @brief writes the last block and the index, the file is incomplete until then
+          */
+         void close();
+
+         size_t rows() const { return _total; }
+
+      private:
+         void flush_block();
+
+         FILE*                                   _file = nullptr;
+         size_t                                  _rows_per_block;
+         size_t                                  _total = 0;
+         uint64_t                                _offset = 0;
+         std::vector<std::pair<uint64_t, uint64_t>> _index;   // offset, rows
+         std::vector<swap>                       _pending;
+   };
+
+   /**
+    * @brief a trace file mapped read only; the blocks' columns point into the mapping
+    */
+   class reader {
+      public:
+         explicit reader(const std::string& path);
+         ~reader();
+
+         reader(const reader&) = delete;
+         reader& operator=(const reader&) = delete;
+
+         size_t rows() const { return _total; }
+         size_t block_count() const { return _blocks.size(); }
+         const block_view& block(size_t i) const { return _blocks[i]; }
+         const std::vector<block_view>& blocks() const { return _blocks; }
+         size_t bytes() const { return _size; }
+
+      private:
+         const char*             _data = nullptr;
+         size_t                  _size = 0;
+         size_t                  _total = 0;
+         std::vector<block_view> _blocks;
+   };
+}
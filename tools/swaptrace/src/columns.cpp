@@ -0,0 +1,152 @@
+/**
+ *  @file
+ *  @copyright defined in ../../../LICENSE
+ */
+
+#include <swaptrace/columns.hpp>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstring>
+
+namespace swaptrace {
+
+   static const char MAGIC[8] = { 'S', 'W', 'P', 'T', 'R', 'C', '0', '1' };
+
+   // the bytes of a column of `rows` values of `width` bytes, padded to keep the next one aligned
+   static size_t column_bytes(size_t rows, size_t width) { return (rows * width + 7) & ~size_t(7); }
+
+   swap block_view::row(size_t i) const {
+      return { timestamp[i], name(converter[i]), asset(from_amount[i], symbol(from_symbol[i])), asset(to_amount[i], symbol(to_symbol[i])),
+               from_price[i], to_price[i], from_depth[i], to_depth[i], from_smart_price[i], to_smart_price[i] };
+   }
+
+   writer::writer(const std::string& path, size_t rows_per_block) : _rows_per_block(rows_per_block) {
+      _file = fopen(path.c_str(), "wb");
+      eosio::check(_file != nullptr, "cannot create " + path);
+      fwrite(MAGIC, 1, sizeof(MAGIC), _file);
+      _offset = sizeof(MAGIC);
+      _pending.reserve(rows_per_block);
+   }
+
+   writer::~writer() {
+      if (_file) close();
+   }
+
+   void writer::append(const swap& s) {
+      _pending.push_back(s);
+      if (_pending.size() == _rows_per_block)
+         flush_block();
+   }
+
+   void writer::flush_block() {
+      if (_pending.empty())
+         return;
+      size_t n = _pending.size();
+      std::vector<char> buffer;
+
+      // one pass over the pending rows per column
+      auto column = [&](size_t width, auto get) {
+         size_t start = buffer.size();
+         buffer.resize(start + column_bytes(n, width), 0);
+         for (size_t i = 0; i < n; ++i) {
+            auto v = get(_pending[i]);
+            static_assert(std::is_trivially_copyable_v<decltype(v)>);
+            memcpy(&buffer[start + i * width], &v, width);
+         }
+      };
+      column(4, [](const swap& s) { return s.timestamp; });
+      column(8, [](const swap& s) { return s.converter.value; });
+      column(8, [](const swap& s) { return s.from.symbol.raw(); });
+      column(8, [](const swap& s) { return s.to.symbol.raw(); });
+      column(8, [](const swap& s) { return s.from.amount; });
+      column(8, [](const swap& s) { return s.to.amount; });
+      column(8, [](const swap& s) { return s.from_price; });
+      column(8, [](const swap& s) { return s.to_price; });
+      column(8, [](const swap& s) { return s.from_depth; });
+      column(8, [](const swap& s) { return s.to_depth; });
+      column(8, [](const swap& s) { return s.from_smart_price; });
+      column(8, [](const swap& s) { return s.to_smart_price; });
+
+      fwrite(buffer.data(), 1, buffer.size(), _file);
+      _index.push_back({ _offset, n });
+      _offset += buffer.size();
+      _total += n;
+      _pending.clear();
+   }
+
+   void writer::close() {
+      flush_block();
+      for (const auto& [offset, rows] : _index) {
+         fwrite(&offset, sizeof(offset), 1, _file);
+         fwrite(&rows, sizeof(rows), 1, _file);
+      }
+      uint64_t count = _index.size(), total = _total;
+      fwrite(&count, sizeof(count), 1, _file);
+      fwrite(&total, sizeof(total), 1, _file);
+      fwrite(MAGIC, 1, sizeof(MAGIC), _file);
+      eosio::check(fclose(_file) == 0, "cannot write the trace file");
+      _file = nullptr;
+   }
+
+   reader::reader(const std::string& path) {
+      int fd = open(path.c_str(), O_RDONLY);
+      eosio::check(fd >= 0, "cannot open " + path);
+      struct stat st;
+      fstat(fd, &st);
+      _size = st.st_size;
+      if (_size > 0) {
+         void* p = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+         eosio::check(p != MAP_FAILED, "cannot map " + path);
+         _data = static_cast<const char*>(p);
+         madvise(p, _size, MADV_SEQUENTIAL);
+      }
+      ::close(fd);
+
+      const size_t trailer = 2 * sizeof(uint64_t) + sizeof(MAGIC);
+      eosio::check(_size >= sizeof(MAGIC) + trailer && memcmp(_data, MAGIC, sizeof(MAGIC)) == 0 &&
+                   memcmp(_data + _size - sizeof(MAGIC), MAGIC, sizeof(MAGIC)) == 0, path + " is not a complete swap trace");
+      uint64_t count, total;
+      memcpy(&count, _data + _size - trailer, sizeof(count));
+      memcpy(&total, _data + _size - trailer + sizeof(count), sizeof(total));
+      eosio::check(count * 16 + trailer + sizeof(MAGIC) <= _size, path + " has a corrupt index");
+      _total = total;
+
+      const char* index = _data + _size - trailer - count * 16;
+      for (uint64_t b = 0; b < count; ++b) {
+         uint64_t offset, rows;
+         memcpy(&offset, index + b * 16, sizeof(offset));
+         memcpy(&rows, index + b * 16 + 8, sizeof(rows));
+
+         const char* at = _data + offset;
+         auto next = [&](size_t width) {
+            const char* column = at;
+            at += column_bytes(rows, width);
+            return column;
+         };
+         block_view v;
+         v.rows = rows;
+         v.timestamp = reinterpret_cast<const uint32_t*>(next(4));
+         v.converter = reinterpret_cast<const uint64_t*>(next(8));
+         v.from_symbol = reinterpret_cast<const uint64_t*>(next(8));
+         v.to_symbol = reinterpret_cast<const uint64_t*>(next(8));
+         v.from_amount = reinterpret_cast<const int64_t*>(next(8));
+         v.to_amount = reinterpret_cast<const int64_t*>(next(8));
+         v.from_price = reinterpret_cast<const double*>(next(8));
+         v.to_price = reinterpret_cast<const double*>(next(8));
+         v.from_depth = reinterpret_cast<const int64_t*>(next(8));
+         v.to_depth = reinterpret_cast<const int64_t*>(next(8));
+         v.from_smart_price = reinterpret_cast<const double*>(next(8));
+         v.to_smart_price = reinterpret_cast<const double*>(next(8));
+         eosio::check(at <= index, path + " has a block past its index");
+         _blocks.push_back(v);
+      }
+   }
+
+   reader::~reader() {
+      if (_data) munmap(const_cast<char*>(_data), _size);
+   }
+}
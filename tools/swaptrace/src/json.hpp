@@ -0,0 +1,136 @@
+/**
+ *  @file
+ *  @copyright defined in ../../../LICENSE
+ *
+ *  Just enough JSON for action traces: objects, arrays, strings (escapes other than \uXXXX kept as
+ *  the escaped character), numbers, true/false/null.
+ */
+#pragma once
+
+#include <eosio/check.hpp>
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace swaptrace {
+
+   struct json {
+      enum kind_t { null, boolean, number, string, array, object };
+
+      kind_t                                    kind = null;
+      bool                                      flag = false;
+      double                                    value = 0;
+      std::string                               text;     // strings, and numbers as written
+      std::vector<json>                         items;
+      std::vector<std::pair<std::string, json>> fields;
+
+      const json* find(std::string_view key) const {
+         for (const auto& [k, v] : fields)
+            if (k == key) return &v;
+         return nullptr;
+      }
+   };
+
+   class json_parser {
+      public:
+         explicit json_parser(std::string_view in) : _in(in) {}
+
+         json parse() {
+            json j = value();
+            skip();
+            eosio::check(_pos == _in.size(), "trailing characters after JSON value");
+            return j;
+         }
+
+      private:
+         void skip() {
+            while (_pos < _in.size() && (_in[_pos] == ' ' || _in[_pos] == '\t' || _in[_pos] == '\n' || _in[_pos] == '\r')) ++_pos;
+         }
+
+         char peek() {
+            skip();
+            eosio::check(_pos < _in.size(), "unexpected end of JSON");
+            return _in[_pos];
+         }
+
+         void expect(char c) {
+            eosio::check(peek() == c, std::string("expected '") + c + "' in JSON");
+            ++_pos;
+         }
+
+         std::string string_value() {
+            expect('"');
+            std::string out;
+            while (_pos < _in.size() && _in[_pos] != '"') {
+               char c = _in[_pos++];
+               if (c == '\\' && _pos < _in.size()) {
+                  c = _in[_pos++];
+                  if (c == 'n') c = '\n';
+                  else if (c == 't') c = '\t';
+                  else if (c == 'u') { _pos += 4; c = '?'; }
+               }
+               out += c;
+            }
+            expect('"');
+            return out;
+         }
+
+         json value() {
+            json j;
+            char c = peek();
+            if (c == '{') {
+               j.kind = json::object;
+               ++_pos;
+               if (peek() == '}') { ++_pos; return j; }
+               for (;;) {
+                  auto key = string_value();
+                  expect(':');
+                  j.fields.emplace_back(std::move(key), value());
+                  if (peek() == ',') { ++_pos; continue; }
+                  expect('}');
+                  return j;
+               }
+            }
+            if (c == '[') {
+               j.kind = json::array;
+               ++_pos;
+               if (peek() == ']') { ++_pos; return j; }
+               for (;;) {
+                  j.items.push_back(value());
+                  if (peek() == ',') { ++_pos; continue; }
+                  expect(']');
+                  return j;
+               }
+            }
+            if (c == '"') {
+               j.kind = json::string;
+               j.text = string_value();
+               return j;
+            }
+            for (auto [word, kind, flag] : { std::tuple{ "true", json::boolean, true }, std::tuple{ "false", json::boolean, false },
+                                             std::tuple{ "null", json::null, false } }) {
+               if (_in.substr(_pos, strlen(word)) == word) {
+                  _pos += strlen(word);
+                  j.kind = kind;
+                  j.flag = flag;
+                  return j;
+               }
+            }
+            size_t start = _pos;
+            while (_pos < _in.size() && strchr("+-0123456789.eE", _in[_pos])) ++_pos;
+            eosio::check(_pos > start, "unexpected character in JSON");
+            j.kind = json::number;
+            j.text = std::string(_in.substr(start, _pos - start));
+            j.value = strtod(j.text.c_str(), nullptr);
+            return j;
+         }
+
+         std::string_view _in;
+         size_t           _pos = 0;
+   };
+}
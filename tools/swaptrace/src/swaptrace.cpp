@@ -0,0 +1,209 @@
+/**
+ *  @file
+ *  @copyright defined in ../../../LICENSE
+ *
+ *  Converts action traces of `swapsdata::log` into the columnar swap trace format and scans it.
+ *
+ *  The input has one action trace per line, as `get_actions` (v1 history) or a state history
+ *  consumer prints them: an object with `act` {account, name, data} and `block_time`, or one wrapping
+ *  it in `action_trace`. Other actions and the notifications of other receivers are skipped.
+ *
+ *  usage: swaptrace convert <traces.json|-> <out.swt> [--account data.tbn] [--block-rows 65536]
+ *         swaptrace scan <file.swt>
+ *         swaptrace dump <file.swt> [rows]
+ */
+
+#include <swaptrace/columns.hpp>
+
+#include "json.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+
+using namespace swaptrace;
+using namespace eosio::literals;
+
+namespace {
+
+   asset parse_asset(const std::string& text) {
+      auto space = text.find(' ');
+      eosio::check(space != std::string::npos, "malformed asset " + text);
+      std::string amount = text.substr(0, space);
+      auto dot = amount.find('.');
+      uint8_t precision = dot == std::string::npos ? 0 : amount.size() - dot - 1;
+      if (dot != std::string::npos) amount.erase(dot, 1);
+      return asset(std::stoll(amount), symbol(text.substr(space + 1), precision));
+   }
+
+   // doubles come as numbers or, from abi serialisers that keep their precision, as strings
+   double number(const json* j) {
+      eosio::check(j != nullptr, "missing number");
+      return j->kind == json::number ? j->value : std::stod(j->text);
+   }
+
+   uint32_t parse_time(const std::string& iso) {
+      tm t{};
+      eosio::check(strptime(iso.c_str(), "%Y-%m-%dT%H:%M:%S", &t) != nullptr, "malformed time " + iso);
+      return timegm(&t);
+   }
+
+   const json& field(const json& j, std::string_view key) {
+      auto f = j.find(key);
+      eosio::check(f != nullptr, "missing " + std::string(key));
+      return *f;
+   }
+
+   /**
+    * @brief the swap of a `log` trace of `account`, false for any other trace
+    */
+   bool to_swap(const json& line, name account, swap& s) {
+      const json& trace = line.find("action_trace") ? *line.find("action_trace") : line;
+      auto act = trace.find("act");
+      if (!act || field(*act, "name").text != "log" || name(field(*act, "account").text) != account)
+         return false;
+      // notifications of the action carry the same data, keep the trace of the contract itself
+      auto receiver = trace.find("receiver");
+      if (!receiver && trace.find("receipt")) receiver = trace.find("receipt")->find("receiver");
+      if (receiver && name(receiver->text) != account)
+         return false;
+
+      auto time = trace.find("block_time") ? trace.find("block_time") : line.find("block_time");
+      eosio::check(time != nullptr, "trace without block_time");
+
+      const json& data = field(*act, "data");
+      const json& records = field(data, "swap_data");
+      eosio::check(records.items.size() == 2, "a log holds the from and the to record");
+      const json& from = records.items[0];
+      const json& to = records.items[1];
+
+      s.timestamp = parse_time(time->text);
+      s.converter = name(field(data, "converter").text);
+      s.from = parse_asset(field(from, "quantity").text);
+      s.to = parse_asset(field(to, "quantity").text);
+      s.from_price = number(from.find("price"));
+      s.to_price = number(to.find("price"));
+      s.from_depth = parse_asset(field(from, "liquidity_depth").text).amount;
+      s.to_depth = parse_asset(field(to, "liquidity_depth").text).amount;
+      s.from_smart_price = number(from.find("smart_price"));
+      s.to_smart_price = number(to.find("smart_price"));
+      return true;
+   }
+
+   int convert(const std::string& in_path, const std::string& out_path, name account, size_t block_rows) {
+      std::ifstream file;
+      if (in_path != "-") {
+         file.open(in_path);
+         eosio::check(file.is_open(), "cannot open " + in_path);
+      }
+      std::istream& in = in_path == "-" ? std::cin : file;
+
+      writer out(out_path, block_rows);
+      size_t lines = 0, skipped = 0;
+      std::string line;
+      auto start = std::chrono::steady_clock::now();
+      while (std::getline(in, line)) {
+         ++lines;
+         if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+         swap s;
+         try {
+            if (to_swap(json_parser(line).parse(), account, s)) out.append(s);
+            else ++skipped;
+         } catch (const std::exception& e) {
+            throw std::runtime_error("line " + std::to_string(lines) + ": " + e.what());
+         }
+      }
+      out.close();
+      auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      printf("%zu lines, %zu swaps, %zu other traces skipped, %.0f lines/s\n", lines, out.rows(), skipped, lines / elapsed);
+      return 0;
+   }
+
+   // a handful of keys seen over and over: a linear table with the last hit cached
+   struct tally {
+      std::vector<std::pair<uint64_t, int64_t>> entries;
+      size_t                                    last = 0;
+
+      int64_t& operator[](uint64_t key) {
+         if (last < entries.size() && entries[last].first == key) return entries[last].second;
+         for (last = 0; last < entries.size(); ++last)
+            if (entries[last].first == key) return entries[last].second;
+         entries.push_back({ key, 0 });
+         return entries.back().second;
+      }
+   };
+
+   /**
+    * @brief per converter swap counts and per symbol volumes, straight off the mapped columns, one
+    * column at a time
+    */
+   int scan(const std::string& path) {
+      auto start = std::chrono::steady_clock::now();
+      reader r(path);
+      tally swaps, volume;   // per converter; per symbol, in and out
+      uint32_t first = UINT32_MAX, last = 0;
+      for (const auto& b : r.blocks()) {
+         for (size_t i = 0; i < b.rows; ++i) {
+            first = std::min(first, b.timestamp[i]);
+            last = std::max(last, b.timestamp[i]);
+         }
+         for (size_t i = 0; i < b.rows; ++i) ++swaps[b.converter[i]];
+         for (size_t i = 0; i < b.rows; ++i) volume[b.from_symbol[i]] += b.from_amount[i];
+         for (size_t i = 0; i < b.rows; ++i) volume[b.to_symbol[i]] += b.to_amount[i];
+      }
+      auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+      printf("%zu swaps in %zu blocks, %u to %u\n", r.rows(), r.block_count(), first, last);
+      for (const auto& [converter, n] : swaps.entries)
+         printf("  %-13s %lld swaps\n", name(converter).to_string().c_str(), (long long)n);
+      for (const auto& [sym, amount] : volume.entries)
+         printf("  %s traded\n", asset(amount, symbol(sym)).to_string().c_str());
+      printf("scanned %.1f MB in %.3f ms, %.2f GB/s\n", r.bytes() / 1e6, elapsed * 1e3, r.bytes() / elapsed / 1e9);
+      return 0;
+   }
+
+   int dump(const std::string& path, size_t limit) {
+      reader r(path);
+      size_t printed = 0;
+      for (const auto& b : r.blocks()) {
+         for (size_t i = 0; i < b.rows && printed < limit; ++i, ++printed) {
+            auto s = b.row(i);
+            printf("%u %s %s -> %s price %.8g/%.8g depth %lld/%lld smart price %.8g/%.8g\n", s.timestamp, s.converter.to_string().c_str(),
+                   s.from.to_string().c_str(), s.to.to_string().c_str(), s.from_price, s.to_price, (long long)s.from_depth,
+                   (long long)s.to_depth, s.from_smart_price, s.to_smart_price);
+         }
+      }
+      return 0;
+   }
+}
+
+int main(int argc, char** argv) {
+   try {
+      std::string command = argc > 1 ? argv[1] : "";
+      if (command == "convert" && argc >= 4) {
+         name account = "data.tbn"_n;
+         size_t block_rows = 65536;
+         for (int i = 4; i + 1 < argc; i += 2) {
+            std::string flag = argv[i], value = argv[i + 1];
+            if      (flag == "--account")    account = name(value);
+            else if (flag == "--block-rows") block_rows = std::stoul(value);
+            else eosio::check(false, "unknown option " + flag);
+         }
+         return convert(argv[2], argv[3], account, block_rows);
+      }
+      if (command == "scan" && argc == 3)
+         return scan(argv[2]);
+      if (command == "dump" && argc >= 3)
+         return dump(argv[2], argc > 3 ? std::stoul(argv[3]) : 20);
+
+      fprintf(stderr, "usage: swaptrace convert <traces.json|-> <out.swt> [--account data.tbn] [--block-rows 65536]\n"
+                      "       swaptrace scan <file.swt>\n"
+                      "       swaptrace dump <file.swt> [rows]\n");
+      return 1;
+   } catch (const std::exception& e) {
+      fprintf(stderr, "%s\n", e.what());
+      return 1;
+   }
+}